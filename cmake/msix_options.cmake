@@ -21,6 +21,7 @@ option(MSIX_SAMPLES "Enables building MSIX SDK samples" ON)
 set(CMAKE_BUILD_TYPE Debug CACHE STRING "Choose the type of build, options are: None Debug Release RelWithDebInfo MinSizeRel. Use the -DCMAKE_BUILD_TYPE=[option] to specify.")
 set(XML_PARSER "" CACHE STRING "Choose the type of parser, options are: [xerces, msxml6, javaxml].  Use the -DXML_PARSER=[option] to specify.")
 set(CRYPTO_LIB "" CACHE STRING "Choose the cryptography library to use, options are: [openssl, crypt32].  Use the -DCRYPTO_LIB=[option] to specify.")
+set(DEFLATE_BACKEND "zlib" CACHE STRING "Choose the library that inflates and deflates whole blocks, options are: [zlib, libdeflate]. Use the -DDEFLATE_BACKEND=[option] to specify.")
 
 # Enforce that target platform is specified.
 if((NOT WIN32) AND (NOT MACOS) AND (NOT IOS) AND (NOT AOSP) AND (NOT LINUX))
@@ -85,6 +86,12 @@ if(MSIX_PACK)
     endif()
 endif()
 
+# Blocks of package files are at most 64KB and inflate and deflate by themselves. libdeflate does that faster
+# than zlib, streams still use the compression library.
+if(NOT ((DEFLATE_BACKEND STREQUAL "zlib") OR (DEFLATE_BACKEND STREQUAL "libdeflate")))
+    message(FATAL_ERROR "Unsupported deflate backend ${DEFLATE_BACKEND}. Use -DDEFLATE_BACKEND=[zlib|libdeflate]")
+endif()
+
 # Compression
 set(COMPRESSION_LIB "zlib")
 if(((IOS) OR (MACOS)) AND (NOT USE_MSIX_SDK_ZLIB))
@@ -116,5 +123,6 @@ else()
 endif()
 
 message(STATUS "\tCompression library = ${COMPRESSION_LIB}")
+message(STATUS "\tDeflate backend     = ${DEFLATE_BACKEND}")
 message(STATUS "\tXML Parser          = ${XML_PARSER} with validation parser ${USE_VALIDATION_PARSER}")
 message(STATUS "\tCrypto library      = ${CRYPTO_LIB}")
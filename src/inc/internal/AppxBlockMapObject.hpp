@@ -6,6 +6,7 @@
 #include <algorithm>
 #include <string>
 #include <map>
+#include <mutex>
 #include <vector>
 #include <iterator>
 
@@ -31,8 +32,13 @@ class IAppxBlockMapInternal : public IUnknown
 {
 public:
     virtual std::vector<std::string> GetFileNames() = 0;
-    virtual std::vector<MSIX::Block> GetBlocks(const std::string& fileName) = 0;
+    // The range stays valid for the lifetime of the block map.
+    virtual MSIX::BlockRange GetBlocks(const std::string& fileName) = 0;
     virtual MSIX::ComPtr<IAppxBlockMapFile> GetFile(const std::string& fileName) = 0;
+    // Returns the files and blocks in a compact binary form that AppxBlockMapObject can load without
+    // parsing AppxBlockMap.xml again.
+    virtual std::vector<std::uint8_t> GetIndex() = 0;
+    virtual bool IsLoadedFromIndex() = 0;
 };
 MSIX_INTERFACE(IAppxBlockMapInternal, 0x67fed21a,0x70ef,0x4175,0x8f,0x12,0x41,0x5b,0x21,0x3a,0xb6,0xd2);
 
@@ -41,7 +47,7 @@ namespace MSIX {
     class AppxBlockMapBlock final : public MSIX::ComClass<AppxBlockMapBlock, IAppxBlockMapBlock>
     {
     public:
-        AppxBlockMapBlock(IMsixFactory* factory, Block* block) :
+        AppxBlockMapBlock(IMsixFactory* factory, const Block* block) :
             m_factory(factory),
             m_block(block)
         {}
@@ -49,7 +55,8 @@ namespace MSIX {
         // IAppxBlockMapBlock
         HRESULT STDMETHODCALLTYPE GetHash(UINT32* bufferSize, BYTE** buffer) noexcept override try
         {
-            ThrowHrIfFailed(m_factory->MarshalOutBytes(m_block->hash, bufferSize, buffer));
+            std::vector<std::uint8_t> hash(m_block->hash.begin(), m_block->hash.end());
+            ThrowHrIfFailed(m_factory->MarshalOutBytes(hash, bufferSize, buffer));
             return static_cast<HRESULT>(Error::OK);
         } CATCH_RETURN();
 
@@ -62,7 +69,7 @@ namespace MSIX {
 
     private:
         IMsixFactory* m_factory;
-        Block*        m_block;
+        const Block*  m_block;
     };
 
     class AppxBlockMapFile final : public MSIX::ComClass<AppxBlockMapFile, IAppxBlockMapFile, IAppxBlockMapFileUtf8 >
@@ -70,7 +77,7 @@ namespace MSIX {
     public:
         AppxBlockMapFile(
             IMsixFactory* factory,
-            std::vector<Block>* blocks,
+            const BlockRange& blocks,
             std::uint32_t localFileHeaderSize,
             const std::string& name,
             std::uint64_t uncompressedSize
@@ -88,10 +95,10 @@ namespace MSIX {
         {
             ThrowErrorIf(Error::InvalidParameter, (blocks == nullptr || *blocks != nullptr), "bad pointer.");
             if (m_blockMapBlocks.empty())
-            {   m_blockMapBlocks.reserve(m_blocks->size());
+            {   m_blockMapBlocks.reserve(m_blocks.size());
                 std::transform(
-                    m_blocks->begin(),
-                    m_blocks->end(),
+                    m_blocks.begin(),
+                    m_blocks.end(),
                     std::back_inserter(m_blockMapBlocks),
                     [&](auto& item){
                         return ComPtr<IAppxBlockMapBlock>::Make<AppxBlockMapBlock>(m_factory, &item);
@@ -137,7 +144,7 @@ namespace MSIX {
 
     private:
         std::vector<ComPtr<IAppxBlockMapBlock>> m_blockMapBlocks;
-        std::vector<Block>* m_blocks;
+        BlockRange          m_blocks;
         IMsixFactory*       m_factory;
         std::uint32_t       m_localFileHeaderSize;
         std::string         m_name;
@@ -148,7 +155,12 @@ namespace MSIX {
     class AppxBlockMapObject final : public MSIX::ComClass<AppxBlockMapObject, IAppxBlockMapReader, IVerifierObject, IAppxBlockMapInternal, IAppxBlockMapReaderUtf8 >
     {
     public:
-        AppxBlockMapObject(IMsixFactory* factory, const ComPtr<IStream>& stream);
+        // Version of the index returned by GetIndex, indexes of other versions are ignored.
+        static const std::uint32_t IndexVersion = 1;
+
+        // When index is a valid index returned by GetIndex, the block map is loaded from it and stream isn't
+        // read. Otherwise stream is parsed. A mapped index is used in place.
+        AppxBlockMapObject(IMsixFactory* factory, const ComPtr<IStream>& stream, const ComPtr<IStream>& index = ComPtr<IStream>());
 
         // IVerifierObject
         const std::string& GetPublisher() override { NOTSUPPORTED; }
@@ -164,16 +176,48 @@ namespace MSIX {
 
         // IAppxBlockMapInternal methods
         std::vector<std::string>        GetFileNames() override;
-        std::vector<Block>              GetBlocks(const std::string& fileName) override;
+        BlockRange                      GetBlocks(const std::string& fileName) override;
         MSIX::ComPtr<IAppxBlockMapFile> GetFile(const std::string& fileName) override;
+        std::vector<std::uint8_t>       GetIndex() override;
+        bool                            IsLoadedFromIndex() override { return m_loadedFromIndex; }
 
         // IAppxBlockMapReaderUtf8
         HRESULT STDMETHODCALLTYPE GetFile(LPCSTR filename, IAppxBlockMapFile **file) noexcept override;
 
     protected:
-        std::map<std::string, std::vector<Block>>        m_blockMap;
-        std::map<std::string, ComPtr<IAppxBlockMapFile>> m_blockMapFiles;
+        void ParseBlockMap();
+        bool LoadIndex(const ComPtr<IStream>& index);
+
+        // Used while AppxBlockMap.xml is parsed. Blocks are added to the last file started.
+        void StartFile(const std::string& name, std::uint64_t size, std::uint32_t localFileHeaderSize);
+        void AddBlock(std::uint64_t sizeAttribute, const std::uint8_t* hash, std::size_t hashSize);
+        void EndFile();
+
+        struct FileEntry
+        {
+            std::string   name;
+            std::uint64_t size;
+            std::uint32_t localFileHeaderSize;
+            std::size_t   firstBlock; // index in m_blocks
+            std::size_t   blockCount;
+        };
+
+        const FileEntry* FindFile(const std::string& fileName);
+        BlockRange GetBlocks(const FileEntry& file) { return BlockRange{ m_blockTable + file.firstBlock, file.blockCount }; }
+        ComPtr<IAppxBlockMapFile> GetFile(const FileEntry& file);
+
+        // The blocks of all the files, the blocks of a file are contiguous. m_files is sorted by name.
+        // m_blockTable points to m_blocks, or into m_index when the block map was loaded from a mapped index.
+        std::vector<Block>     m_blocks;
+        const Block*           m_blockTable = nullptr;
+        std::size_t            m_blockCount = 0;
+        std::vector<FileEntry> m_files;
+        // IAppxBlockMapFile objects are only created when requested. Same index as m_files.
+        std::vector<ComPtr<IAppxBlockMapFile>> m_fileObjects;
+        std::mutex m_fileObjectsMutex;
         IMsixFactory*   m_factory;
         ComPtr<IStream> m_stream;
+        ComPtr<IStream> m_index;
+        bool            m_loadedFromIndex = false;
     };
 }
\ No newline at end of file
@@ -22,6 +22,8 @@ namespace MSIX {
         void EnableFileHash();
         void AddFile(const std::string& name, std::uint64_t uncompressedSize, std::uint32_t lfh);
         void AddBlock(const std::vector<std::uint8_t>& block, ULONG size, bool isCompressed);
+        // Same as above, for callers that already computed the SHA256 hash of the block.
+        void AddBlock(const std::vector<std::uint8_t>& hash, const std::vector<std::uint8_t>& block, ULONG size, bool isCompressed);
         void CloseFile();
         void Close();
         ComPtr<IStream> GetStream() { return m_xmlWriter.GetStream(); }
@@ -13,6 +13,7 @@
 #include "BundleWriterHelper.hpp"
 #include "BundleManifestWriter.hpp"
 #include "AppxPackageInfo.hpp"
+#include "ThreadPool.hpp"
 
 // internal interface
 // {ca90bcd9-78a2-4773-820c-0b687de49f99}
@@ -64,9 +65,12 @@ namespace MSIX {
         }
         WriterState;
 
-        void AddFileToPackage(const std::string& name, IStream* stream, bool toCompress,
+        // Returns the offset of the file data in the bundle.
+        std::uint64_t AddFileToPackage(const std::string& name, IStream* stream, APPX_COMPRESSION_OPTION compressionOpt,
             bool addToBlockMap, const char* contentType, bool forceContentTypeOverride = false);
 
+        void AddPayloadPackageInternal(std::string fileName, IStream* packageStream, bool isDefaultApplicablePackage);
+
         void AddPackageReferenceInternal(std::string fileName, IStream* packageStream, bool isDefaultApplicablePackage);
 
         void AddExternalPackageReferenceInternal(std::string fileName, IStream* packageStream, bool isDefaultApplicablePackage);
@@ -81,6 +85,7 @@ namespace MSIX {
         BlockMapWriter m_blockMapWriter;
         ContentTypeWriter m_contentTypeWriter;
         BundleWriterHelper m_bundleWriterHelper;
+        ThreadPool m_threadPool;
     };
 }
 
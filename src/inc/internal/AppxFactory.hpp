@@ -14,6 +14,8 @@
 #include <string>
 #include <vector>
 #include <array>
+#include <memory>
+#include <mutex>
 
 namespace MSIX {
 
@@ -73,6 +75,9 @@ namespace MSIX {
         HRESULT MarshalOutBytes(std::vector<std::uint8_t>& data, UINT32* size, BYTE** buffer) noexcept override;
         MSIX_VALIDATION_OPTION GetValidationOptions() override { return m_validationOptions; }
         ComPtr<IStream> GetResource(const std::string& resource) override;
+        std::shared_ptr<TrustStore> GetTrustStore() override;
+        ComPtr<IMsixIndexCache> GetIndexCache() override { return m_indexCache; }
+        std::shared_ptr<ThreadPool> GetInflateThreadPool() override;
 
         // IXmlFactory
         MSIX::ComPtr<IXmlDom> CreateDomFromStream(XmlContentType footPrintType, const ComPtr<IStream>& stream) override
@@ -80,6 +85,11 @@ namespace MSIX {
             return m_xmlFactory->CreateDomFromStream(footPrintType, stream);
         }
 
+        bool ParseStream(XmlContentType footPrintType, const ComPtr<IStream>& stream, XmlStreamHandler& handler) override
+        {
+            return m_xmlFactory->ParseStream(footPrintType, stream, handler);
+        }
+
         // IMsixFactoryOverrides
         HRESULT STDMETHODCALLTYPE SpecifyExtension(MSIX_FACTORY_EXTENSION name, IUnknown* extension) noexcept override;
         HRESULT STDMETHODCALLTYPE GetCurrentSpecifiedExtension(MSIX_FACTORY_EXTENSION name, IUnknown** extension) noexcept override;
@@ -93,10 +103,17 @@ namespace MSIX {
         MSIX_VALIDATION_OPTION m_validationOptions;
         MSIX_FACTORY_OPTIONS m_factoryOptions;
         ComPtr<IStorageObject> m_resourcezip;
+        std::mutex m_resourcezipMutex;
         std::vector<std::uint8_t> m_resourcesVector;
         MSIX_APPLICABILITY_OPTIONS m_applicabilityFlags;
         ComPtr<IMsixStreamFactory> m_streamFactory;
         ComPtr<IMsixApplicabilityLanguagesEnumerator> m_applicabilityLanguagesEnumerator;
+        ComPtr<IStream> m_trustedCertificates;
+        std::shared_ptr<TrustStore> m_trustStore;
+        std::mutex m_trustStoreMutex;
+        ComPtr<IMsixIndexCache> m_indexCache;
+        std::shared_ptr<ThreadPool> m_inflateThreadPool;
+        std::mutex m_inflateThreadPoolMutex;
 
     private:
         template<typename T>
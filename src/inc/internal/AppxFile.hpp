@@ -9,6 +9,7 @@
 #include <algorithm>
 #include <iostream>
 #include <limits>
+#include <mutex>
 
 #include "MSIXWindows.hpp"
 #include "AppxPackaging.hpp"
@@ -34,7 +35,7 @@ namespace MSIX {
             {
                 *compressionOption = APPX_COMPRESSION_OPTION_NONE;
                 ComPtr<IStreamInternal> streamInt;
-                HRESULT hr = m_streamFunc()->QueryInterface(UuidOfImpl<IStreamInternal>::iid, reinterpret_cast<void**>(&streamInt));
+                HRESULT hr = GetFileStream()->QueryInterface(UuidOfImpl<IStreamInternal>::iid, reinterpret_cast<void**>(&streamInt));
                 if (SUCCEEDED(hr))
                 {
                     *compressionOption = streamInt->IsCompressed() ? APPX_COMPRESSION_OPTION_NORMAL : APPX_COMPRESSION_OPTION_NONE;
@@ -58,7 +59,7 @@ namespace MSIX {
             if (size)
             {
                 STATSTG statstg {};
-                ThrowHrIfFailed(m_streamFunc()->Stat(&statstg, 0));
+                ThrowHrIfFailed(GetFileStream()->Stat(&statstg, 0));
                 *size = static_cast<uint64_t>(statstg.cbSize.QuadPart);
             }
             return static_cast<HRESULT>(Error::OK);
@@ -67,7 +68,7 @@ namespace MSIX {
         virtual HRESULT STDMETHODCALLTYPE GetStream(IStream** stream) noexcept override try
         {
             ThrowErrorIf(Error::InvalidParameter, (stream == nullptr || *stream != nullptr), "bad pointer");
-            *stream = m_streamFunc().As<IStream>().Detach();
+            *stream = GetFileStream().As<IStream>().Detach();
             return static_cast<HRESULT>(Error::OK);
         } CATCH_RETURN();
 
@@ -83,8 +84,16 @@ namespace MSIX {
         } CATCH_RETURN();
 
     protected:
+        // The stream function may create the stream on first use, don't let two threads do it.
+        ComPtr<IStream> GetFileStream()
+        {
+            std::lock_guard<std::mutex> lock(m_streamMutex);
+            return m_streamFunc();
+        }
+
         std::string m_name;
         std::function<ComPtr<IStream>()> m_streamFunc;
+        std::mutex m_streamMutex;
         IMsixFactory* m_factory;
     };
 }
\ No newline at end of file
@@ -8,6 +8,7 @@
 #include <vector>
 #include <map>
 #include <memory>
+#include <mutex>
 
 #include "AppxPackaging.hpp"
 #include "MSIXWindows.hpp"
@@ -24,22 +25,7 @@
 #include "AppxPackageInfo.hpp"
 #include "AppxManifestObject.hpp"
 #include "DirectoryObject.hpp"
-
-// internal interface
-// {51b2c456-aaa9-46d6-8ec9-298220559189}
-#ifndef WIN32
-interface IPackage : public IUnknown
-#else
-#include "Unknwn.h"
-#include "Objidl.h"
-class IPackage : public IUnknown
-#endif
-{
-public:
-    virtual void Unpack(MSIX_PACKUNPACK_OPTION options, const MSIX::ComPtr<IDirectoryObject>& to) = 0;
-    virtual std::vector<std::string>& GetFootprintFiles() = 0;
-};
-MSIX_INTERFACE(IPackage, 0x51b2c456,0xaaa9,0x46d6,0x8e,0xc9,0x29,0x82,0x20,0x55,0x91,0x89);
+#include "IPackage.hpp"
 
 namespace MSIX {
     // Storage object representing the entire AppxPackage
@@ -48,7 +34,10 @@ namespace MSIX {
     class AppxPackageObject final : public ComClass<AppxPackageObject, IAppxPackageReader, IPackage, IStorageObject, IAppxBundleReader, IAppxPackageReaderUtf8, IAppxBundleReaderUtf8>
     {
     public:
-        AppxPackageObject(IMsixFactory* factory, MSIX_VALIDATION_OPTION validation, MSIX_APPLICABILITY_OPTIONS applicabilityOptions, const ComPtr<IStorageObject>& container);
+        // With MSIX_FACTORY_OPTION_READER_LAZY_OPEN only the signature is parsed here. The other footprint files
+        // are parsed and the payload files indexed when they are first needed.
+        AppxPackageObject(IMsixFactory* factory, MSIX_VALIDATION_OPTION validation, MSIX_APPLICABILITY_OPTIONS applicabilityOptions,
+            MSIX_FACTORY_OPTIONS factoryOptions, const ComPtr<IStorageObject>& container);
         ~AppxPackageObject() {}
 
         HRESULT STDMETHODCALLTYPE QueryInterface(REFIID riid, void** ppvObject) noexcept override
@@ -107,7 +96,10 @@ namespace MSIX {
 
         // internal IPackage methods
         void Unpack(MSIX_PACKUNPACK_OPTION options, const ComPtr<IDirectoryObject>& to) override;
-        std::vector<std::string>& GetFootprintFiles() override { return m_footprintFiles; }
+        std::vector<std::string>& GetFootprintFiles() override { IndexFiles(); return m_footprintFiles; }
+        ComPtr<IStorageObject> CreateView() override;
+        void UnpackFootprintFiles(MSIX_PACKUNPACK_OPTION options, const ComPtr<IDirectoryObject>& to) override;
+        void UnpackPayloadFiles(MSIX_PACKUNPACK_OPTION options, const ComPtr<IDirectoryObject>& to, const ComPtr<IStorageObject>& view) override;
 
         // IAppxPackageReader
         HRESULT STDMETHODCALLTYPE GetBlockMap(IAppxBlockMapReader** blockMapReader) noexcept override;
@@ -137,24 +129,50 @@ namespace MSIX {
 
     protected:
         // Helper methods
+        void ValidateContentTypes();
+        const ComPtr<IVerifierObject>& GetBlockMapObject();
+        std::string GetBlockMapIndexKey();
+        const ComPtr<IVerifierObject>& GetManifestObject();
+        void IndexFiles();
+        void BuildFileIndex();
         void VerifyFile(const ComPtr<IStream>& stream, const std::string& fileName, const ComPtr<IAppxBlockMapInternal>& blockMapInternal);
         ComPtr<IAppxFile> GetAppxFile(const std::string& fileName);
+        ComPtr<IStream> GetPayloadStream(const ComPtr<IStorageObject>& container, const std::string& opcFileName, const std::string& fileName);
+        std::string GetUnpackTargetPrefix(MSIX_PACKUNPACK_OPTION options);
+        // Returns the size of fileName from the block map, 0 when it isn't known. UnpackFile reserves it for the target.
+        std::uint64_t GetUnpackedSize(const std::string& fileName);
+        void UnpackFile(const ComPtr<IStream>& source, const std::string& targetName, const ComPtr<IDirectoryObject>& to, std::uint64_t size);
+        void UnpackPayloadFilesInParallel(const std::vector<std::string>& fileNames, const std::string& targetPrefix, const ComPtr<IDirectoryObject>& to);
+        #ifdef BUNDLE_SUPPORT
+        void UnpackPackagesInParallel(MSIX_PACKUNPACK_OPTION options, const ComPtr<IDirectoryObject>& to);
+        #endif
 
         std::map<std::string, ComPtr<IAppxFile>> m_files;
 
         MSIX_VALIDATION_OPTION      m_validation = MSIX_VALIDATION_OPTION::MSIX_VALIDATION_OPTION_FULL;
+        MSIX_APPLICABILITY_OPTIONS  m_applicabilityFlags = MSIX_APPLICABILITY_OPTIONS::MSIX_APPLICABILITY_OPTION_FULL;
         ComPtr<IMsixFactory>        m_factory;
         ComPtr<IVerifierObject>     m_appxSignature;
         ComPtr<IVerifierObject>     m_appxBlockMap;
         ComPtr<IVerifierObject>     m_appxManifest;
         ComPtr<IVerifierObject>     m_appxBundleManifest;
         ComPtr<IStorageObject>      m_container;
+        ComPtr<IStream>             m_manifestInContainer;
+        AppxSignatureObject::Digest m_appxBlockMapDigest; // empty if the signature isn't validated
+
+        // Each part is read once, by whichever call needs it first
+        std::once_flag              m_contentTypesValidated;
+        std::once_flag              m_blockMapLoaded;
+        std::once_flag              m_manifestLoaded;
+        std::once_flag              m_filesIndexed;
         
         std::vector<std::string>    m_payloadFiles;
+        std::map<std::string, std::string> m_payloadBlockMapNames; // payload file name in the container -> name in the block map
         std::vector<std::string>    m_footprintFiles;
         std::vector<std::string>    m_applicablePackagesNames;
         std::vector<ComPtr<IAppxPackageReader>> m_applicablePackages;
         bool                        m_isBundle = false;
+        bool                        m_parallelInflate = false;
     };
 
     class AppxFilesEnumerator final : public MSIX::ComClass<AppxFilesEnumerator, IAppxFilesEnumerator>
@@ -10,10 +10,14 @@
 #include "AppxBlockMapWriter.hpp"
 #include "ContentTypeWriter.hpp"
 #include "ZipObjectWriter.hpp"
+#include "ZipObjectReader.hpp"
+#include "AppxBlockMapObject.hpp"
+#include "ThreadPool.hpp"
 
 #include <map>
 #include <memory>
 #include <future>
+#include <set>
 
 // internal interface
 // {32e89da5-7cbb-4443-8cf0-b84eedb51d0a}
@@ -26,21 +30,21 @@ class IPackageWriter : public IUnknown
 #endif
 {
 public:
-    // TODO: add options if needed
-    virtual void PackPayloadFiles(const MSIX::ComPtr<IDirectoryObject>& from) = 0;
+    // compressionOpt is used for every file that isn't already compressed based on its extension.
+    virtual void PackPayloadFiles(const MSIX::ComPtr<IDirectoryObject>& from, APPX_COMPRESSION_OPTION compressionOpt) = 0;
 };
 MSIX_INTERFACE(IPackageWriter, 0x32e89da5,0x7cbb,0x4443,0x8c,0xf0,0xb8,0x4e,0xed,0xb5,0x1d,0x0a);
 
 namespace MSIX {
     class AppxPackageWriter final : public ComClass<AppxPackageWriter, IPackageWriter, IAppxPackageWriter,
-        IAppxPackageWriterUtf8, IAppxPackageWriter3, IAppxPackageWriter3Utf8>
+        IAppxPackageWriterUtf8, IAppxPackageWriter3, IAppxPackageWriter3Utf8, IMsixPackageWriterBasePackage>
     {
     public:
         AppxPackageWriter(IMsixFactory* factory, const ComPtr<IZipWriter>& zip, bool enableFileHash);
         ~AppxPackageWriter() {};
 
         // IPackageWriter
-        void PackPayloadFiles(const ComPtr<IDirectoryObject>& from) override;
+        void PackPayloadFiles(const ComPtr<IDirectoryObject>& from, APPX_COMPRESSION_OPTION compressionOpt) override;
 
         // IAppxPackageWriter
         HRESULT STDMETHODCALLTYPE AddPayloadFile(LPCWSTR fileName, LPCWSTR contentType,
@@ -59,6 +63,9 @@ namespace MSIX {
         HRESULT STDMETHODCALLTYPE AddPayloadFiles(UINT32 fileCount, APPX_PACKAGE_WRITER_PAYLOAD_STREAM_UTF8* payloadFiles,
             UINT64 memoryLimit) noexcept override;
 
+        // IMsixPackageWriterBasePackage
+        HRESULT STDMETHODCALLTYPE SetBasePackage(IStream* basePackage) noexcept override;
+
     protected:
         typedef enum
         {
@@ -68,10 +75,13 @@ namespace MSIX {
         }
         WriterState;
 
+        // Returns the raw stream and the blocks of name in the base package, if it is there and compressed.
+        std::pair<ComPtr<IStream>, BlockRange> GetBaseBlocks(const std::string& name);
+
         void ValidateAndAddPayloadFile(const std::string& name, IStream* stream,
             APPX_COMPRESSION_OPTION compressionOpt, const char* contentType);
 
-        void AddFileToPackage(const std::string& name, IStream* stream, bool toCompress,
+        void AddFileToPackage(const std::string& name, IStream* stream, APPX_COMPRESSION_OPTION compressionOpt,
             bool addToBlockMap, const char* contentType, bool forceContentTypeOverride = false);
 
         void ValidateCompressionOption(APPX_COMPRESSION_OPTION compressionOpt);
@@ -81,6 +91,10 @@ namespace MSIX {
         ComPtr<IZipWriter> m_zipWriter;
         BlockMapWriter m_blockMapWriter;
         ContentTypeWriter m_contentTypeWriter;
+        ThreadPool m_threadPool;
+        ComPtr<IZipReader> m_baseZip;
+        ComPtr<IAppxBlockMapInternal> m_baseBlockMap;
+        std::set<std::string> m_baseFiles;
     };
 }
 
@@ -42,6 +42,11 @@ namespace MSIX {
         AXCI = 0x49435841, // AppxMetadata/CodeIntegrity.cat (uncompressed, optional)
     };    
 
+    // Names of the validation streams over the zip file records and central directory, the parts of the
+    // container covered by the AXPC and AXCD digests. '<' isn't valid in a file name, so they can't collide.
+    #define FILE_RECORDS_PART      "<FileRecords>"
+    #define CENTRAL_DIRECTORY_PART "<CentralDirectory>"
+
     const unsigned HASH_BYTES = 32;
 
     struct DigestHash
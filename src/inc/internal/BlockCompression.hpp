@@ -0,0 +1,34 @@
+//
+//  Copyright (C) 2019 Microsoft.  All rights reserved.
+//  See LICENSE file in the project root for full license information.
+//
+#pragma once
+
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <vector>
+
+namespace MSIX {
+
+    // Blocks of package files are at most 64KB and deflate and inflate on their own. DEFLATE_BACKEND selects the
+    // implementation in PAL/DataCompression, streams still use the compression library.
+    class IBlockDeflater
+    {
+    public:
+        // Deflates countBytes of buffer into the layout of the output of Z_FULL_FLUSH: it ends on a byte boundary
+        // with an empty stored block and doesn't reference any previous data.
+        virtual std::vector<std::uint8_t> Deflate(const void* buffer, std::uint32_t countBytes) = 0;
+        virtual ~IBlockDeflater() = default;
+    };
+
+    // Returns a block deflater for the zlib compression level, or nullptr if blocks are deflated with zlib.
+    std::unique_ptr<IBlockDeflater> CreateBlockDeflater(int level);
+
+    // Inflates data that was deflated on its own, like a block map block that ends with a full flush, into inflated.
+    // Returns false if it doesn't inflate to exactly inflated.size() bytes.
+    bool InflateBlock(std::uint8_t* data, std::size_t size, std::vector<std::uint8_t>& inflated);
+
+    // crc32 of data, as stored in the zip headers
+    std::uint32_t ComputeCrc32(const std::uint8_t* data, std::size_t size);
+}
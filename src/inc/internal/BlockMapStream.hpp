@@ -13,6 +13,7 @@
 #include "Crypto.hpp"
 #include "AppxFactory.hpp"
 
+#include <array>
 #include <string>
 #include <map>
 #include <functional>
@@ -22,18 +23,31 @@
 namespace MSIX {
   
     const std::uint64_t BLOCKMAP_BLOCK_SIZE = 65536; // 64KB
+    const std::size_t BLOCKMAP_HASH_SIZE = 32; // SHA256
 
     typedef struct Block
     {
         std::uint64_t compressedSize;
         std::uint64_t blockSize;
-        std::vector<std::uint8_t> hash;
+        std::array<std::uint8_t, BLOCKMAP_HASH_SIZE> hash;
     } Block;
 
+    // The blocks of one file, a view into the block table of the block map.
+    struct BlockRange
+    {
+        const Block* first;
+        std::size_t  count;
+
+        const Block* begin() const { return first; }
+        const Block* end() const { return first + count; }
+        std::size_t size() const { return count; }
+    };
+
     typedef struct BlockPlusStream : Block
     {
         std::uint64_t   size;
         std::uint64_t   offset;         
+        std::uint64_t   position;       // current seek position of stream, relative to the block
         ComPtr<IStream> stream;
     } BlockPlusStream;
 
@@ -41,7 +55,7 @@ namespace MSIX {
     class BlockMapStream final : public StreamBase
     {
     public:
-        BlockMapStream(IMsixFactory* factory, std::string decodedName, const ComPtr<IStream>& stream, std::vector<Block>& blocks)
+        BlockMapStream(IMsixFactory* factory, std::string decodedName, const ComPtr<IStream>& stream, const BlockRange& blocks)
             : m_factory(factory), m_decodedName(decodedName), m_stream(stream)
         {
             // Determine overall stream size
@@ -62,12 +76,13 @@ namespace MSIX {
             for (auto block = blocks.begin(); ((sizeRemaining != 0) && (block != blocks.end())); block++)
             {
                 auto rangeStream = ComPtr<IStream>::Make<RangeStream>(offset, std::min(sizeRemaining, BLOCKMAP_BLOCK_SIZE), stream.Get());                
-                auto hashStream = ComPtr<IStream>::Make<HashStream>(rangeStream, block->hash);
+                auto hashStream = ComPtr<IStream>::Make<HashStream>(rangeStream, block->hash.data(), block->hash.size());
                 std::uint64_t blockSize = std::min(sizeRemaining, BLOCKMAP_BLOCK_SIZE);
 
                 BlockPlusStream bs;
                 bs.offset = offset;
                 bs.size   = blockSize;
+                bs.position = 0;
                 bs.stream = hashStream;
                 bs.hash   = block->hash;
                 m_blockStreams.emplace_back(std::move(bs));
@@ -76,6 +91,26 @@ namespace MSIX {
                 sizeRemaining   -= blockSize;
             }
 
+            // Packages compress every block with a full flush, so a compressed file can be inflated from the start
+            // of any block. The stream checks that a block inflates by itself before starting there.
+            auto internal = m_stream.As<IStreamInternal>();
+            if (internal->IsCompressed())
+            {
+                std::vector<StreamCheckpoint> checkpoints;
+                std::uint64_t compressedOffset = 0;
+                for (std::size_t i = 0; i < m_blockStreams.size(); i++)
+                {
+                    const auto& block = m_blockStreams[i];
+                    auto compressedSize = blocks.begin()[i].compressedSize;
+                    if (block.offset != 0)
+                    {
+                        checkpoints.push_back(StreamCheckpoint{ block.offset, block.size, { compressedOffset, compressedSize }, block.hash });
+                    }
+                    compressedOffset += compressedSize;
+                }
+                internal->SetCheckpoints(checkpoints);
+            }
+
             // Reset seek position to beginning
             ThrowHrIfFailed(stream->Seek(li, STREAM_SEEK_SET, nullptr));
             ThrowHrIfFailed(Seek(li, STREAM_SEEK_SET, nullptr));
@@ -99,43 +134,45 @@ namespace MSIX {
             }
             m_relativePosition = std::max((std::uint64_t)0, std::min(m_relativePosition, m_streamSize));
             if (newPosition) { newPosition->QuadPart = m_relativePosition; }
-
-            m_currentBlock = m_blockStreams.begin();
             return S_OK;
         } CATCH_RETURN();
 
         HRESULT STDMETHODCALLTYPE Read(void* buffer, ULONG countBytes, ULONG* actualRead) noexcept override try
         {
+            Global::Log::PartScope part(m_decodedName);
             std::uint32_t bytesRead = 0;
             if (m_relativePosition < m_streamSize)
             {
                 std::uint32_t bytesToRead = std::min(static_cast<std::uint32_t>(countBytes), static_cast<std::uint32_t>(m_streamSize - m_relativePosition));
-                while (m_currentBlock != m_blockStreams.end() && bytesToRead > 0)
+                while (bytesToRead > 0)
                 {
-                    if ((m_currentBlock->offset + m_currentBlock->size) <= m_relativePosition)
-                    {
-                        m_currentBlock++;
-                    }
-                    else if (m_currentBlock->offset <= m_relativePosition)
+                    // Every block but the last one is BLOCKMAP_BLOCK_SIZE, so the block is found directly
+                    // and a read covering several blocks is handed to each one a whole block at a time.
+                    std::size_t blockIndex = static_cast<std::size_t>(m_relativePosition / BLOCKMAP_BLOCK_SIZE);
+                    if (blockIndex >= m_blockStreams.size()) { break; }
+                    auto& block = m_blockStreams[blockIndex];
+
+                    // Sequential reads continue where the block stream stopped, only seek it when the
+                    // caller moved somewhere else.
+                    std::uint64_t positionInBlock = m_relativePosition - block.offset;
+                    if (block.position != positionInBlock)
                     {
-                        std::uint64_t positionInBlock = m_relativePosition - m_currentBlock->offset;
                         LARGE_INTEGER li{0};
                         li.QuadPart = positionInBlock;
-                        ThrowHrIfFailed(m_currentBlock->stream->Seek(li, STREAM_SEEK_SET, nullptr));
+                        ThrowHrIfFailed(block.stream->Seek(li, STREAM_SEEK_SET, nullptr));
+                        block.position = positionInBlock;
+                    }
 
-                        std::uint32_t count = std::min(bytesToRead, static_cast<std::uint32_t>(m_currentBlock->size - positionInBlock));
-                        ULONG actual = 0;
-                        ThrowHrIfFailed(m_currentBlock->stream->Read(buffer, count, &actual));
+                    std::uint32_t count = std::min(bytesToRead, static_cast<std::uint32_t>(block.size - positionInBlock));
+                    ULONG actual = 0;
+                    ThrowHrIfFailed(block.stream->Read(buffer, count, &actual));
+                    if (actual == 0) { break; }
 
-                        buffer = static_cast<std::uint8_t*>(buffer) + actual;
-                        m_relativePosition += actual;
-                        bytesToRead -= actual;
-                        bytesRead += actual;
-                    }
-                    else
-                    {
-                        m_currentBlock = m_blockStreams.begin();
-                    }
+                    buffer = static_cast<std::uint8_t*>(buffer) + actual;
+                    block.position += actual;
+                    m_relativePosition += actual;
+                    bytesToRead -= actual;
+                    bytesRead += actual;
                 }
             }
             if (actualRead) { *actualRead = bytesRead; }
@@ -159,9 +196,8 @@ namespace MSIX {
         }
       
     protected:
-        std::vector<BlockPlusStream>::iterator m_currentBlock;
         std::vector<BlockPlusStream> m_blockStreams;
-        std::uint64_t m_relativePosition;
+        std::uint64_t m_relativePosition = 0;
         std::uint64_t m_streamSize;
         std::string m_decodedName;
         ComPtr<IStream> m_stream;
@@ -4,6 +4,8 @@
 // 
 #pragma once
 
+#include <cstdint>
+#include <utility>
 #include <vector>
 
 #ifndef SHA256_DIGEST_LENGTH
@@ -17,6 +19,20 @@ namespace MSIX {
     public:
         static bool ComputeHash(const std::uint8_t *buffer, std::uint32_t cbBuffer, std::vector<uint8_t>& hash);
 
+        /// <summary>
+        /// Number of buffers ComputeHashes hashes at once. Callers that have many blocks to hash should give it at
+        /// least this many at a time.
+        /// </summary>
+        static std::size_t GetParallelHashCount();
+
+        /// <summary>
+        /// Computes the hash of each buffer. Buffers of the same size are hashed together when the CPU allows it.
+        /// </summary>
+        /// <param name="buffers">Data and size in bytes of each buffer</param>
+        /// <param name="hashes">Receives the hash of each buffer, in the same order</param>
+        static void ComputeHashes(const std::vector<std::pair<const std::uint8_t*, std::uint32_t>>& buffers,
+            std::vector<std::vector<std::uint8_t>>& hashes);
+
         /// <summary>
         /// Construct and initialize the hash engine so it can be used to compute hash of input data.
         /// </summary>
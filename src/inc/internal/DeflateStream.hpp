@@ -4,19 +4,55 @@
 // 
 #pragma once
 
+#include "AppxPackaging.hpp"
 #include "ComHelper.hpp"
 #include "StreamBase.hpp"
+#include "BlockCompression.hpp"
 
+#include <memory>
 #include <vector>
 #include <zlib.h>
 
 namespace MSIX {
 
+    // Raw deflate (no zlib header) compressor. The compression option selects the zlib compression level.
+    // Data flushed with Z_FULL_FLUSH is deflated by the block deflater of DEFLATE_BACKEND at the same level,
+    // into the same layout, when it has one.
+    class Deflater final
+    {
+    public:
+        Deflater(APPX_COMPRESSION_OPTION compressionOpt = APPX_COMPRESSION_OPTION_NORMAL);
+        ~Deflater();
+
+        Deflater(const Deflater&) = delete;
+        Deflater& operator=(const Deflater&) = delete;
+
+        // Compresses the data and returns the output produced for it. With Z_FULL_FLUSH the output ends
+        // on a byte boundary and doesn't reference any previous data, so blocks of a file can be compressed
+        // independently and concatenated. Z_FINISH terminates the deflate stream.
+        std::vector<std::uint8_t> Deflate(const void* buffer, std::uint32_t countBytes, int disposition);
+
+        // Starts a new deflate stream, keeping the memory of the previous one.
+        void Reset();
+
+        // Returns a deflater of the calling thread for the compression option, reset for a new deflate stream. It is
+        // valid until the thread ends and must not be used by the thread again until the caller is done with it.
+        static Deflater& GetThreadDeflater(APPX_COMPRESSION_OPTION compressionOpt);
+
+    protected:
+        std::unique_ptr<IBlockDeflater> m_blockDeflater;
+        z_stream m_zstrm;
+    };
+
+    // Returns true if compressed is raw deflate data that inflates to exactly expected without referencing any
+    // previous data and ends like the output of Z_FULL_FLUSH, so it can be used in place of deflating expected.
+    bool IsFullFlushBlockOf(const std::vector<std::uint8_t>& compressed, const std::vector<std::uint8_t>& expected);
+
     class DeflateStream final : public StreamBase
     {
     public:
-        DeflateStream(const ComPtr<IStream>& stream);
-        ~DeflateStream();
+        DeflateStream(const ComPtr<IStream>& stream, APPX_COMPRESSION_OPTION compressionOpt = APPX_COMPRESSION_OPTION_NORMAL);
+        ~DeflateStream() {}
 
         // IStream
         HRESULT STDMETHODCALLTYPE Seek(LARGE_INTEGER move, DWORD origin, ULARGE_INTEGER *newPosition) noexcept override;
@@ -29,8 +65,6 @@ namespace MSIX {
         std::string GetName() override { return m_stream.As<IStreamInternal>()->GetName(); }
     
     protected:
-        std::vector<std::uint8_t> Deflate(int disposition);
-
         typedef enum
         {
             Open,
@@ -39,7 +73,7 @@ namespace MSIX {
         State;
 
         State m_state = State::Open;
-        z_stream m_zstrm;
+        Deflater m_deflater;
         ComPtr<IStream> m_stream;
     };
 }
@@ -8,6 +8,8 @@
 #include <vector>
 #include <map>
 #include <memory>
+#include <mutex>
+#include <set>
 
 #include "Exceptions.hpp"
 #include "StreamBase.hpp"
@@ -31,6 +33,10 @@ public:
     // then the file is created and an empty stream to the file is handed back to the caller.
     virtual MSIX::ComPtr<IStream> OpenFile(const std::string& fileName, MSIX::FileStream::Mode mode) = 0;
 
+    // Creates a file to write size bytes to, like OpenFile with write mode. Where it is supported, the space for
+    // the file is reserved up front.
+    virtual MSIX::ComPtr<IStream> OpenFileForWrite(const std::string& fileName, std::uint64_t size) = 0;
+
     // Returns a multipmap sorted by last modified time. Use multimap in the unlikely case there are two files
     // with the same last modified time.
     virtual std::multimap<std::uint64_t, std::string> GetFilesByLastModDate() = 0;
@@ -56,12 +62,16 @@ namespace MSIX {
 
         // IDirectoryObject
         ComPtr<IStream> OpenFile(const std::string& fileName, MSIX::FileStream::Mode mode) override;
+        ComPtr<IStream> OpenFileForWrite(const std::string& fileName, std::uint64_t size) override;
         std::multimap<std::uint64_t, std::string> GetFilesByLastModDate() override;
 
         char GetPathSeparator() const;
 
     protected:
         std::string m_root;
-
+        // Directories already created under m_root, so writing many files to the same directory doesn't
+        // create it every time. Only used on POSIX, where creating the parent directories is a mkdir per level.
+        std::set<std::string> m_directories;
+        std::mutex m_directoriesMutex;
     };//class DirectoryObject
 }
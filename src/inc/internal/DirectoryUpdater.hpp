@@ -0,0 +1,68 @@
+//
+//  Copyright (C) 2019 Microsoft.  All rights reserved.
+//  See LICENSE file in the project root for full license information.
+//
+#pragma once
+
+#include <array>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "AppxPackaging.hpp"
+#include "ComHelper.hpp"
+#include "DirectoryObject.hpp"
+#include "AppxBlockMapObject.hpp"
+#include "ZipObjectReader.hpp"
+
+namespace MSIX {
+
+    // Updates a directory with an unpacked package, including its AppxBlockMap.xml, to the content of another
+    // version of the package. Blocks whose hash is in the block map of the directory are copied from the files
+    // in the directory, only the other blocks are read from the package. Every block is checked against the
+    // block map of the package before it is written, whatever its source.
+    // The new files are written next to the old ones and renamed over them once all of them are written.
+    class DirectoryUpdater final
+    {
+    public:
+        DirectoryUpdater(IMsixFactory* factory, const ComPtr<IAppxPackageReader>& package,
+            const ComPtr<IStream>& packageStream, const std::string& directory);
+
+        void Update();
+
+        // Bytes of the new files copied from the directory
+        std::uint64_t GetBytesCopied() const { return m_bytesCopied; }
+        // Bytes of the package read for the blocks that weren't in the directory
+        std::uint64_t GetBytesRead() const { return m_bytesRead; }
+
+    protected:
+        struct LocalBlock
+        {
+            std::string   fileName;
+            std::uint64_t offset;
+            std::uint64_t size;
+        };
+
+        void IndexLocalBlocks();
+        void WriteFile(const std::string& containerName, const std::string& blockMapName, const ComPtr<IStream>& target);
+        void CopyFile(const ComPtr<IStream>& source, const ComPtr<IStream>& target);
+        bool ReadLocalBlock(const std::array<std::uint8_t, BLOCKMAP_HASH_SIZE>& hash, std::vector<std::uint8_t>& block);
+        bool ReadPackageBlock(const ComPtr<IStream>& rawFile, std::uint64_t offset, std::uint64_t size, bool isCompressed,
+            const std::array<std::uint8_t, BLOCKMAP_HASH_SIZE>& hash, std::vector<std::uint8_t>& block);
+        void CommitFiles(std::vector<std::string>& files);
+
+        ComPtr<IMsixFactory> m_factory;
+        ComPtr<IAppxPackageReader> m_package;
+        ComPtr<IAppxBlockMapInternal> m_blockMap;
+        ComPtr<IZipReader> m_zip;
+        ComPtr<IDirectoryObject> m_directory;
+        std::string m_root;
+
+        std::map<std::array<std::uint8_t, BLOCKMAP_HASH_SIZE>, LocalBlock> m_localBlocks;
+        std::map<std::string, ComPtr<IStream>> m_localFiles;
+        std::vector<std::string> m_localFileNames;
+        std::uint64_t m_bytesCopied = 0;
+        std::uint64_t m_bytesRead = 0;
+    };
+}
@@ -18,7 +18,7 @@ namespace MSIX {
     public:
         enum Mode { READ = 0, WRITE, APPEND, READ_UPDATE, WRITE_UPDATE, APPEND_UPDATE };
 
-        FileStream(const std::string& name, Mode mode) : m_name(name)
+        FileStream(const std::string& name, Mode mode) : m_name(name), m_mode(mode)
         {
             static const char* modes[] = { "rb", "wb", "ab", "r+b", "w+b", "a+b" };
             #ifdef WIN32
@@ -34,10 +34,10 @@ namespace MSIX {
             ULARGE_INTEGER end = { 0 };
             ThrowHrIfFailed(Seek(start, StreamBase::Reference::END, &end));
             ThrowHrIfFailed(Seek(start, StreamBase::Reference::START, nullptr));
-            m_size = end.u.LowPart;
+            m_size = end.QuadPart;
         }
 
-        FileStream(const std::wstring& name, Mode mode)
+        FileStream(const std::wstring& name, Mode mode) : m_mode(mode)
         {
             m_name = wstring_to_utf8(name);
             #ifdef WIN32
@@ -54,7 +54,7 @@ namespace MSIX {
             ULARGE_INTEGER end = { 0 };
             ThrowHrIfFailed(Seek(start, StreamBase::Reference::END, &end));
             ThrowHrIfFailed(Seek(start, StreamBase::Reference::START, nullptr));
-            m_size = end.u.LowPart;
+            m_size = end.QuadPart;
         }
 
         virtual ~FileStream() override
@@ -72,12 +72,33 @@ namespace MSIX {
         }
 
         // IStream
+        // Opens the file again, so the clone can be read independently of this stream (for example from
+        // another thread). Only supported for files opened for read.
+        HRESULT STDMETHODCALLTYPE Clone(IStream** stream) noexcept override try
+        {
+            ThrowErrorIf(Error::InvalidParameter, (stream == nullptr || *stream != nullptr), "bad pointer");
+            if (m_mode != Mode::READ)
+            {
+                return static_cast<HRESULT>(Error::NotSupported);
+            }
+            #ifdef WIN32
+            auto clone = ComPtr<IStream>::Make<FileStream>(utf8_to_wstring(m_name), Mode::READ);
+            #else
+            auto clone = ComPtr<IStream>::Make<FileStream>(m_name, Mode::READ);
+            #endif
+            LARGE_INTEGER pos = { 0 };
+            pos.QuadPart = m_offset;
+            ThrowHrIfFailed(clone->Seek(pos, StreamBase::Reference::START, nullptr));
+            *stream = clone.Detach();
+            return static_cast<HRESULT>(Error::OK);
+        } CATCH_RETURN();
+
         HRESULT STDMETHODCALLTYPE Seek(LARGE_INTEGER move, DWORD origin, ULARGE_INTEGER* newPosition) noexcept override try
         {
             #ifdef WIN32
             int rc = _fseeki64(m_file, move.QuadPart, origin);
             #else       
-            int rc = std::fseek(m_file, static_cast<long>(move.QuadPart), origin);
+            int rc = fseeko(m_file, static_cast<off_t>(move.QuadPart), origin);
             #endif
             ThrowErrorIfNot(Error::FileSeek, (rc == 0), "seek failed");
             m_offset = Ftell();
@@ -108,6 +129,10 @@ namespace MSIX {
         // IStreamInternal
         std::string GetName() override { return m_name; }
 
+        #ifndef WIN32
+        int GetFileDescriptor() { return fileno(m_file); }
+        #endif
+
     protected:
         inline int Ferror() { return std::ferror(m_file); }
         inline bool Feof()  { return 0 != std::feof(m_file); }
@@ -118,7 +143,7 @@ namespace MSIX {
             #ifdef WIN32
             auto result = _ftelli64(m_file);
             #else       
-            auto result = std::ftell(m_file);
+            auto result = ftello(m_file);
             #endif  
             return static_cast<std::uint64_t>(result);
         }
@@ -126,6 +151,7 @@ namespace MSIX {
         std::uint64_t m_offset = 0;
         std::uint64_t m_size = 0;
         std::string m_name;
+        Mode m_mode;
         FILE* m_file;
     };
 }
@@ -17,22 +17,45 @@
 
 namespace MSIX {
   
-    // This represents a subset of a Stream
+    // This represents a subset of a Stream whose content must match an expected SHA256 digest.
+    // Data is hashed as it is read into the caller's buffer. Reading the last byte of the
+    // stream fails if the digest doesn't match, so callers must not trust the data until
+    // the whole stream has been read successfully.
     class HashStream final : public StreamBase
     {
     protected:
         bool m_validated;
+        bool m_hashMismatch;
         ComPtr<IStream> m_stream;
-        std::vector<std::uint8_t>& m_expectedHash;
-        std::unique_ptr<std::vector<std::uint8_t>> m_cacheBuffer;
+        const std::uint8_t* m_expectedHash;
+        std::size_t m_expectedHashSize;
+        SHA256 m_hasher;
+        std::uint64_t m_hashedBytes;      // bytes [0, m_hashedBytes) have been hashed
         std::uint64_t m_relativePosition;
-        size_t m_streamSize;
+        std::uint64_t m_streamSize;
+
+        // Scratch buffer used to hash data the caller skipped over. It is reused by all the
+        // hash streams of a thread, block map streams create one hash stream per block.
+        static std::vector<std::uint8_t>& GetScratchBuffer()
+        {
+            thread_local std::vector<std::uint8_t> buffer(64 * 1024);
+            return buffer;
+        }
 
     public:
-        HashStream(const ComPtr<IStream>& stream, std::vector<std::uint8_t>& expectedHash) :
+        HashStream(const ComPtr<IStream>& stream, const std::vector<std::uint8_t>& expectedHash) :
+            HashStream(stream, expectedHash.data(), expectedHash.size())
+        {
+        }
+
+        // expectedHash must outlive the stream.
+        HashStream(const ComPtr<IStream>& stream, const std::uint8_t* expectedHash, std::size_t expectedHashSize) :
             m_validated(false),
+            m_hashMismatch(false),
             m_stream(stream),
             m_expectedHash(expectedHash),
+            m_expectedHashSize(expectedHashSize),
+            m_hashedBytes(0),
             m_relativePosition(0),
             m_streamSize(0)
         {
@@ -42,85 +65,101 @@ namespace MSIX {
             
             ThrowHrIfFailed(m_stream->Seek(li, StreamBase::Reference::END, &uli));
             ThrowHrIfFailed(m_stream->Seek(li, StreamBase::Reference::START, nullptr));
-            m_streamSize = static_cast<size_t>(uli.u.LowPart);
+            m_streamSize = uli.QuadPart;
         }
 
-        void Validate()
+        // Hashes the data read between the current position and position + count. Data before
+        // m_hashedBytes was hashed already, data is always hashed in order.
+        void HashRead(const std::uint8_t* data, ULONG count)
         {
-            if (m_validated) { return; }
+            if (m_validated || (m_relativePosition + count <= m_hashedBytes)) { return; }
+            auto alreadyHashed = static_cast<ULONG>(m_hashedBytes - m_relativePosition);
+            m_hasher.HashData(data + alreadyHashed, count - alreadyHashed);
+            m_hashedBytes = m_relativePosition + count;
+            if (m_hashedBytes == m_streamSize)
+            {
+                ValidateHash();
+            }
+        }
 
-            // read stream into cache buffer
-            m_cacheBuffer = std::make_unique<std::vector<std::uint8_t>>(m_streamSize);
-            ULONG bytesRead = 0;
-            ThrowHrIfFailed(m_stream->Read(m_cacheBuffer->data(), static_cast<ULONG>(m_cacheBuffer->size()), &bytesRead));
-            ThrowErrorIfNot(MSIX::Error::SignatureInvalid, bytesRead == m_streamSize, "read failed");
+        // Hashes the data between m_hashedBytes and the current position. Used when the caller
+        // seeks past data that wasn't read or reaches the end of the stream without reading.
+        void HashSkippedData()
+        {
+            if (m_validated || (m_hashedBytes >= m_relativePosition)) { return; }
+            auto target = m_relativePosition;
+            LARGE_INTEGER li = { 0 };
+            li.QuadPart = static_cast<LONGLONG>(m_hashedBytes);
+            ThrowHrIfFailed(m_stream->Seek(li, StreamBase::Reference::START, nullptr));
+            m_relativePosition = m_hashedBytes;
+
+            auto& scratch = GetScratchBuffer();
+            while (m_relativePosition < target)
+            {
+                auto toRead = static_cast<ULONG>(std::min(static_cast<std::uint64_t>(scratch.size()), target - m_relativePosition));
+                ULONG bytesRead = 0;
+                ThrowHrIfFailed(m_stream->Read(scratch.data(), toRead, &bytesRead));
+                ThrowErrorIf(MSIX::Error::SignatureInvalid, bytesRead == 0, "read failed");
+                HashRead(scratch.data(), bytesRead);
+                m_relativePosition += bytesRead;
+            }
+        }
 
-            // compute digest and compare against expected digest
+        // compute digest and compare against expected digest
+        void ValidateHash()
+        {
             std::vector<std::uint8_t> hash;
-            ThrowErrorIfNot(MSIX::Error::SignatureInvalid, 
-                MSIX::SHA256::ComputeHash(m_cacheBuffer->data(), static_cast<uint32_t>(m_cacheBuffer->size()), hash), 
-                "Invalid signature");
-            ThrowErrorIfNot(MSIX::Error::SignatureInvalid, m_expectedHash.size() == hash.size(), "Signature is corrupt");
+            m_hasher.FinalizeAndGetHashValue(hash);
+            // The hash engine can't be finalized again, remember the failure for subsequent reads.
+            m_hashMismatch = true;
+            ThrowErrorIfNot(MSIX::Error::SignatureInvalid, m_expectedHashSize == hash.size(), "Signature is corrupt");
             ThrowErrorIfNot(
                 MSIX::Error::SignatureInvalid,
-                memcmp(m_expectedHash.data(), hash.data(), hash.size()) == 0,
+                memcmp(m_expectedHash, hash.data(), hash.size()) == 0,
                 "Signature hash doesn't match digest hash"); //TODO: better exception
-
+            m_hashMismatch = false;
             m_validated = true;
         }
 
-        void CacheSeek(LARGE_INTEGER move, DWORD origin, ULARGE_INTEGER *newPosition)
+        HRESULT STDMETHODCALLTYPE Seek(LARGE_INTEGER move, DWORD origin, ULARGE_INTEGER *newPosition) noexcept override try
         {
-            LARGE_INTEGER newPos = { 0 };
+            LONGLONG newPos = move.QuadPart;
             switch (origin)
             {
                 case Reference::CURRENT:
-                    m_relativePosition += move.u.LowPart;
-                    break;
-                case Reference::START:
-                    m_relativePosition = move.u.LowPart;
+                    newPos += static_cast<LONGLONG>(m_relativePosition);
                     break;
                 case Reference::END:
-                    m_relativePosition = m_streamSize;
+                    newPos += static_cast<LONGLONG>(m_streamSize);
                     break;
             }
-            m_relativePosition = std::max((std::uint64_t)0, std::min(m_relativePosition, static_cast<std::uint64_t>(m_streamSize)));
-            if (newPosition) { newPosition->QuadPart = (std::uint64_t)m_relativePosition; }
-        }        
-
-        HRESULT STDMETHODCALLTYPE Seek(LARGE_INTEGER move, DWORD origin, ULARGE_INTEGER *newPosition) noexcept override try
-        {
-            if (m_cacheBuffer.get() == nullptr)
-            {   ThrowHrIfFailed(m_stream->Seek(move, origin, newPosition));
-            }
-            // always call into cache seek to keep cache state aligned with the underlying stream state.
-            CacheSeek(move, origin, newPosition);
+            m_relativePosition = static_cast<std::uint64_t>(std::max(static_cast<LONGLONG>(0), std::min(newPos, static_cast<LONGLONG>(m_streamSize))));
+            LARGE_INTEGER li = { 0 };
+            li.QuadPart = static_cast<LONGLONG>(m_relativePosition);
+            ThrowHrIfFailed(m_stream->Seek(li, StreamBase::Reference::START, nullptr));
+            if (newPosition) { newPosition->QuadPart = m_relativePosition; }
             return static_cast<HRESULT>(Error::OK);
         } CATCH_RETURN();
 
-        void CacheRead(void* buffer, ULONG countBytes, ULONG* actualRead)
+        HRESULT STDMETHODCALLTYPE Read(void* buffer, ULONG countBytes, ULONG* actualRead) noexcept override try
         {
             ThrowErrorIf(Error::Stg_E_Invalidpointer, (buffer == nullptr), "bad input");
-            ULONG bytesToRead = std::min((std::uint32_t)countBytes, static_cast<std::uint32_t>((std::uint64_t)m_cacheBuffer->size() - m_relativePosition));
-            if (bytesToRead)
-            {
-                memcpy(buffer, reinterpret_cast<BYTE*>(m_cacheBuffer->data()) + m_relativePosition, bytesToRead);
-            }
+            ThrowErrorIf(MSIX::Error::SignatureInvalid, m_hashMismatch, "Signature hash doesn't match digest hash");
+            // Data after the hashed range must be hashed in order, catch up with the current position first.
+            HashSkippedData();
 
-            m_relativePosition += bytesToRead;
-            if (m_streamSize == m_relativePosition) { m_cacheBuffer = nullptr; }
-            if (actualRead) { *actualRead = bytesToRead; }
-        }
+            ULONG bytesRead = 0;
+            ThrowHrIfFailed(m_stream->Read(buffer, countBytes, &bytesRead));
+            ThrowErrorIf(MSIX::Error::SignatureInvalid, (bytesRead == 0) && (countBytes != 0) && (m_relativePosition < m_streamSize), "read failed");
+            HashRead(static_cast<std::uint8_t*>(buffer), bytesRead);
+            m_relativePosition += bytesRead;
 
-        HRESULT STDMETHODCALLTYPE Read(void* buffer, ULONG countBytes, ULONG* actualRead) noexcept override try
-        {
-            Validate();
-            if (m_cacheBuffer.get() == nullptr)
-            {   ThrowHrIfFailed(m_stream->Read(buffer, countBytes, actualRead));
-            }
-            else
-            {   CacheRead(buffer, countBytes, actualRead);
+            // Reaching the end of the range means all the data must have been checked
+            if (!m_validated && (m_relativePosition == m_streamSize) && (m_hashedBytes == m_streamSize))
+            {
+                ValidateHash();
             }
+            if (actualRead) { *actualRead = bytesRead; }
             return static_cast<HRESULT>(Error::OK);
         } CATCH_RETURN();
     };
@@ -37,4 +37,9 @@ namespace MSIX {
     };
 
     std::unique_ptr<ICompressionObject> CreateCompressionObject();
+
+    // Compression objects can keep the memory of an operation after Cleanup and reuse it when initialized again.
+    // Objects released to the pool are handed out again instead of creating a new one for every stream.
+    std::unique_ptr<ICompressionObject> AcquireCompressionObject();
+    void ReleaseCompressionObject(std::unique_ptr<ICompressionObject>&& compressionObject);
 }
\ No newline at end of file
@@ -0,0 +1,36 @@
+//
+//  Copyright (C) 2017 Microsoft.  All rights reserved.
+//  See LICENSE file in the project root for full license information.
+// 
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "AppxPackaging.hpp"
+#include "MSIXWindows.hpp"
+#include "ComHelper.hpp"
+#include "DirectoryObject.hpp"
+
+// internal interface
+// {51b2c456-aaa9-46d6-8ec9-298220559189}
+#ifndef WIN32
+interface IPackage : public IUnknown
+#else
+#include "Unknwn.h"
+#include "Objidl.h"
+class IPackage : public IUnknown
+#endif
+{
+public:
+    virtual void Unpack(MSIX_PACKUNPACK_OPTION options, const MSIX::ComPtr<IDirectoryObject>& to) = 0;
+    virtual std::vector<std::string>& GetFootprintFiles() = 0;
+
+    // Used to unpack the packages of a bundle in parallel. CreateView returns a view of the package over a clone of
+    // its stream, empty if the stream can't be cloned. The footprint files are unpacked on the calling thread, then
+    // the payload files can be unpacked from the view on another thread.
+    virtual MSIX::ComPtr<IStorageObject> CreateView() = 0;
+    virtual void UnpackFootprintFiles(MSIX_PACKUNPACK_OPTION options, const MSIX::ComPtr<IDirectoryObject>& to) = 0;
+    virtual void UnpackPayloadFiles(MSIX_PACKUNPACK_OPTION options, const MSIX::ComPtr<IDirectoryObject>& to, const MSIX::ComPtr<IStorageObject>& view) = 0;
+};
+MSIX_INTERFACE(IPackage, 0x51b2c456,0xaaa9,0x46d6,0x8e,0xc9,0x29,0x82,0x20,0x55,0x91,0x89);
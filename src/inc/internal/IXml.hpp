@@ -179,6 +179,25 @@ public:
 };
 MSIX_INTERFACE(IXmlDom, 0x0e7a446e,0xbaf7,0x44c1,0xb3,0x8a,0x21,0x6b,0xfa,0x18,0xa1,0xa8);
 
+// An element reported by IXmlFactory::ParseStream. It is only valid during the call to the handler.
+struct XmlStreamElement
+{
+    virtual ~XmlStreamElement() = default;
+    virtual std::string GetLocalName() = 0;
+    virtual std::string GetAttributeValue(XmlAttributeName attribute) = 0;
+    // Decodes the attribute into buffer and returns the number of bytes decoded.
+    virtual std::size_t GetBase64DecodedAttributeValue(XmlAttributeName attribute, std::uint8_t* buffer, std::size_t bufferSize) = 0;
+};
+
+// Receives the elements of a document parsed by IXmlFactory::ParseStream in document order.
+// depth is 0 for the root element.
+struct XmlStreamHandler
+{
+    virtual ~XmlStreamHandler() = default;
+    virtual void StartElement(std::size_t depth, XmlStreamElement& element) = 0;
+    virtual void EndElement(std::size_t depth) = 0;
+};
+
 // {f82a60ec-fbfc-4cb9-bc04-1a0fe2b4d5be}
 #ifndef WIN32
 interface IXmlFactory : public IUnknown
@@ -189,6 +208,9 @@ class IXmlFactory : public IUnknown
 {
 public:
     virtual MSIX::ComPtr<IXmlDom> CreateDomFromStream(XmlContentType footPrintType, const MSIX::ComPtr<IStream>& stream) = 0;
+    // Parses the stream without building a DOM and without schema validation, reporting its elements to handler.
+    // Returns false if the XML implementation doesn't support it, use CreateDomFromStream instead.
+    virtual bool ParseStream(XmlContentType footPrintType, const MSIX::ComPtr<IStream>& stream, XmlStreamHandler& handler) = 0;
 };
 MSIX_INTERFACE(IXmlFactory, 0xf82a60ec,0xfbfc,0x4cb9,0xbc,0x04,0x1a,0x0f,0xe2,0xb4,0xd5,0xbe);
 
@@ -224,9 +246,8 @@ namespace MSIX {
     };
 
     template <class T>
-    static T GetNumber(const ComPtr<IXmlElement>& element, XmlAttributeName attribute, T defaultValue)
+    static T GetNumber(const std::string& attributeValue, T defaultValue)
     {
-        const auto& attributeValue = element->GetAttributeValue(attribute);
         bool hasValue = !attributeValue.empty();
         T value = defaultValue;
         if (hasValue)
@@ -251,6 +272,18 @@ namespace MSIX {
         return value;
     }
 
+    template <class T>
+    static T GetNumber(const ComPtr<IXmlElement>& element, XmlAttributeName attribute, T defaultValue)
+    {
+        return GetNumber<T>(element->GetAttributeValue(attribute), defaultValue);
+    }
+
+    template <class T>
+    static T GetNumber(XmlStreamElement& element, XmlAttributeName attribute, T defaultValue)
+    {
+        return GetNumber<T>(element.GetAttributeValue(attribute), defaultValue);
+    }
+
 #ifdef USING_MSXML
     using XmlQueryNameCharType = wchar_t;
 #else
@@ -0,0 +1,30 @@
+//
+//  Copyright (C) 2019 Microsoft.  All rights reserved.
+//  See LICENSE file in the project root for full license information.
+//
+#pragma once
+
+#include <string>
+
+#include "AppxPackaging.hpp"
+#include "ComHelper.hpp"
+
+namespace MSIX {
+
+    // Index cache that keeps each entry in its own file, <directory>/<key>.idx. Entries are written to a
+    // temporary file that is then renamed, so readers never see a partial entry and mapped entries stay valid.
+    class DirectoryIndexCache final : public ComClass<DirectoryIndexCache, IMsixIndexCache>
+    {
+    public:
+        DirectoryIndexCache(const std::string& directory);
+
+        // IMsixIndexCache
+        HRESULT STDMETHODCALLTYPE GetEntry(LPCSTR key, IStream** entry) noexcept override;
+        HRESULT STDMETHODCALLTYPE SetEntry(LPCSTR key, IStream* entry) noexcept override;
+
+    protected:
+        std::string GetEntryName(LPCSTR key);
+
+        std::string m_directory;
+    };
+}
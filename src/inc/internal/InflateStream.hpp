@@ -7,6 +7,7 @@
 #include "StreamBase.hpp"
 #include "ComHelper.hpp"
 #include "ICompressionObject.hpp"
+#include "BlockCompression.hpp"
 
 #undef max
 #undef min
@@ -17,7 +18,9 @@
 
 namespace MSIX {
 
-    // This represents a LZW-compressed stream
+    // This represents a LZW-compressed stream. Seeking back inflates again from the beginning of the stream, or
+    // from the closest checkpoint before the seek position when the stream has checkpoints. Seeking forward past
+    // a checkpoint also starts inflating there.
     class InflateStream final : public StreamBase
     {
     public:
@@ -46,7 +49,12 @@ namespace MSIX {
         {   // The underlying ZipFileStream object knows, so go ask it.
             return m_stream.As<IStreamInternal>()->GetName();
         }
+
+        void SetCheckpoints(const std::vector<StreamCheckpoint>& checkpoints) override;
+
         void Cleanup();
+        const StreamCheckpoint* FindCheckpoint(std::uint64_t position, std::uint64_t after);
+        bool VerifyCheckpoint(const StreamCheckpoint& checkpoint);
 
         enum class State : size_t
         {
@@ -69,6 +77,13 @@ namespace MSIX {
         ULONG           m_inflateWindowPosition = 0;
         ULONGLONG       m_fileCurrentWindowPositionEnd = 0;
         ULONGLONG       m_fileCurrentPosition = 0;
+        // Where inflating starts, in the stream and in the compressed stream
+        ULONGLONG       m_restartPosition = 0;
+        ULONGLONG       m_restartSourcePosition = 0;
+
+        // Checkpoints by offset, each is verified the first time it is used
+        std::vector<StreamCheckpoint> m_checkpoints;
+        std::vector<bool> m_checkpointVerified;
 
         std::unique_ptr<ICompressionObject> m_compressionObject;
         CompressionStatus m_compressionStatus = CompressionStatus::Ok;
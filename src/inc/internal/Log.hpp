@@ -3,14 +3,39 @@
 //  See LICENSE file in the project root for full license information.
 // 
 #pragma once
+#include <cstdint>
 #include <string>
 
 namespace MSIX {
     namespace Global { 
         namespace Log {
+            // The log is kept per thread in a ring buffer that holds the last records only, so long running
+            // processes don't accumulate it and threads don't contend on it. Text and Clear only see the
+            // records of the calling thread.
+
+            // Records a failure. file must have static storage duration (__FILE__); details is copied.
+            void Append(std::uint32_t code, const char* file, int line, const char* details);
             void Append(const std::string& comment);
             std::string Text();
             void Clear();
+
+            // Returns the text of the calling thread's log and clears it. Used to hand the records
+            // logged by a worker thread over to the thread that waits for it.
+            std::string Take();
+
+            // Names the package part being processed by the calling thread while in scope, failures
+            // logged meanwhile record it.
+            class PartScope
+            {
+            public:
+                PartScope(const std::string& part);
+                ~PartScope();
+                PartScope(const PartScope&) = delete;
+                PartScope& operator=(const PartScope&) = delete;
+
+            protected:
+                const std::string* m_previous;
+            };
         }
     }
-}
\ No newline at end of file
+}
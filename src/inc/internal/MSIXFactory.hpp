@@ -7,6 +7,9 @@
 #include "ComHelper.hpp"
 
 #include <vector>
+#include <memory>
+
+namespace MSIX { struct TrustStore; class ThreadPool; }
 
 // internal interface
 // {1f850db4-32b8-4db6-8bf4-5a897eb611f1}
@@ -25,5 +28,11 @@ public:
     virtual MSIX::ComPtr<IStream> GetResource(const std::string& resource) = 0;
     virtual HRESULT MarshalOutWstring(std::wstring& internal, LPWSTR* result) = 0;
     virtual HRESULT MarshalOutStringUtf8(std::string& internal, LPSTR* result) = 0;
+    virtual std::shared_ptr<MSIX::TrustStore> GetTrustStore() = 0;
+    // Returns the cache set with MSIX_FACTORY_EXTENSION_INDEX_CACHE, empty if there is none.
+    virtual MSIX::ComPtr<IMsixIndexCache> GetIndexCache() = 0;
+    // Pool that inflates the blocks of large payload files, created when first needed. Streams keep it alive,
+    // so its threads are joined when the factory and the last stream are released, not at process exit.
+    virtual std::shared_ptr<MSIX::ThreadPool> GetInflateThreadPool() = 0;
 };
 MSIX_INTERFACE(IMsixFactory, 0x1f850db4,0x32b8,0x4db6,0x8b,0xf4,0x5a,0x89,0x7e,0xb6,0x11,0xf1);
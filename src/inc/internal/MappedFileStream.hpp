@@ -0,0 +1,121 @@
+//
+//  Copyright (C) 2019 Microsoft.  All rights reserved.
+//  See LICENSE file in the project root for full license information.
+// 
+#pragma once
+
+#include <memory>
+#include <string>
+
+#include "Exceptions.hpp"
+#include "StreamBase.hpp"
+
+namespace MSIX {
+
+    // Read only stream over a memory mapped file. Clones share the mapping and have their own seek
+    // pointer, and GetData exposes the mapping so range streams can read from it without moving
+    // any seek pointer. This lets several readers read the same file at the same time.
+    // The file must not be truncated while it is mapped.
+    class MappedFileStream final : public StreamBase
+    {
+    public:
+        struct Mapping
+        {
+            Mapping(std::string fileName) : name(std::move(fileName)) {}
+            ~Mapping();
+
+            std::string name;
+            std::uint8_t* data = nullptr; // nullptr for empty files
+            std::uint64_t size = 0;
+        };
+
+        // Maps the file. Returns nullptr if the file exists but can't be mapped, callers should
+        // fall back to FileStream.
+        static std::shared_ptr<Mapping> MapFile(const std::string& name);
+
+        MappedFileStream(const std::shared_ptr<Mapping>& mapping) : m_mapping(mapping) {}
+
+        // IStream
+        HRESULT STDMETHODCALLTYPE Clone(IStream** stream) noexcept override try
+        {
+            ThrowErrorIf(Error::InvalidParameter, (stream == nullptr || *stream != nullptr), "bad pointer");
+            auto clone = ComPtr<IStream>::Make<MappedFileStream>(m_mapping);
+            LARGE_INTEGER pos = { 0 };
+            pos.QuadPart = m_position;
+            ThrowHrIfFailed(clone->Seek(pos, StreamBase::Reference::START, nullptr));
+            *stream = clone.Detach();
+            return static_cast<HRESULT>(Error::OK);
+        } CATCH_RETURN();
+
+        // Writes straight from the mapping, without copying to an intermediate buffer.
+        HRESULT STDMETHODCALLTYPE CopyTo(IStream *stream, ULARGE_INTEGER bytesCount, ULARGE_INTEGER *bytesRead, ULARGE_INTEGER *bytesWritten) noexcept override try
+        {
+            if (bytesRead) { bytesRead->QuadPart = 0; }
+            if (bytesWritten) { bytesWritten->QuadPart = 0; }
+            ThrowErrorIf(Error::InvalidParameter, (nullptr == stream), "invalid parameter.");
+
+            std::uint64_t toCopy = std::min(static_cast<std::uint64_t>(bytesCount.QuadPart), GetRemaining());
+            std::uint64_t written = 0;
+            while (written < toCopy)
+            {
+                auto chunk = static_cast<ULONG>(std::min(toCopy - written, static_cast<std::uint64_t>(std::numeric_limits<ULONG>::max())));
+                ULONG copy = 0;
+                ThrowHrIfFailed(stream->Write(m_mapping->data + m_position, chunk, &copy));
+                ThrowErrorIf(Error::FileWrite, (copy == 0), "write failed");
+                m_position += copy;
+                written += copy;
+            }
+
+            if (bytesRead)      { bytesRead->QuadPart = written; }
+            if (bytesWritten)   { bytesWritten->QuadPart = written; }
+            return static_cast<HRESULT>(Error::OK);
+        } CATCH_RETURN();
+
+        HRESULT STDMETHODCALLTYPE Read(void* buffer, ULONG countBytes, ULONG* bytesRead) noexcept override try
+        {
+            ULONG toRead = static_cast<ULONG>(std::min(static_cast<std::uint64_t>(countBytes), GetRemaining()));
+            if (toRead > 0)
+            {
+                ThrowErrorIf(Error::InvalidParameter, (buffer == nullptr), "bad pointer");
+                memcpy(buffer, m_mapping->data + m_position, toRead);
+                m_position += toRead;
+            }
+            if (bytesRead) { *bytesRead = toRead; }
+            return static_cast<HRESULT>(Error::OK);
+        } CATCH_RETURN();
+
+        HRESULT STDMETHODCALLTYPE Seek(LARGE_INTEGER move, DWORD origin, ULARGE_INTEGER* newPosition) noexcept override try
+        {
+            LONGLONG newPos = move.QuadPart;
+            switch (origin)
+            {
+                case Reference::CURRENT:
+                    newPos += static_cast<LONGLONG>(m_position);
+                    break;
+                case Reference::END:
+                    newPos += static_cast<LONGLONG>(m_mapping->size);
+                    break;
+            }
+            ThrowErrorIf(Error::FileSeek, (newPos < 0), "seek failed");
+            // Same as fseek, seeking past the end is allowed and reads return no data.
+            m_position = static_cast<std::uint64_t>(newPos);
+            if (newPosition) { newPosition->QuadPart = m_position; }
+            return static_cast<HRESULT>(Error::OK);
+        } CATCH_RETURN();
+
+        // IStreamInternal
+        std::uint64_t GetSize() override { return m_mapping->size; }
+        std::string GetName() override { return m_mapping->name; }
+        const std::uint8_t* GetData() override { return m_mapping->data; }
+
+    protected:
+        // Bytes between the seek pointer and the end of the file, 0 if it is past the end
+        std::uint64_t GetRemaining() const
+        {
+            return (m_position < m_mapping->size) ? (m_mapping->size - m_position) : 0;
+        }
+
+        std::shared_ptr<Mapping> m_mapping;
+        std::uint64_t m_position = 0;
+    };
+}
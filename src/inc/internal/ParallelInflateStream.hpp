@@ -0,0 +1,84 @@
+//
+//  Copyright (C) 2019 Microsoft.  All rights reserved.
+//  See LICENSE file in the project root for full license information.
+//
+#pragma once
+
+#include <deque>
+#include <future>
+#include <vector>
+
+#include "Exceptions.hpp"
+#include "StreamBase.hpp"
+#include "BlockMapStream.hpp"
+#include "ThreadPool.hpp"
+
+namespace MSIX {
+
+    // Read only stream over a compressed file of a package that inflates its blocks on a thread pool. Packages
+    // compress every block with a full flush, so each block inflates by itself. The calling thread reads the
+    // compressed blocks ahead of the read position and the pool inflates and hashes them, the data is returned
+    // in order. If a block doesn't inflate by itself, the file wasn't compressed that way: the rest of it is read
+    // from fallback, the block map stream over the inflate stream. A block that inflates by itself but doesn't
+    // match its hash is corrupt.
+    class ParallelInflateStream final : public StreamBase
+    {
+    public:
+        // Files with fewer blocks aren't worth it
+        static const std::size_t MinimumBlockCount = 16;
+
+        // Without threads in threadPool, the blocks are inflated by the calling thread as they are read.
+        ParallelInflateStream(const ComPtr<IStream>& rawStream, const BlockRange& blocks, std::uint64_t size, const ComPtr<IStream>& fallback,
+            const std::shared_ptr<ThreadPool>& threadPool);
+
+        // IStream
+        HRESULT STDMETHODCALLTYPE Read(void* buffer, ULONG countBytes, ULONG* bytesRead) noexcept override;
+        HRESULT STDMETHODCALLTYPE Seek(LARGE_INTEGER move, DWORD origin, ULARGE_INTEGER* newPosition) noexcept override;
+
+        // IStreamInternal
+        std::uint64_t GetSize() override { return m_fallback.As<IStreamInternal>()->GetSize(); }
+        bool IsCompressed() override { return m_fallback.As<IStreamInternal>()->IsCompressed(); }
+        std::string GetName() override { return m_fallback.As<IStreamInternal>()->GetName(); }
+
+    protected:
+        struct InflatedBlock
+        {
+            std::vector<std::uint8_t> data; // empty if the block can't be used
+            bool corrupt;                   // inflated by itself, but doesn't match its hash
+        };
+
+        struct PendingBlock
+        {
+            std::size_t index;
+            std::future<InflatedBlock> block;
+        };
+
+        struct BatchBlock
+        {
+            std::size_t index;
+            std::vector<std::uint8_t> compressed;
+            std::size_t size;
+            std::array<std::uint8_t, BLOCKMAP_HASH_SIZE> hash;
+            std::promise<InflatedBlock> inflated;
+        };
+
+        void ReadBlock(std::size_t index);
+        void SubmitBlocks(std::size_t first);
+        // Submits the blocks to the pool as one task and clears batch
+        void SubmitBatch(std::vector<BatchBlock>& batch);
+
+        ComPtr<IStream> m_rawStream;
+        ComPtr<IStream> m_fallback;
+        std::shared_ptr<ThreadPool> m_threadPool;
+        std::vector<Block> m_blocks;
+        std::size_t m_blockCount;
+        std::vector<std::uint64_t> m_compressedOffsets;
+        std::uint64_t m_size;
+        std::uint64_t m_position = 0;
+        bool m_useFallback = false;
+
+        std::deque<PendingBlock> m_pending;
+        std::size_t m_currentIndex = 0;
+        std::vector<std::uint8_t> m_current; // inflated data of block m_currentIndex, empty if there isn't one
+    };
+}
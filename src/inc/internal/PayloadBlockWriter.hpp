@@ -0,0 +1,65 @@
+//
+//  Copyright (C) 2019 Microsoft.  All rights reserved.
+//  See LICENSE file in the project root for full license information.
+// 
+#pragma once
+
+#include "AppxPackaging.hpp"
+#include "ComHelper.hpp"
+#include "AppxBlockMapWriter.hpp"
+#include "ThreadPool.hpp"
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace MSIX {
+
+    // Writes the data of a file to its stream in the zip, a block at a time, and adds its blocks to the block map.
+    // Used by the package and bundle writers.
+    //
+    // Blocks are independent of each other, every compressed block ends with a full flush and its hash only covers
+    // its own data. They are read and written in order on the calling thread, while compressing and hashing is done
+    // by the thread pool, a batch of blocks at a time so they can be hashed together. Limits how many blocks are in
+    // memory at the same time.
+    class PayloadBlockWriter final
+    {
+    public:
+        // The compressed block at the same position of the same file in a base package, if any.
+        struct BaseBlock
+        {
+            std::vector<std::uint8_t> compressed;
+            const std::uint8_t* hash = nullptr;
+        };
+
+        // Returns the base block of a block of the file. Called in order of the blocks, on the calling thread.
+        using BaseBlockSource = std::function<BaseBlock(std::size_t blockIndex)>;
+
+        // blockMapWriter can be null for files that aren't in the block map.
+        PayloadBlockWriter(ThreadPool& threadPool, APPX_COMPRESSION_OPTION compressionOpt, BlockMapWriter* blockMapWriter);
+
+        // Writes size bytes of stream to zipFileStream, followed by the deflate stream termination if the file
+        // is compressed. A base block is used instead of deflating the block when it is the same data.
+        // Returns the crc32 of the uncompressed data.
+        std::uint32_t Write(IStream* stream, std::uint64_t size, const ComPtr<IStream>& zipFileStream,
+            const BaseBlockSource& baseBlockSource = nullptr);
+
+    protected:
+        struct PayloadBlock
+        {
+            std::vector<std::uint8_t> data;       // uncompressed data of the block
+            std::vector<std::uint8_t> compressed; // deflated data, only set for compressed files
+            std::vector<std::uint8_t> hash;       // SHA256 of the uncompressed data, only set for files in the blockmap
+            std::uint32_t crc = 0;                // crc32 of the uncompressed data
+        };
+
+        // Hashes the blocks of a batch together, then compresses each of them
+        static std::vector<PayloadBlock> ProcessBlocks(std::vector<std::vector<std::uint8_t>>&& data,
+            std::vector<BaseBlock>&& baseBlocks, APPX_COMPRESSION_OPTION compressionOpt, bool computeHash);
+        static void ProcessBlock(PayloadBlock& block, BaseBlock&& baseBlock, APPX_COMPRESSION_OPTION compressionOpt);
+
+        ThreadPool& m_threadPool;
+        APPX_COMPRESSION_OPTION m_compressionOpt;
+        BlockMapWriter* m_blockMapWriter;
+    };
+}
@@ -0,0 +1,67 @@
+//
+//  Copyright (C) 2019 Microsoft.  All rights reserved.
+//  See LICENSE file in the project root for full license information.
+//
+#pragma once
+
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "Exceptions.hpp"
+#include "StreamBase.hpp"
+
+namespace MSIX {
+
+    // Read only stream over an IMsixRangeSource. Reads are served from the ranges read from the source. A read
+    // that isn't read reads at least MinimumReadSize bytes from the source, and continues along the read order
+    // up to MaximumReadSize bytes, so the many small reads of the zip reader and inflate streams read the
+    // source a few times. A read near the end of the source reads back from it instead, where zip files start.
+    // Clones share the ranges read and the read order; the source is read by one of them at a time.
+    class RangeSourceStream final : public StreamBase
+    {
+    public:
+        static const std::uint64_t MinimumReadSize = 256 * 1024;
+        static const std::uint64_t MaximumReadSize = 4 * 1024 * 1024;
+        // Oldest ranges are dropped above this size
+        static const std::uint64_t CacheSize = 32 * 1024 * 1024;
+
+        struct Source
+        {
+            Source(IMsixRangeSource* rangeSource);
+
+            std::mutex mutex;
+            ComPtr<IMsixRangeSource> source;
+            std::uint64_t size = 0;
+            std::map<std::uint64_t, std::vector<std::uint8_t>> ranges; // by offset, never overlapping
+            std::deque<std::uint64_t> readOrder;                       // offsets of ranges, oldest first
+            std::uint64_t rangesSize = 0;
+            std::vector<ByteRange> expectedRanges;                     // by offset
+        };
+
+        RangeSourceStream(const std::shared_ptr<Source>& source) : m_source(source) {}
+
+        // IStream
+        HRESULT STDMETHODCALLTYPE Clone(IStream** stream) noexcept override;
+        HRESULT STDMETHODCALLTYPE Read(void* buffer, ULONG countBytes, ULONG* bytesRead) noexcept override;
+        HRESULT STDMETHODCALLTYPE Seek(LARGE_INTEGER move, DWORD origin, ULARGE_INTEGER* newPosition) noexcept override;
+
+        // IStreamInternal
+        std::uint64_t GetSize() override { return m_source->size; }
+        bool IsCompressed() override { return false; }
+        std::string GetName() override { return std::string(); }
+        void Prefetch(const std::vector<ByteRange>& ranges) override;
+        void SetReadOrder(const std::vector<ByteRange>& ranges) override;
+
+    protected:
+        // These must be called with the source locked
+        std::size_t ReadFromRanges(std::uint64_t offset, std::uint8_t* buffer, std::size_t size);
+        void ReadMissingRange(std::uint64_t offset, std::uint64_t size);
+        void ReadRange(std::uint64_t offset, std::uint64_t end);
+
+        std::shared_ptr<Source> m_source;
+        std::uint64_t m_position = 0;
+    };
+}
@@ -11,6 +11,8 @@
 #include <string>
 #include <map>
 #include <functional>
+#include <memory>
+#include <mutex>
 
 namespace MSIX {
 
@@ -18,11 +20,29 @@ namespace MSIX {
     class RangeStream : public StreamBase
     {
     public:
-        RangeStream(std::uint64_t offset, std::uint64_t size, IStream* stream) :
+        // For reading/unpack
+        // Each range stream keeps its own seek pointer. Range streams that share the underlying stream
+        // and are read from different threads must be given the same streamLock, which guards the
+        // seek and read of the underlying stream.
+        RangeStream(std::uint64_t offset, std::uint64_t size, IStream* stream, const std::shared_ptr<std::mutex>& streamLock = nullptr) :
             m_offset(offset),
             m_size(size),
-            m_stream(stream)
+            m_stream(stream),
+            m_streamLock(streamLock),
+            m_isReadOnly(true)
         {
+            // If the underlying stream is in memory, read straight from it. Range streams over the same
+            // stream then don't share its seek pointer.
+            ComPtr<IStreamInternal> internal;
+            HRESULT hr = m_stream->QueryInterface(UuidOfImpl<IStreamInternal>::iid, reinterpret_cast<void**>(&internal));
+            if (SUCCEEDED(hr))
+            {
+                const std::uint8_t* data = internal->GetData();
+                if (data != nullptr && m_offset <= internal->GetSize() && m_size <= internal->GetSize() - m_offset)
+                {
+                    m_data = data + m_offset;
+                }
+            }
         }
 
         // For writing/pack
@@ -63,6 +83,14 @@ namespace MSIX {
                 newPos.QuadPart = m_size;
             }
 
+            // Reads always seek the underlying stream first
+            if (m_isReadOnly)
+            {
+                m_relativePosition = static_cast<std::uint64_t>(newPos.QuadPart);
+                if (newPosition) { newPosition->QuadPart = m_relativePosition; }
+                return static_cast<HRESULT>(Error::OK);
+            }
+
             // Add in the underlying stream offset
             newPos.QuadPart += m_offset;
 
@@ -75,12 +103,28 @@ namespace MSIX {
 
         HRESULT STDMETHODCALLTYPE Read(void* buffer, ULONG countBytes, ULONG* bytesRead) noexcept override try
         {
+            if (m_data != nullptr)
+            {
+                ULONG amountToRead = static_cast<ULONG>(std::min(static_cast<std::uint64_t>(countBytes), m_size - m_relativePosition));
+                if (amountToRead > 0)
+                {
+                    memcpy(buffer, m_data + m_relativePosition, amountToRead);
+                    m_relativePosition += amountToRead;
+                }
+                if (bytesRead) { *bytesRead = amountToRead; }
+                return static_cast<HRESULT>(Error::OK);
+            }
+
             LARGE_INTEGER offset = {0};
             offset.QuadPart = m_relativePosition + m_offset;
-            ThrowHrIfFailed(m_stream->Seek(offset, StreamBase::START, nullptr));
-            ULONG amountToRead = std::min(countBytes, static_cast<ULONG>(m_size - m_relativePosition));
+            ULONG amountToRead = static_cast<ULONG>(std::min(static_cast<std::uint64_t>(countBytes), m_size - m_relativePosition));
             ULONG amountRead = 0;
-            ThrowHrIfFailed(m_stream->Read(buffer, amountToRead, &amountRead));
+            {
+                std::unique_lock<std::mutex> lock;
+                if (m_streamLock) { lock = std::unique_lock<std::mutex>(*m_streamLock); }
+                ThrowHrIfFailed(m_stream->Seek(offset, StreamBase::START, nullptr));
+                ThrowHrIfFailed(m_stream->Read(buffer, amountToRead, &amountRead));
+            }
             ThrowErrorIf(Error::FileRead, (amountToRead != amountRead), "Did not read as much as requested.");
             m_relativePosition += amountRead;
             if (bytesRead) { *bytesRead = amountRead; }
@@ -103,6 +147,9 @@ namespace MSIX {
             return static_cast<HRESULT>(Error::OK);
         } CATCH_RETURN();
 
+        // IStreamInternal
+        const std::uint8_t* GetData() override { return m_data; }
+
         std::uint64_t Size() { return m_size; }
 
     protected:
@@ -110,5 +157,8 @@ namespace MSIX {
         std::uint64_t m_size;
         std::uint64_t m_relativePosition = 0;
         ComPtr<IStream> m_stream;
+        std::shared_ptr<std::mutex> m_streamLock;
+        bool m_isReadOnly = false;
+        const std::uint8_t* m_data = nullptr;
     };
 }
\ No newline at end of file
@@ -0,0 +1,54 @@
+//
+//  Copyright (C) 2019 Microsoft.  All rights reserved.
+//  See LICENSE file in the project root for full license information.
+//
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace MSIX { namespace SHA256Kernel {
+
+    // SHA256 implementation used by the OpenSSL crypto layer. The compression function is selected when it is
+    // first used, from what the CPU supports: the SHA extensions of x86-64, then AVX2 for hashing several
+    // buffers at once, then portable code.
+
+    struct Context
+    {
+        std::uint32_t state[8];
+        std::uint8_t  buffer[64];
+        std::size_t   bufferSize;
+        std::uint64_t length;
+    };
+
+    void Init(Context& context);
+    void Update(Context& context, const std::uint8_t* data, std::size_t size);
+    void Final(Context& context, std::uint8_t digest[32]);
+
+    const std::size_t MaximumParallelCount = 8;
+
+    // Number of buffers HashParallel hashes at once, 1 if the CPU can't do better than one after the other.
+    // Never more than MaximumParallelCount.
+    std::size_t GetParallelCount();
+
+    // Hashes count buffers of the same size. count must not be greater than GetParallelCount().
+    void HashParallel(const std::uint8_t* const* data, std::size_t size, std::size_t count, std::uint8_t (*digests)[32]);
+
+    // Name of the compression function in use, for diagnostics.
+    const char* GetImplementationName();
+
+    enum class ImplementationKind
+    {
+        Portable,
+        Avx2,
+        ShaNi,
+    };
+
+    // Whether the CPU can run kind. Portable always runs.
+    bool IsSupported(ImplementationKind kind);
+
+    // Tests use these to run every implementation the CPU supports, not only the selected one. kind must be
+    // supported. Don't call them while other threads are hashing.
+    void ForceImplementation(ImplementationKind kind);
+    void ResetImplementation();
+} }
@@ -9,12 +9,23 @@
 
 #include <vector>
 #include <map>
+#include <memory>
 
 namespace MSIX {
 
+    // Trusted roots used to validate package signatures. Built once per factory and
+    // only read afterwards, so a single instance is shared by concurrent validations.
+    struct TrustStore;
+
     class SignatureValidator
     {
     public:
+        // Builds the trust store from the certificates in our resources plus any PEM
+        // certificates in additionalCertificates (which may be null).
+        static std::shared_ptr<TrustStore> CreateTrustStore(
+            IMsixFactory* factory,
+            const ComPtr<IStream>& additionalCertificates);
+
         static bool Validate(
             IMsixFactory* factory,
             MSIX_VALIDATION_OPTION option, 
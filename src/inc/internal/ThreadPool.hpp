@@ -0,0 +1,66 @@
+//
+//  Copyright (C) 2019 Microsoft.  All rights reserved.
+//  See LICENSE file in the project root for full license information.
+//
+#pragma once
+
+#include <cstddef>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace MSIX {
+
+    // Fixed size pool of worker threads. Work items are executed in the order they are
+    // submitted, results and exceptions are returned via the std::future from Submit.
+    // A pool created with 0 threads runs every work item inline on the calling thread.
+    class ThreadPool final
+    {
+    public:
+        explicit ThreadPool(std::size_t threadCount);
+        ~ThreadPool();
+
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+
+        // Number of worker threads a pool should use on this machine. Returns 0 if there's
+        // nothing to gain from using threads.
+        static std::size_t DefaultThreadCount();
+
+        std::size_t GetThreadCount() const { return m_workers.size(); }
+
+        template <typename TWork>
+        std::future<typename std::result_of<TWork()>::type> Submit(TWork&& work)
+        {
+            using TResult = typename std::result_of<TWork()>::type;
+            // std::function must be copyable, std::packaged_task is not.
+            auto task = std::make_shared<std::packaged_task<TResult()>>(std::forward<TWork>(work));
+            auto result = task->get_future();
+            if (m_workers.empty())
+            {
+                (*task)();
+            }
+            else
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_queue.emplace_back([task]() { (*task)(); });
+                m_hasWork.notify_one();
+            }
+            return result;
+        }
+
+    protected:
+        void Run();
+
+        std::vector<std::thread> m_workers;
+        std::deque<std::function<void()>> m_queue;
+        std::mutex m_mutex;
+        std::condition_variable m_hasWork;
+        bool m_stopping = false;
+    };
+}
@@ -18,6 +18,9 @@ namespace MSIX {
     public:
         VectorStream(std::vector<std::uint8_t>* data) : m_data(data) {}
 
+        // Takes ownership of data
+        VectorStream(std::vector<std::uint8_t>&& data) : m_ownedData(std::move(data)), m_data(&m_ownedData) {}
+
         HRESULT STDMETHODCALLTYPE Read(void* buffer, ULONG countBytes, ULONG* bytesRead) noexcept override try
         {
             ULONG amountToRead = std::min(countBytes, static_cast<ULONG>(m_data->size() - m_offset));
@@ -67,6 +70,7 @@ namespace MSIX {
 
     protected:
         ULONG m_offset = 0;
+        std::vector<std::uint8_t> m_ownedData;
         std::vector<std::uint8_t>* m_data;
     };
 } // namespace MSIX
\ No newline at end of file
@@ -24,8 +24,9 @@ namespace MSIX {
             bool isCompressed,
             std::uint64_t offset,
             std::uint64_t size,
-            IStream* stream // this is the actual zip file stream
-        ) : m_isCompressed(isCompressed), RangeStream(offset, size, stream), m_name(std::move(name))
+            IStream* stream, // this is the actual zip file stream
+            const std::shared_ptr<std::mutex>& streamLock = nullptr // shared by the streams of the zip file, see RangeStream
+        ) : m_isCompressed(isCompressed), RangeStream(offset, size, stream, streamLock), m_name(std::move(name))
         {
         }
 
@@ -39,6 +40,25 @@ namespace MSIX {
             THROW_IF_PACK_NOT_ENABLED
         }
 
+        // IStream
+        // The clone reads from a clone of the zip file stream, see FileStream::Clone.
+        HRESULT STDMETHODCALLTYPE Clone(IStream** stream) noexcept override try
+        {
+            ThrowErrorIf(Error::InvalidParameter, (stream == nullptr || *stream != nullptr), "bad pointer");
+            ComPtr<IStream> zipStream;
+            HRESULT hr = m_stream->Clone(&zipStream);
+            if (FAILED(hr))
+            {
+                return hr;
+            }
+            auto clone = ComPtr<IStream>::Make<ZipFileStream>(m_name, m_isCompressed, m_offset, m_size, zipStream.Get());
+            LARGE_INTEGER pos = { 0 };
+            pos.QuadPart = m_relativePosition;
+            ThrowHrIfFailed(clone->Seek(pos, StreamBase::Reference::START, nullptr));
+            *stream = clone.Detach();
+            return static_cast<HRESULT>(Error::OK);
+        } CATCH_RETURN();
+
         // IStreamInternal
         std::uint64_t GetSize() override { return m_size; }
         bool IsCompressed() override { return m_isCompressed; }
@@ -431,12 +431,16 @@ namespace MSIX {
     public:
         EndCentralDirectoryRecord();
 
+        // Sets the values of the central directory that aren't stored in the zip64 end of central directory record
+        void SetData(std::uint64_t numCentralDirs, std::uint64_t sizeCentralDir, std::uint64_t offsetStartCentralDirectory);
+
         void Read(const ComPtr<IStream>& stream);
 
         bool GetIsZip64() const noexcept { return m_isZip64; }
 
         std::uint64_t GetNumberOfCentralDirectoryEntries() noexcept { return static_cast<std::uint64_t>(Field<3>().get()); }
         std::uint64_t GetStartOfCentralDirectory()         noexcept { return static_cast<std::uint64_t>(Field<6>().get()); }
+        std::uint64_t GetSizeOfCentralDirectory()          noexcept { return static_cast<std::uint64_t>(Field<5>().get()); }
 
     protected:
         void SetSignature(std::uint32_t value)                      noexcept { Field<0>() = value; }
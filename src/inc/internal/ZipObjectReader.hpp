@@ -8,23 +8,83 @@
 #include "ComHelper.hpp"
 #include "ZipObject.hpp"
 
+#include <string>
 #include <vector>
 #include <map>
 #include <memory>
+#include <mutex>
+
+// internal interface
+// {6f6b2a4e-3c35-4a8e-9b0a-7e2d7f1c5b21}
+#ifndef WIN32
+interface IZipReader : public IUnknown
+#else
+#include "Unknwn.h"
+#include "Objidl.h"
+class IZipReader : public IUnknown
+#endif
+{
+public:
+    // Creates a reader that shares the parsed central directory but reads from a clone of the zip stream,
+    // so files can be read from it and from this reader at the same time on different threads.
+    // Returns an empty ComPtr if the zip stream doesn't support Clone.
+    virtual MSIX::ComPtr<IStorageObject> CreateView() = 0;
+
+    // Returns a stream over the file records that precede signatureFile, the data covered by the AXPC digest
+    // of the package signature. Reading it reads the zip stream sequentially from the start.
+    virtual MSIX::ComPtr<IStream> GetFileRecordsStream(const std::string& signatureFile) = 0;
+
+    // Returns the central directory as it was before signatureFile was added to the zip file, the data
+    // covered by the AXCD digest of the package signature.
+    virtual MSIX::ComPtr<IStream> GetCentralDirectoryStream(const std::string& signatureFile) = 0;
+
+    // Returns the SHA256 of the central directory and the end of central directory records. It identifies
+    // the files of the zip file, including their sizes and CRCs, without reading them.
+    virtual std::vector<std::uint8_t> GetCentralDirectoryHash() = 0;
+
+    // Returns a stream over the data of fileName as it is stored in the zip file, without inflating it.
+    // Returns an empty ComPtr if the file isn't in the zip file.
+    virtual MSIX::ComPtr<IStream> GetRawFile(const std::string& fileName) = 0;
+
+    // Reads the records of fileNames ahead of time when reading the zip stream is expensive, see
+    // IStreamInternal::Prefetch. Files that aren't in the zip file are ignored.
+    virtual void PrefetchFiles(const std::vector<std::string>& fileNames) = 0;
+};
+MSIX_INTERFACE(IZipReader, 0x6f6b2a4e,0x3c35,0x4a8e,0x9b,0x0a,0x7e,0x2d,0x7f,0x1c,0x5b,0x21);
 
 namespace MSIX {
     // This represents a raw stream over a.zip file.
-    class ZipObjectReader final : public ComClass<ZipObjectReader, IStorageObject>, ZipObject
+    // GetFile can be called and the returned streams read from different threads. Every file stream keeps
+    // its own seek pointer; reads of the zip stream are serialized unless it is in memory.
+    class ZipObjectReader final : public ComClass<ZipObjectReader, IStorageObject, IZipReader>, ZipObject
     {
     public:
         ZipObjectReader(const ComPtr<IStream>& stream);
 
+        // Creates a reader over stream for an already parsed zip file. Used by CreateView.
+        ZipObjectReader(const ZipObject& zipObject, const ComPtr<IStream>& stream);
+
         // IStorageObject methods
         std::vector<std::string> GetFileNames(FileNameOptions options) override;
         ComPtr<IStream> GetFile(const std::string& fileName) override;
         std::string GetFileName() override;
 
+        // IZipReader
+        ComPtr<IStorageObject> CreateView() override;
+        ComPtr<IStream> GetFileRecordsStream(const std::string& signatureFile) override;
+        ComPtr<IStream> GetCentralDirectoryStream(const std::string& signatureFile) override;
+        std::vector<std::uint8_t> GetCentralDirectoryHash() override;
+        ComPtr<IStream> GetRawFile(const std::string& fileName) override;
+        void PrefetchFiles(const std::vector<std::string>& fileNames) override;
+
     protected:
+        ComPtr<IStream> CreateRawFileStream(const std::string& fileName, CentralDirectoryFileHeader& centralFileHeader);
+        // Returns the range of the zip stream of each file record, from its local file header to the next record.
+        std::map<std::string, ByteRange> GetFileRecordRanges();
+        ComPtr<IStreamInternal> GetStreamInternal();
+
         std::map<std::string, ComPtr<IStream>> m_streams;
+        std::mutex m_streamsMutex;
+        std::shared_ptr<std::mutex> m_streamLock = std::make_shared<std::mutex>();
     };
 }
@@ -26,9 +26,14 @@ class IZipWriter : public IUnknown
 #endif
 {
 public:
-    // Writes the lfh header to the stream and return the size of the header
+    // Writes the lfh header to the stream and return the size of the header and the stream for the file data.
+    // The data is written as is, if isCompressed is true the caller is responsible of writing deflated data.
     virtual std::pair<std::uint32_t, MSIX::ComPtr<IStream>> PrepareToAddFile(const std::string& name, bool isCompressed) = 0;
 
+    // Returns the offset in the zip file where the data of the file being added starts.
+    // Must be called between PrepareToAddFile and EndFile.
+    virtual std::uint64_t GetFileDataOffset() = 0;
+
     // Ends the file, rewrites the LFH or writes data descriptor and adds an entry
     // to the central directories map
     virtual void EndFile(std::uint32_t crc, std::uint64_t compressedSize, std::uint64_t uncompressedSize, bool forceDataDescriptor) = 0;
@@ -55,6 +60,7 @@ namespace MSIX {
 
         // IZipWriter
         std::pair<std::uint32_t, ComPtr<IStream>> PrepareToAddFile(const std::string& name, bool isCompressed) override;
+        std::uint64_t GetFileDataOffset() override;
         void EndFile(std::uint32_t crc, std::uint64_t compressedSize, std::uint64_t uncompressedSize, bool forceDataDescriptor) override;
         void Close() override;
 
@@ -70,4 +76,4 @@ namespace MSIX {
         std::pair<std::uint64_t, LocalFileHeader> m_lastLFH;
         std::vector<std::string> m_fileNameSequence;
     };
-}
\ No newline at end of file
+}
\ No newline at end of file
@@ -1199,6 +1199,9 @@ interface IMsixElementEnumerator;
 interface IMsixFactoryOverrides;
 interface IMsixStreamFactory;   
 interface IMsixApplicabilityLanguagesEnumerator;
+interface IMsixIndexCache;
+interface IMsixPackageWriterBasePackage;
+interface IMsixRangeSource;
 
 MSIX_INTERFACE(IMsixDocumentElement,0xe8900e0e,0x1dfd,0x4728,0x83,0x52,0xaa,0xda,0xeb,0xbf,0x00,0x65);
 MSIX_INTERFACE(IMsixElement,0x5b6786ff,0x6145,0x4f0e,0xb8,0xc9,0x8e,0x03,0xaa,0xcb,0x60,0xd0);
@@ -1206,6 +1209,9 @@ MSIX_INTERFACE(IMsixElementEnumerator,0x7e7ea105,0xa4f9,0x4c12,0x9e,0xfa,0x98,0x
 MSIX_INTERFACE(IMsixFactoryOverrides,0x0acedbdb,0x57cd,0x4aca,0x8c,0xee,0x33,0xfa,0x52,0x39,0x43,0x16);
 MSIX_INTERFACE(IMsixStreamFactory,0xc74f4821,0x3b82,0x4ad5,0x98,0xea,0x3d,0x52,0x68,0x1a,0xff,0x56);
 MSIX_INTERFACE(IMsixApplicabilityLanguagesEnumerator,0xbfc4655a,0xbe7a,0x456a,0xbc,0x4e,0x2a,0xf9,0x48,0x1e,0x84,0x32);
+MSIX_INTERFACE(IMsixIndexCache,0x3d9c6b1e,0x8f47,0x4c2a,0x9e,0x51,0x0b,0x7a,0x64,0xd2,0x93,0xc8);
+MSIX_INTERFACE(IMsixPackageWriterBasePackage,0x14297d4a,0x5cef,0x4b83,0x92,0xde,0x42,0xb6,0xb8,0xb2,0x36,0xf2);
+MSIX_INTERFACE(IMsixRangeSource,0xd8a4d975,0xf089,0x4848,0x8d,0xee,0x23,0x62,0xf4,0x94,0x49,0x60);
 
 extern "C"{
 
@@ -1278,6 +1284,8 @@ extern "C"{
     {
         MSIX_FACTORY_EXTENSION_STREAM_FACTORY = 0x1,
         MSIX_FACTORY_EXTENSION_APPLICABILITY_LANGUAGES = 0x2,
+        MSIX_FACTORY_EXTENSION_TRUSTED_CERTIFICATES = 0x3,
+        MSIX_FACTORY_EXTENSION_INDEX_CACHE = 0x4,
     } MSIX_FACTORY_EXTENSION;
 
     // {0acedbdb-57cd-4aca-8cee-33fa52394316}
@@ -1328,6 +1336,65 @@ extern "C"{
     };
 #endif  /* __IMsixApplicabilityLanguagesEnumerator_INTERFACE_DEFINED__ */
 
+#ifndef __IMsixIndexCache_INTERFACE_DEFINED__
+#define __IMsixIndexCache_INTERFACE_DEFINED__
+
+    // Stores the parsed block maps of the packages opened by package readers, so reopening a package
+    // doesn't parse its AppxBlockMap.xml again. Keys are lowercase hexadecimal strings derived from the
+    // package central directory and signature. Entries are only valid for the library that wrote them.
+    // Entries are trusted as they are, so the cache must only be writable by whoever trusts its content.
+    // {3d9c6b1e-8f47-4c2a-9e51-0b7a64d293c8}
+    interface IMsixIndexCache : public IUnknown
+    {
+    public:
+        // Returns S_OK and a null stream if there is no entry for key.
+        virtual HRESULT STDMETHODCALLTYPE GetEntry(
+            /* [in] */ LPCSTR key,
+            /* [retval][out] */ IStream** entry) noexcept = 0;
+
+        virtual HRESULT STDMETHODCALLTYPE SetEntry(
+            /* [in] */ LPCSTR key,
+            /* [in] */ IStream* entry) noexcept = 0;
+    };
+#endif  /* __IMsixIndexCache_INTERFACE_DEFINED__ */
+
+#ifndef __IMsixPackageWriterBasePackage_INTERFACE_DEFINED__
+#define __IMsixPackageWriterBasePackage_INTERFACE_DEFINED__
+
+    // Implemented by package writers. A base package is a package built from a previous version of the payload.
+    // Compressed blocks of payload files added after SetBasePackage are copied from the file with the same name in
+    // the base package when their block map hash matches the new data, instead of being compressed again. Every
+    // copied block is inflated and compared with the new data first, so the base package doesn't need to be trusted.
+    // {14297d4a-5cef-4b83-92de-42b6b8b236f2}
+    interface IMsixPackageWriterBasePackage : public IUnknown
+    {
+    public:
+        virtual HRESULT STDMETHODCALLTYPE SetBasePackage(
+            /* [in] */ IStream* basePackage) noexcept = 0;
+    };
+#endif  /* __IMsixPackageWriterBasePackage_INTERFACE_DEFINED__ */
+
+#ifndef __IMsixRangeSource_INTERFACE_DEFINED__
+#define __IMsixRangeSource_INTERFACE_DEFINED__
+
+    // Reads byte ranges of a package that isn't a local file, for example with HTTP range requests.
+    // See CreateStreamOnRangeSource. Every call is expected to be expensive, so the stream reads large ranges and
+    // few of them. Calls are serialized.
+    // {d8a4d975-f089-4848-8dee-2362f4944960}
+    interface IMsixRangeSource : public IUnknown
+    {
+    public:
+        virtual HRESULT STDMETHODCALLTYPE GetSize(
+            /* [retval][out] */ UINT64* size) noexcept = 0;
+
+        // Fills buffer with the size bytes at offset. The range is always within the size of the source.
+        virtual HRESULT STDMETHODCALLTYPE ReadRange(
+            /* [in] */ UINT64 offset,
+            /* [in] */ UINT32 size,
+            /* [out] */ BYTE* buffer) noexcept = 0;
+    };
+#endif  /* __IMsixRangeSource_INTERFACE_DEFINED__ */
+
 } // extern "C"
 
 // Specific to MSIX SDK. UTF8 variant of AppxPackaging interfaces
@@ -1670,6 +1737,9 @@ enum MSIX_VALIDATION_OPTION
                                                                   // no schema validation is done, but it needs to be
                                                                   // valid xml.
         MSIX_VALIDATION_OPTION_SKIPPACKAGEVALIDATION       = 0x8,
+        MSIX_VALIDATION_OPTION_VERIFYCONTAINERDIGESTS      = 0x10, // Hash the whole package in one sequential pass and check it
+                                                                   // against the AXPC and AXCD digests of the signature before
+                                                                   // any file is read. Ignored with MSIX_VALIDATION_OPTION_SKIPSIGNATURE.
     }   MSIX_VALIDATION_OPTION;
 
 typedef /* [v1_enum] */
@@ -1677,7 +1747,10 @@ enum MSIX_PACKUNPACK_OPTION
     {
         MSIX_PACKUNPACK_OPTION_NONE                    = 0x0,
         MSIX_PACKUNPACK_OPTION_CREATEPACKAGESUBFOLDER  = 0x1,
-        MSIX_PACKUNPACK_OPTION_UNPACKWITHFLATSTRUCTURE = 0x2
+        MSIX_PACKUNPACK_OPTION_UNPACKWITHFLATSTRUCTURE = 0x2,
+        MSIX_PACKUNPACK_OPTION_PARALLELUNPACK          = 0x4, // Extract payload files and bundle packages on multiple
+                                                              // threads. Requires a stream that supports Clone, like the
+                                                              // ones from CreateStreamOnFile.
     }   MSIX_PACKUNPACK_OPTION;
 
 typedef /* [v1_enum] */
@@ -1720,6 +1793,12 @@ enum MSIX_FACTORY_OPTIONS
 {
     MSIX_FACTORY_OPTION_NONE = 0x0,
     MSIX_FACTORY_OPTION_WRITER_ENABLE_FILE_HASH = 0x1,  // The package writer will compute full file hash and add <FileHash> element in block map xml
+    MSIX_FACTORY_OPTION_READER_LAZY_OPEN = 0x2,         // Package readers parse the content types, block map and manifest and index the
+                                                        // payload files when they are first used, instead of when they are created.
+                                                        // Reading the manifest only reads the signature, the block map and the manifest.
+                                                        // Errors in the other parts are reported by the first call that needs them.
+    MSIX_FACTORY_OPTION_READER_PARALLEL_INFLATE = 0x4,  // Payload streams of large compressed files inflate and hash their blocks on
+                                                        // several threads, ahead of the read position.
 }   MSIX_FACTORY_OPTIONS;
 
 #define MSIX_PLATFORM_ALL MSIX_PLATFORM_WINDOWS10      | \
@@ -1779,6 +1858,32 @@ MSIX_API HRESULT STDMETHODCALLTYPE UnpackBundleFromStream(
     char* utf8Destination
 ) noexcept;
 
+// Verify
+// Checks that the package or bundle at utf8SourcePackage matches its signature without extracting it.
+// MSIX_VALIDATION_OPTION_VERIFYCONTAINERDIGESTS is always added to validationOption.
+MSIX_API HRESULT STDMETHODCALLTYPE VerifyPackage(
+    MSIX_VALIDATION_OPTION validationOption,
+    char* utf8SourcePackage
+) noexcept;
+
+typedef struct MSIX_UPDATE_STATISTICS
+{
+    UINT64 bytesCopied; // bytes of the new files copied from the directory
+    UINT64 bytesRead;   // bytes of the package read for the other blocks
+} MSIX_UPDATE_STATISTICS;
+
+// Update
+// Updates utf8Directory, where a previous version of the package was unpacked, to the content of the package at
+// utf8SourcePackage. Blocks listed in the AppxBlockMap.xml of the directory are copied from its files when their
+// hash matches, only the other blocks are read from the package. Files of the previous version that aren't in
+// the package are removed. Bundles aren't supported. statistics is optional.
+MSIX_API HRESULT STDMETHODCALLTYPE UpdatePackageDirectory(
+    MSIX_VALIDATION_OPTION validationOption,
+    char* utf8SourcePackage,
+    char* utf8Directory,
+    MSIX_UPDATE_STATISTICS* statistics
+) noexcept;
+
 #ifdef MSIX_PACK
 
 MSIX_API HRESULT STDMETHODCALLTYPE PackPackage(
@@ -1788,6 +1893,27 @@ MSIX_API HRESULT STDMETHODCALLTYPE PackPackage(
     char* outputPackage
 ) noexcept;
 
+// Same as PackPackage, but files that aren't already compressed based on their extension
+// are deflated using compressionOption instead of APPX_COMPRESSION_OPTION_NORMAL.
+MSIX_API HRESULT STDMETHODCALLTYPE PackPackageWithCompressionOption(
+    MSIX_PACKUNPACK_OPTION packUnpackOptions,
+    MSIX_VALIDATION_OPTION validationOption,
+    APPX_COMPRESSION_OPTION compressionOption,
+    char* directoryPath,
+    char* outputPackage
+) noexcept;
+
+// Same as PackPackageWithCompressionOption, but compressed blocks of unchanged files are copied from
+// basePackage instead of being compressed again. See IMsixPackageWriterBasePackage. basePackage can be null.
+MSIX_API HRESULT STDMETHODCALLTYPE PackPackageWithBasePackage(
+    MSIX_PACKUNPACK_OPTION packUnpackOptions,
+    MSIX_VALIDATION_OPTION validationOption,
+    APPX_COMPRESSION_OPTION compressionOption,
+    char* directoryPath,
+    char* basePackage,
+    char* outputPackage
+) noexcept;
+
 MSIX_API HRESULT STDMETHODCALLTYPE PackBundle(
     MSIX_BUNDLE_OPTIONS bundleOptions,
     char* directoryPath,
@@ -1803,6 +1929,7 @@ MSIX_API HRESULT STDMETHODCALLTYPE PackBundle(
 typedef LPVOID STDMETHODCALLTYPE COTASKMEMALLOC(SIZE_T cb);
 typedef void STDMETHODCALLTYPE COTASKMEMFREE(LPVOID pv);
 
+// Returns the errors logged by the calling thread and clears them. Each thread keeps only its most recent errors.
 MSIX_API HRESULT STDMETHODCALLTYPE MsixGetLogTextUTF8(COTASKMEMALLOC* memalloc, char** logText) noexcept;
 
 #ifndef MSIX_DEFINE_GetLogTextUTF8_BACKCOMPAT
@@ -1861,6 +1988,28 @@ MSIX_API HRESULT STDMETHODCALLTYPE CreateStreamOnFileUTF16(
     bool forRead,
     IStream** stream) noexcept;
 
+// Opens utf8File for read and memory maps it on POSIX platforms. Clones share the mapping, so several threads can
+// read the file without sharing a file pointer. The file must not be truncated or replaced while the stream is in
+// use, reading a page that is no longer backed by the file raises SIGBUS instead of failing the read. Returns the
+// stream of CreateStreamOnFile if the file can't be mapped, and on Windows.
+MSIX_API HRESULT STDMETHODCALLTYPE CreateMappedStreamOnFile(
+    char* utf8File,
+    IStream** stream) noexcept;
+
+// Creates an index cache that keeps one file per entry in utf8Directory, which must exist. Use it with
+// MSIX_FACTORY_EXTENSION_INDEX_CACHE. Entries are replaced atomically, so several processes can share it.
+MSIX_API HRESULT STDMETHODCALLTYPE CreateIndexCacheOnDirectory(
+    char* utf8Directory,
+    IMsixIndexCache** indexCache) noexcept;
+
+// Creates a read only stream over source to open a package that isn't a local file. Small reads are served from
+// large ranges read ahead of them. Package readers created on the stream read the central directory and the
+// footprint files in as few ranges as possible, usually one, and read the payload files ahead in zip order.
+// The stream supports Clone, clones share the ranges already read.
+MSIX_API HRESULT STDMETHODCALLTYPE CreateStreamOnRangeSource(
+    IMsixRangeSource* source,
+    IStream** stream) noexcept;
+
 } // extern "C++"
 
 #endif //__appxpackaging_hpp__
\ No newline at end of file
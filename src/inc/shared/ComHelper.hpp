@@ -183,11 +183,13 @@ namespace MSIX {
         virtual ULONG STDMETHODCALLTYPE AddRef() noexcept override { return ++m_ref; }
         virtual ULONG STDMETHODCALLTYPE Release() noexcept override
         {
-            if (--m_ref == 0)
+            // Don't read m_ref again, other threads may be releasing their references.
+            ULONG ref = --m_ref;
+            if (ref == 0)
             {   delete this;
                 return 0;
             }
-            return m_ref;
+            return ref;
         }
 
         virtual HRESULT STDMETHODCALLTYPE QueryInterface(REFIID riid, void** ppvObject) noexcept override
@@ -20,7 +20,10 @@
 namespace MSIX {
     namespace Global {
         namespace Log {
+            inline void Append(std::uint32_t, const char*, int, const char*) {}
             inline void Append(const std::string&) {}
+            inline std::string Take() { return std::string(); }
+            class PartScope { public: PartScope(const std::string&) {} };
         }
     }
 }
@@ -30,38 +33,23 @@ namespace MSIX {
 
     // Defines a common exception type to throw in exceptional cases.  DO NOT USE FOR FLOW CONTROL!
     // Throwing MSIX::Exception will break into the debugger on chk builds to aid debugging
+    // The details of the failure are recorded in the log by RaiseException, the exception only carries the code.
     class Exception : public std::exception
     {
     public:
-        Exception(std::string& message, Error error) :
-            m_code(static_cast<std::uint32_t>(error)),
-            m_message(message)
-        {
-            Global::Log::Append(Message());
-        }
-
-        Exception(std::string& message, HRESULT error) :
-            m_code(error),
-            m_message(message)
-        {
-            Global::Log::Append(Message());
-        }
+        Exception(Error error) : m_code(static_cast<std::uint32_t>(error)) {}
+        Exception(HRESULT error) : m_code(error) {}
 
         uint32_t            Code() { return m_code; }
-        const std::string&  Message() { return m_message; }
 
     protected:
         std::uint32_t   m_code;
-        std::string     m_message;
     };
 
     class Win32Exception final : public Exception
     {
     public:
-        Win32Exception(std::string& message, DWORD error) : Exception(message, 0x80070000 + error)
-        {
-            Global::Log::Append(Message());
-        }
+        Win32Exception(DWORD error) : Exception(static_cast<HRESULT>(0x80070000 + error)) {}
     };
 
     // Provides an ABI exception boundary with parameter validation
@@ -105,11 +93,9 @@ namespace MSIX {
             assert(false);
         }
 
-        std::ostringstream builder;
-        if (details) { builder << details << "\n"; }
-        builder << "Call failed in " << file << " on line " << line;
-        std::string message = builder.str();
-        throw E(message, c);
+        E exception(c);
+        Global::Log::Append(exception.Code(), file, line, details);
+        throw exception;
     }
     
     #ifdef WIN32
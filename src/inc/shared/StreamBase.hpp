@@ -4,6 +4,7 @@
 // 
 #pragma once
 
+#include <array>
 #include <memory>
 #include <vector>
 #include <algorithm>
@@ -15,6 +16,25 @@
 #include "Exceptions.hpp"
 #include "ComHelper.hpp"
 
+namespace MSIX {
+    struct ByteRange
+    {
+        std::uint64_t offset;
+        std::uint64_t size;
+    };
+
+    // A position of a compressed stream where inflating can start over, without inflating the data before it.
+    // The data of the stream at offset is inflated from source, a range of the compressed data, and its first
+    // size bytes must have the SHA256 hash hash.
+    struct StreamCheckpoint
+    {
+        std::uint64_t offset;
+        std::uint64_t size;
+        ByteRange source;
+        std::array<std::uint8_t, 32> hash;
+    };
+}
+
 // {44d2a7a8-a165-4a6e-a56f-c7c24de7505c}
 #ifndef WIN32
 interface IStreamInternal : public IUnknown
@@ -28,6 +48,18 @@ public:
     virtual std::uint64_t GetSize() = 0;
     virtual bool IsCompressed() = 0;
     virtual std::string GetName() = 0;
+    // Returns the content of the stream when it is already in memory (e.g. a mapped file), nullptr otherwise.
+    // Callers can read from it without moving the seek pointer of the stream.
+    virtual const std::uint8_t* GetData() = 0;
+    // Hints for streams where every read is expensive, like a package fetched over the network. Other streams
+    // ignore them.
+    // Reads ranges before they are used, merged into as few reads as possible.
+    virtual void Prefetch(const std::vector<MSIX::ByteRange>& ranges) = 0;
+    // Sets the ranges that are expected to be read, in order. A read in one of them can read the ones that follow it.
+    virtual void SetReadOrder(const std::vector<MSIX::ByteRange>& ranges) = 0;
+    // Positions where compressed streams can start inflating again when seeking, instead of from the beginning.
+    // Other streams ignore them.
+    virtual void SetCheckpoints(const std::vector<MSIX::StreamCheckpoint>& checkpoints) = 0;
 };
 MSIX_INTERFACE(IStreamInternal, 0x44d2a7a8,0xa165,0x4a6e,0xa5,0x6f,0xc7,0xc2,0x4d,0xe7,0x50,0x5c);
 
@@ -58,8 +90,12 @@ namespace MSIX {
             if (bytesWritten) { bytesWritten->QuadPart = 0; }
             ThrowErrorIf(Error::InvalidParameter, (nullptr == stream), "invalid parameter.");
 
-            static const ULONGLONG size = 1024;
-            std::vector<std::int8_t> bytes(size);
+            // Large enough to let the source read many 64KB package blocks and the destination
+            // write them with a single call. Each thread keeps its buffer, so copying many small
+            // files doesn't allocate and clear 1MB for each of them.
+            static const ULONGLONG size = 1024 * 1024;
+            thread_local std::vector<std::int8_t> bytes;
+            bytes.resize(size);
             std::int64_t read = 0;
             std::int64_t written = 0;
             ULONG length = 0;
@@ -116,7 +152,7 @@ namespace MSIX {
             ThrowHrIfFailed(Seek(start, StreamBase::Reference::END, &end));
             ThrowHrIfFailed(Seek(start, StreamBase::Reference::START, nullptr));
             statStg->type = STGTY_STREAM;
-            statStg->cbSize.QuadPart = end.u.LowPart;
+            statStg->cbSize.QuadPart = end.QuadPart;
             return static_cast<HRESULT>(Error::OK);
         } CATCH_RETURN();
 
@@ -133,6 +169,10 @@ namespace MSIX {
         virtual std::uint64_t GetSize() override { NOTIMPLEMENTED; }
         virtual bool IsCompressed() override { NOTIMPLEMENTED; }
         virtual std::string GetName() override { NOTIMPLEMENTED; }
+        virtual const std::uint8_t* GetData() override { return nullptr; }
+        virtual void Prefetch(const std::vector<ByteRange>&) override {}
+        virtual void SetReadOrder(const std::vector<ByteRange>&) override {}
+        virtual void SetCheckpoints(const std::vector<StreamCheckpoint>&) override {}
 
         template <class T>
         static ULONG Read(const ComPtr<IStream>& stream, T* value)
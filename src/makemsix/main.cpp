@@ -352,6 +352,11 @@ MSIX_PACKUNPACK_OPTION GetPackUnpackOptionBase(const Invocation& invocation)
         packUnpack |= MSIX_PACKUNPACK_OPTION::MSIX_PACKUNPACK_OPTION_CREATEPACKAGESUBFOLDER;
     }
 
+    if (invocation.IsOptionPresent("-mt"))
+    {
+        packUnpack |= MSIX_PACKUNPACK_OPTION::MSIX_PACKUNPACK_OPTION_PARALLELUNPACK;
+    }
+
     return packUnpack;
 }
 
@@ -393,6 +398,11 @@ MSIX_VALIDATION_OPTION GetValidationOption(const Invocation& invocation)
         validation |= MSIX_VALIDATION_OPTION::MSIX_VALIDATION_OPTION_SKIPSIGNATURE;
     }
 
+    if (invocation.IsOptionPresent("-vd"))
+    {
+        validation |= MSIX_VALIDATION_OPTION::MSIX_VALIDATION_OPTION_VERIFYCONTAINERDIGESTS;
+    }
+
     return validation;
 }
 
@@ -418,6 +428,25 @@ MSIX_APPLICABILITY_OPTIONS GetApplicabilityOption(const Invocation& invocation)
     return applicability;
 }
 
+// Returns false if the value of -c isn't a known compression option.
+bool GetCompressionOption(const Invocation& invocation, APPX_COMPRESSION_OPTION& compression)
+{
+    compression = APPX_COMPRESSION_OPTION::APPX_COMPRESSION_OPTION_NORMAL;
+
+    if (invocation.IsOptionPresent("-c"))
+    {
+        const std::string& value = invocation.GetOptionValue("-c");
+        if (value == "none") { compression = APPX_COMPRESSION_OPTION::APPX_COMPRESSION_OPTION_NONE; }
+        else if (value == "superfast") { compression = APPX_COMPRESSION_OPTION::APPX_COMPRESSION_OPTION_SUPERFAST; }
+        else if (value == "fast") { compression = APPX_COMPRESSION_OPTION::APPX_COMPRESSION_OPTION_FAST; }
+        else if (value == "normal") { compression = APPX_COMPRESSION_OPTION::APPX_COMPRESSION_OPTION_NORMAL; }
+        else if (value == "maximum") { compression = APPX_COMPRESSION_OPTION::APPX_COMPRESSION_OPTION_MAXIMUM; }
+        else { return false; }
+    }
+
+    return true;
+}
+
 MSIX_BUNDLE_OPTIONS GetBundleOptions(const Invocation& invocation)
 {
     MSIX_BUNDLE_OPTIONS bundleOptions = MSIX_BUNDLE_OPTIONS::MSIX_OPTION_NONE;
@@ -498,6 +527,8 @@ Command CreateUnpackCommand()
             // Identical behavior as -pfn. This option was created to create parity with unbundle's -pfn-flat option so that IT pros
             // creating packages for app attach only need to be aware of a single option.
             Option{ "-pfn-flat", "Same behavior as -pfn for packages." },
+            Option{ "-mt", "Extracts files on multiple threads." },
+            Option{ "-vd", "Verifies the whole package against its signature before extracting any file." },
             Option{ TOOL_HELP_COMMAND_STRING, "Displays this help text." },
         }
     };
@@ -540,6 +571,8 @@ Command CreateUnbundleCommand()
                                  "named after the package full name. Unpacks packages to subdirectories also "
                                  "under the specified output path, named after the package full name. "
                                  "By default unpacked packages will be nested inside the bundle folder." },
+            Option{ "-mt", "Extracts packages on multiple threads." },
+            Option{ "-vd", "Verifies the whole bundle against its signature before extracting any file." },
             Option{ TOOL_HELP_COMMAND_STRING, "Displays this help text." },
         }
     };
@@ -565,6 +598,75 @@ Command CreateUnbundleCommand()
     return result;
 }
 
+Command CreateVerifyCommand()
+{
+    Command result{ "verify", "Verify a package or bundle against its signature",
+        {
+            Option{ "-p", "Input package or bundle file path.", true, 1, "package" },
+            Option{ "-ac", "Allows any certificate. By default the signature origin must be known." },
+            Option{ TOOL_HELP_COMMAND_STRING, "Displays this help text." },
+        }
+    };
+
+    result.SetDescription({
+        "Checks that the app package or bundle at the input <package> name is signed",
+        "and that none of its contents were modified after it was signed. The whole",
+        "file is read once, sequentially, and nothing is extracted.",
+        });
+
+    result.SetInvocationFunc([](const Invocation& invocation)
+        {
+            auto hr = VerifyPackage(
+                GetValidationOption(invocation),
+                const_cast<char*>(invocation.GetOptionValue("-p").c_str()));
+            if (SUCCEEDED(hr))
+            {
+                std::cout << "The package matches its signature." << std::endl;
+            }
+            return hr;
+        });
+
+    return result;
+}
+
+Command CreateUpdateCommand()
+{
+    Command result{ "update", "Update an unpacked package to another version",
+        {
+            Option{ "-p", "Input package file path.", true, 1, "package" },
+            Option{ "-d", "Directory where the previous version was unpacked.", true, 1, "directory" },
+            Option{ "-ac", "Allows any certificate. By default the signature origin must be known." },
+            Option{ "-ss", "Skips enforcement of signed packages. By default packages must be signed." },
+            Option{ TOOL_HELP_COMMAND_STRING, "Displays this help text." },
+        }
+    };
+
+    result.SetDescription({
+        "Updates the <directory> where a previous version of the package was unpacked",
+        "to the content of the input <package>. Blocks that didn't change are copied",
+        "from the files in <directory> based on its AppxBlockMap.xml, only the other",
+        "blocks are read from <package>. Bundles aren't supported.",
+        });
+
+    result.SetInvocationFunc([](const Invocation& invocation)
+        {
+            MSIX_UPDATE_STATISTICS statistics = {};
+            auto hr = UpdatePackageDirectory(
+                GetValidationOption(invocation),
+                const_cast<char*>(invocation.GetOptionValue("-p").c_str()),
+                const_cast<char*>(invocation.GetOptionValue("-d").c_str()),
+                &statistics);
+            if (SUCCEEDED(hr))
+            {
+                std::cout << "Copied " << statistics.bytesCopied << " bytes from the directory, read "
+                    << statistics.bytesRead << " bytes from the package." << std::endl;
+            }
+            return hr;
+        });
+
+    return result;
+}
+
 #ifdef MSIX_PACK
 Command CreatePackCommand()
 {
@@ -572,6 +674,10 @@ Command CreatePackCommand()
         {
             Option{ "-d", "Input directory path.", true, 1, "directory" },
             Option{ "-p", "Output package file path.", true, 1, "package" },
+            Option{ "-c", "Compression used for files that aren't already compressed. Valid values are "
+                          "none, superfast, fast, normal and maximum. Default is normal.", false, 1, "compression" },
+            Option{ "-bp", "Package created from a previous version of the input directory. Compressed "
+                           "blocks of unchanged files are copied from it instead of being compressed again.", false, 1, "basePackage" },
             Option{ TOOL_HELP_COMMAND_STRING, "Displays this help text." },
         }
     };
@@ -584,10 +690,19 @@ Command CreatePackCommand()
 
     result.SetInvocationFunc([](const Invocation& invocation)
         {
-            return PackPackage(
+            APPX_COMPRESSION_OPTION compression;
+            if (!GetCompressionOption(invocation, compression))
+            {
+                std::cout << "Error: invalid compression option '" << invocation.GetOptionValue("-c") << "'" << std::endl;
+                return static_cast<HRESULT>(E_INVALIDARG);
+            }
+
+            return PackPackageWithBasePackage(
                 MSIX_PACKUNPACK_OPTION::MSIX_PACKUNPACK_OPTION_NONE,
                 MSIX_VALIDATION_OPTION::MSIX_VALIDATION_OPTION_FULL,
+                compression,
                 const_cast<char*>(invocation.GetOptionValue("-d").c_str()),
+                invocation.IsOptionPresent("-bp") ? const_cast<char*>(invocation.GetOptionValue("-bp").c_str()) : nullptr,
                 const_cast<char*>(invocation.GetOptionValue("-p").c_str()));
         });
 
@@ -664,6 +779,8 @@ int main(int argc, char* argv[])
     std::vector<Command> commands = {
         CreateUnpackCommand(),
         CreateUnbundleCommand(),
+        CreateVerifyCommand(),
+        CreateUpdateCommand(),
         #ifdef MSIX_PACK
         CreatePackCommand(),
         CreateBundleCommand(),
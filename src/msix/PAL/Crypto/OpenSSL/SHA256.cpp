@@ -0,0 +1,84 @@
+//
+//  Copyright (C) 2017 Microsoft.  All rights reserved.
+//  See LICENSE file in the project root for full license information.
+// 
+#include "Exceptions.hpp"
+#include "Crypto.hpp"
+#include "SHA256Kernel.hpp"
+
+// SHA256 doesn't use OpenSSL, which is built without its assembly code. The kernel uses the SHA instructions
+// of the CPU when it has them. This file doesn't depend on OpenSSL, the unit tests build it too.
+namespace MSIX {
+    SHA256::SHA256()
+    {
+        m_hashContext = new SHA256Kernel::Context;
+        Reset();
+    }
+
+    SHA256::~SHA256()
+    {
+        if (m_hashContext != nullptr)
+        {
+            // Linux, aosp (Android) and iOS compilers do not allow delete a void pointer, hence the casting.
+            delete (SHA256Kernel::Context*)m_hashContext;
+        }
+    }
+
+    void SHA256::Reset()
+    {
+        SHA256Kernel::Init(*(SHA256Kernel::Context*)m_hashContext);
+    }
+
+    void SHA256::HashData(const std::uint8_t* buffer, std::uint32_t cbBuffer)
+    {
+        SHA256Kernel::Update(*(SHA256Kernel::Context*)m_hashContext, buffer, cbBuffer);
+    }
+
+    void SHA256::FinalizeAndGetHashValue(std::vector<uint8_t>& hash)
+    {
+        hash.resize(SHA256_DIGEST_LENGTH);
+        SHA256Kernel::Final(*(SHA256Kernel::Context*)m_hashContext, hash.data());
+    }
+
+    bool SHA256::ComputeHash(const std::uint8_t *buffer, std::uint32_t cbBuffer, std::vector<uint8_t>& hash)
+    {
+        hash.resize(SHA256_DIGEST_LENGTH);
+        SHA256Kernel::Context context;
+        SHA256Kernel::Init(context);
+        SHA256Kernel::Update(context, buffer, cbBuffer);
+        SHA256Kernel::Final(context, hash.data());
+        return true;
+    }
+
+    std::size_t SHA256::GetParallelHashCount()
+    {
+        return SHA256Kernel::GetParallelCount();
+    }
+
+    void SHA256::ComputeHashes(const std::vector<std::pair<const std::uint8_t*, std::uint32_t>>& buffers,
+        std::vector<std::vector<std::uint8_t>>& hashes)
+    {
+        hashes.resize(buffers.size());
+        auto parallelCount = SHA256Kernel::GetParallelCount();
+        const std::uint8_t* data[SHA256Kernel::MaximumParallelCount];
+        std::uint8_t digests[SHA256Kernel::MaximumParallelCount][32];
+        for (std::size_t first = 0; first < buffers.size();)
+        {   // Consecutive buffers of the same size, the blocks of a file but the last one
+            std::size_t count = 1;
+            while (count < parallelCount && first + count < buffers.size() && buffers[first + count].second == buffers[first].second)
+            {
+                count++;
+            }
+            for (std::size_t i = 0; i < count; i++)
+            {
+                data[i] = buffers[first + i].first;
+            }
+            SHA256Kernel::HashParallel(data, buffers[first].second, count, digests);
+            for (std::size_t i = 0; i < count; i++)
+            {
+                hashes[first + i].assign(digests[i], digests[i] + SHA256_DIGEST_LENGTH);
+            }
+            first += count;
+        }
+    }
+}
@@ -35,7 +35,7 @@ namespace MSIX {
     class NtStatusException final : public Exception
     {
     public:
-        NtStatusException(std::string& message, NTSTATUS error) : Exception(message, static_cast<std::uint32_t>(error)) {}
+        NtStatusException(NTSTATUS error) : Exception(static_cast<HRESULT>(error)) {}
     };
 
     #define ThrowStatusIfFailed(a, m)                                                      \
@@ -132,6 +132,21 @@ namespace MSIX {
         return true;
     }
 
+    std::size_t SHA256::GetParallelHashCount()
+    {
+        return 1;
+    }
+
+    void SHA256::ComputeHashes(const std::vector<std::pair<const std::uint8_t*, std::uint32_t>>& buffers,
+        std::vector<std::vector<std::uint8_t>>& hashes)
+    {
+        hashes.resize(buffers.size());
+        for (std::size_t i = 0; i < buffers.size(); i++)
+        {
+            ComputeHash(buffers[i].first, buffers[i].second, hashes[i]);
+        }
+    }
+
     std::string Base64::ComputeBase64(const std::vector<std::uint8_t>& buffer)
     {
         std::wstring result;
@@ -0,0 +1,108 @@
+//
+//  Copyright (C) 2019 Microsoft.  All rights reserved.
+//  See LICENSE file in the project root for full license information.
+//
+#include "BlockCompression.hpp"
+#include "Exceptions.hpp"
+
+#include <libdeflate.h>
+#include <zlib.h>
+
+namespace MSIX {
+
+    class BlockDeflater final : public IBlockDeflater
+    {
+    public:
+        BlockDeflater(int level)
+        {
+            m_blockInflater = {};
+            ThrowErrorIf(Error::DeflateInitialize, (inflateInit2(&m_blockInflater, -MAX_WBITS) != Z_OK), "Error calling inflateInit2");
+            // libdeflate levels go up to 12, the same level compresses about as much as zlib
+            m_compressor = libdeflate_alloc_compressor(level);
+            if (m_compressor == nullptr)
+            {
+                inflateEnd(&m_blockInflater);
+                ThrowErrorAndLog(Error::DeflateInitialize, "Error calling libdeflate_alloc_compressor");
+            }
+        }
+
+        ~BlockDeflater()
+        {
+            inflateEnd(&m_blockInflater);
+            libdeflate_free_compressor(m_compressor);
+        }
+
+        // libdeflate deflates a whole buffer into a complete deflate stream, whose last block is the final block. The
+        // output of Z_FULL_FLUSH doesn't have a final block and ends with an empty stored block on a byte boundary.
+        // Inflating the output with Z_BLOCK stops at the end of every block and tells where the next one starts, so
+        // the final bit of the last block can be cleared and the empty stored block added after it.
+        std::vector<std::uint8_t> Deflate(const void* buffer, std::uint32_t countBytes) override
+        {
+            std::vector<std::uint8_t> compressed(libdeflate_deflate_compress_bound(m_compressor, countBytes) + 5);
+            auto compressedSize = libdeflate_deflate_compress(m_compressor, buffer, countBytes, compressed.data(), compressed.size());
+            ThrowErrorIf(Error::DeflateWrite, (compressedSize == 0), "Error deflating block");
+            compressed.resize(compressedSize);
+
+            ThrowErrorIf(Error::DeflateWrite, (inflateReset(&m_blockInflater) != Z_OK), "Error calling inflateReset");
+            m_inflatedBlock.resize(countBytes);
+            m_blockInflater.next_in = compressed.data();
+            m_blockInflater.avail_in = static_cast<uInt>(compressed.size());
+            m_blockInflater.next_out = m_inflatedBlock.data();
+            m_blockInflater.avail_out = static_cast<uInt>(m_inflatedBlock.size());
+
+            // Bit positions in compressed. data_type has the number of bits inflate read but didn't use, 64 if the
+            // block that ended is the final block and 128 at the end of a block.
+            std::uint64_t lastBlock = 0;
+            std::uint64_t end = 0;
+            while (true)
+            {
+                auto result = inflate(&m_blockInflater, Z_BLOCK);
+                ThrowErrorIf(Error::DeflateWrite, (result != Z_OK), "Error finding the deflate blocks");
+                if ((m_blockInflater.data_type & 128) == 0)
+                {
+                    continue;
+                }
+                auto position = static_cast<std::uint64_t>(m_blockInflater.total_in) * 8 - (m_blockInflater.data_type & 63);
+                if ((m_blockInflater.data_type & 64) != 0)
+                {
+                    end = position;
+                    break;
+                }
+                lastBlock = position;
+            }
+            ThrowErrorIf(Error::DeflateWrite, ((m_blockInflater.total_out != countBytes) || ((end + 7) / 8 != compressed.size())),
+                "Deflated block doesn't match its data");
+
+            // The header of a block starts with its final bit. The stored block header takes 3 bits, zero for a
+            // block that isn't final, after the end of the last block, then its length and the complement of it
+            // start on the next byte boundary.
+            compressed[static_cast<std::size_t>(lastBlock / 8)] &= static_cast<std::uint8_t>(~(1u << (lastBlock % 8)));
+            auto unusedBits = (8 - end % 8) % 8;
+            if (unusedBits > 0)
+            {
+                compressed.back() &= static_cast<std::uint8_t>(0xFF >> unusedBits);
+            }
+            if (unusedBits < 3)
+            {
+                compressed.push_back(0x00);
+            }
+            compressed.insert(compressed.end(), { 0x00, 0x00, 0xFF, 0xFF });
+            return compressed;
+        }
+
+    private:
+        libdeflate_compressor* m_compressor = nullptr;
+        z_stream m_blockInflater;                   // finds the deflate blocks of the output of libdeflate
+        std::vector<std::uint8_t> m_inflatedBlock;
+    };
+
+    std::unique_ptr<IBlockDeflater> CreateBlockDeflater(int level)
+    {
+        return std::make_unique<BlockDeflater>(level);
+    }
+
+    std::uint32_t ComputeCrc32(const std::uint8_t* data, std::size_t size)
+    {
+        return libdeflate_crc32(0, data, size);
+    }
+}
@@ -0,0 +1,29 @@
+//
+//  Copyright (C) 2019 Microsoft.  All rights reserved.
+//  See LICENSE file in the project root for full license information.
+//
+#include "BlockCompression.hpp"
+#include "Exceptions.hpp"
+
+#include <libdeflate.h>
+
+namespace MSIX {
+
+    // libdeflate inflates whole buffers that end with a final block. A block that ends with a full flush doesn't have
+    // one, it is terminated with the empty final block Z_FINISH writes. Data that has a final block stops there.
+    bool InflateBlock(std::uint8_t* data, std::size_t size, std::vector<std::uint8_t>& inflated)
+    {
+        thread_local std::unique_ptr<libdeflate_decompressor, decltype(&libdeflate_free_decompressor)> decompressor(
+            libdeflate_alloc_decompressor(), &libdeflate_free_decompressor);
+        ThrowErrorIf(Error::InflateInitialize, !decompressor, "Failed to initialize inflate");
+        thread_local std::vector<std::uint8_t> terminated;
+        terminated.assign(data, data + size);
+        terminated.push_back(0x03);
+        terminated.push_back(0x00);
+
+        std::size_t inflatedSize = 0;
+        auto result = libdeflate_deflate_decompress(decompressor.get(), terminated.data(), terminated.size(),
+            inflated.data(), inflated.size(), &inflatedSize);
+        return (result == LIBDEFLATE_SUCCESS) && (inflatedSize == inflated.size());
+    }
+}
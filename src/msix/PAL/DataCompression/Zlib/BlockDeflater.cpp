@@ -0,0 +1,21 @@
+//
+//  Copyright (C) 2019 Microsoft.  All rights reserved.
+//  See LICENSE file in the project root for full license information.
+//
+#include "BlockCompression.hpp"
+
+#include <zlib.h>
+
+namespace MSIX {
+
+    // The Deflater flushes every block of its zlib stream
+    std::unique_ptr<IBlockDeflater> CreateBlockDeflater(int)
+    {
+        return nullptr;
+    }
+
+    std::uint32_t ComputeCrc32(const std::uint8_t* data, std::size_t size)
+    {
+        return static_cast<std::uint32_t>(crc32(0, data, static_cast<uInt>(size)));
+    }
+}
@@ -0,0 +1,28 @@
+//
+//  Copyright (C) 2019 Microsoft.  All rights reserved.
+//  See LICENSE file in the project root for full license information.
+//
+#include "BlockCompression.hpp"
+#include "ICompressionObject.hpp"
+#include "Exceptions.hpp"
+
+namespace MSIX {
+
+    bool InflateBlock(std::uint8_t* data, std::size_t size, std::vector<std::uint8_t>& inflated)
+    {
+        auto expectedSize = inflated.size();
+        // One more byte than expected, so longer data doesn't go unnoticed
+        inflated.resize(expectedSize + 1);
+        auto inflater = AcquireCompressionObject();
+        ThrowErrorIf(Error::InflateInitialize, (inflater->Initialize(CompressionOperation::Inflate) != CompressionStatus::Ok),
+            "Failed to initialize inflate");
+        inflater->SetInput(data, size);
+        inflater->SetOutput(inflated.data(), inflated.size());
+        auto status = inflater->Inflate();
+        auto inflatedSize = inflated.size() - inflater->GetAvailableDestinationSize();
+        inflater->Cleanup();
+        ReleaseCompressionObject(std::move(inflater));
+        inflated.resize(expectedSize);
+        return (status == CompressionStatus::Ok || status == CompressionStatus::End) && (inflatedSize == expectedSize);
+    }
+}
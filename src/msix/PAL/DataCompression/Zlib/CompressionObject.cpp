@@ -19,16 +19,30 @@ namespace MSIX {
     public:
         CompressionObject() = default;
 
+        ~CompressionObject()
+        {
+            if (m_initialized)
+            {
+                inflateEnd(&m_zstrm);
+            }
+        }
+
         // ICompressionObject interface
         CompressionStatus Initialize(CompressionOperation operation) noexcept
         {
-            m_zstrm = { 0 };
-
             switch (operation)
             {
                 case CompressionOperation::Inflate:
-                    return GetStatus(inflateInit2(&m_zstrm, -MAX_WBITS));
-                    break;
+                    // Reuse the state and window of the previous inflate
+                    if (m_initialized)
+                    {
+                        SetInput(nullptr, 0);
+                        SetOutput(nullptr, 0);
+                        return GetStatus(inflateReset(&m_zstrm));
+                    }
+                    m_zstrm = { 0 };
+                    m_initialized = (inflateInit2(&m_zstrm, -MAX_WBITS) == Z_OK);
+                    return m_initialized ? CompressionStatus::Ok : CompressionStatus::Error;
                 default:
                     NOTIMPLEMENTED;
             }
@@ -40,8 +54,8 @@ namespace MSIX {
         }
 
         CompressionStatus Cleanup() noexcept
-        {
-            return GetStatus(inflateEnd(&m_zstrm));
+        {   // The memory is freed with the object
+            return CompressionStatus::Ok;
         }
 
         size_t GetAvailableSourceSize() noexcept
@@ -68,6 +82,7 @@ namespace MSIX {
 
     private:
         z_stream        m_zstrm;
+        bool            m_initialized = false;
 
         CompressionStatus GetStatus(int status)
         {
@@ -11,6 +11,7 @@
 #include <errno.h>
 #include <fts.h>
 #include <dirent.h>
+#include <fcntl.h>
 #include <map>
 
 namespace MSIX
@@ -95,11 +96,35 @@ namespace MSIX
         std::string name = m_root + GetPathSeparator() + fileName;
         auto lastSlash = name.find_last_of(GetPathSeparator());
         std::string path = name.substr(0, lastSlash);
-        mkdirp(path, m_root.size());
+        {
+            std::lock_guard<std::mutex> lock(m_directoriesMutex);
+            if (m_directories.find(path) == m_directories.end())
+            {
+                mkdirp(path, m_root.size());
+                m_directories.insert(std::move(path));
+            }
+        }
         auto result = ComPtr<IStream>::Make<FileStream>(std::move(name), mode);
         return result;
     }
 
+    ComPtr<IStream> DirectoryObject::OpenFileForWrite(const std::string& fileName, std::uint64_t size)
+    {
+        auto result = OpenFile(fileName, FileStream::Mode::WRITE);
+        #ifdef __linux__
+        if (size > 0)
+        {   // Reserve the space of the file so it isn't extended piece by piece as it is written. Best effort, not
+            // every file system supports it. The size of the file doesn't change, so a file that is written only
+            // partially doesn't end with zeros. OpenFile always creates a FileStream.
+            auto fd = static_cast<FileStream*>(result.Get())->GetFileDescriptor();
+            static_cast<void>(fallocate(fd, FALLOC_FL_KEEP_SIZE, 0, static_cast<off_t>(size)));
+        }
+        #else
+        static_cast<void>(size);
+        #endif
+        return result;
+    }
+
     std::multimap<std::uint64_t, std::string> DirectoryObject::GetFilesByLastModDate()
     {
         THROW_IF_PACK_NOT_ENABLED
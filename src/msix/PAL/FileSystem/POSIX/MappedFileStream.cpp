@@ -0,0 +1,50 @@
+//
+//  Copyright (C) 2019 Microsoft.  All rights reserved.
+//  See LICENSE file in the project root for full license information.
+// 
+#include "Exceptions.hpp"
+#include "MappedFileStream.hpp"
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace MSIX {
+
+    MappedFileStream::Mapping::~Mapping()
+    {
+        if (data != nullptr)
+        {
+            munmap(data, static_cast<size_t>(size));
+        }
+    }
+
+    std::shared_ptr<MappedFileStream::Mapping> MappedFileStream::MapFile(const std::string& name)
+    {
+        int fd = open(name.c_str(), O_RDONLY | O_CLOEXEC);
+        ThrowErrorIf(Error::FileOpen, (fd == -1), std::string("file: " + name + " does not exist.").c_str());
+        // The mapping stays valid after the file descriptor is closed.
+        std::unique_ptr<int, void(*)(int*)> closeFile(&fd, [](int* f) { close(*f); });
+
+        struct stat sb;
+        if ((fstat(fd, &sb) == -1) || !S_ISREG(sb.st_mode) ||
+            (static_cast<std::uint64_t>(sb.st_size) > static_cast<std::uint64_t>(std::numeric_limits<size_t>::max())))
+        {
+            return nullptr;
+        }
+
+        auto mapping = std::make_shared<Mapping>(name);
+        mapping->size = static_cast<std::uint64_t>(sb.st_size);
+        if (mapping->size > 0)
+        {
+            void* data = mmap(nullptr, static_cast<size_t>(mapping->size), PROT_READ, MAP_SHARED, fd, 0);
+            if (data == MAP_FAILED)
+            {
+                return nullptr;
+            }
+            mapping->data = static_cast<std::uint8_t*>(data);
+        }
+        return mapping;
+    }
+}
@@ -316,6 +316,11 @@ namespace MSIX
         return result;
     }
 
+    ComPtr<IStream> DirectoryObject::OpenFileForWrite(const std::string& fileName, std::uint64_t)
+    {   // The space isn't reserved on Windows
+        return OpenFile(fileName, FileStream::Mode::WRITE);
+    }
+
     std::multimap<std::uint64_t, std::string> DirectoryObject::GetFilesByLastModDate()
     {
         THROW_IF_PACK_NOT_ENABLED
@@ -62,7 +62,7 @@ namespace MSIX
     };
 
     struct unique_STACK_X509_deleter {
-        void operator()(STACK_OF(X509) *sx) const { if (sx) sk_X509_free(sx); };
+        void operator()(STACK_OF(X509) *sx) const { if (sx) sk_X509_pop_free(sx, X509_free); };
     };
 
     struct shared_BIO_deleter {
@@ -384,6 +384,89 @@ namespace MSIX
         return false;
     }
 
+    struct TrustStore
+    {
+        unique_X509_STORE store;
+        unique_STACK_X509 trustedStack;
+    };
+
+    static void InitializeOpenSSL()
+    {
+        // Tell OpenSSL to use all available algorithms when evaluating certs
+        static std::once_flag sslInitializationFlag;
+        std::call_once(sslInitializationFlag, []
+        {
+            // Best effort to check if OpenSSL isn't initialized by the app or another library
+            if (CRYPTO_THREADID_get_callback() == NULL)
+            {
+                OpenSSL_add_all_algorithms();
+                CRYPTO_THREADID_set_callback(CryptoThreadIDCallback);
+                CRYPTO_set_locking_callback(CryptoLockingCallback);
+            }
+        });
+    }
+
+    static void AddTrustedCert(TrustStore& trustStore, unique_X509 cert)
+    {
+        // Add the cert to the trusted store
+        ThrowErrorIfNot(Error::SignatureInvalid, 
+            X509_STORE_add_cert(trustStore.store.get(), cert.get()) == 1, 
+            "Could not add cert to keychain");
+
+        // The store doesn't keep a reference when the cert is already in it, so the stack owns its own.
+        ThrowErrorIf(Error::OutOfMemory, (sk_X509_push(trustStore.trustedStack.get(), cert.get()) == 0), "Could not add cert to trusted stack");
+        cert.release();
+    }
+
+    std::shared_ptr<TrustStore> SignatureValidator::CreateTrustStore(
+        IMsixFactory* factory,
+        const ComPtr<IStream>& additionalCertificates)
+    {
+        InitializeOpenSSL();
+
+        auto trustStore = std::make_shared<TrustStore>();
+        // Create a trusted cert store
+        trustStore->store.reset(X509_STORE_new());
+        // Set a verify callback to evaluate errors
+        X509_STORE_set_verify_cb(trustStore->store.get(), &VerifyCallback);
+        // We have to tell OpenSSL why we are using the store -- in this case, closest is ANY.
+        X509_STORE_set_purpose(trustStore->store.get(), X509_PURPOSE_ANY);
+        
+        // Loop through our trusted PEM certs, create X509 objects from them, and add to trusted store
+        trustStore->trustedStack.reset(sk_X509_new_null());
+        
+        // Get certificates from our resources
+        auto appxCerts = GetResources(factory, Resource::Certificates);
+        for ( auto& appxCert : appxCerts )
+        {
+            auto certBuffer = Helper::CreateBufferFromStream(appxCert.second);
+            // Load the cert into memory
+            unique_BIO bcert(BIO_new_mem_buf(certBuffer.data(), certBuffer.size()));
+
+            // Create a cert from the memory buffer
+            AddTrustedCert(*trustStore, unique_X509(PEM_read_bio_X509(bcert.get(), nullptr, nullptr, nullptr)));
+        }
+
+        // Certificates specified via MSIX_FACTORY_EXTENSION_TRUSTED_CERTIFICATES may hold several PEM blocks
+        if (additionalCertificates.Get() != nullptr)
+        {
+            auto certBuffer = Helper::CreateBufferFromStream(additionalCertificates);
+            unique_BIO bcert(BIO_new_mem_buf(certBuffer.data(), static_cast<int>(certBuffer.size())));
+            std::size_t count = 0;
+            while (true)
+            {
+                unique_X509 cert(PEM_read_bio_X509(bcert.get(), nullptr, nullptr, nullptr));
+                if (!cert) { break; }
+                AddTrustedCert(*trustStore, std::move(cert));
+                count++;
+            }
+            // Reaching the end of the buffer leaves a "no start line" error in the queue
+            ERR_clear_error();
+            ThrowErrorIf(Error::InvalidParameter, (count == 0), "No PEM certificates found in the trusted certificates stream");
+        }
+        return trustStore;
+    }
+
     bool SignatureValidator::Validate(
         IMsixFactory* factory,
         MSIX_VALIDATION_OPTION option,
@@ -416,47 +499,10 @@ namespace MSIX
         // Initialize the PKCS7 object from the BIO buffer
         unique_PKCS7 p7(d2i_PKCS7_bio(bmem.get(), nullptr));
 
-        // Tell OpenSSL to use all available algorithms when evaluating certs
-        static std::once_flag sslInitializationFlag;
-        std::call_once(sslInitializationFlag, []
-        {
-            // Best effort to check if OpenSSL isn't initialized by the app or another library
-            if (CRYPTO_THREADID_get_callback() == NULL)
-            {
-                OpenSSL_add_all_algorithms();
-                CRYPTO_THREADID_set_callback(CryptoThreadIDCallback);
-                CRYPTO_set_locking_callback(CryptoLockingCallback);
-            }
-        });
-
-        // Create a trusted cert store
-        unique_X509_STORE store(X509_STORE_new());
-        // Set a verify callback to evaluate errors
-        X509_STORE_set_verify_cb(store.get(), &VerifyCallback);
-        // We have to tell OpenSSL why we are using the store -- in this case, closest is ANY.
-        X509_STORE_set_purpose(store.get(), X509_PURPOSE_ANY);
-        
-        // Loop through our trusted PEM certs, create X509 objects from them, and add to trusted store
-        unique_STACK_X509 trustedStack(sk_X509_new_null());
-        
-        // Get certificates from our resources
-        auto appxCerts = GetResources(factory, Resource::Certificates);
-        for ( auto& appxCert : appxCerts )
-        {
-            auto certBuffer = Helper::CreateBufferFromStream(appxCert.second);
-            // Load the cert into memory
-            unique_BIO bcert(BIO_new_mem_buf(certBuffer.data(), certBuffer.size()));
-
-            // Create a cert from the memory buffer
-            unique_X509 cert(PEM_read_bio_X509(bcert.get(), nullptr, nullptr, nullptr));
-            
-            // Add the cert to the trusted store
-            ThrowErrorIfNot(Error::SignatureInvalid, 
-                X509_STORE_add_cert(store.get(), cert.get()) == 1, 
-                "Could not add cert to keychain");
-            
-            sk_X509_push(trustedStack.get(), cert.get());
-        }
+        // The trusted store is built once per factory and shared read-only
+        auto trustStore = factory->GetTrustStore();
+        X509_STORE* store = trustStore->store.get();
+        STACK_OF(X509)* trustedStack = trustStore->trustedStack.get();
 
         unique_BIO signatureDigest(nullptr);
         ReadDigestHashes(p7.get(), signatureObject, signatureDigest);
@@ -471,10 +517,10 @@ namespace MSIX
             {
                 X509* cert = sk_X509_value(untrustedCerts, i);
                 unique_X509_STORE_CTX context(X509_STORE_CTX_new());
-                X509_STORE_CTX_init(context.get(), store.get(), nullptr, nullptr);
+                X509_STORE_CTX_init(context.get(), store, nullptr, nullptr);
 
                 X509_STORE_CTX_set_chain(context.get(), untrustedCerts);
-                X509_STORE_CTX_trusted_stack(context.get(), trustedStack.get());
+                X509_STORE_CTX_trusted_stack(context.get(), trustedStack);
                 X509_STORE_CTX_set_cert(context.get(), cert);
 
                 X509_VERIFY_PARAM* param = X509_STORE_CTX_get0_param(context.get());
@@ -493,7 +539,7 @@ namespace MSIX
             }
 
             ThrowErrorIfNot(Error::SignatureInvalid, 
-                PKCS7_verify(p7.get(), trustedStack.get(), store.get(), signatureDigest.get(), nullptr/*out*/, PKCS7_NOCRL/*flags*/) == 1, 
+                PKCS7_verify(p7.get(), trustedStack, store, signatureDigest.get(), nullptr/*out*/, PKCS7_NOCRL/*flags*/) == 1, 
                 "Could not verify package signature");
         }
 
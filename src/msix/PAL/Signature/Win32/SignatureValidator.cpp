@@ -493,6 +493,18 @@ namespace MSIX
     }
 
 
+    // WinVerifyTrust evaluates the chain against the system stores, so there is nothing to cache.
+    struct TrustStore {};
+
+    std::shared_ptr<TrustStore> SignatureValidator::CreateTrustStore(
+        IMsixFactory*,
+        const ComPtr<IStream>& additionalCertificates)
+    {
+        ThrowErrorIf(Error::NotSupported, (additionalCertificates.Get() != nullptr),
+            "Add trusted certificates to the Windows certificate store instead");
+        return std::make_shared<TrustStore>();
+    }
+
     bool SignatureValidator::Validate(
         IMsixFactory* factory,
         MSIX_VALIDATION_OPTION option,
@@ -659,4 +671,4 @@ namespace MSIX
 
         return true;
     }
-} // namespace MSIX
\ No newline at end of file
+} // namespace MSIX
\ No newline at end of file
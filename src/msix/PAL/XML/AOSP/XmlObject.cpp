@@ -271,6 +271,11 @@ public:
     {
         return ComPtr<IXmlDom>::Make<JavaXmlDom>(m_factory, stream);
     }
+
+    bool ParseStream(XmlContentType, const ComPtr<IStream>&, XmlStreamHandler&) override
+    {
+        return false;
+    }
 protected:
     IMsixFactory* m_factory;
 };
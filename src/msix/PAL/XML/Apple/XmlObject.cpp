@@ -179,6 +179,11 @@ public:
     {
         return ComPtr<IXmlDom>::Make<XmlDom>(m_factory, stream);
     }
+
+    bool ParseStream(XmlContentType, const ComPtr<IStream>&, XmlStreamHandler&) override
+    {
+        return false;
+    }
 protected:
     IMsixFactory* m_factory;
 };
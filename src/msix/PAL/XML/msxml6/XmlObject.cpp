@@ -595,6 +595,11 @@ public:
             HasIgnorableNamespaces);
     }
 
+    bool ParseStream(XmlContentType, const ComPtr<IStream>&, XmlStreamHandler&) override
+    {
+        return false;
+    }
+
 protected:
     bool            m_CoInitialized;
     IMsixFactory*   m_factory;
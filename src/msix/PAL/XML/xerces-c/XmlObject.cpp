@@ -8,6 +8,7 @@
 #include <map>
 #include <queue>
 #include <list>
+#include <mutex>
 
 #include "Exceptions.hpp"
 #include "StreamBase.hpp"
@@ -20,6 +21,7 @@
 // Mandatory for using any feature of Xerces.
 #include "xercesc/dom/DOM.hpp"
 #include "xercesc/framework/MemBufInputSource.hpp"
+#include "xercesc/framework/XMLPScanToken.hpp"
 #include "xercesc/framework/XMLGrammarPoolImpl.hpp"
 #include "xercesc/parsers/AbstractDOMParser.hpp"
 #include "xercesc/parsers/XercesDOMParser.hpp"
@@ -28,6 +30,11 @@
 #include "xercesc/util/XMLString.hpp"
 #include "xercesc/util/Base64.hpp"
 #include "xercesc/sax/SAXParseException.hpp"
+#include "xercesc/sax2/Attributes.hpp"
+#include "xercesc/sax2/DefaultHandler.hpp"
+#include "xercesc/sax2/SAX2XMLReader.hpp"
+#include "xercesc/sax2/XMLReaderFactory.hpp"
+#include "xercesc/util/BinInputStream.hpp"
 #include "xercesc/util/XMLEntityResolver.hpp"
 #include "xercesc/util/XMLUni.hpp" // helpful XMLChr*
 #include "xercesc/framework/MemBufFormatTarget.hpp"
@@ -374,40 +381,16 @@ protected:
 class XercesDom final : public ComClass<XercesDom, IXmlDom>
 {
 public:
-    XercesDom(IMsixFactory* factory, const ComPtr<IStream>& stream, XmlContentType footPrintType) :
-        m_factory(factory), m_stream(stream)
+    // grammarPool contains the schemas to validate against, or is null if the xml is not validated.
+    XercesDom(IMsixFactory* factory, const ComPtr<IStream>& stream, XmlContentType footPrintType, const std::shared_ptr<XERCES_CPP_NAMESPACE::XMLGrammarPool>& grammarPool) :
+        m_factory(factory), m_stream(stream), m_grammarPool(grammarPool)
     {
         auto buffer = Helper::CreateBufferFromStream(stream);
         std::unique_ptr<XERCES_CPP_NAMESPACE::MemBufInputSource> source = std::make_unique<XERCES_CPP_NAMESPACE::MemBufInputSource>(
             reinterpret_cast<const XMLByte*>(&buffer[0]), buffer.size(), "XML File");
 
-        // Create parser and grammar pool
-        auto grammarPool = std::make_unique<XERCES_CPP_NAMESPACE::XMLGrammarPoolImpl>(XERCES_CPP_NAMESPACE::XMLPlatformUtils::fgMemoryManager);
-        m_parser = std::make_unique<XERCES_CPP_NAMESPACE::XercesDOMParser>(nullptr, XERCES_CPP_NAMESPACE::XMLPlatformUtils::fgMemoryManager, grammarPool.get());
-        
-        // For Non validation parser GetResources will return an empty vector for the ContentType, BlockMap and AppxBundleManifest.
-        // XercesDom will only parse the schemas if the vector is not empty. If not, it will only see that it is valid xml.
-        std::vector<std::pair<std::string, ComPtr<IStream>>> schemas;
-        if (footPrintType == XmlContentType::AppxBlockMapXml)
-        {
-            // Block map xml does not need schema validation.
-        }
-        else if (footPrintType == XmlContentType::AppxManifestXml)
-        {
-            schemas = GetResources(m_factory, Resource::Type::AppxManifest);
-        }
-        else if (footPrintType == XmlContentType::ContentTypeXml)
-        {
-            schemas = GetResources(m_factory, Resource::Type::ContentType);
-        }
-        else if (footPrintType == XmlContentType::AppxBundleManifestXml)
-        {
-            schemas = GetResources(m_factory, Resource::Type::AppxBundleManifest);
-        }
-        else
-        {
-            ThrowError(Error::InvalidParameter);
-        }
+        // Create parser. The grammar pool is shared with other parsers, so it must outlive the parser.
+        m_parser = std::make_unique<XERCES_CPP_NAMESPACE::XercesDOMParser>(nullptr, XERCES_CPP_NAMESPACE::XMLPlatformUtils::fgMemoryManager, m_grammarPool.get());
 
         // Set the error handler and entity resolver for the parser
         auto errorHandler = std::make_unique<ParsingException>();
@@ -416,15 +399,19 @@ public:
         m_parser->setXMLEntityResolver(entityResolver.get());
         m_parser->setDoNamespaces(true);
 
-        if (!schemas.empty())
+        if (m_grammarPool)
         {
             if (footPrintType == XmlContentType::AppxManifestXml || footPrintType == XmlContentType::AppxBundleManifestXml)
             {
-                source = StripIgnorableNamespaces(*source, s_xmlNamespaces[static_cast<std::uint8_t>(footPrintType)]);
+                auto strippedSource = StripIgnorableNamespaces(*source, s_xmlNamespaces[static_cast<std::uint8_t>(footPrintType)]);
+                if (strippedSource)
+                {
+                    source = std::move(strippedSource);
+                }
             }
 
             m_parser->setValidationScheme(XERCES_CPP_NAMESPACE::AbstractDOMParser::ValSchemes::Val_Always);
-            m_parser->cacheGrammarFromParse(true);
+            m_parser->useCachedGrammarInParse(true);
             m_parser->setDoSchema(true);
             m_parser->setValidationSchemaFullChecking(true);
             // Disable DTD and prevent XXE attacks.  See https://www.owasp.org/index.php/XML_External_Entity_(XXE)_Prevention_Cheat_Sheet#libxerces-c for additional details.
@@ -432,14 +419,6 @@ public:
             m_parser->setSkipDTDValidation(true);
             m_parser->setCreateEntityReferenceNodes(true);
             m_parser->setDisableDefaultEntityResolution(true);
-
-            for(const auto& schema : schemas)
-            {
-                auto schemaBuffer = Helper::CreateBufferFromStream(schema.second);
-                auto item = std::make_unique<XERCES_CPP_NAMESPACE::MemBufInputSource>(
-                    reinterpret_cast<const XMLByte*>(&schemaBuffer[0]), schemaBuffer.size(), schema.first.c_str());
-                m_parser->loadGrammar(*item, XERCES_CPP_NAMESPACE::Grammar::GrammarType::SchemaGrammarType, true);
-            }
         }
 
         m_parser->parse(*source);
@@ -492,33 +471,56 @@ public:
 
 protected:
 
+    // Removes the content of ignorable namespaces we don't know about and returns the new document to validate.
+    // The document is only parsed up to the root element to find those namespaces. If there aren't any, nothing is
+    // stripped, the parse is abandoned and nullptr is returned so the original document is validated in a single parse.
     std::unique_ptr<MemBufInputSource> StripIgnorableNamespaces(const InputSource& source, const NamespaceManager& namespaces)
     {
         m_parser->setDoNamespaces(true);
-        m_parser->parse(source);
+        XMLPScanToken token;
+        bool moreToParse = m_parser->parseFirst(source, token);
+        while (moreToParse && (m_parser->getDocument() == nullptr || m_parser->getDocument()->getDocumentElement() == nullptr))
+        {
+            moreToParse = m_parser->parseNext(token);
+        }
         XERCES_CPP_NAMESPACE::DOMDocument* dom = m_parser->getDocument();
+        if (dom == nullptr || dom->getDocumentElement() == nullptr)
+        {   // Let the validating parse report the error.
+            m_parser->parseReset(token);
+            return nullptr;
+        }
+
         auto rootElement = ComPtr<IXercesElement>::Make<XercesElement>(m_factory, dom->getDocumentElement(), m_parser.get());
         std::string attr = "IgnorableNamespaces";
         std::string attrValue = rootElement->GetAttributeValue(attr);
-        if (!attrValue.empty())
+        std::vector<std::string> aliasesToStrip;
         {
-            std::vector<std::string> aliasesToLookup;
+            std::string alias;
+            std::istringstream aliases(attrValue);
+            while(getline(aliases, alias, ' '))
             {
-                std::string alias;
-                std::istringstream aliases(attrValue);
-                while(getline(aliases, alias, ' ')) { aliasesToLookup.push_back(alias); }
-            }
-            for (const auto& a : aliasesToLookup)
-            {
-                std::string alias = "xmlns:" + a; // Look for xmlns:[alias] attribute name
-                std::string aliasValue = rootElement->GetAttributeValue(alias);
+                std::string aliasValue = rootElement->GetAttributeValue("xmlns:" + alias); // Look for xmlns:[alias] attribute name
                 const auto& entry = std::find(namespaces.begin(), namespaces.end(), aliasValue.c_str());
                 if (entry == namespaces.end()) // only strip if we don't know about it
                 {
-                    RemoveAllInNamespace(rootElement, a);
+                    aliasesToStrip.push_back(alias);
                 }
             }
+        }
+
+        if (aliasesToStrip.empty())
+        {
+            m_parser->parseReset(token);
+            return nullptr;
+        }
 
+        while (moreToParse)
+        {
+            moreToParse = m_parser->parseNext(token);
+        }
+        for (const auto& a : aliasesToStrip)
+        {
+            RemoveAllInNamespace(rootElement, a);
         }
 
         // Serialize the new dom to parse.
@@ -638,10 +640,125 @@ protected:
     }
 
     IMsixFactory* m_factory;
+    std::shared_ptr<XERCES_CPP_NAMESPACE::XMLGrammarPool> m_grammarPool;
     std::unique_ptr<XERCES_CPP_NAMESPACE::XercesDOMParser> m_parser;
     ComPtr<IStream> m_stream;
 };
 
+// Feeds xerces from the stream a chunk at a time, so the document is never in memory as a whole.
+class StreamBinInputStream final : public BinInputStream
+{
+public:
+    StreamBinInputStream(const ComPtr<IStream>& stream) : m_stream(stream) {}
+
+    XMLFilePos curPos() const override { return m_position; }
+
+    XMLSize_t readBytes(XMLByte* const toFill, const XMLSize_t maxToRead) override
+    {
+        ULONG bytesRead = 0;
+        ThrowHrIfFailed(m_stream->Read(toFill, static_cast<ULONG>(maxToRead), &bytesRead));
+        m_position += bytesRead;
+        return bytesRead;
+    }
+
+    const XMLCh* getContentType() const override { return nullptr; }
+
+private:
+    ComPtr<IStream> m_stream;
+    XMLFilePos m_position = 0;
+};
+
+class StreamInputSource final : public InputSource
+{
+public:
+    StreamInputSource(const ComPtr<IStream>& stream) : InputSource("XML File"), m_stream(stream) {}
+
+    BinInputStream* makeStream() const override { return new StreamBinInputStream(m_stream); }
+
+private:
+    ComPtr<IStream> m_stream;
+};
+
+class XercesStreamElement final : public XmlStreamElement
+{
+public:
+    XercesStreamElement(const XMLCh* localName, const Attributes& attributes) : m_localName(localName), m_attributes(attributes) {}
+
+    std::string GetLocalName() override
+    {
+        return u16string_to_utf8(std::u16string(reinterpret_cast<const char16_t*>(m_localName)));
+    }
+
+    std::string GetAttributeValue(XmlAttributeName attribute) override
+    {
+        const XMLCh* value = FindAttribute(attribute);
+        if (value == nullptr)
+        {
+            return {};
+        }
+        return u16string_to_utf8(std::u16string(reinterpret_cast<const char16_t*>(value)));
+    }
+
+    std::size_t GetBase64DecodedAttributeValue(XmlAttributeName attribute, std::uint8_t* buffer, std::size_t bufferSize) override
+    {
+        const XMLCh* value = FindAttribute(attribute);
+        if (value == nullptr)
+        {
+            return 0;
+        }
+        XMLSize_t len = 0;
+        XercesXMLBytePtr decodedData(XERCES_CPP_NAMESPACE::Base64::decodeToXMLByte(value, &len));
+        ThrowErrorIf(Error::XmlInvalidData, (len > bufferSize), "Decoded attribute value is too big");
+        if (len > 0)
+        {
+            std::memcpy(buffer, decodedData.Get(), static_cast<std::size_t>(len));
+        }
+        return static_cast<std::size_t>(len);
+    }
+
+private:
+    // Attribute names are ASCII, so they are compared without transcoding them.
+    const XMLCh* FindAttribute(XmlAttributeName attribute)
+    {
+        const char* name = GetAttributeNameStringUtf8(attribute);
+        for (XMLSize_t i = 0; i < m_attributes.getLength(); i++)
+        {
+            const XMLCh* qName = m_attributes.getQName(i);
+            std::size_t j = 0;
+            while (name[j] != '\0' && qName[j] == static_cast<XMLCh>(name[j])) { j++; }
+            if (name[j] == '\0' && qName[j] == chNull)
+            {
+                return m_attributes.getValue(i);
+            }
+        }
+        return nullptr;
+    }
+
+    const XMLCh* m_localName;
+    const Attributes& m_attributes;
+};
+
+class XercesStreamHandler final : public XERCES_CPP_NAMESPACE::DefaultHandler
+{
+public:
+    XercesStreamHandler(XmlStreamHandler& handler) : m_handler(handler) {}
+
+    void startElement(const XMLCh* const, const XMLCh* const localName, const XMLCh* const, const Attributes& attributes) override
+    {
+        XercesStreamElement element(localName, attributes);
+        m_handler.StartElement(m_depth++, element);
+    }
+
+    void endElement(const XMLCh* const, const XMLCh* const, const XMLCh* const) override
+    {
+        m_handler.EndElement(--m_depth);
+    }
+
+private:
+    XmlStreamHandler& m_handler;
+    std::size_t m_depth = 0;
+};
+
 class XercesFactory final : public ComClass<XercesFactory, IXmlFactory>
 {
 public:
@@ -652,15 +769,110 @@ public:
 
     ~XercesFactory()
     {
+        // The grammars must be released before xerces is terminated.
+        m_grammarPools.clear();
         XERCES_CPP_NAMESPACE::XMLPlatformUtils::Terminate();
     }
 
     ComPtr<IXmlDom> CreateDomFromStream(XmlContentType footPrintType, const ComPtr<IStream>& stream) override
     {
-        return ComPtr<IXmlDom>::Make<XercesDom>(m_factory, stream, footPrintType);
+        return ComPtr<IXmlDom>::Make<XercesDom>(m_factory, stream, footPrintType, GetGrammarPool(footPrintType));
+    }
+
+    bool ParseStream(XmlContentType footPrintType, const ComPtr<IStream>& stream, XmlStreamHandler& handler) override
+    {
+        LARGE_INTEGER start = { 0 };
+        ThrowHrIfFailed(stream->Seek(start, StreamBase::Reference::START, nullptr));
+
+        std::unique_ptr<SAX2XMLReader> reader(XMLReaderFactory::createXMLReader(XERCES_CPP_NAMESPACE::XMLPlatformUtils::fgMemoryManager));
+        reader->setFeature(XMLUni::fgSAX2CoreNameSpaces, true);
+        reader->setFeature(XMLUni::fgSAX2CoreValidation, false);
+        reader->setFeature(XMLUni::fgXercesLoadSchema, false);
+        // Disable DTD and prevent XXE attacks.
+        reader->setFeature(XMLUni::fgXercesLoadExternalDTD, false);
+        reader->setFeature(XMLUni::fgXercesDisableDefaultEntityResolution, true);
+
+        ParsingException errorHandler;
+        XercesStreamHandler contentHandler(handler);
+        reader->setErrorHandler(&errorHandler);
+        reader->setContentHandler(&contentHandler);
+
+        StreamInputSource source(stream);
+        reader->parse(source);
+
+        // move the underlying stream back to the beginning.
+        ThrowHrIfFailed(stream->Seek(start, StreamBase::Reference::START, nullptr));
+        return true;
     }
 protected:
+    // Loading the schemas is the most expensive part of parsing a manifest, so they are loaded once per
+    // content type and kept for the lifetime of the factory. The pool is locked after it is loaded, which makes
+    // it read only and safe to share between parsers on different threads.
+    std::shared_ptr<XERCES_CPP_NAMESPACE::XMLGrammarPool> GetGrammarPool(XmlContentType footPrintType)
+    {
+        std::lock_guard<std::mutex> lock(m_grammarPoolsMutex);
+        auto found = m_grammarPools.find(footPrintType);
+        if (found != m_grammarPools.end())
+        {
+            return found->second;
+        }
+
+        // For Non validation parser GetResources will return an empty vector for the ContentType, BlockMap and AppxBundleManifest.
+        // XercesDom will only validate if there is a grammar pool. If not, it will only see that it is valid xml.
+        std::vector<std::pair<std::string, ComPtr<IStream>>> schemas;
+        if (footPrintType == XmlContentType::AppxBlockMapXml)
+        {
+            // Block map xml does not need schema validation.
+        }
+        else if (footPrintType == XmlContentType::AppxManifestXml)
+        {
+            schemas = GetResources(m_factory, Resource::Type::AppxManifest);
+        }
+        else if (footPrintType == XmlContentType::ContentTypeXml)
+        {
+            schemas = GetResources(m_factory, Resource::Type::ContentType);
+        }
+        else if (footPrintType == XmlContentType::AppxBundleManifestXml)
+        {
+            schemas = GetResources(m_factory, Resource::Type::AppxBundleManifest);
+        }
+        else
+        {
+            ThrowError(Error::InvalidParameter);
+        }
+
+        std::shared_ptr<XERCES_CPP_NAMESPACE::XMLGrammarPoolImpl> grammarPool;
+        if (!schemas.empty())
+        {
+            grammarPool = std::make_shared<XERCES_CPP_NAMESPACE::XMLGrammarPoolImpl>(XERCES_CPP_NAMESPACE::XMLPlatformUtils::fgMemoryManager);
+            {
+                XERCES_CPP_NAMESPACE::XercesDOMParser parser(nullptr, XERCES_CPP_NAMESPACE::XMLPlatformUtils::fgMemoryManager, grammarPool.get());
+                ParsingException errorHandler;
+                MsixEntityResolver entityResolver(m_factory, s_xmlNamespaces[static_cast<std::uint8_t>(footPrintType)]);
+                parser.setErrorHandler(&errorHandler);
+                parser.setXMLEntityResolver(&entityResolver);
+                parser.setDoNamespaces(true);
+                parser.setDoSchema(true);
+                parser.setValidationSchemaFullChecking(true);
+                parser.setDisableDefaultEntityResolution(true);
+
+                for(const auto& schema : schemas)
+                {
+                    auto schemaBuffer = Helper::CreateBufferFromStream(schema.second);
+                    auto item = std::make_unique<XERCES_CPP_NAMESPACE::MemBufInputSource>(
+                        reinterpret_cast<const XMLByte*>(&schemaBuffer[0]), schemaBuffer.size(), schema.first.c_str());
+                    parser.loadGrammar(*item, XERCES_CPP_NAMESPACE::Grammar::GrammarType::SchemaGrammarType, true);
+                }
+            }
+            grammarPool->lockPool();
+        }
+        m_grammarPools[footPrintType] = grammarPool;
+        return grammarPool;
+    }
+
     IMsixFactory* m_factory;
+    std::mutex m_grammarPoolsMutex;
+    std::map<XmlContentType, std::shared_ptr<XERCES_CPP_NAMESPACE::XMLGrammarPool>> m_grammarPools;
 };
 
 ComPtr<IXmlFactory> CreateXmlFactory(IMsixFactory* factory) { return ComPtr<IXmlFactory>::Make<XercesFactory>(factory); }
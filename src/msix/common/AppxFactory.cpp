@@ -13,6 +13,8 @@
 #include "AppxPackageWriter.hpp"
 #include "AppxBundleWriter.hpp"
 #include "ZipObjectWriter.hpp"
+#include "SignatureValidator.hpp"
+#include "ThreadPool.hpp"
 
 #ifdef BUNDLE_SUPPORT
 #include "AppxBundleManifest.hpp"
@@ -47,7 +49,7 @@ namespace MSIX {
         ThrowErrorIf(Error::InvalidParameter, (packageReader == nullptr || *packageReader != nullptr), "Invalid parameter");
         ComPtr<IStream> input(inputStream);
         auto zip = ComPtr<IStorageObject>::Make<ZipObjectReader>(input);
-        auto result = ComPtr<IAppxPackageReader>::Make<AppxPackageObject>(this, m_validationOptions, m_applicabilityFlags, zip);
+        auto result = ComPtr<IAppxPackageReader>::Make<AppxPackageObject>(this, m_validationOptions, m_applicabilityFlags, m_factoryOptions, zip);
         *packageReader = result.Detach();
         return static_cast<HRESULT>(Error::OK);
     } CATCH_RETURN();
@@ -180,6 +182,7 @@ namespace MSIX {
             ThrowErrorAndLog(Error::FileNotFound, resource.c_str());
         }
 
+        std::unique_lock<std::mutex> lock(m_resourcezipMutex);
         if(!m_resourcezip) // Initialize it when first needed.
         {
             // Get stream of the resource zip file generated at CMake processing.
@@ -187,11 +190,32 @@ namespace MSIX {
             auto resourceStream = ComPtr<IStream>::Make<VectorStream>(&m_resourcesVector);
             m_resourcezip = ComPtr<IStorageObject>::Make<ZipObjectReader>(resourceStream.Get());
         }
+        lock.unlock();
         auto file = m_resourcezip->GetFile(resource);
         ThrowErrorIfNot(Error::FileNotFound, file, resource.c_str());
         return file;
     }
 
+    std::shared_ptr<TrustStore> AppxFactory::GetTrustStore()
+    {
+        std::lock_guard<std::mutex> lock(m_trustStoreMutex);
+        if (!m_trustStore) // Initialize it when first needed.
+        {
+            m_trustStore = SignatureValidator::CreateTrustStore(this, m_trustedCertificates);
+        }
+        return m_trustStore;
+    }
+
+    std::shared_ptr<ThreadPool> AppxFactory::GetInflateThreadPool()
+    {
+        std::lock_guard<std::mutex> lock(m_inflateThreadPoolMutex);
+        if (!m_inflateThreadPool) // Initialize it when first needed.
+        {
+            m_inflateThreadPool = std::make_shared<ThreadPool>(ThreadPool::DefaultThreadCount());
+        }
+        return m_inflateThreadPool;
+    }
+
     // IMsixFactoryOverrides
     HRESULT STDMETHODCALLTYPE AppxFactory::SpecifyExtension(MSIX_FACTORY_EXTENSION name, IUnknown* extension) noexcept try
     {
@@ -205,6 +229,20 @@ namespace MSIX {
         {
             ThrowHrIfFailed(extension->QueryInterface(UuidOfImpl<IMsixApplicabilityLanguagesEnumerator>::iid, reinterpret_cast<void**>(&m_applicabilityLanguagesEnumerator)));
         }
+        else if (name == MSIX_FACTORY_EXTENSION_TRUSTED_CERTIFICATES)
+        {
+            ComPtr<IStream> certificates;
+            ThrowHrIfFailed(extension->QueryInterface(UuidOfImpl<IStream>::iid, reinterpret_cast<void**>(&certificates)));
+            // Build the store now so invalid certificates are reported to the caller
+            auto trustStore = SignatureValidator::CreateTrustStore(this, certificates);
+            std::lock_guard<std::mutex> lock(m_trustStoreMutex);
+            m_trustedCertificates = certificates;
+            m_trustStore = trustStore;
+        }
+        else if (name == MSIX_FACTORY_EXTENSION_INDEX_CACHE)
+        {
+            ThrowHrIfFailed(extension->QueryInterface(UuidOfImpl<IMsixIndexCache>::iid, reinterpret_cast<void**>(&m_indexCache)));
+        }
         else
         {
             return static_cast<HRESULT>(Error::InvalidParameter);
@@ -231,6 +269,21 @@ namespace MSIX {
                 *extension = m_applicabilityLanguagesEnumerator.As<IUnknown>().Detach();
             }
         }
+        else if (name == MSIX_FACTORY_EXTENSION_TRUSTED_CERTIFICATES)
+        {
+            std::lock_guard<std::mutex> lock(m_trustStoreMutex);
+            if (m_trustedCertificates.Get() != nullptr)
+            {
+                *extension = m_trustedCertificates.As<IUnknown>().Detach();
+            }
+        }
+        else if (name == MSIX_FACTORY_EXTENSION_INDEX_CACHE)
+        {
+            if (m_indexCache.Get() != nullptr)
+            {
+                *extension = m_indexCache.As<IUnknown>().Detach();
+            }
+        }
         else
         {
             return static_cast<HRESULT>(Error::InvalidParameter);
@@ -0,0 +1,55 @@
+//
+//  Copyright (C) 2019 Microsoft.  All rights reserved.
+//  See LICENSE file in the project root for full license information.
+//
+#include "ICompressionObject.hpp"
+
+#include <mutex>
+#include <vector>
+
+namespace MSIX {
+
+    // An inflate keeps about 40KB, enough for the streams of a few unpack threads
+    static const std::size_t MaximumPoolSize = 16;
+
+    struct CompressionObjectPool
+    {
+        std::mutex mutex;
+        std::vector<std::unique_ptr<ICompressionObject>> objects;
+    };
+
+    static CompressionObjectPool& GetPool()
+    {
+        static CompressionObjectPool pool;
+        return pool;
+    }
+
+    std::unique_ptr<ICompressionObject> AcquireCompressionObject()
+    {
+        auto& pool = GetPool();
+        {
+            std::lock_guard<std::mutex> lock(pool.mutex);
+            if (!pool.objects.empty())
+            {
+                auto compressionObject = std::move(pool.objects.back());
+                pool.objects.pop_back();
+                return compressionObject;
+            }
+        }
+        return CreateCompressionObject();
+    }
+
+    void ReleaseCompressionObject(std::unique_ptr<ICompressionObject>&& compressionObject)
+    {
+        auto& pool = GetPool();
+        {
+            std::lock_guard<std::mutex> lock(pool.mutex);
+            if (compressionObject && pool.objects.size() < MaximumPoolSize)
+            {
+                pool.objects.push_back(std::move(compressionObject));
+                return;
+            }
+        }
+        compressionObject.reset();
+    }
+}
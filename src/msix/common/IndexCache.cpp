@@ -0,0 +1,81 @@
+//
+//  Copyright (C) 2019 Microsoft.  All rights reserved.
+//  See LICENSE file in the project root for full license information.
+//
+#include "IndexCache.hpp"
+#include "Exceptions.hpp"
+#include "FileStream.hpp"
+#include "StreamHelper.hpp"
+#include "ScopeExit.hpp"
+
+#include <cstdio>
+#include <random>
+
+namespace MSIX {
+
+    DirectoryIndexCache::DirectoryIndexCache(const std::string& directory) : m_directory(directory)
+    {
+        ThrowErrorIf(Error::InvalidParameter, m_directory.empty(), "Invalid index cache directory");
+        if (m_directory.back() == '/' || m_directory.back() == '\\')
+        {
+            m_directory.pop_back();
+        }
+    }
+
+    std::string DirectoryIndexCache::GetEntryName(LPCSTR key)
+    {
+        // Only hexadecimal keys are accepted, so a key can't name a file outside of the directory
+        ThrowErrorIf(Error::InvalidParameter, (key == nullptr || *key == '\0'), "Invalid index cache key");
+        for (auto c = key; *c != '\0'; c++)
+        {
+            ThrowErrorIfNot(Error::InvalidParameter, ((*c >= '0' && *c <= '9') || (*c >= 'a' && *c <= 'f')), "Invalid index cache key");
+        }
+        return m_directory + "/" + key + ".idx";
+    }
+
+    // IMsixIndexCache
+    HRESULT STDMETHODCALLTYPE DirectoryIndexCache::GetEntry(LPCSTR key, IStream** entry) noexcept try
+    {
+        ThrowErrorIf(Error::InvalidParameter, (entry == nullptr || *entry != nullptr), "bad pointer");
+        auto name = GetEntryName(key);
+
+        // A missing entry isn't an error
+        auto file = std::fopen(name.c_str(), "rb");
+        if (file == nullptr)
+        {
+            return static_cast<HRESULT>(Error::OK);
+        }
+        std::fclose(file);
+        ThrowHrIfFailed(CreateStreamOnFile(const_cast<char*>(name.c_str()), true, entry));
+        return static_cast<HRESULT>(Error::OK);
+    } CATCH_RETURN();
+
+    HRESULT STDMETHODCALLTYPE DirectoryIndexCache::SetEntry(LPCSTR key, IStream* entry) noexcept try
+    {
+        ThrowErrorIf(Error::InvalidParameter, (entry == nullptr), "bad pointer");
+        auto name = GetEntryName(key);
+        auto data = Helper::CreateBufferFromStream(ComPtr<IStream>(entry));
+
+        // Other processes might write the same entry at the same time, so every writer uses its own temporary file
+        std::random_device random;
+        auto temporaryName = name + "." + std::to_string(random()) + ".tmp";
+        auto deleteFile = MSIX::scope_exit([&temporaryName]
+        {
+            std::remove(temporaryName.c_str());
+        });
+        {
+            auto stream = ComPtr<IStream>::Make<FileStream>(temporaryName, FileStream::Mode::WRITE);
+            ULONG written = 0;
+            ThrowHrIfFailed(stream->Write(data.data(), static_cast<ULONG>(data.size()), &written));
+            ThrowErrorIf(Error::FileWrite, (written != data.size()), "Failed to write index cache entry");
+        }
+
+        #ifdef WIN32
+        // rename doesn't replace existing files on Windows
+        std::remove(name.c_str());
+        #endif
+        ThrowErrorIf(Error::FileWrite, (std::rename(temporaryName.c_str(), name.c_str()) != 0), "Failed to replace index cache entry");
+        deleteFile.release();
+        return static_cast<HRESULT>(Error::OK);
+    } CATCH_RETURN();
+}
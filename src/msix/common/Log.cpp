@@ -3,13 +3,105 @@
 //  See LICENSE file in the project root for full license information.
 // 
 #include "Log.hpp"
+#include <array>
+#include <iomanip>
 #include <sstream>
 
 namespace MSIX { namespace Global { namespace Log {
-static std::stringstream g_content;
 
-void Append(const std::string& comment) { ((!comment.empty()) ? g_content << '\n' : g_content) << comment; }
-std::string Text() { return g_content.str(); }
-void Clear() { g_content.str(""), g_content.clear(); }
+namespace {
+    // A failure only copies its details and part name into a reused record. The text is built by Text.
+    struct Record
+    {
+        std::uint32_t code = 0;
+        const char*   file = nullptr; // nullptr for comments
+        int           line = 0;
+        std::string   details;
+        std::string   part;
+    };
 
-} /* log */ } /* Global */ } /* msix */
\ No newline at end of file
+    struct RingBuffer
+    {
+        static const std::size_t Capacity = 32;
+
+        Record& Add()
+        {
+            auto& record = records[count % Capacity];
+            count++;
+            return record;
+        }
+
+        std::array<Record, Capacity> records;
+        std::size_t count = 0; // records added since the last Clear, including the ones overwritten
+    };
+
+    thread_local RingBuffer t_log;
+    thread_local const std::string* t_part = nullptr;
+
+    Record& AddRecord()
+    {
+        auto& record = t_log.Add();
+        if (t_part) { record.part.assign(*t_part); }
+        else { record.part.clear(); }
+        return record;
+    }
+}
+
+void Append(std::uint32_t code, const char* file, int line, const char* details)
+{
+    auto& record = AddRecord();
+    record.code = code;
+    record.file = file;
+    record.line = line;
+    if (details) { record.details.assign(details); }
+    else { record.details.clear(); }
+}
+
+void Append(const std::string& comment)
+{
+    if (comment.empty()) { return; }
+    auto& record = AddRecord();
+    record.code = 0;
+    record.file = nullptr;
+    record.line = 0;
+    record.details.assign(comment);
+}
+
+std::string Text()
+{
+    std::ostringstream text;
+    std::size_t first = 0;
+    if (t_log.count > RingBuffer::Capacity)
+    {
+        first = t_log.count - RingBuffer::Capacity;
+        text << '\n' << first << " earlier log records were dropped";
+    }
+    for (std::size_t i = first; i < t_log.count; i++)
+    {
+        const auto& record = t_log.records[i % RingBuffer::Capacity];
+        text << '\n' << record.details;
+        if (record.file)
+        {
+            if (!record.details.empty()) { text << '\n'; }
+            text << "Call failed in " << record.file << " on line " << record.line
+                 << " with 0x" << std::hex << std::setw(8) << std::setfill('0') << record.code << std::dec;
+        }
+        if (!record.part.empty()) { text << "\nwhile processing " << record.part; }
+    }
+    return text.str();
+}
+
+void Clear() { t_log.count = 0; }
+
+std::string Take()
+{
+    auto text = Text();
+    Clear();
+    if (!text.empty()) { text.erase(0, 1); } // the caller appends it as one comment
+    return text;
+}
+
+PartScope::PartScope(const std::string& part) : m_previous(t_part) { t_part = &part; }
+PartScope::~PartScope() { t_part = m_previous; }
+
+} /* log */ } /* Global */ } /* msix */
@@ -0,0 +1,203 @@
+//
+//  Copyright (C) 2019 Microsoft.  All rights reserved.
+//  See LICENSE file in the project root for full license information.
+//
+#include "RangeSourceStream.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+
+namespace MSIX {
+
+    const std::uint64_t RangeSourceStream::MinimumReadSize;
+    const std::uint64_t RangeSourceStream::MaximumReadSize;
+    const std::uint64_t RangeSourceStream::CacheSize;
+
+    RangeSourceStream::Source::Source(IMsixRangeSource* rangeSource) : source(rangeSource)
+    {
+        ThrowErrorIf(Error::InvalidParameter, (rangeSource == nullptr), "bad pointer");
+        UINT64 sourceSize = 0;
+        ThrowHrIfFailed(rangeSource->GetSize(&sourceSize));
+        size = sourceSize;
+    }
+
+    // IStream
+    HRESULT STDMETHODCALLTYPE RangeSourceStream::Clone(IStream** stream) noexcept try
+    {
+        ThrowErrorIf(Error::InvalidParameter, (stream == nullptr || *stream != nullptr), "bad pointer");
+        auto clone = ComPtr<IStream>::Make<RangeSourceStream>(m_source);
+        LARGE_INTEGER pos = { 0 };
+        pos.QuadPart = m_position;
+        ThrowHrIfFailed(clone->Seek(pos, StreamBase::Reference::START, nullptr));
+        *stream = clone.Detach();
+        return static_cast<HRESULT>(Error::OK);
+    } CATCH_RETURN();
+
+    HRESULT STDMETHODCALLTYPE RangeSourceStream::Read(void* buffer, ULONG countBytes, ULONG* bytesRead) noexcept try
+    {
+        if (bytesRead) { *bytesRead = 0; }
+        ThrowErrorIf(Error::InvalidParameter, (buffer == nullptr && countBytes != 0), "bad pointer");
+        std::lock_guard<std::mutex> lock(m_source->mutex);
+        ULONG total = 0;
+        while (total < countBytes && m_position < m_source->size)
+        {
+            auto read = ReadFromRanges(m_position, static_cast<std::uint8_t*>(buffer) + total, countBytes - total);
+            if (read == 0)
+            {
+                ReadMissingRange(m_position, countBytes - total);
+                continue;
+            }
+            total += static_cast<ULONG>(read);
+            m_position += read;
+        }
+        if (bytesRead) { *bytesRead = total; }
+        return static_cast<HRESULT>(Error::OK);
+    } CATCH_RETURN();
+
+    HRESULT STDMETHODCALLTYPE RangeSourceStream::Seek(LARGE_INTEGER move, DWORD origin, ULARGE_INTEGER* newPosition) noexcept try
+    {
+        LONGLONG newPos = move.QuadPart;
+        switch (origin)
+        {
+            case Reference::CURRENT:
+                newPos += static_cast<LONGLONG>(m_position);
+                break;
+            case Reference::END:
+                newPos += static_cast<LONGLONG>(m_source->size);
+                break;
+        }
+        ThrowErrorIf(Error::FileSeek, (newPos < 0), "seek failed");
+        m_position = std::min(static_cast<std::uint64_t>(newPos), m_source->size);
+        if (newPosition) { newPosition->QuadPart = m_position; }
+        return static_cast<HRESULT>(Error::OK);
+    } CATCH_RETURN();
+
+    // IStreamInternal
+    void RangeSourceStream::Prefetch(const std::vector<ByteRange>& ranges)
+    {
+        auto sorted = ranges;
+        std::sort(sorted.begin(), sorted.end(), [](const ByteRange& a, const ByteRange& b) { return a.offset < b.offset; });
+
+        std::lock_guard<std::mutex> lock(m_source->mutex);
+        for (auto range = sorted.begin(); range != sorted.end();)
+        {   // Reading a small gap costs less than another read
+            auto start = range->offset;
+            auto end = range->offset + range->size;
+            for (range++; range != sorted.end() && range->offset <= end + MinimumReadSize; range++)
+            {
+                end = std::max(end, range->offset + range->size);
+            }
+            end = std::min(end, m_source->size);
+
+            while (start < end)
+            {
+                auto next = m_source->ranges.upper_bound(start);
+                if (next != m_source->ranges.begin())
+                {
+                    auto previous = std::prev(next);
+                    auto previousEnd = previous->first + previous->second.size();
+                    if (previousEnd > start)
+                    {
+                        start = previousEnd;
+                        continue;
+                    }
+                }
+                auto readEnd = std::min(end, start + MaximumReadSize);
+                if (next != m_source->ranges.end())
+                {
+                    readEnd = std::min(readEnd, next->first);
+                }
+                ReadRange(start, readEnd);
+                start = readEnd;
+            }
+        }
+    }
+
+    void RangeSourceStream::SetReadOrder(const std::vector<ByteRange>& ranges)
+    {
+        auto sorted = ranges;
+        std::sort(sorted.begin(), sorted.end(), [](const ByteRange& a, const ByteRange& b) { return a.offset < b.offset; });
+        std::lock_guard<std::mutex> lock(m_source->mutex);
+        m_source->expectedRanges = std::move(sorted);
+    }
+
+    std::size_t RangeSourceStream::ReadFromRanges(std::uint64_t offset, std::uint8_t* buffer, std::size_t size)
+    {
+        auto range = m_source->ranges.upper_bound(offset);
+        if (range == m_source->ranges.begin())
+        {
+            return 0;
+        }
+        range--;
+        auto rangeEnd = range->first + range->second.size();
+        if (rangeEnd <= offset)
+        {
+            return 0;
+        }
+        auto toCopy = static_cast<std::size_t>(std::min(static_cast<std::uint64_t>(size), rangeEnd - offset));
+        std::memcpy(buffer, range->second.data() + (offset - range->first), toCopy);
+        return toCopy;
+    }
+
+    void RangeSourceStream::ReadMissingRange(std::uint64_t offset, std::uint64_t size)
+    {
+        auto end = offset + std::max(size, MinimumReadSize);
+
+        // Continue with the ranges expected to be read next, as long as they follow each other
+        auto& expected = m_source->expectedRanges;
+        auto current = std::upper_bound(expected.begin(), expected.end(), offset,
+            [](std::uint64_t value, const ByteRange& range) { return value < range.offset + range.size; });
+        if (current != expected.end() && current->offset <= offset)
+        {
+            auto last = current->offset + current->size;
+            for (auto next = current + 1; next != expected.end() && next->offset == last; next++)
+            {
+                if (next->offset + next->size - offset > MaximumReadSize)
+                {
+                    break;
+                }
+                last = next->offset + next->size;
+            }
+            end = std::max(end, last);
+        }
+        end = std::min({ end, offset + MaximumReadSize, m_source->size });
+
+        // Zip readers start at the end of the file, then read the central directory before it
+        auto start = offset;
+        if (end - start < MinimumReadSize)
+        {
+            start = (end > MinimumReadSize) ? end - MinimumReadSize : 0;
+        }
+
+        // Don't read again what was already read
+        auto next = m_source->ranges.upper_bound(offset);
+        if (next != m_source->ranges.end())
+        {
+            end = std::min(end, next->first);
+        }
+        if (next != m_source->ranges.begin())
+        {
+            auto previous = std::prev(next);
+            start = std::max(start, previous->first + previous->second.size());
+        }
+        ReadRange(start, end);
+    }
+
+    void RangeSourceStream::ReadRange(std::uint64_t offset, std::uint64_t end)
+    {
+        std::vector<std::uint8_t> data(static_cast<std::size_t>(end - offset));
+        ThrowHrIfFailed(m_source->source->ReadRange(offset, static_cast<UINT32>(data.size()), data.data()));
+        m_source->rangesSize += data.size();
+        m_source->ranges.emplace(offset, std::move(data));
+        m_source->readOrder.push_back(offset);
+
+        while (m_source->rangesSize > CacheSize && m_source->readOrder.size() > 1)
+        {
+            auto oldest = m_source->ranges.find(m_source->readOrder.front());
+            m_source->rangesSize -= oldest->second.size();
+            m_source->ranges.erase(oldest);
+            m_source->readOrder.pop_front();
+        }
+    }
+}
@@ -0,0 +1,449 @@
+//
+//  Copyright (C) 2019 Microsoft.  All rights reserved.
+//  See LICENSE file in the project root for full license information.
+//
+#include "SHA256Kernel.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define MSIX_SHA256_X64
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define MSIX_TARGET(features)
+#else
+#include <cpuid.h>
+#define MSIX_TARGET(features) __attribute__((target(features)))
+#endif
+#endif
+
+namespace MSIX { namespace SHA256Kernel {
+
+    static const std::uint32_t K[64] = {
+        0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+        0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+        0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+        0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+        0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+        0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+        0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+        0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2 };
+
+    static const std::uint32_t InitialState[8] = {
+        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19 };
+
+    static inline std::uint32_t LoadBigEndian(const std::uint8_t* data)
+    {
+        return (static_cast<std::uint32_t>(data[0]) << 24) | (static_cast<std::uint32_t>(data[1]) << 16) |
+            (static_cast<std::uint32_t>(data[2]) << 8) | static_cast<std::uint32_t>(data[3]);
+    }
+
+    static inline void StoreBigEndian(std::uint8_t* data, std::uint32_t value)
+    {
+        data[0] = static_cast<std::uint8_t>(value >> 24);
+        data[1] = static_cast<std::uint8_t>(value >> 16);
+        data[2] = static_cast<std::uint8_t>(value >> 8);
+        data[3] = static_cast<std::uint8_t>(value);
+    }
+
+    static inline std::uint32_t Rotr(std::uint32_t x, int n)
+    {
+        return (x >> n) | (x << (32 - n));
+    }
+
+    // Compresses blocks of 64 bytes into state
+    typedef void (*CompressFunction)(std::uint32_t* state, const std::uint8_t* data, std::size_t blocks);
+
+    static void CompressPortable(std::uint32_t* state, const std::uint8_t* data, std::size_t blocks)
+    {
+        std::uint32_t w[16];
+        for (; blocks > 0; blocks--, data += 64)
+        {
+            std::uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+            std::uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+            for (int t = 0; t < 64; t++)
+            {
+                if (t < 16)
+                {
+                    w[t] = LoadBigEndian(data + 4 * t);
+                }
+                else
+                {
+                    auto w15 = w[(t - 15) & 15];
+                    auto w2 = w[(t - 2) & 15];
+                    w[t & 15] += (Rotr(w2, 17) ^ Rotr(w2, 19) ^ (w2 >> 10)) + w[(t - 7) & 15] +
+                        (Rotr(w15, 7) ^ Rotr(w15, 18) ^ (w15 >> 3));
+                }
+                auto t1 = h + (Rotr(e, 6) ^ Rotr(e, 11) ^ Rotr(e, 25)) + ((e & f) ^ (~e & g)) + K[t] + w[t & 15];
+                auto t2 = (Rotr(a, 2) ^ Rotr(a, 13) ^ Rotr(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+                h = g; g = f; f = e; e = d + t1;
+                d = c; c = b; b = a; a = t1 + t2;
+            }
+            state[0] += a; state[1] += b; state[2] += c; state[3] += d;
+            state[4] += e; state[5] += f; state[6] += g; state[7] += h;
+        }
+    }
+
+#ifdef MSIX_SHA256_X64
+    MSIX_TARGET("sha,sse4.1,ssse3")
+    static void CompressShaNi(std::uint32_t* state, const std::uint8_t* data, std::size_t blocks)
+    {
+        const __m128i byteSwap = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+
+        // The instructions work on the state as ABEF and CDGH
+        __m128i tmp = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(&state[0])), 0xB1);
+        __m128i state1 = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(&state[4])), 0x1B);
+        __m128i state0 = _mm_alignr_epi8(tmp, state1, 8);
+        state1 = _mm_blend_epi16(state1, tmp, 0xF0);
+
+        for (; blocks > 0; blocks--, data += 64)
+        {
+            __m128i abef = state0;
+            __m128i cdgh = state1;
+            __m128i w[4];
+            for (int i = 0; i < 16; i++)
+            {
+                if (i < 4)
+                {
+                    w[i] = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 16 * i)), byteSwap);
+                }
+                else
+                {
+                    w[i & 3] = _mm_sha256msg2_epu32(_mm_add_epi32(_mm_sha256msg1_epu32(w[i & 3], w[(i - 3) & 3]),
+                        _mm_alignr_epi8(w[(i - 1) & 3], w[(i - 2) & 3], 4)), w[(i - 1) & 3]);
+                }
+                __m128i message = _mm_add_epi32(w[i & 3], _mm_loadu_si128(reinterpret_cast<const __m128i*>(&K[4 * i])));
+                state1 = _mm_sha256rnds2_epu32(state1, state0, message);
+                state0 = _mm_sha256rnds2_epu32(state0, state1, _mm_shuffle_epi32(message, 0x0E));
+            }
+            state0 = _mm_add_epi32(state0, abef);
+            state1 = _mm_add_epi32(state1, cdgh);
+        }
+
+        tmp = _mm_shuffle_epi32(state0, 0x1B);
+        state1 = _mm_shuffle_epi32(state1, 0xB1);
+        state0 = _mm_blend_epi16(tmp, state1, 0xF0);
+        state1 = _mm_alignr_epi8(state1, tmp, 8);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(&state[0]), state0);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(&state[4]), state1);
+    }
+
+    template <int N>
+    MSIX_TARGET("avx2")
+    static inline __m256i Rotr8(__m256i x)
+    {
+        return _mm256_or_si256(_mm256_srli_epi32(x, N), _mm256_slli_epi32(x, 32 - N));
+    }
+
+    // Compresses the blocks of 8 buffers at once, a 32 bit lane for each of them. states has the 8 words of
+    // state of every buffer.
+    MSIX_TARGET("avx2")
+    static void CompressAvx2x8(std::uint32_t (*states)[8], const std::uint8_t* const* data, std::size_t blocks)
+    {
+        __m256i s[8];
+        for (int j = 0; j < 8; j++)
+        {
+            s[j] = _mm256_setr_epi32(states[0][j], states[1][j], states[2][j], states[3][j],
+                states[4][j], states[5][j], states[6][j], states[7][j]);
+        }
+
+        for (std::size_t offset = 0; blocks > 0; blocks--, offset += 64)
+        {
+            __m256i w[16];
+            __m256i a = s[0], b = s[1], c = s[2], d = s[3], e = s[4], f = s[5], g = s[6], h = s[7];
+            for (int t = 0; t < 64; t++)
+            {
+                if (t < 16)
+                {
+                    auto word = offset + 4 * t;
+                    w[t] = _mm256_setr_epi32(
+                        LoadBigEndian(data[0] + word), LoadBigEndian(data[1] + word), LoadBigEndian(data[2] + word),
+                        LoadBigEndian(data[3] + word), LoadBigEndian(data[4] + word), LoadBigEndian(data[5] + word),
+                        LoadBigEndian(data[6] + word), LoadBigEndian(data[7] + word));
+                }
+                else
+                {
+                    auto w15 = w[(t - 15) & 15];
+                    auto w2 = w[(t - 2) & 15];
+                    auto sigma0 = _mm256_xor_si256(_mm256_xor_si256(Rotr8<7>(w15), Rotr8<18>(w15)), _mm256_srli_epi32(w15, 3));
+                    auto sigma1 = _mm256_xor_si256(_mm256_xor_si256(Rotr8<17>(w2), Rotr8<19>(w2)), _mm256_srli_epi32(w2, 10));
+                    w[t & 15] = _mm256_add_epi32(_mm256_add_epi32(w[t & 15], sigma0), _mm256_add_epi32(w[(t - 7) & 15], sigma1));
+                }
+                auto sum1 = _mm256_xor_si256(_mm256_xor_si256(Rotr8<6>(e), Rotr8<11>(e)), Rotr8<25>(e));
+                auto choose = _mm256_xor_si256(_mm256_and_si256(e, f), _mm256_andnot_si256(e, g));
+                auto t1 = _mm256_add_epi32(_mm256_add_epi32(h, sum1),
+                    _mm256_add_epi32(choose, _mm256_add_epi32(_mm256_set1_epi32(static_cast<int>(K[t])), w[t & 15])));
+                auto sum0 = _mm256_xor_si256(_mm256_xor_si256(Rotr8<2>(a), Rotr8<13>(a)), Rotr8<22>(a));
+                auto majority = _mm256_or_si256(_mm256_and_si256(a, b), _mm256_and_si256(c, _mm256_or_si256(a, b)));
+                auto t2 = _mm256_add_epi32(sum0, majority);
+                h = g; g = f; f = e; e = _mm256_add_epi32(d, t1);
+                d = c; c = b; b = a; a = _mm256_add_epi32(t1, t2);
+            }
+            s[0] = _mm256_add_epi32(s[0], a); s[1] = _mm256_add_epi32(s[1], b);
+            s[2] = _mm256_add_epi32(s[2], c); s[3] = _mm256_add_epi32(s[3], d);
+            s[4] = _mm256_add_epi32(s[4], e); s[5] = _mm256_add_epi32(s[5], f);
+            s[6] = _mm256_add_epi32(s[6], g); s[7] = _mm256_add_epi32(s[7], h);
+        }
+
+        for (int j = 0; j < 8; j++)
+        {
+            alignas(32) std::uint32_t lanes[8];
+            _mm256_store_si256(reinterpret_cast<__m256i*>(lanes), s[j]);
+            for (int lane = 0; lane < 8; lane++)
+            {
+                states[lane][j] = lanes[lane];
+            }
+        }
+    }
+
+    struct CpuFeatures
+    {
+        bool sha = false;
+        bool avx2 = false;
+    };
+
+    static CpuFeatures GetCpuFeatures()
+    {
+        CpuFeatures features;
+        unsigned int leaf1[4] = {};
+        unsigned int leaf7[4] = {};
+        #ifdef _MSC_VER
+        int registers[4];
+        __cpuid(registers, 0);
+        auto maxLeaf = static_cast<unsigned int>(registers[0]);
+        __cpuid(registers, 1);
+        for (int i = 0; i < 4; i++) { leaf1[i] = static_cast<unsigned int>(registers[i]); }
+        if (maxLeaf >= 7)
+        {
+            __cpuidex(registers, 7, 0);
+            for (int i = 0; i < 4; i++) { leaf7[i] = static_cast<unsigned int>(registers[i]); }
+        }
+        #else
+        auto maxLeaf = __get_cpuid_max(0, nullptr);
+        __get_cpuid(1, &leaf1[0], &leaf1[1], &leaf1[2], &leaf1[3]);
+        if (maxLeaf >= 7)
+        {
+            __cpuid_count(7, 0, leaf7[0], leaf7[1], leaf7[2], leaf7[3]);
+        }
+        #endif
+        bool ssse3 = (leaf1[2] & (1u << 9)) != 0;
+        bool sse41 = (leaf1[2] & (1u << 19)) != 0;
+        features.sha = ssse3 && sse41 && ((leaf7[1] & (1u << 29)) != 0);
+
+        // AVX2 also needs the OS to save the YMM registers
+        bool osxsave = (leaf1[2] & (1u << 27)) != 0;
+        if (osxsave && ((leaf7[1] & (1u << 5)) != 0))
+        {
+            #ifdef _MSC_VER
+            auto xcr0 = _xgetbv(0);
+            #else
+            unsigned int eax = 0, edx = 0;
+            __asm__("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+            auto xcr0 = (static_cast<std::uint64_t>(edx) << 32) | eax;
+            #endif
+            features.avx2 = ((xcr0 & 6) == 6);
+        }
+        return features;
+    }
+#endif
+
+    struct Implementation
+    {
+        CompressFunction compress = CompressPortable;
+        bool parallel = false;
+        const char* name = "portable";
+    };
+
+    static const Implementation& GetImplementationOf(ImplementationKind kind)
+    {
+        static const Implementation portable;
+        #ifdef MSIX_SHA256_X64
+        static const Implementation avx2 = { CompressPortable, true, "avx2" };
+        static const Implementation shaNi = { CompressShaNi, false, "sha-ni" };
+        switch (kind)
+        {
+        case ImplementationKind::Avx2:
+            return avx2;
+        case ImplementationKind::ShaNi:
+            return shaNi;
+        default:
+            break;
+        }
+        #endif
+        return portable;
+    }
+
+    static const Implementation& GetSelectedImplementation()
+    {
+        static const Implementation& implementation = []() -> const Implementation&
+        {
+            if (IsSupported(ImplementationKind::ShaNi))
+            {   // Faster than hashing 8 buffers at once with AVX2
+                return GetImplementationOf(ImplementationKind::ShaNi);
+            }
+            else if (IsSupported(ImplementationKind::Avx2))
+            {
+                return GetImplementationOf(ImplementationKind::Avx2);
+            }
+            return GetImplementationOf(ImplementationKind::Portable);
+        }();
+        return implementation;
+    }
+
+    // Set by ForceImplementation
+    static std::atomic<const Implementation*> s_forcedImplementation(nullptr);
+
+    static const Implementation& GetImplementation()
+    {
+        auto forced = s_forcedImplementation.load(std::memory_order_relaxed);
+        return (forced != nullptr) ? *forced : GetSelectedImplementation();
+    }
+
+    void Init(Context& context)
+    {
+        std::memcpy(context.state, InitialState, sizeof(InitialState));
+        context.bufferSize = 0;
+        context.length = 0;
+    }
+
+    void Update(Context& context, const std::uint8_t* data, std::size_t size)
+    {
+        auto compress = GetImplementation().compress;
+        context.length += size;
+        if (context.bufferSize > 0)
+        {
+            auto toCopy = std::min(size, sizeof(context.buffer) - context.bufferSize);
+            std::memcpy(context.buffer + context.bufferSize, data, toCopy);
+            context.bufferSize += toCopy;
+            data += toCopy;
+            size -= toCopy;
+            if (context.bufferSize < sizeof(context.buffer))
+            {
+                return;
+            }
+            compress(context.state, context.buffer, 1);
+            context.bufferSize = 0;
+        }
+        if (size >= 64)
+        {
+            compress(context.state, data, size / 64);
+            data += size & ~static_cast<std::size_t>(63);
+            size &= 63;
+        }
+        if (size > 0)
+        {
+            std::memcpy(context.buffer, data, size);
+            context.bufferSize = size;
+        }
+    }
+
+    // Writes the padding of a message of length bytes that ends with the size bytes of tail, returns the number
+    // of blocks written to padded.
+    static std::size_t Pad(const std::uint8_t* tail, std::size_t size, std::uint64_t length, std::uint8_t padded[128])
+    {
+        std::memset(padded, 0, 128);
+        std::memcpy(padded, tail, size);
+        padded[size] = 0x80;
+        std::size_t blocks = (size + 9 > 64) ? 2 : 1;
+        auto bits = length * 8;
+        for (int i = 0; i < 8; i++)
+        {
+            padded[blocks * 64 - 1 - i] = static_cast<std::uint8_t>(bits >> (8 * i));
+        }
+        return blocks;
+    }
+
+    void Final(Context& context, std::uint8_t digest[32])
+    {
+        std::uint8_t padded[128];
+        auto blocks = Pad(context.buffer, context.bufferSize, context.length, padded);
+        GetImplementation().compress(context.state, padded, blocks);
+        for (int i = 0; i < 8; i++)
+        {
+            StoreBigEndian(digest + 4 * i, context.state[i]);
+        }
+    }
+
+    std::size_t GetParallelCount()
+    {
+        return GetImplementation().parallel ? MaximumParallelCount : 1;
+    }
+
+    void HashParallel(const std::uint8_t* const* data, std::size_t size, std::size_t count, std::uint8_t (*digests)[32])
+    {
+        #ifdef MSIX_SHA256_X64
+        if (GetImplementation().parallel && count > 1)
+        {   // Missing buffers hash the first one again
+            const std::uint8_t* lanes[8];
+            std::uint32_t states[8][8];
+            for (std::size_t lane = 0; lane < 8; lane++)
+            {
+                lanes[lane] = data[(lane < count) ? lane : 0];
+                std::memcpy(states[lane], InitialState, sizeof(InitialState));
+            }
+            auto blocks = size / 64;
+            CompressAvx2x8(states, lanes, blocks);
+
+            std::uint8_t padded[8][128];
+            std::size_t paddedBlocks = 0;
+            for (std::size_t lane = 0; lane < 8; lane++)
+            {
+                paddedBlocks = Pad(lanes[lane] + blocks * 64, size % 64, size, padded[lane]);
+                lanes[lane] = padded[lane];
+            }
+            CompressAvx2x8(states, lanes, paddedBlocks);
+
+            for (std::size_t lane = 0; lane < count; lane++)
+            {
+                for (int i = 0; i < 8; i++)
+                {
+                    StoreBigEndian(digests[lane] + 4 * i, states[lane][i]);
+                }
+            }
+            return;
+        }
+        #endif
+        for (std::size_t i = 0; i < count; i++)
+        {
+            Context context;
+            Init(context);
+            Update(context, data[i], size);
+            Final(context, digests[i]);
+        }
+    }
+
+    const char* GetImplementationName()
+    {
+        return GetImplementation().name;
+    }
+
+    bool IsSupported(ImplementationKind kind)
+    {
+        #ifdef MSIX_SHA256_X64
+        static const CpuFeatures features = GetCpuFeatures();
+        switch (kind)
+        {
+        case ImplementationKind::Avx2:
+            return features.avx2;
+        case ImplementationKind::ShaNi:
+            return features.sha;
+        default:
+            break;
+        }
+        #endif
+        return (kind == ImplementationKind::Portable);
+    }
+
+    void ForceImplementation(ImplementationKind kind)
+    {
+        s_forcedImplementation.store(IsSupported(kind) ? &GetImplementationOf(kind) : nullptr, std::memory_order_relaxed);
+    }
+
+    void ResetImplementation()
+    {
+        s_forcedImplementation.store(nullptr, std::memory_order_relaxed);
+    }
+} }
@@ -0,0 +1,57 @@
+//
+//  Copyright (C) 2019 Microsoft.  All rights reserved.
+//  See LICENSE file in the project root for full license information.
+//
+
+#include "ThreadPool.hpp"
+
+namespace MSIX {
+
+    ThreadPool::ThreadPool(std::size_t threadCount)
+    {
+        m_workers.reserve(threadCount);
+        for (std::size_t i = 0; i < threadCount; i++)
+        {
+            m_workers.emplace_back([this]() { Run(); });
+        }
+    }
+
+    ThreadPool::~ThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stopping = true;
+        }
+        m_hasWork.notify_all();
+        for (auto& worker : m_workers)
+        {
+            worker.join();
+        }
+    }
+
+    std::size_t ThreadPool::DefaultThreadCount()
+    {
+        auto cores = static_cast<std::size_t>(std::thread::hardware_concurrency());
+        return (cores > 1) ? cores : 0;
+    }
+
+    void ThreadPool::Run()
+    {
+        while (true)
+        {
+            std::function<void()> work;
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_hasWork.wait(lock, [this]() { return m_stopping || !m_queue.empty(); });
+                // Pending work is still executed on shutdown so no future is left without a result.
+                if (m_queue.empty())
+                {
+                    return;
+                }
+                work = std::move(m_queue.front());
+                m_queue.pop_front();
+            }
+            work();
+        }
+    }
+}
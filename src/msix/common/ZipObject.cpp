@@ -449,6 +449,25 @@ EndCentralDirectoryRecord::EndCentralDirectoryRecord()
     SetCommentLength(0);
 }
 
+void EndCentralDirectoryRecord::SetData(std::uint64_t numCentralDirs, std::uint64_t sizeCentralDir, std::uint64_t offsetStartCentralDirectory)
+{
+    // In a zip64 file only the fields that aren't 0xFFFF.. or 0 have a value
+    auto hasValue = [this](std::uint64_t value, std::uint64_t max) { return !m_isZip64 || ((value != 0) && (value != max)); };
+    if (hasValue(Field<3>().get(), std::numeric_limits<std::uint16_t>::max()))
+    {
+        SetTotalNumberOfEntries(static_cast<std::uint16_t>(numCentralDirs));
+        SetTotalEntriesInCentralDirectory(static_cast<std::uint16_t>(numCentralDirs));
+    }
+    if (hasValue(Field<5>().get(), std::numeric_limits<std::uint32_t>::max()))
+    {
+        SetSizeOfCentralDirectory(static_cast<std::uint32_t>(sizeCentralDir));
+    }
+    if (hasValue(Field<6>().get(), std::numeric_limits<std::uint32_t>::max()))
+    {
+        SetOffsetOfCentralDirectory(static_cast<std::uint32_t>(offsetStartCentralDirectory));
+    }
+}
+
 void EndCentralDirectoryRecord::Read(const ComPtr<IStream>& stream)
 {
     std::vector<std::uint8_t> bytes(Size(), 0);
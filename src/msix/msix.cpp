@@ -15,6 +15,7 @@
 #include "AppxFactory.hpp"
 #include "Log.hpp"
 #include "DirectoryObject.hpp"
+#include "DirectoryUpdater.hpp"
 #include "AppxPackageObject.hpp"
 #include "MsixFeatureSelector.hpp"
 #include "AppxPackageWriter.hpp"
@@ -24,6 +25,11 @@
 #include "MappingFileParser.hpp"
 #include "FileStream.hpp"
 #include "VectorStream.hpp"
+#include "RangeSourceStream.hpp"
+#include "IndexCache.hpp"
+#ifndef WIN32
+#include "MappedFileStream.hpp"
+#endif
 
 #ifndef WIN32
 // on non-win32 platforms, compile with -fvisibility=hidden
@@ -50,14 +56,15 @@ void STDMETHODCALLTYPE InternalFree(LPVOID pv)        { std::free(pv); }
 MSIX_API HRESULT STDMETHODCALLTYPE MsixGetLogTextUTF8(COTASKMEMALLOC* memalloc, char** logText) noexcept try
 {
     ThrowErrorIf(MSIX::Error::InvalidParameter, (logText == nullptr || *logText != nullptr), "bad pointer" );
-    std::size_t countBytes = sizeof(char)*(MSIX::Global::Log::Text().size()+1);
+    // Only the failures logged by the calling thread are returned
+    auto text = MSIX::Global::Log::Take();
+    std::size_t countBytes = sizeof(char)*(text.size()+1);
     *logText = reinterpret_cast<char*>(memalloc(countBytes));
     ThrowErrorIfNot(MSIX::Error::OutOfMemory, (*logText), "Allocation failed!");
     std::memset(reinterpret_cast<void*>(*logText), 0, countBytes);
     std::memcpy(reinterpret_cast<void*>(*logText),
-                reinterpret_cast<void*>(const_cast<char*>(MSIX::Global::Log::Text().c_str())),
+                reinterpret_cast<void*>(const_cast<char*>(text.c_str())),
                 countBytes - sizeof(char));
-    MSIX::Global::Log::Clear();
     return static_cast<HRESULT>(MSIX::Error::OK);
 } CATCH_RETURN();
 
@@ -76,6 +83,23 @@ MSIX_API HRESULT STDMETHODCALLTYPE CreateStreamOnFile(
     return static_cast<HRESULT>(MSIX::Error::OK);
 } CATCH_RETURN();
 
+MSIX_API HRESULT STDMETHODCALLTYPE CreateMappedStreamOnFile(
+    char* utf8File,
+    IStream** stream) noexcept try
+{
+    ThrowErrorIf(MSIX::Error::InvalidParameter, (utf8File == nullptr || stream == nullptr || *stream != nullptr), "Invalid parameter");
+    #ifndef WIN32
+    // Map the file if we can, so readers of the package don't have to share a file pointer.
+    auto mapping = MSIX::MappedFileStream::MapFile(utf8File);
+    if (mapping)
+    {
+        *stream = MSIX::ComPtr<IStream>::Make<MSIX::MappedFileStream>(mapping).Detach();
+        return static_cast<HRESULT>(MSIX::Error::OK);
+    }
+    #endif
+    return CreateStreamOnFile(utf8File, true, stream);
+} CATCH_RETURN();
+
 MSIX_API HRESULT STDMETHODCALLTYPE CreateStreamOnFileUTF16(
     LPCWSTR utf16File,
     bool forRead,
@@ -86,6 +110,25 @@ MSIX_API HRESULT STDMETHODCALLTYPE CreateStreamOnFileUTF16(
     return static_cast<HRESULT>(MSIX::Error::OK);
 } CATCH_RETURN();
 
+MSIX_API HRESULT STDMETHODCALLTYPE CreateStreamOnRangeSource(
+    IMsixRangeSource* source,
+    IStream** stream) noexcept try
+{
+    ThrowErrorIf(MSIX::Error::InvalidParameter, (source == nullptr || stream == nullptr || *stream != nullptr), "Invalid parameter");
+    auto rangeSource = std::make_shared<MSIX::RangeSourceStream::Source>(source);
+    *stream = MSIX::ComPtr<IStream>::Make<MSIX::RangeSourceStream>(rangeSource).Detach();
+    return static_cast<HRESULT>(MSIX::Error::OK);
+} CATCH_RETURN();
+
+MSIX_API HRESULT STDMETHODCALLTYPE CreateIndexCacheOnDirectory(
+    char* utf8Directory,
+    IMsixIndexCache** indexCache) noexcept try
+{
+    ThrowErrorIf(MSIX::Error::InvalidParameter, (utf8Directory == nullptr || indexCache == nullptr || *indexCache != nullptr), "Invalid parameter");
+    *indexCache = MSIX::ComPtr<IMsixIndexCache>::Make<MSIX::DirectoryIndexCache>(utf8Directory).Detach();
+    return static_cast<HRESULT>(MSIX::Error::OK);
+} CATCH_RETURN();
+
 MSIX_API HRESULT STDMETHODCALLTYPE CoCreateAppxFactoryWithHeapAndOptions(
     COTASKMEMALLOC* memalloc,
     COTASKMEMFREE* memfree,
@@ -276,6 +319,54 @@ MSIX_API HRESULT STDMETHODCALLTYPE UnpackBundleFromStream(
     return static_cast<HRESULT>(MSIX::Error::OK);
 } CATCH_RETURN();
 
+MSIX_API HRESULT STDMETHODCALLTYPE VerifyPackage(
+    MSIX_VALIDATION_OPTION validationOption,
+    char* utf8SourcePackage) noexcept try
+{
+    ThrowErrorIfNot(MSIX::Error::InvalidParameter, (utf8SourcePackage != nullptr), "Invalid parameters");
+
+    MSIX::ComPtr<IStream> stream;
+    ThrowHrIfFailed(CreateStreamOnFile(utf8SourcePackage, true, &stream));
+
+    MSIX::ComPtr<IAppxFactory> factory;
+    auto validation = static_cast<MSIX_VALIDATION_OPTION>(validationOption | MSIX_VALIDATION_OPTION_VERIFYCONTAINERDIGESTS);
+    ThrowHrIfFailed(CoCreateAppxFactoryWithHeap(InternalAllocate, InternalFree, validation, &factory));
+
+    // The digests are checked while the reader is created
+    MSIX::ComPtr<IAppxPackageReader> reader;
+    ThrowHrIfFailed(factory->CreatePackageReader(stream.Get(), &reader));
+    return static_cast<HRESULT>(MSIX::Error::OK);
+} CATCH_RETURN();
+
+MSIX_API HRESULT STDMETHODCALLTYPE UpdatePackageDirectory(
+    MSIX_VALIDATION_OPTION validationOption,
+    char* utf8SourcePackage,
+    char* utf8Directory,
+    MSIX_UPDATE_STATISTICS* statistics) noexcept try
+{
+    ThrowErrorIfNot(MSIX::Error::InvalidParameter,
+        (utf8SourcePackage != nullptr && utf8Directory != nullptr),
+        "Invalid parameters");
+
+    MSIX::ComPtr<IStream> stream;
+    ThrowHrIfFailed(CreateStreamOnFile(utf8SourcePackage, true, &stream));
+
+    MSIX::ComPtr<IAppxFactory> factory;
+    ThrowHrIfFailed(CoCreateAppxFactoryWithHeap(InternalAllocate, InternalFree, validationOption, &factory));
+
+    MSIX::ComPtr<IAppxPackageReader> reader;
+    ThrowHrIfFailed(factory->CreatePackageReader(stream.Get(), &reader));
+
+    MSIX::DirectoryUpdater updater(factory.As<IMsixFactory>().Get(), reader, stream, utf8Directory);
+    updater.Update();
+    if (statistics != nullptr)
+    {
+        statistics->bytesCopied = updater.GetBytesCopied();
+        statistics->bytesRead = updater.GetBytesRead();
+    }
+    return static_cast<HRESULT>(MSIX::Error::OK);
+} CATCH_RETURN();
+
 #ifdef MSIX_PACK
 
 MSIX_API HRESULT STDMETHODCALLTYPE PackPackage(
@@ -283,16 +374,54 @@ MSIX_API HRESULT STDMETHODCALLTYPE PackPackage(
     MSIX_VALIDATION_OPTION validationOption,
     char* directoryPath,
     char* outputPackage
+) noexcept
+{
+    return PackPackageWithCompressionOption(packUnpackOptions, validationOption,
+        APPX_COMPRESSION_OPTION_NORMAL, directoryPath, outputPackage);
+}
+
+MSIX_API HRESULT STDMETHODCALLTYPE PackPackageWithCompressionOption(
+    MSIX_PACKUNPACK_OPTION packUnpackOptions,
+    MSIX_VALIDATION_OPTION validationOption,
+    APPX_COMPRESSION_OPTION compressionOption,
+    char* directoryPath,
+    char* outputPackage
+) noexcept
+{
+    return PackPackageWithBasePackage(packUnpackOptions, validationOption,
+        compressionOption, directoryPath, nullptr, outputPackage);
+}
+
+MSIX_API HRESULT STDMETHODCALLTYPE PackPackageWithBasePackage(
+    MSIX_PACKUNPACK_OPTION packUnpackOptions,
+    MSIX_VALIDATION_OPTION validationOption,
+    APPX_COMPRESSION_OPTION compressionOption,
+    char* directoryPath,
+    char* basePackage,
+    char* outputPackage
 ) noexcept try
 {
     ThrowErrorIfNot(MSIX::Error::InvalidParameter, 
         (directoryPath != nullptr && outputPackage != nullptr), 
         "Invalid parameters");
+    ThrowErrorIf(MSIX::Error::InvalidParameter,
+        (basePackage != nullptr && std::string(basePackage) == outputPackage),
+        "The base package can't be the output package");
+    ThrowErrorIf(MSIX::Error::InvalidParameter,
+        (compressionOption < APPX_COMPRESSION_OPTION_NONE || compressionOption > APPX_COMPRESSION_OPTION_SUPERFAST),
+        "Invalid compression option");
 
     auto from = MSIX::ComPtr<IDirectoryObject>::Make<MSIX::DirectoryObject>(directoryPath);
     // PackPackage assumes AppxManifest.xml to be in the directory provided.
     auto manifest = from.As<IStorageObject>()->GetFile(MSIX::footprintFiles[APPX_FOOTPRINT_FILE_TYPE_MANIFEST]);
 
+    // Fail before the output package is created if the base package can't be opened
+    MSIX::ComPtr<IStream> baseStream;
+    if (basePackage != nullptr)
+    {
+        ThrowHrIfFailed(CreateStreamOnFile(basePackage, true, &baseStream));
+    }
+
     auto deleteFile = MSIX::scope_exit([&outputPackage]
     {
         remove(outputPackage);
@@ -306,7 +435,11 @@ MSIX_API HRESULT STDMETHODCALLTYPE PackPackage(
 
     MSIX::ComPtr<IAppxPackageWriter> writer;
     ThrowHrIfFailed(factory->CreatePackageWriter(stream.Get(), nullptr, &writer));
-    writer.As<IPackageWriter>()->PackPayloadFiles(from);
+    if (baseStream)
+    {
+        ThrowHrIfFailed(writer.As<IMsixPackageWriterBasePackage>()->SetBasePackage(baseStream.Get()));
+    }
+    writer.As<IPackageWriter>()->PackPayloadFiles(from, compressionOption);
     ThrowHrIfFailed(writer->Close(manifest.Get()));
     deleteFile.release();
     return static_cast<HRESULT>(MSIX::Error::OK);
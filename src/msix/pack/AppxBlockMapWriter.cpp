@@ -93,7 +93,11 @@ namespace MSIX {
         ThrowErrorIfNot(MSIX::Error::BlockMapInvalidData,
             MSIX::SHA256::ComputeHash(block.data(), static_cast<uint32_t>(block.size()), hash), 
             "Failed computing hash");
+        AddBlock(hash, block, size, isCompressed);
+    }
 
+    void BlockMapWriter::AddBlock(const std::vector<std::uint8_t>& hash, const std::vector<std::uint8_t>& block, ULONG size, bool isCompressed)
+    {
         m_xmlWriter.StartElement(blockElement);
         m_xmlWriter.AddAttribute(hashAttribute, Base64::ComputeBase64(hash));
         // We only add the size attribute for compressed files, we cannot just check for the 
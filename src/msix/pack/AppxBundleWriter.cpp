@@ -15,14 +15,16 @@
 #include "FileNameValidation.hpp"
 #include "StringHelper.hpp"
 #include "VectorStream.hpp"
+#include "PayloadBlockWriter.hpp"
 
 #include <ctime>
 #include <iomanip>
+#include <algorithm>
 
 namespace MSIX {
 
     AppxBundleWriter::AppxBundleWriter(IMsixFactory* factory, const ComPtr<IZipWriter>& zip, std::uint64_t bundleVersion)
-        : m_factory(factory), m_zipWriter(zip)
+        : m_factory(factory), m_zipWriter(zip), m_threadPool(ThreadPool::DefaultThreadCount())
     {
         m_state = WriterState::Open;
         if(bundleVersion == 0)
@@ -62,6 +64,10 @@ namespace MSIX {
                 {
                     ThrowHrIfFailed(AddPackageReference(utf8_to_wstring(file.second).c_str(), stream.Get(), false));
                 }
+                else
+                {
+                    ThrowHrIfFailed(AddPayloadPackage(utf8_to_wstring(file.second).c_str(), stream.Get(), false));
+                }
             }
         }
 
@@ -92,6 +98,10 @@ namespace MSIX {
                 {
                     ThrowHrIfFailed(AddPackageReference(utf8_to_wstring(outputPath).c_str(), stream.Get(), false));
                 }
+                else
+                {
+                    ThrowHrIfFailed(AddPayloadPackage(utf8_to_wstring(outputPath).c_str(), stream.Get(), false));
+                }
             }
         }
         failState.release();
@@ -116,8 +126,7 @@ namespace MSIX {
     // IAppxBundleWriter
     HRESULT STDMETHODCALLTYPE AppxBundleWriter::AddPayloadPackage(LPCWSTR fileName, IStream* packageStream) noexcept try
     {
-        // TODO: implement
-        NOTIMPLEMENTED;
+        return AddPayloadPackage(fileName, packageStream, FALSE);
     } CATCH_RETURN();
 
     HRESULT STDMETHODCALLTYPE AppxBundleWriter::Close() noexcept try
@@ -133,18 +142,18 @@ namespace MSIX {
 
         auto bundleManifestStream = m_bundleWriterHelper.GetBundleManifestStream();
         auto bundleManifestContentType = ContentType::GetBundlePayloadFileContentType(APPX_BUNDLE_FOOTPRINT_FILE_TYPE_MANIFEST);
-        AddFileToPackage(APPXBUNDLEMANIFEST_XML, bundleManifestStream.Get(), true, true, bundleManifestContentType.c_str());
+        AddFileToPackage(APPXBUNDLEMANIFEST_XML, bundleManifestStream.Get(), APPX_COMPRESSION_OPTION_NORMAL, true, bundleManifestContentType.c_str());
 
         // Close blockmap and add it to the bundle
         m_blockMapWriter.Close();
         auto blockMapStream = m_blockMapWriter.GetStream();
         auto blockMapContentType = ContentType::GetPayloadFileContentType(APPX_FOOTPRINT_FILE_TYPE_BLOCKMAP);
-        AddFileToPackage(APPXBLOCKMAP_XML, blockMapStream.Get(), true, false, blockMapContentType.c_str());
+        AddFileToPackage(APPXBLOCKMAP_XML, blockMapStream.Get(), APPX_COMPRESSION_OPTION_NORMAL, false, blockMapContentType.c_str());
 
         // Close content types and add it to the bundle
         m_contentTypeWriter.Close();
         auto contentTypeStream = m_contentTypeWriter.GetStream();
-        AddFileToPackage(CONTENT_TYPES_XML, contentTypeStream.Get(), true, false, nullptr);
+        AddFileToPackage(CONTENT_TYPES_XML, contentTypeStream.Get(), APPX_COMPRESSION_OPTION_NORMAL, false, nullptr);
 
         m_zipWriter->Close();
         failState.release();
@@ -176,10 +185,47 @@ namespace MSIX {
     HRESULT STDMETHODCALLTYPE AppxBundleWriter::AddPayloadPackage(LPCWSTR fileName, IStream* packageStream, 
         BOOL isDefaultApplicablePackage) noexcept try
     {
-        // TODO: implement
-        NOTIMPLEMENTED;
+        ThrowErrorIf(Error::InvalidParameter, (fileName == nullptr || packageStream == nullptr), "Invalid parameter");
+        ThrowErrorIf(Error::InvalidState, m_state != WriterState::Open, "Invalid package writer state");
+        auto failState = MSIX::scope_exit([this]
+            {
+                this->m_state = WriterState::Failed;
+            });
+        this->AddPayloadPackageInternal(wstring_to_utf8(fileName), packageStream, !!isDefaultApplicablePackage);
+        failState.release();
+        return static_cast<HRESULT>(Error::OK);
     } CATCH_RETURN();
 
+    void AppxBundleWriter::AddPayloadPackageInternal(std::string fileName, IStream* packageStream,
+        bool isDefaultApplicablePackage)
+    {
+        ThrowErrorIfNot(Error::InvalidParameter, FileNameValidation::IsFileNameValid(fileName), "Invalid file name");
+        ThrowErrorIf(Error::InvalidParameter, FileNameValidation::IsFootPrintFile(fileName, true), "Trying to add footprint file to bundle");
+        ThrowErrorIf(Error::InvalidParameter, FileNameValidation::IsReservedFolder(fileName), "Trying to add file in reserved folder");
+
+        auto appxFactory = m_factory.As<IAppxFactory>();
+
+        ComPtr<IAppxPackageReader> reader;
+        ThrowHrIfFailed(appxFactory->CreatePackageReader(packageStream, &reader));
+
+        ComPtr<IAppxManifestPackageId> packageId;
+        APPX_BUNDLE_PAYLOAD_PACKAGE_TYPE packageType = APPX_BUNDLE_PAYLOAD_PACKAGE_TYPE::APPX_BUNDLE_PAYLOAD_PACKAGE_TYPE_APPLICATION;
+        ComPtr<IAppxManifestQualifiedResourcesEnumerator> resources;
+        ComPtr<IAppxManifestTargetDeviceFamiliesEnumerator> tdfs;
+        this->m_bundleWriterHelper.GetValidatedPackageData(fileName, reader.Get(), &packageType, &packageId, &resources, &tdfs);
+
+        // Packages are stored in the bundle and the bundle manifest records where they start, so they can be
+        // read in place. The package is copied block by block, it is never fully loaded in memory. Packages
+        // have their own block map, the block map of the bundle only describes AppxBundleManifest.xml.
+        std::uint64_t packageStreamSize = this->m_bundleWriterHelper.GetStreamSize(packageStream);
+        std::string ext = Helper::tolower(fileName.substr(fileName.find_last_of(".") + 1));
+        auto contentType = ContentType::GetContentTypeByExtension(ext);
+        auto bundleOffset = AddFileToPackage(fileName, packageStream, APPX_COMPRESSION_OPTION_NONE, false, contentType.GetContentType().c_str());
+
+        this->m_bundleWriterHelper.AddValidatedPackageData(fileName, bundleOffset, packageStreamSize, packageType, packageId,
+            isDefaultApplicablePackage, resources.Get(), tdfs.Get());
+    }
+
     HRESULT STDMETHODCALLTYPE AppxBundleWriter::AddExternalPackageReference(LPCWSTR fileName,
         IStream* inputStream, BOOL isDefaultApplicablePackage) noexcept try
     {
@@ -219,12 +265,13 @@ namespace MSIX {
         ThrowErrorIf(Error::InvalidParameter, FileNameValidation::IsFootPrintFile(name, false), "Trying to add footprint file to package");
         ThrowErrorIf(Error::InvalidParameter, FileNameValidation::IsReservedFolder(name), "Trying to add file in reserved folder");
         ValidateCompressionOption(compressionOpt);
-        AddFileToPackage(name, stream, compressionOpt != APPX_COMPRESSION_OPTION_NONE, true, contentType);
+        AddFileToPackage(name, stream, compressionOpt, true, contentType);
     }
 
-    void AppxBundleWriter::AddFileToPackage(const std::string& name, IStream* stream, bool toCompress,
+    std::uint64_t AppxBundleWriter::AddFileToPackage(const std::string& name, IStream* stream, APPX_COMPRESSION_OPTION compressionOpt,
         bool addToBlockMap, const char* contentType, bool forceContentTypeOverride)
     {
+        bool toCompress = (compressionOpt != APPX_COMPRESSION_OPTION_NONE);
         std::string opcFileName;
         // Don't encode [Content Type].xml
         if (contentType != nullptr)
@@ -236,6 +283,7 @@ namespace MSIX {
             opcFileName = name;
         }
         auto fileInfo = m_zipWriter->PrepareToAddFile(opcFileName, toCompress);
+        auto fileDataOffset = m_zipWriter->GetFileDataOffset();
 
         // Add content type to [Content Types].xml
         if (contentType != nullptr)
@@ -258,41 +306,8 @@ namespace MSIX {
 
         auto& zipFileStream = fileInfo.second;
 
-        std::uint64_t bytesToRead = uncompressedSize;
-        std::uint32_t crc = 0;
-        while (bytesToRead > 0)
-        {
-            // Calculate the size of the next block to add
-            std::uint32_t blockSize = (bytesToRead > DefaultBlockSize) ? DefaultBlockSize : static_cast<std::uint32_t>(bytesToRead);
-            bytesToRead -= blockSize;
-
-            // read block from stream
-            std::vector<std::uint8_t> block;
-            block.resize(blockSize);
-            ULONG bytesRead;
-            ThrowHrIfFailed(stream->Read(static_cast<void*>(block.data()), static_cast<ULONG>(blockSize), &bytesRead));
-            ThrowErrorIfNot(Error::FileRead, (static_cast<ULONG>(blockSize) == bytesRead), "Read stream file failed");
-            crc = crc32(crc, block.data(), static_cast<uInt>(block.size()));
-
-            // Write block and compress if needed
-            ULONG bytesWritten = 0;
-            ThrowHrIfFailed(zipFileStream->Write(block.data(), static_cast<ULONG>(block.size()), &bytesWritten));
-
-            // Add block to blockmap
-            if (addToBlockMap)
-            {
-                m_blockMapWriter.AddBlock(block, bytesWritten, toCompress);
-            }
-
-        }
-
-        if (toCompress)
-        {
-            // Put the stream termination on
-            std::vector<std::uint8_t> buffer;
-            ULONG bytesWritten = 0;
-            ThrowHrIfFailed(zipFileStream->Write(buffer.data(), static_cast<ULONG>(buffer.size()), &bytesWritten));
-        }
+        PayloadBlockWriter blockWriter(m_threadPool, compressionOpt, addToBlockMap ? &m_blockMapWriter : nullptr);
+        auto crc = blockWriter.Write(stream, uncompressedSize, zipFileStream);
 
         // Close File element
         if (addToBlockMap)
@@ -303,6 +318,7 @@ namespace MSIX {
         // This could be the compressed or uncompressed size
         auto streamSize = zipFileStream.As<IStreamInternal>()->GetSize();
         m_zipWriter->EndFile(crc, streamSize, uncompressedSize, true);
+        return fileDataOffset;
     }
 
     void AppxBundleWriter::ValidateCompressionOption(APPX_COMPRESSION_OPTION compressionOpt)
@@ -14,16 +14,20 @@
 #include "ScopeExit.hpp"
 #include "FileNameValidation.hpp"
 #include "StringHelper.hpp"
+#include "PayloadBlockWriter.hpp"
+#include "ZipObjectReader.hpp"
+#include "AppxBlockMapObject.hpp"
 
 #include <string>
 #include <memory>
-#include <future>
 #include <algorithm>
 #include <functional>
+#include <tuple>
 
 namespace MSIX {
 
-    AppxPackageWriter::AppxPackageWriter(IMsixFactory* factory, const ComPtr<IZipWriter>& zip, bool enableFileHash) : m_factory(factory), m_zipWriter(zip)
+    AppxPackageWriter::AppxPackageWriter(IMsixFactory* factory, const ComPtr<IZipWriter>& zip, bool enableFileHash) : m_factory(factory), m_zipWriter(zip),
+        m_threadPool(ThreadPool::DefaultThreadCount())
     {
         if (enableFileHash)
         {
@@ -33,7 +37,7 @@ namespace MSIX {
     }
 
     // IPackageWriter
-    void AppxPackageWriter::PackPayloadFiles(const ComPtr<IDirectoryObject>& from)
+    void AppxPackageWriter::PackPayloadFiles(const ComPtr<IDirectoryObject>& from, APPX_COMPRESSION_OPTION compressionOpt)
     {
         ThrowErrorIf(Error::InvalidState, m_state != WriterState::Open, "Invalid package writer state");
         auto failState = MSIX::scope_exit([this]
@@ -51,7 +55,11 @@ namespace MSIX {
                 std::string ext = Helper::tolower(file.second.substr(file.second.find_last_of(".") + 1));
                 auto contentType = ContentType::GetContentTypeByExtension(ext);
                 auto stream = from.As<IStorageObject>()->GetFile(file.second);
-                ValidateAndAddPayloadFile(file.second, stream.Get(), contentType.GetCompressionOpt(), contentType.GetContentType().c_str());
+                // Files that are already compressed (images, media, archives) are always stored, every other
+                // file uses the compression option requested.
+                auto fileCompressionOpt = (contentType.GetCompressionOpt() == APPX_COMPRESSION_OPTION_NONE) ?
+                    APPX_COMPRESSION_OPTION_NONE : compressionOpt;
+                ValidateAndAddPayloadFile(file.second, stream.Get(), fileCompressionOpt, contentType.GetContentType().c_str());
             }
         }
         failState.release();
@@ -79,18 +87,18 @@ namespace MSIX {
         // If the creating the AppxManifestObject succeeds, then the stream is valid.
         auto manifestObj = ComPtr<IAppxManifestReader>::Make<AppxManifestObject>(m_factory.Get(), manifestStream.Get());
         auto manifestContentType = ContentType::GetPayloadFileContentType(APPX_FOOTPRINT_FILE_TYPE_MANIFEST);
-        AddFileToPackage(APPXMANIFEST_XML, manifestStream.Get(), true, true, manifestContentType.c_str());
+        AddFileToPackage(APPXMANIFEST_XML, manifestStream.Get(), APPX_COMPRESSION_OPTION_NORMAL, true, manifestContentType.c_str());
 
         // Close blockmap and add it to package
         m_blockMapWriter.Close();
         auto blockMapStream = m_blockMapWriter.GetStream();
         auto blockMapContentType = ContentType::GetPayloadFileContentType(APPX_FOOTPRINT_FILE_TYPE_BLOCKMAP);
-        AddFileToPackage(APPXBLOCKMAP_XML, blockMapStream.Get(), true, false, blockMapContentType.c_str());
+        AddFileToPackage(APPXBLOCKMAP_XML, blockMapStream.Get(), APPX_COMPRESSION_OPTION_NORMAL, false, blockMapContentType.c_str());
 
         // Close content types and add it to package
         m_contentTypeWriter.Close();
         auto contentTypeStream = m_contentTypeWriter.GetStream();
-        AddFileToPackage(CONTENT_TYPES_XML, contentTypeStream.Get(), true, false, nullptr);
+        AddFileToPackage(CONTENT_TYPES_XML, contentTypeStream.Get(), APPX_COMPRESSION_OPTION_NORMAL, false, nullptr);
 
         m_zipWriter->Close();
         failState.release();
@@ -153,6 +161,26 @@ namespace MSIX {
         return static_cast<HRESULT>(Error::OK);
     } CATCH_RETURN();
 
+    // IMsixPackageWriterBasePackage
+    HRESULT STDMETHODCALLTYPE AppxPackageWriter::SetBasePackage(IStream* basePackage) noexcept try
+    {
+        ThrowErrorIf(Error::InvalidState, m_state != WriterState::Open, "Invalid package writer state");
+        ThrowErrorIf(Error::InvalidParameter, (basePackage == nullptr), "Invalid base package");
+
+        // Only the zip file and the block map are read. The base package isn't validated, every block
+        // copied from it is checked against the new data instead.
+        auto baseZip = ComPtr<IZipReader>::Make<ZipObjectReader>(ComPtr<IStream>(basePackage));
+        auto blockMapStream = baseZip.As<IStorageObject>()->GetFile(footprintFiles[APPX_FOOTPRINT_FILE_TYPE_BLOCKMAP]);
+        ThrowErrorIf(Error::MissingAppxBlockMapXML, !blockMapStream, "Base package doesn't have a block map");
+        auto baseBlockMap = ComPtr<IAppxBlockMapInternal>::Make<AppxBlockMapObject>(m_factory.Get(), blockMapStream);
+
+        auto fileNames = baseBlockMap->GetFileNames();
+        m_baseFiles = std::set<std::string>(fileNames.begin(), fileNames.end());
+        m_baseZip = std::move(baseZip);
+        m_baseBlockMap = std::move(baseBlockMap);
+        return static_cast<HRESULT>(Error::OK);
+    } CATCH_RETURN();
+
     void AppxPackageWriter::ValidateAndAddPayloadFile(const std::string& name, IStream* stream,
         APPX_COMPRESSION_OPTION compressionOpt, const char* contentType)
     {
@@ -160,12 +188,13 @@ namespace MSIX {
         ThrowErrorIf(Error::InvalidParameter, FileNameValidation::IsFootPrintFile(name, false), "Trying to add footprint file to package");
         ThrowErrorIf(Error::InvalidParameter, FileNameValidation::IsReservedFolder(name), "Trying to add file in reserved folder");
         ValidateCompressionOption(compressionOpt);
-        AddFileToPackage(name, stream, compressionOpt != APPX_COMPRESSION_OPTION_NONE, true, contentType);
+        AddFileToPackage(name, stream, compressionOpt, true, contentType);
     }
 
-    void AppxPackageWriter::AddFileToPackage(const std::string& name, IStream* stream, bool toCompress,
+    void AppxPackageWriter::AddFileToPackage(const std::string& name, IStream* stream, APPX_COMPRESSION_OPTION compressionOpt,
         bool addToBlockMap, const char* contentType, bool forceContentTypeOverride)
     {
+        bool toCompress = (compressionOpt != APPX_COMPRESSION_OPTION_NONE);
         std::string opcFileName;
         // Don't encode [Content Type].xml
         if (contentType != nullptr)
@@ -199,41 +228,50 @@ namespace MSIX {
 
         auto& zipFileStream = fileInfo.second;
 
-        std::uint64_t bytesToRead = uncompressedSize;
-        std::uint32_t crc = 0;
-        while (bytesToRead > 0)
+        // Blocks of the base package are only reused for files that are compressed in both packages
+        PayloadBlockWriter::BaseBlockSource baseBlockSource;
+        if (toCompress && addToBlockMap && m_baseZip)
         {
-            // Calculate the size of the next block to add
-            std::uint32_t blockSize = (bytesToRead > DefaultBlockSize) ? DefaultBlockSize : static_cast<std::uint32_t>(bytesToRead);
-            bytesToRead -= blockSize;
-
-            // read block from stream
-            std::vector<std::uint8_t> block;
-            block.resize(blockSize);
-            ULONG bytesRead;
-            ThrowHrIfFailed(stream->Read(static_cast<void*>(block.data()), static_cast<ULONG>(blockSize), &bytesRead));
-            ThrowErrorIfNot(Error::FileRead, (static_cast<ULONG>(blockSize) == bytesRead), "Read stream file failed");
-            crc = crc32(crc, block.data(), static_cast<uInt>(block.size()));
-
-            // Write block and compress if needed
-            ULONG bytesWritten = 0;
-            ThrowHrIfFailed(zipFileStream->Write(block.data(), static_cast<ULONG>(block.size()), &bytesWritten));
-
-            // Add block to blockmap
-            if (addToBlockMap)
+            ComPtr<IStream> baseStream;
+            BlockRange baseBlocks = { nullptr, 0 };
+            std::tie(baseStream, baseBlocks) = GetBaseBlocks(name);
+            if (baseBlocks.size() > 0)
             {
-                m_blockMapWriter.AddBlock(block, bytesWritten, toCompress);
+                baseBlockSource = [baseStream, baseBlocks](std::size_t blockIndex) mutable
+                {
+                    // Blocks of a compressed file are stored one after the other. A deflated block is never much
+                    // larger than the block itself, stop reusing the file if the base block map says otherwise.
+                    PayloadBlockWriter::BaseBlock baseBlock;
+                    if (blockIndex < baseBlocks.size())
+                    {
+                        const auto& blockInBase = baseBlocks.begin()[blockIndex];
+                        if (blockInBase.compressedSize > 2 * DefaultBlockSize)
+                        {
+                            baseBlocks.count = blockIndex;
+                        }
+                        else
+                        {
+                            ULONG bytesRead = 0;
+                            baseBlock.compressed.resize(static_cast<std::size_t>(blockInBase.compressedSize));
+                            ThrowHrIfFailed(baseStream->Read(baseBlock.compressed.data(), static_cast<ULONG>(baseBlock.compressed.size()), &bytesRead));
+                            if (bytesRead == baseBlock.compressed.size())
+                            {
+                                baseBlock.hash = blockInBase.hash.data();
+                            }
+                            else
+                            {
+                                baseBlock.compressed.clear();
+                                baseBlocks.count = blockIndex;
+                            }
+                        }
+                    }
+                    return baseBlock;
+                };
             }
-
         }
 
-        if (toCompress)
-        {
-            // Put the stream termination on
-            std::vector<std::uint8_t> buffer;
-            ULONG bytesWritten = 0;
-            ThrowHrIfFailed(zipFileStream->Write(buffer.data(), static_cast<ULONG>(buffer.size()), &bytesWritten));
-        }
+        PayloadBlockWriter blockWriter(m_threadPool, compressionOpt, addToBlockMap ? &m_blockMapWriter : nullptr);
+        auto crc = blockWriter.Write(stream, uncompressedSize, zipFileStream, baseBlockSource);
 
         // Close File element
         if (addToBlockMap)
@@ -246,6 +284,22 @@ namespace MSIX {
         m_zipWriter->EndFile(crc, streamSize, uncompressedSize, true);
     }
 
+    std::pair<ComPtr<IStream>, BlockRange> AppxPackageWriter::GetBaseBlocks(const std::string& name)
+    {
+        BlockRange noBlocks = { nullptr, 0 };
+        auto blockMapName = Helper::toBackSlash(name);
+        if (m_baseFiles.find(blockMapName) == m_baseFiles.end())
+        {
+            return std::make_pair(ComPtr<IStream>(), noBlocks);
+        }
+        auto baseStream = m_baseZip->GetRawFile(Encoding::EncodeFileName(name));
+        if (!baseStream || !baseStream.As<IStreamInternal>()->IsCompressed())
+        {
+            return std::make_pair(ComPtr<IStream>(), noBlocks);
+        }
+        return std::make_pair(std::move(baseStream), m_baseBlockMap->GetBlocks(blockMapName));
+    }
+
     void AppxPackageWriter::ValidateCompressionOption(APPX_COMPRESSION_OPTION compressionOpt)
     {
         bool result = ((compressionOpt == APPX_COMPRESSION_OPTION_NONE) ||
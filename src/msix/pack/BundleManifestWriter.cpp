@@ -26,6 +26,8 @@ namespace MSIX {
     static const char* packageArchitectureAttribute = "Architecture";
     static const char* packageResourceIdAttribute = "ResourceId";
     static const char* fileNameAttribute = "FileName";
+    static const char* packageSizeAttribute = "Size";
+    static const char* packageOffsetAttribute = "Offset";
     static const char* resourcesManifestElement = "Resources";
     static const char* resourceManifestElement = "Resource";
     static const char* resourceLanguageAttribute = "Language";
@@ -138,14 +140,11 @@ namespace MSIX {
             m_xmlWriter.AddAttribute(fileNameAttribute, packageInfo.fileName);
         }
 
-        if(packageInfo.offset > 0)
-        {
-            //TODO: not applicable for flat bundle
-        }
-
+        // Offset and size are only applicable for packages stored in the bundle, not for flat bundles
         if (packageInfo.size > 0 && packageInfo.offset > 0)
         {
-            //TODO: not applicable for flat bundles
+            m_xmlWriter.AddAttribute(packageSizeAttribute, std::to_string(packageInfo.size));
+            m_xmlWriter.AddAttribute(packageOffsetAttribute, std::to_string(packageInfo.offset));
         }
 
         //WriteResourcesElement
@@ -16,6 +16,7 @@ namespace MSIX {
         {
             { "atom",  ContentType("application/atom+xml", APPX_COMPRESSION_OPTION_NORMAL) },
             { "appx",  ContentType("application/vnd.ms-appx", APPX_COMPRESSION_OPTION_NONE) },
+            { "msix",  ContentType("application/vnd.ms-appx", APPX_COMPRESSION_OPTION_NONE) },
             { "b64",   ContentType("application/base64", APPX_COMPRESSION_OPTION_NORMAL) },
             { "cab",   ContentType("application/vnd.ms-cab-compressed", APPX_COMPRESSION_OPTION_NONE) },
             { "doc",   ContentType("application/msword", APPX_COMPRESSION_OPTION_NORMAL) },
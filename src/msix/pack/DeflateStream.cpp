@@ -5,25 +5,146 @@
 
 #include "DeflateStream.hpp"
 #include "Exceptions.hpp"
+#include "ScopeExit.hpp"
 
+#include <algorithm>
+#include <map>
+#include <memory>
 #include <vector>
 
 namespace MSIX {
 
-    DeflateStream::DeflateStream(const ComPtr<IStream>& stream) : m_stream(stream)
+    static int GetCompressionLevel(APPX_COMPRESSION_OPTION compressionOpt)
+    {
+        switch (compressionOpt)
+        {
+            // Normal has always been packed with the best compression, keep it that way
+            // so packages don't grow for existing callers.
+            case APPX_COMPRESSION_OPTION_NORMAL:
+            case APPX_COMPRESSION_OPTION_MAXIMUM:
+                return Z_BEST_COMPRESSION;
+            case APPX_COMPRESSION_OPTION_FAST:
+                return 3;
+            case APPX_COMPRESSION_OPTION_SUPERFAST:
+                return Z_BEST_SPEED;
+            default:
+                break;
+        }
+        ThrowErrorAndLog(Error::InvalidParameter, "Invalid compression option for deflate.");
+    }
+
+    Deflater::Deflater(APPX_COMPRESSION_OPTION compressionOpt) :
+        m_blockDeflater(CreateBlockDeflater(GetCompressionLevel(compressionOpt)))
     {
         m_zstrm.zalloc = Z_NULL;
         m_zstrm.zfree = Z_NULL;
         m_zstrm.opaque = Z_NULL;
-        auto result = deflateInit2(&m_zstrm, Z_BEST_COMPRESSION, Z_DEFLATED, -MAX_WBITS, MAX_MEM_LEVEL, Z_DEFAULT_STRATEGY);
+        auto result = deflateInit2(&m_zstrm, GetCompressionLevel(compressionOpt), Z_DEFLATED, -MAX_WBITS, MAX_MEM_LEVEL, Z_DEFAULT_STRATEGY);
         ThrowErrorIf(Error::DeflateInitialize, result != Z_OK, "Error calling deflateinit2");
     }
 
-    DeflateStream::~DeflateStream()
+    Deflater::~Deflater()
     {
         deflateEnd(&m_zstrm);
     }
 
+    std::vector<std::uint8_t> Deflater::Deflate(const void* buffer, std::uint32_t countBytes, int disposition)
+    {
+        if (m_blockDeflater && (disposition == Z_FULL_FLUSH) && (countBytes > 0))
+        {
+            return m_blockDeflater->Deflate(buffer, countBytes);
+        }
+        m_zstrm.next_in = reinterpret_cast<Bytef *>(const_cast<void*>(buffer));
+        m_zstrm.avail_in = countBytes;
+
+        // Deflate straight into the result. deflateBound doesn't count the flush markers, the buffer only grows
+        // if they don't fit in the extra bytes.
+        std::vector<std::uint8_t> compressedBuffer(deflateBound(&m_zstrm, countBytes) + 16);
+        std::size_t have = 0;
+        do
+        {
+            if (have == compressedBuffer.size())
+            {
+                compressedBuffer.resize(compressedBuffer.size() * 2);
+            }
+            m_zstrm.next_out = compressedBuffer.data() + have;
+            m_zstrm.avail_out = static_cast<std::uint32_t>(compressedBuffer.size() - have);
+            auto result = deflate(&m_zstrm, disposition);
+            if (disposition == Z_FINISH && result == Z_STREAM_END)
+            {
+                result = Z_OK;
+            }
+            ThrowErrorIf(Error::DeflateWrite, result != Z_OK, "Error deflating stream");
+            have = compressedBuffer.size() - m_zstrm.avail_out;
+        } while (m_zstrm.avail_out == 0);
+        compressedBuffer.resize(have);
+        return compressedBuffer;
+    }
+
+    void Deflater::Reset()
+    {
+        ThrowErrorIf(Error::DeflateInitialize, (deflateReset(&m_zstrm) != Z_OK), "Error calling deflateReset");
+    }
+
+    Deflater& Deflater::GetThreadDeflater(APPX_COMPRESSION_OPTION compressionOpt)
+    {
+        // deflateInit2 allocates a few hundred KB at MAX_MEM_LEVEL, keep them for every block the thread deflates
+        thread_local std::map<APPX_COMPRESSION_OPTION, std::unique_ptr<Deflater>> deflaters;
+        auto& deflater = deflaters[compressionOpt];
+        if (!deflater)
+        {
+            deflater = std::make_unique<Deflater>(compressionOpt);
+        }
+        else
+        {
+            deflater->Reset();
+        }
+        return *deflater;
+    }
+
+    bool IsFullFlushBlockOf(const std::vector<std::uint8_t>& compressed, const std::vector<std::uint8_t>& expected)
+    {
+        if (compressed.empty() || expected.empty())
+        {
+            return false;
+        }
+
+        z_stream zstrm = {};
+        ThrowErrorIf(Error::InflateInitialize, (inflateInit2(&zstrm, -MAX_WBITS) != Z_OK), "Error calling inflateInit2");
+        auto inflateEnd = MSIX::scope_exit([&zstrm]
+        {
+            ::inflateEnd(&zstrm);
+        });
+
+        // One more byte than expected, so longer data doesn't go unnoticed
+        std::vector<std::uint8_t> inflated(expected.size() + 1);
+        zstrm.next_in = const_cast<Bytef*>(compressed.data());
+        zstrm.avail_in = static_cast<uInt>(compressed.size());
+        zstrm.next_out = inflated.data();
+        zstrm.avail_out = static_cast<uInt>(inflated.size());
+        while (zstrm.avail_in > 0)
+        {
+            // Z_BLOCK stops at every deflate block boundary. A stream that ends (Z_STREAM_END) has a final
+            // block and can't be followed by more blocks, and data referencing a previous block fails.
+            if (inflate(&zstrm, Z_BLOCK) != Z_OK)
+            {
+                return false;
+            }
+        }
+
+        // data_type has the number of unused bits in the last byte, 64 if the last block was the final
+        // block and 128 at the end of a block. A full flush ends a block on a byte boundary.
+        bool endsOnBoundary = ((zstrm.data_type & 0x7) == 0) && ((zstrm.data_type & 64) == 0) && ((zstrm.data_type & 128) != 0);
+        auto inflatedSize = inflated.size() - zstrm.avail_out;
+        return endsOnBoundary && (inflatedSize == expected.size()) &&
+            std::equal(expected.begin(), expected.end(), inflated.begin());
+    }
+
+    DeflateStream::DeflateStream(const ComPtr<IStream>& stream, APPX_COMPRESSION_OPTION compressionOpt) :
+        m_deflater(compressionOpt), m_stream(stream)
+    {
+    }
+
     // IStream
     HRESULT STDMETHODCALLTYPE DeflateStream::Seek(LARGE_INTEGER move, DWORD origin, ULARGE_INTEGER *newPosition) noexcept try
     {
@@ -53,31 +174,9 @@ namespace MSIX {
             disposition = Z_FINISH;
             m_state = State::Closed;
         }
-        m_zstrm.next_in = reinterpret_cast<Bytef *>(const_cast<void*>(buffer));
-        m_zstrm.avail_in = static_cast<std::uint32_t>(countBytes);
-        auto toWrite = Deflate(disposition);
+        auto toWrite = m_deflater.Deflate(buffer, static_cast<std::uint32_t>(countBytes), disposition);
         ThrowHrIfFailed(m_stream->Write(toWrite.data(), static_cast<ULONG>(toWrite.size()), bytesWritten));
         return static_cast<HRESULT>(Error::OK);
     } CATCH_RETURN();
 
-    std::vector<std::uint8_t> DeflateStream::Deflate(int disposition)
-    {
-        std::vector<std::uint8_t> compressedBuffer;
-        std::vector<std::uint8_t> deflateBuffer(1024);
-        do
-        {
-            m_zstrm.next_out = deflateBuffer.data();
-            m_zstrm.avail_out = static_cast<std::uint32_t>(deflateBuffer.size());
-            auto result = deflate(&m_zstrm, disposition);
-            if (disposition == Z_FINISH && result == Z_STREAM_END)
-            {
-                result = Z_OK;
-            }
-            ThrowErrorIf(Error::DeflateWrite, result != Z_OK, "Error deflating stream");
-            auto have = deflateBuffer.size() - m_zstrm.avail_out;
-            compressedBuffer.insert(compressedBuffer.end(), deflateBuffer.data(), deflateBuffer.data() + have);
-       } while (m_zstrm.avail_out == 0);
-       return compressedBuffer;
-    }
-
 }
\ No newline at end of file
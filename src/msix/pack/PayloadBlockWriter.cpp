@@ -0,0 +1,142 @@
+//
+//  Copyright (C) 2019 Microsoft.  All rights reserved.
+//  See LICENSE file in the project root for full license information.
+// 
+
+#include "PayloadBlockWriter.hpp"
+#include "MsixErrors.hpp"
+#include "Exceptions.hpp"
+#include "StreamBase.hpp"
+#include "DeflateStream.hpp"
+#include "Crypto.hpp"
+#include "BlockMapStream.hpp"
+
+#include <algorithm>
+#include <deque>
+#include <future>
+
+namespace MSIX {
+
+    PayloadBlockWriter::PayloadBlockWriter(ThreadPool& threadPool, APPX_COMPRESSION_OPTION compressionOpt, BlockMapWriter* blockMapWriter) :
+        m_threadPool(threadPool), m_compressionOpt(compressionOpt), m_blockMapWriter(blockMapWriter)
+    {
+    }
+
+    std::uint32_t PayloadBlockWriter::Write(IStream* stream, std::uint64_t size, const ComPtr<IStream>& zipFileStream,
+        const BaseBlockSource& baseBlockSource)
+    {
+        bool toCompress = (m_compressionOpt != APPX_COMPRESSION_OPTION_NONE);
+        bool addToBlockMap = (m_blockMapWriter != nullptr);
+        auto compressionOpt = m_compressionOpt;
+        std::size_t blockIndex = 0;
+
+        std::size_t blocksPerBatch = MSIX::SHA256::GetParallelHashCount();
+        std::size_t maxBatchesInFlight = std::max<std::size_t>(2 * m_threadPool.GetThreadCount(), 1);
+        std::deque<std::future<std::vector<PayloadBlock>>> batchesInFlight;
+        std::uint64_t bytesToRead = size;
+        std::uint32_t crc = 0;
+        while (bytesToRead > 0 || !batchesInFlight.empty())
+        {
+            while (bytesToRead > 0 && batchesInFlight.size() < maxBatchesInFlight)
+            {
+                std::vector<std::vector<std::uint8_t>> batch;
+                std::vector<BaseBlock> baseBatch;
+                while (bytesToRead > 0 && batch.size() < blocksPerBatch)
+                {
+                    // Calculate the size of the next block to add
+                    std::uint32_t blockSize = (bytesToRead > DefaultBlockSize) ? DefaultBlockSize : static_cast<std::uint32_t>(bytesToRead);
+                    bytesToRead -= blockSize;
+
+                    // read block from stream
+                    std::vector<std::uint8_t> block;
+                    block.resize(blockSize);
+                    ULONG bytesRead;
+                    ThrowHrIfFailed(stream->Read(static_cast<void*>(block.data()), static_cast<ULONG>(blockSize), &bytesRead));
+                    ThrowErrorIfNot(Error::FileRead, (static_cast<ULONG>(blockSize) == bytesRead), "Read stream file failed");
+
+                    batch.push_back(std::move(block));
+                    baseBatch.push_back(baseBlockSource ? baseBlockSource(blockIndex) : BaseBlock());
+                    blockIndex++;
+                }
+
+                batchesInFlight.push_back(m_threadPool.Submit([data = std::move(batch), base = std::move(baseBatch), compressionOpt, addToBlockMap]() mutable
+                {
+                    return ProcessBlocks(std::move(data), std::move(base), compressionOpt, addToBlockMap);
+                }));
+            }
+
+            auto batch = batchesInFlight.front().get();
+            batchesInFlight.pop_front();
+            for (const auto& block : batch)
+            {
+                crc = static_cast<std::uint32_t>(crc32_combine(crc, block.crc, static_cast<z_off_t>(block.data.size())));
+
+                // Write block, compressed if needed
+                const auto& toWrite = toCompress ? block.compressed : block.data;
+                ULONG bytesWritten = 0;
+                ThrowHrIfFailed(zipFileStream->Write(toWrite.data(), static_cast<ULONG>(toWrite.size()), &bytesWritten));
+
+                // Add block to blockmap
+                if (addToBlockMap)
+                {
+                    m_blockMapWriter->AddBlock(block.hash, block.data, bytesWritten, toCompress);
+                }
+            }
+        }
+
+        if (toCompress)
+        {
+            // Put the stream termination on
+            auto& deflater = Deflater::GetThreadDeflater(compressionOpt);
+            auto termination = deflater.Deflate(nullptr, 0, Z_FINISH);
+            ULONG bytesWritten = 0;
+            ThrowHrIfFailed(zipFileStream->Write(termination.data(), static_cast<ULONG>(termination.size()), &bytesWritten));
+        }
+        return crc;
+    }
+
+    // Runs on the thread pool. Must not touch any state of the writer.
+    std::vector<PayloadBlockWriter::PayloadBlock> PayloadBlockWriter::ProcessBlocks(std::vector<std::vector<std::uint8_t>>&& data,
+        std::vector<BaseBlock>&& baseBlocks, APPX_COMPRESSION_OPTION compressionOpt, bool computeHash)
+    {
+        std::vector<std::vector<std::uint8_t>> hashes(data.size());
+        if (computeHash)
+        {
+            std::vector<std::pair<const std::uint8_t*, std::uint32_t>> buffers;
+            for (const auto& blockData : data)
+            {
+                buffers.emplace_back(blockData.data(), static_cast<std::uint32_t>(blockData.size()));
+            }
+            MSIX::SHA256::ComputeHashes(buffers, hashes);
+        }
+
+        std::vector<PayloadBlock> blocks(data.size());
+        for (std::size_t i = 0; i < data.size(); i++)
+        {
+            blocks[i].data = std::move(data[i]);
+            blocks[i].hash = std::move(hashes[i]);
+            ProcessBlock(blocks[i], std::move(baseBlocks[i]), compressionOpt);
+        }
+        return blocks;
+    }
+
+    void PayloadBlockWriter::ProcessBlock(PayloadBlock& block, BaseBlock&& baseBlock, APPX_COMPRESSION_OPTION compressionOpt)
+    {
+        block.crc = ComputeCrc32(block.data.data(), block.data.size());
+        if (compressionOpt != APPX_COMPRESSION_OPTION_NONE)
+        {
+            // The hash only selects the candidate, the block is reused if it really is the new data deflated
+            if ((baseBlock.hash != nullptr) && (block.hash.size() == BLOCKMAP_HASH_SIZE) &&
+                std::equal(block.hash.begin(), block.hash.end(), baseBlock.hash) &&
+                IsFullFlushBlockOf(baseBlock.compressed, block.data))
+            {
+                block.compressed = std::move(baseBlock.compressed);
+            }
+            else
+            {
+                auto& deflater = Deflater::GetThreadDeflater(compressionOpt);
+                block.compressed = deflater.Deflate(block.data.data(), static_cast<std::uint32_t>(block.data.size()), Z_FULL_FLUSH);
+            }
+        }
+    }
+}
@@ -8,7 +8,6 @@
 #include "MsixErrors.hpp"
 #include "Exceptions.hpp"
 #include "ZipFileStream.hpp"
-#include "DeflateStream.hpp"
 #include "StreamHelper.hpp"
 #include "Encoding.hpp"
 
@@ -92,14 +91,15 @@ namespace MSIX {
         m_state = ZipObjectWriter::State::ReadyForFile;
 
         ComPtr<IStream> zipStream = ComPtr<IStream>::Make<ZipFileStream>(name, isCompressed, m_stream.Get());
-        if (isCompressed)
-        {
-            zipStream = ComPtr<IStream>::Make<DeflateStream>(zipStream);
-        }
-
         return std::make_pair(static_cast<std::uint32_t>(m_lastLFH.second.Size()), std::move(zipStream));
     }
 
+    std::uint64_t ZipObjectWriter::GetFileDataOffset()
+    {
+        ThrowErrorIf(Error::InvalidState, m_state != ZipObjectWriter::State::ReadyForFile, "Invalid zip writer state");
+        return m_lastLFH.first + m_lastLFH.second.Size();
+    }
+
     void ZipObjectWriter::EndFile(std::uint32_t crc, std::uint64_t compressedSize, std::uint64_t uncompressedSize, bool forceDataDescriptor)
     {
         ThrowErrorIf(Error::InvalidState, m_state != ZipObjectWriter::State::ReadyForFile, "Invalid zip writer state");
@@ -172,4 +172,4 @@ namespace MSIX {
         m_state = ZipObjectWriter::State::Closed;
     }
 
-}
\ No newline at end of file
+}
\ No newline at end of file
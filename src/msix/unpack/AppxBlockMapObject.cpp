@@ -9,6 +9,9 @@
 #include "BlockMapStream.hpp"
 #include "MSIXResource.hpp"
 #include "Enumerators.hpp"
+#include "StreamHelper.hpp"
+
+#include <cstring>
 
 /* Example XML:
 <?xml version="1.0" encoding="UTF-8"?>
@@ -31,93 +34,271 @@
 
 namespace MSIX {
 
-    static Block GetBlock(const ComPtr<IXmlElement>& element, std::uint64_t fallbackSize)
+    // Layout of the index returned by GetIndex: BlockMapIndexHeader, the block table, an BlockMapIndexFile per file sorted by name
+    // and then the names of the files. Integers use the byte order of the machine that wrote it. The block table
+    // starts 8 bytes aligned, so it can be used in place when the index is mapped.
+    const std::uint32_t BlockMapIndexSignature = 0x4D425849; // XIBM
+
+    struct BlockMapIndexHeader
     {
-        Block result {0};
-        auto sizeAttr = GetNumber<std::uint64_t>(element, XmlAttributeName::Size, -1);
-        if (sizeAttr == -1)
-        {
-            result.blockSize = BLOCKMAP_BLOCK_SIZE;
-            result.compressedSize = fallbackSize;
-        }
-        else
+        std::uint32_t signature;
+        std::uint32_t version;
+        std::uint64_t fileCount;
+        std::uint64_t blockCount;
+        std::uint64_t namesSize;
+    };
+
+    struct BlockMapIndexFile
+    {
+        std::uint64_t size;
+        std::uint64_t firstBlock;
+        std::uint64_t blockCount;
+        std::uint32_t localFileHeaderSize;
+        std::uint32_t nameSize;
+    };
+
+    static_assert(sizeof(BlockMapIndexHeader) == 32 && sizeof(BlockMapIndexFile) == 32 && sizeof(Block) == 48, "unexpected padding in the block map index");
+
+    AppxBlockMapObject::AppxBlockMapObject(IMsixFactory* factory, const ComPtr<IStream>& stream, const ComPtr<IStream>& index) :
+        m_factory(factory), m_stream(stream)
+    {
+        m_loadedFromIndex = (index.Get() != nullptr) && LoadIndex(index);
+        if (!m_loadedFromIndex)
         {
-            result.blockSize = sizeAttr;
-            result.compressedSize = sizeAttr;
+            ParseBlockMap();
         }
-        result.hash = element->GetBase64DecodedAttributeValue(XmlAttributeName::BlockMap_File_Block_Hash);
-        return result;
+        m_fileObjects.resize(m_files.size());
     }
 
-    AppxBlockMapObject::AppxBlockMapObject(IMsixFactory* factory, const ComPtr<IStream>& stream) : m_factory(factory), m_stream(stream)
+    void AppxBlockMapObject::ParseBlockMap()
     {
         ComPtr<IXmlFactory> xmlFactory;
-        ThrowHrIfFailed(factory->QueryInterface(UuidOfImpl<IXmlFactory>::iid, reinterpret_cast<void**>(&xmlFactory)));
-        auto dom = xmlFactory->CreateDomFromStream(XmlContentType::AppxBlockMapXml, stream);
+        ThrowHrIfFailed(m_factory->QueryInterface(UuidOfImpl<IXmlFactory>::iid, reinterpret_cast<void**>(&xmlFactory)));
 
-        struct _context
+        // Block maps of large packages are big, so parse them without building a DOM when the xml
+        // implementation supports it.
+        class BlockMapHandler final : public XmlStreamHandler
         {
-            AppxBlockMapObject* self;
-            IMsixFactory*       factory;
-            size_t              countFilesFound;
-            IXmlDom*            dom;
-        };
-        _context context = { this, factory, 0, dom.Get() };
+        public:
+            BlockMapHandler(AppxBlockMapObject* self) : m_self(self) {}
 
-        XmlVisitor visitor(static_cast<void*>(&context), [](void* c, const ComPtr<IXmlElement>& fileNode)->bool
-        {
-            const auto& name = fileNode->GetAttributeValue(XmlAttributeName::Name);
-            ThrowErrorIf(Error::BlockMapSemanticError, (name == "[Content_Types].xml"), "[Content_Types].xml cannot be in the AppxBlockMap.xml file");
+            void StartElement(std::size_t depth, XmlStreamElement& element) override
+            {
+                if (depth == 0)
+                {
+                    ThrowErrorIf(Error::XmlFatal, (element.GetLocalName() != "BlockMap"), "Invalid root element");
+                }
+                else if (depth == 1 && element.GetLocalName() == "File")
+                {
+                    m_self->StartFile(
+                        element.GetAttributeValue(XmlAttributeName::Name),
+                        GetNumber<std::uint64_t>(element, XmlAttributeName::Size, BLOCKMAP_BLOCK_SIZE),
+                        GetNumber<std::uint32_t>(element, XmlAttributeName::BlockMap_File_LocalFileHeaderSize, 0));
+                    m_inFile = true;
+                }
+                else if (depth == 2 && m_inFile && element.GetLocalName() == "Block")
+                {
+                    std::uint8_t hash[BLOCKMAP_HASH_SIZE];
+                    auto hashSize = element.GetBase64DecodedAttributeValue(XmlAttributeName::BlockMap_File_Block_Hash, hash, sizeof(hash));
+                    m_self->AddBlock(GetNumber<std::uint64_t>(element, XmlAttributeName::Size, -1), hash, hashSize);
+                }
+            }
 
-            _context* context = reinterpret_cast<_context*>(c);
-            std::ostringstream builder;
-            builder << "Duplicate file: '" << name << "' specified in AppxBlockMap.xml.";
-            ThrowErrorIf(Error::BlockMapSemanticError, (context->self->m_blockMap.find(name) != context->self->m_blockMap.end()), builder.str().c_str());
+            void EndElement(std::size_t depth) override
+            {
+                if (depth == 1 && m_inFile)
+                {
+                    m_self->EndFile();
+                    m_inFile = false;
+                }
+            }
 
-            std::uint64_t sizeAttribute = GetNumber<std::uint64_t>(fileNode, XmlAttributeName::Size, BLOCKMAP_BLOCK_SIZE);
+        private:
+            AppxBlockMapObject* m_self;
+            bool m_inFile = false;
+        };
 
-            std::vector<Block> blocks;
-            struct _contextBlock
+        BlockMapHandler handler(this);
+        if (!xmlFactory->ParseStream(XmlContentType::AppxBlockMapXml, m_stream, handler))
+        {
+            auto dom = xmlFactory->CreateDomFromStream(XmlContentType::AppxBlockMapXml, m_stream);
+            struct _context
             {
-                std::vector<Block>* blocks;
-                std::uint64_t fallbackSize;
+                AppxBlockMapObject* self;
+                IXmlDom*            dom;
             };
-            _contextBlock contextBlock = { &blocks, sizeAttribute};
-            XmlVisitor visitor(static_cast<void*>(&contextBlock), [](void* c, const ComPtr<IXmlElement>& blockNode)->bool
+            _context context = { this, dom.Get() };
+
+            XmlVisitor visitor(static_cast<void*>(&context), [](void* c, const ComPtr<IXmlElement>& fileNode)->bool
             {
-                _contextBlock* contextBlock = reinterpret_cast<_contextBlock*>(c);
-                contextBlock->blocks->push_back(GetBlock(blockNode, contextBlock->fallbackSize));
+                _context* context = reinterpret_cast<_context*>(c);
+                context->self->StartFile(
+                    fileNode->GetAttributeValue(XmlAttributeName::Name),
+                    GetNumber<std::uint64_t>(fileNode, XmlAttributeName::Size, BLOCKMAP_BLOCK_SIZE),
+                    GetNumber<std::uint32_t>(fileNode, XmlAttributeName::BlockMap_File_LocalFileHeaderSize, 0));
+
+                XmlVisitor visitor(static_cast<void*>(context->self), [](void* c, const ComPtr<IXmlElement>& blockNode)->bool
+                {
+                    auto hash = blockNode->GetBase64DecodedAttributeValue(XmlAttributeName::BlockMap_File_Block_Hash);
+                    reinterpret_cast<AppxBlockMapObject*>(c)->AddBlock(
+                        GetNumber<std::uint64_t>(blockNode, XmlAttributeName::Size, -1), hash.data(), hash.size());
+                    return true;
+                });
+                context->dom->ForEachElementIn(fileNode, XmlQueryName::Child_Block, visitor);
+                context->self->EndFile();
                 return true;
             });
-            context->dom->ForEachElementIn(fileNode, XmlQueryName::Child_Block, visitor);
-
-            ThrowErrorIf(Error::BlockMapSemanticError, (0 == blocks.size() && 0 != sizeAttribute), "If size is non-zero, then there must be 1+ blocks.");
-
-            context->self->m_blockMap.insert(std::make_pair(name, std::move(blocks)));
-            context->self->m_blockMapFiles.insert(std::make_pair(name,
-                ComPtr<IAppxBlockMapFile>::Make<AppxBlockMapFile>(
-                    context->factory,
-                    &(context->self->m_blockMap[name]),
-                    GetNumber<std::uint32_t>(fileNode, XmlAttributeName::BlockMap_File_LocalFileHeaderSize, 0),
-                    name,
-                    sizeAttribute
-                )));
-            context->countFilesFound++;
-            return true;
-        });
-        dom->ForEachElementIn(dom->GetDocument(), XmlQueryName::BlockMap_File, visitor);
-        ThrowErrorIf(Error::XmlError, (0 == context.countFilesFound), "Empty AppxBlockMap.xml");
+            dom->ForEachElementIn(dom->GetDocument(), XmlQueryName::BlockMap_File, visitor);
+        }
+        ThrowErrorIf(Error::XmlError, (m_files.empty()), "Empty AppxBlockMap.xml");
+
+        std::sort(m_files.begin(), m_files.end(), [](const FileEntry& a, const FileEntry& b) { return a.name < b.name; });
+        auto duplicate = std::adjacent_find(m_files.begin(), m_files.end(), [](const FileEntry& a, const FileEntry& b) { return a.name == b.name; });
+        if (duplicate != m_files.end())
+        {
+            std::ostringstream builder;
+            builder << "Duplicate file: '" << duplicate->name << "' specified in AppxBlockMap.xml.";
+            ThrowErrorAndLog(Error::BlockMapSemanticError, builder.str().c_str());
+        }
+        m_blocks.shrink_to_fit();
+        m_files.shrink_to_fit();
+        m_blockTable = m_blocks.data();
+        m_blockCount = m_blocks.size();
+    }
+
+    bool AppxBlockMapObject::LoadIndex(const ComPtr<IStream>& index)
+    {
+        // Use the index in place when it is already in memory, otherwise read it.
+        const std::uint8_t* data = nullptr;
+        std::uint64_t size = 0;
+        std::vector<std::uint8_t> buffer;
+        ComPtr<IStreamInternal> indexInternal;
+        HRESULT hr = index->QueryInterface(UuidOfImpl<IStreamInternal>::iid, reinterpret_cast<void**>(&indexInternal));
+        if (SUCCEEDED(hr) && indexInternal->GetData() != nullptr)
+        {
+            data = indexInternal->GetData();
+            size = indexInternal->GetSize();
+        }
+        else
+        {
+            buffer = Helper::CreateBufferFromStream(index);
+            data = buffer.data();
+            size = buffer.size();
+        }
+
+        BlockMapIndexHeader header;
+        if (size < sizeof(header)) { return false; }
+        std::memcpy(&header, data, sizeof(header));
+        if (header.signature != BlockMapIndexSignature || header.version != IndexVersion || header.fileCount == 0) { return false; }
+
+        // The sizes must add up to the size of the index
+        auto remaining = size - sizeof(header);
+        if (header.blockCount > remaining / sizeof(Block)) { return false; }
+        remaining -= header.blockCount * sizeof(Block);
+        if (header.fileCount > remaining / sizeof(BlockMapIndexFile)) { return false; }
+        remaining -= header.fileCount * sizeof(BlockMapIndexFile);
+        if (header.namesSize != remaining) { return false; }
+
+        auto blocks = data + sizeof(header);
+        auto files = blocks + header.blockCount * sizeof(Block);
+        auto names = reinterpret_cast<const char*>(files + header.fileCount * sizeof(BlockMapIndexFile));
+
+        std::vector<FileEntry> entries;
+        entries.reserve(static_cast<std::size_t>(header.fileCount));
+        std::uint64_t nameOffset = 0;
+        for (std::uint64_t i = 0; i < header.fileCount; i++)
+        {
+            BlockMapIndexFile file;
+            std::memcpy(&file, files + i * sizeof(BlockMapIndexFile), sizeof(file));
+            if ((file.firstBlock > header.blockCount) || (file.blockCount > header.blockCount - file.firstBlock) ||
+                (file.nameSize > header.namesSize - nameOffset))
+            {
+                return false;
+            }
+            entries.push_back(FileEntry{ std::string(names + nameOffset, file.nameSize), file.size, file.localFileHeaderSize,
+                static_cast<std::size_t>(file.firstBlock), static_cast<std::size_t>(file.blockCount) });
+            nameOffset += file.nameSize;
+            // FindFile relies on the files being sorted without duplicates
+            if (i > 0 && !(entries[i - 1].name < entries[i].name)) { return false; }
+        }
+
+        m_files = std::move(entries);
+        m_blockCount = static_cast<std::size_t>(header.blockCount);
+        if (buffer.empty() && (reinterpret_cast<std::uintptr_t>(blocks) % alignof(Block) == 0))
+        {
+            m_blockTable = reinterpret_cast<const Block*>(blocks);
+            m_index = index;
+        }
+        else
+        {
+            m_blocks.resize(m_blockCount);
+            std::memcpy(m_blocks.data(), blocks, m_blockCount * sizeof(Block));
+            m_blockTable = m_blocks.data();
+        }
+        return true;
+    }
+
+    void AppxBlockMapObject::StartFile(const std::string& name, std::uint64_t size, std::uint32_t localFileHeaderSize)
+    {
+        ThrowErrorIf(Error::BlockMapSemanticError, (name == "[Content_Types].xml"), "[Content_Types].xml cannot be in the AppxBlockMap.xml file");
+        m_files.push_back(FileEntry{ name, size, localFileHeaderSize, m_blocks.size(), 0 });
+    }
+
+    void AppxBlockMapObject::AddBlock(std::uint64_t sizeAttribute, const std::uint8_t* hash, std::size_t hashSize)
+    {
+        ThrowErrorIf(Error::BlockMapSemanticError, (hashSize != BLOCKMAP_HASH_SIZE), "Invalid block hash in AppxBlockMap.xml");
+        Block block;
+        if (sizeAttribute == static_cast<std::uint64_t>(-1))
+        {
+            block.blockSize = BLOCKMAP_BLOCK_SIZE;
+            block.compressedSize = m_files.back().size;
+        }
+        else
+        {
+            block.blockSize = sizeAttribute;
+            block.compressedSize = sizeAttribute;
+        }
+        std::copy(hash, hash + hashSize, block.hash.begin());
+        m_blocks.push_back(block);
+        m_files.back().blockCount++;
+    }
+
+    void AppxBlockMapObject::EndFile()
+    {
+        const auto& file = m_files.back();
+        ThrowErrorIf(Error::BlockMapSemanticError, (0 == file.blockCount && 0 != file.size), "If size is non-zero, then there must be 1+ blocks.");
+    }
+
+    const AppxBlockMapObject::FileEntry* AppxBlockMapObject::FindFile(const std::string& fileName)
+    {
+        auto file = std::lower_bound(m_files.begin(), m_files.end(), fileName, [](const FileEntry& a, const std::string& name) { return a.name < name; });
+        if (file == m_files.end() || file->name != fileName)
+        {
+            return nullptr;
+        }
+        return &(*file);
+    }
+
+    ComPtr<IAppxBlockMapFile> AppxBlockMapObject::GetFile(const FileEntry& file)
+    {
+        std::lock_guard<std::mutex> lock(m_fileObjectsMutex);
+        auto& fileObject = m_fileObjects[&file - m_files.data()];
+        if (!fileObject)
+        {
+            fileObject = ComPtr<IAppxBlockMapFile>::Make<AppxBlockMapFile>(m_factory, GetBlocks(file), file.localFileHeaderSize, file.name, file.size);
+        }
+        return fileObject;
     }
 
     // IVerifierObject
     ComPtr<IStream> AppxBlockMapObject::GetValidationStream(const std::string& part, const ComPtr<IStream>& stream)
     {
         ThrowErrorIf(Error::InvalidParameter, (part.empty() || !stream), "bad input");
-        auto item = m_blockMap.find(part);
+        auto file = FindFile(part);
         std::ostringstream builder;
         builder << "file: '" << part << "' not tracked by blockmap.";
-        ThrowErrorIf(Error::BlockMapSemanticError, item == m_blockMap.end(), builder.str().c_str());
-        return ComPtr<IStream>::Make<BlockMapStream>(m_factory, part, stream, item->second);
+        ThrowErrorIf(Error::BlockMapSemanticError, file == nullptr, builder.str().c_str());
+        return ComPtr<IStream>::Make<BlockMapStream>(m_factory, part, stream, GetBlocks(*file));
     }
 
     // IAppxBlockMapReader
@@ -130,10 +311,10 @@ namespace MSIX {
     {
         ThrowErrorIf(Error::InvalidParameter, (enumerator == nullptr || *enumerator != nullptr), "bad pointer");
         std::vector<ComPtr<IAppxBlockMapFile>> blockMapFiles;
-        for(const auto& file : m_blockMapFiles)
+        blockMapFiles.reserve(m_files.size());
+        for(const auto& file : m_files)
         {
-            auto blockFile = file.second;
-            blockMapFiles.push_back(std::move(blockFile));
+            blockMapFiles.push_back(GetFile(file));
         }
         *enumerator = ComPtr<IAppxBlockMapFilesEnumerator>::
                 Make<EnumeratorCom<IAppxBlockMapFilesEnumerator, IAppxBlockMapFile>>(blockMapFiles).Detach();
@@ -159,27 +340,57 @@ namespace MSIX {
     std::vector<std::string> AppxBlockMapObject::GetFileNames()
     {
         std::vector<std::string> fileNames;
+        fileNames.reserve(m_files.size());
         std::transform(
-            m_blockMapFiles.begin(),
-            m_blockMapFiles.end(),
+            m_files.begin(),
+            m_files.end(),
             std::back_inserter(fileNames),
-            [](auto keyValuePair){ return keyValuePair.first; }
+            [](const FileEntry& file){ return file.name; }
         );
         return fileNames;
     }
 
-    std::vector<Block> AppxBlockMapObject::GetBlocks(const std::string& fileName)
+    BlockRange AppxBlockMapObject::GetBlocks(const std::string& fileName)
     {
-        auto index = m_blockMap.find(fileName);
-        ThrowErrorIf(Error::FileNotFound, (index == m_blockMap.end()), "File not in blockmap");
-        return index->second;
+        auto file = FindFile(fileName);
+        ThrowErrorIf(Error::FileNotFound, (file == nullptr), "File not in blockmap");
+        return GetBlocks(*file);
     }
 
     ComPtr<IAppxBlockMapFile> AppxBlockMapObject::GetFile(const std::string& fileName)
     {
-        auto index = m_blockMapFiles.find(fileName);
-        ThrowErrorIf(Error::FileNotFound, (index == m_blockMapFiles.end()), "File not in blockmap");
-        return index->second;
+        auto file = FindFile(fileName);
+        ThrowErrorIf(Error::FileNotFound, (file == nullptr), "File not in blockmap");
+        return GetFile(*file);
+    }
+
+    std::vector<std::uint8_t> AppxBlockMapObject::GetIndex()
+    {
+        BlockMapIndexHeader header = { BlockMapIndexSignature, IndexVersion, m_files.size(), m_blockCount, 0 };
+        for (const auto& file : m_files)
+        {
+            header.namesSize += file.name.size();
+        }
+
+        std::vector<std::uint8_t> index;
+        index.reserve(sizeof(header) + m_blockCount * sizeof(Block) + m_files.size() * sizeof(BlockMapIndexFile) + header.namesSize);
+        auto append = [&index](const void* data, std::size_t size)
+        {
+            auto bytes = static_cast<const std::uint8_t*>(data);
+            index.insert(index.end(), bytes, bytes + size);
+        };
+        append(&header, sizeof(header));
+        append(m_blockTable, m_blockCount * sizeof(Block));
+        for (const auto& file : m_files)
+        {
+            BlockMapIndexFile indexFile = { file.size, file.firstBlock, file.blockCount, file.localFileHeaderSize, static_cast<std::uint32_t>(file.name.size()) };
+            append(&indexFile, sizeof(indexFile));
+        }
+        for (const auto& file : m_files)
+        {
+            append(file.name.data(), file.name.size());
+        }
+        return index;
     }
 
     // IAppxBlockMapReaderUtf8
@@ -188,10 +399,9 @@ namespace MSIX {
         ThrowErrorIf(Error::InvalidParameter, (
             filename == nullptr || *filename == '\0' || file == nullptr || *file != nullptr
         ), "bad pointer");
-        auto blockMapFile = m_blockMapFiles.find(filename);
-        ThrowErrorIf(Error::InvalidParameter, (blockMapFile == m_blockMapFiles.end()), "File not found!");
-        MSIX::ComPtr<IAppxBlockMapFile> result = blockMapFile->second;
-        *file = result.Detach();
+        auto blockMapFile = FindFile(filename);
+        ThrowErrorIf(Error::InvalidParameter, (blockMapFile == nullptr), "File not found!");
+        *file = GetFile(*blockMapFile).Detach();
         return static_cast<HRESULT>(Error::OK);
     } CATCH_RETURN();
 }
\ No newline at end of file
@@ -19,6 +19,11 @@
 #include "MsixFeatureSelector.hpp"
 #include "ScopeExit.hpp"
 #include "StringHelper.hpp"
+#include "ThreadPool.hpp"
+#include "ParallelInflateStream.hpp"
+#include "ZipObjectReader.hpp"
+#include "VectorStream.hpp"
+#include "Crypto.hpp"
 
 #ifdef BUNDLE_SUPPORT
 #include "Applicability.hpp"
@@ -32,17 +37,26 @@
 #include <limits>
 #include <algorithm>
 #include <array>
+#include <atomic>
+#include <future>
+#include <mutex>
 
 namespace MSIX {
 
     AppxPackageObject::AppxPackageObject(IMsixFactory* factory, MSIX_VALIDATION_OPTION validation,
-        MSIX_APPLICABILITY_OPTIONS applicabilityFlags, const ComPtr<IStorageObject>& container) :
+        MSIX_APPLICABILITY_OPTIONS applicabilityFlags, MSIX_FACTORY_OPTIONS factoryOptions, const ComPtr<IStorageObject>& container) :
         m_factory(factory),
         m_validation(validation),
+        m_applicabilityFlags(applicabilityFlags),
         m_container(container)
     {
-        ComPtr<IXmlFactory> xmlFactory;
-        ThrowHrIfFailed(factory->QueryInterface(UuidOfImpl<IXmlFactory>::iid, reinterpret_cast<void**>(&xmlFactory)));
+        m_parallelInflate = (factoryOptions & MSIX_FACTORY_OPTION_READER_PARALLEL_INFLATE) != 0;
+
+        // Read the footprint files together, they are all read before anything else
+        std::vector<std::string> footprint = { CONTENT_TYPES_XML };
+        footprint.insert(footprint.end(), footprintFiles.begin(), footprintFiles.end());
+        footprint.insert(footprint.end(), bundleFootprintFiles.begin(), bundleFootprintFiles.end());
+        m_container.As<IZipReader>()->PrefetchFiles(footprint);
 
         // 1. Get the appx signature from the container and parse it
         // TODO: pass validation flags and other necessary goodness through.
@@ -50,22 +64,42 @@ namespace MSIX {
         if ((validation & MSIX_VALIDATION_OPTION_SKIPSIGNATURE) == 0)
         {   ThrowErrorIfNot(Error::MissingAppxSignatureP7X, file, "AppxSignature.p7x not in archive!");
         }
-        m_appxSignature = ComPtr<IVerifierObject>::Make<AppxSignatureObject>(factory, validation, file);
+        auto appxSignature = ComPtr<AppxSignatureObject>::Make<AppxSignatureObject>(factory, validation, file);
+        m_appxBlockMapDigest = appxSignature->GetAppxBlockMapDigest();
+        m_appxSignature = appxSignature.As<IVerifierObject>();
 
-        // 2. Get content type using signature object for validation
-        file = m_container->GetFile(CONTENT_TYPES_XML);
-        ThrowErrorIfNot(Error::MissingContentTypesXML, file, "[Content_Types].xml not in archive!");
-        ComPtr<IStream> stream = m_appxSignature->GetValidationStream(CONTENT_TYPES_XML, file);
-        auto contentType = xmlFactory->CreateDomFromStream(XmlContentType::ContentTypeXml, stream);
+        // Optionally check the whole container against the signature before anything else is read from it, so
+        // a tampered package is rejected up front instead of when the damaged file is extracted.
+        if (((validation & MSIX_VALIDATION_OPTION_VERIFYCONTAINERDIGESTS) != 0) &&
+            ((validation & MSIX_VALIDATION_OPTION_SKIPSIGNATURE) == 0))
+        {
+            auto zipReader = m_container.As<IZipReader>();
+            // Both parts are read front to back in large chunks, so the package is hashed in one sequential pass.
+            std::vector<std::uint8_t> buffer(1024 * 1024);
+            auto validatePart = [&](const char* part, const ComPtr<IStream>& partStream)
+            {
+                auto validationStream = m_appxSignature->GetValidationStream(part, partStream);
+                ULONG bytesRead = 0;
+                do
+                {   // The validation stream throws when its last byte is read if the part doesn't match the digest
+                    ThrowHrIfFailed(validationStream->Read(buffer.data(), static_cast<ULONG>(buffer.size()), &bytesRead));
+                } while (bytesRead != 0);
+            };
+            validatePart(FILE_RECORDS_PART, zipReader->GetFileRecordsStream(APPXSIGNATURE_P7X));
+            validatePart(CENTRAL_DIRECTORY_PART, zipReader->GetCentralDirectoryStream(APPXSIGNATURE_P7X));
+        }
 
-        // 3. Get blockmap object using signature object for validation
-        file = m_container->GetFile(APPXBLOCKMAP_XML);
-        ThrowErrorIfNot(Error::MissingAppxBlockMapXML, file, "AppxBlockMap.xml not in archive!");
-        stream = m_appxSignature->GetValidationStream(APPXBLOCKMAP_XML, file);
-        m_appxBlockMap = ComPtr<IVerifierObject>::Make<AppxBlockMapObject>(factory, stream);
+        // A lazy open reads the other parts of the package when they are first used. Whether the package is a bundle
+        // must be known up front, so only look for its manifest.
+        bool lazyOpen = (factoryOptions & MSIX_FACTORY_OPTION_READER_LAZY_OPEN) != 0;
+        if (!lazyOpen)
+        {   // 2. Get content type using signature object for validation
+            ValidateContentTypes();
+            // 3. Get blockmap object using signature object for validation
+            GetBlockMapObject();
+        }
 
-        // 4. Get manifest object using blockmap object for validation
-        // TODO: pass validation flags and other necessary goodness through.
+        // 4. Find the manifest
         auto appxManifestInContainer = m_container->GetFile(APPXMANIFEST_XML);
         auto appxBundleManifestInContainer = m_container->GetFile(APPXBUNDLEMANIFEST_XML);
 
@@ -76,47 +110,164 @@ namespace MSIX {
         // We already validate that there's at least one and not both
         if(appxManifestInContainer)
         {
-            stream = m_appxBlockMap->GetValidationStream(APPXMANIFEST_XML, appxManifestInContainer);
-            m_appxManifest = ComPtr<IVerifierObject>::Make<AppxManifestObject>(factory, stream);
+            m_manifestInContainer = std::move(appxManifestInContainer);
         }
         else
         {
             // It is valid for a user to create an IAppxPackageReader and then QI for IAppxBundleReader, but
             // not when bundle support is off.
             THROW_IF_BUNDLE_NOT_ENABLED
-            #ifdef BUNDLE_SUPPORT
-            std::string pathInWindows = Helper::toBackSlash(APPXBUNDLEMANIFEST_XML);
-            stream = m_appxBlockMap->GetValidationStream(pathInWindows, appxBundleManifestInContainer);
-            m_appxBundleManifest = ComPtr<IVerifierObject>::Make<AppxBundleManifestObject>(factory, stream);
+            m_manifestInContainer = std::move(appxBundleManifestInContainer);
             m_isBundle = true;
-            #endif
         }
 
-        if ((m_validation & MSIX_VALIDATION_OPTION_SKIPSIGNATURE) == 0)
+        if (!lazyOpen)
+        {   // Get manifest object using blockmap object for validation
+            GetManifestObject();
+            // 5. Index the footprint and payload files
+            IndexFiles();
+        }
+    }
+
+    void AppxPackageObject::ValidateContentTypes()
+    {
+        std::call_once(m_contentTypesValidated, [this]()
         {
-            ComPtr<IAppxManifestPackageId> packageId;
-            if (m_isBundle)
+            auto file = m_container->GetFile(CONTENT_TYPES_XML);
+            ThrowErrorIfNot(Error::MissingContentTypesXML, file, "[Content_Types].xml not in archive!");
+            ComPtr<IStream> stream = m_appxSignature->GetValidationStream(CONTENT_TYPES_XML, file);
+            m_factory.As<IXmlFactory>()->CreateDomFromStream(XmlContentType::ContentTypeXml, stream);
+        });
+    }
+
+    const ComPtr<IVerifierObject>& AppxPackageObject::GetBlockMapObject()
+    {
+        std::call_once(m_blockMapLoaded, [this]()
+        {
+            auto file = m_container->GetFile(APPXBLOCKMAP_XML);
+            ThrowErrorIfNot(Error::MissingAppxBlockMapXML, file, "AppxBlockMap.xml not in archive!");
+            auto stream = m_appxSignature->GetValidationStream(APPXBLOCKMAP_XML, file);
+
+            // Reuse the block map parsed by an earlier open of the same package when there is an index cache
+            auto indexCache = m_factory->GetIndexCache();
+            std::string indexKey;
+            ComPtr<IStream> index;
+            if (indexCache)
             {
-                auto manifest = m_appxBundleManifest.As<IAppxBundleManifestReader>();
-                ThrowHrIfFailed(manifest->GetPackageId(&packageId));
+                indexKey = GetBlockMapIndexKey();
             }
-            else
+            if (!indexKey.empty())
             {
-                auto manifest = m_appxManifest.As<IAppxManifestReader>();
-                ThrowHrIfFailed(manifest->GetPackageId(&packageId));
+                ThrowHrIfFailed(indexCache->GetEntry(indexKey.c_str(), &index));
             }
-            auto publisherFromSignature = m_appxSignature->GetPublisher();
-            BOOL isSame = FALSE;
-            ThrowHrIfFailed(packageId->ComparePublisher(
-                reinterpret_cast<LPCWSTR>(utf8_to_wstring(publisherFromSignature).c_str()), &isSame));
-            if(!isSame)
-            {
-                auto internal = packageId.As<IAppxManifestPackageIdInternal>();
-                std::string reason = "Publisher mismatch: '" + internal->GetPublisher() + "' != '" + publisherFromSignature + "'";
-                ThrowErrorAndLog(Error::PublisherMismatch, reason.c_str());
+
+            m_appxBlockMap = ComPtr<IVerifierObject>::Make<AppxBlockMapObject>(m_factory.Get(), stream, index);
+            auto blockMapInternal = m_appxBlockMap.As<IAppxBlockMapInternal>();
+            if (!indexKey.empty() && !blockMapInternal->IsLoadedFromIndex())
+            {   // The cache is only an optimization, failing to update it doesn't fail the open
+                auto entry = ComPtr<IStream>::Make<VectorStream>(blockMapInternal->GetIndex());
+                static_cast<void>(indexCache->SetEntry(indexKey.c_str(), entry.Get()));
             }
+        });
+        return m_appxBlockMap;
+    }
+
+    std::string AppxPackageObject::GetBlockMapIndexKey()
+    {
+        ComPtr<IZipReader> zipReader;
+        HRESULT hr = m_container->QueryInterface(UuidOfImpl<IZipReader>::iid, reinterpret_cast<void**>(&zipReader));
+        if (FAILED(hr))
+        {
+            return std::string();
+        }
+
+        // The central directory has the size and CRC of AppxBlockMap.xml. When the signature is validated, the block map
+        // digest also ties the index to a block map that matched the signature, so it can't be used for an unvalidated one.
+        SHA256 hash;
+        std::uint32_t version = AppxBlockMapObject::IndexVersion;
+        hash.HashData(reinterpret_cast<const std::uint8_t*>(&version), sizeof(version));
+        std::uint8_t validated = m_appxBlockMapDigest.empty() ? 0 : 1;
+        hash.HashData(&validated, sizeof(validated));
+        if (validated)
+        {
+            hash.HashData(m_appxBlockMapDigest.data(), static_cast<std::uint32_t>(m_appxBlockMapDigest.size()));
         }
+        auto centralDirectoryHash = zipReader->GetCentralDirectoryHash();
+        hash.HashData(centralDirectoryHash.data(), static_cast<std::uint32_t>(centralDirectoryHash.size()));
+        std::vector<std::uint8_t> key;
+        hash.FinalizeAndGetHashValue(key);
+
+        static const char hexDigits[] = "0123456789abcdef";
+        std::string result;
+        result.reserve(key.size() * 2);
+        for (auto byte : key)
+        {
+            result.push_back(hexDigits[byte >> 4]);
+            result.push_back(hexDigits[byte & 0x0F]);
+        }
+        return result;
+    }
+
+    const ComPtr<IVerifierObject>& AppxPackageObject::GetManifestObject()
+    {
+        std::call_once(m_manifestLoaded, [this]()
+        {
+            // The manifest is validated by the blockmap, which is validated by the signature
+            const auto& blockMap = GetBlockMapObject();
+            if (!m_isBundle)
+            {
+                auto stream = blockMap->GetValidationStream(APPXMANIFEST_XML, m_manifestInContainer);
+                m_appxManifest = ComPtr<IVerifierObject>::Make<AppxManifestObject>(m_factory.Get(), stream);
+            }
+            else
+            {
+                #ifdef BUNDLE_SUPPORT
+                std::string pathInWindows = Helper::toBackSlash(APPXBUNDLEMANIFEST_XML);
+                auto stream = blockMap->GetValidationStream(pathInWindows, m_manifestInContainer);
+                m_appxBundleManifest = ComPtr<IVerifierObject>::Make<AppxBundleManifestObject>(m_factory.Get(), stream);
+                #endif
+            }
+
+            if ((m_validation & MSIX_VALIDATION_OPTION_SKIPSIGNATURE) == 0)
+            {
+                ComPtr<IAppxManifestPackageId> packageId;
+                if (m_isBundle)
+                {
+                    auto manifest = m_appxBundleManifest.As<IAppxBundleManifestReader>();
+                    ThrowHrIfFailed(manifest->GetPackageId(&packageId));
+                }
+                else
+                {
+                    auto manifest = m_appxManifest.As<IAppxManifestReader>();
+                    ThrowHrIfFailed(manifest->GetPackageId(&packageId));
+                }
+                auto publisherFromSignature = m_appxSignature->GetPublisher();
+                BOOL isSame = FALSE;
+                ThrowHrIfFailed(packageId->ComparePublisher(
+                    reinterpret_cast<LPCWSTR>(utf8_to_wstring(publisherFromSignature).c_str()), &isSame));
+                if(!isSame)
+                {
+                    auto internal = packageId.As<IAppxManifestPackageIdInternal>();
+                    std::string reason = "Publisher mismatch: '" + internal->GetPublisher() + "' != '" + publisherFromSignature + "'";
+                    ThrowErrorAndLog(Error::PublisherMismatch, reason.c_str());
+                }
+            }
+        });
+        return m_isBundle ? m_appxBundleManifest : m_appxManifest;
+    }
+
+    void AppxPackageObject::IndexFiles()
+    {
+        std::call_once(m_filesIndexed, [this]()
+        {
+            ValidateContentTypes();
+            GetManifestObject();
+            BuildFileIndex();
+        });
+    }
 
+    void AppxPackageObject::BuildFileIndex()
+    {
         struct Config
         {
             typedef ComPtr<IStream> (*lambda)(AppxPackageObject* self);
@@ -205,7 +356,7 @@ namespace MSIX {
             auto bundleInfo = m_appxBundleManifest.As<IBundleInfo>();
             auto appxFactory = m_factory.As<IAppxFactory>();
 
-            Applicability applicability(applicabilityFlags);
+            Applicability applicability(m_applicabilityFlags);
 
             auto factoryOverrides = m_factory.As<IMsixFactoryOverrides>();
             ComPtr<IUnknown> applicabilityLanguagesUnk;
@@ -221,7 +372,7 @@ namespace MSIX {
                 applicability.InitializeLanguages();
             }
 
-            if (!(validation & MSIX_VALIDATION_OPTION::MSIX_VALIDATION_OPTION_SKIPPACKAGEVALIDATION))
+            if (!(m_validation & MSIX_VALIDATION_OPTION::MSIX_VALIDATION_OPTION_SKIPPACKAGEVALIDATION))
             {
                 for (const auto& package : bundleInfo->GetPackages())
                 {
@@ -331,15 +482,12 @@ namespace MSIX {
                 {
                     auto opcFileName = Encoding::EncodeFileName(fileName);
                     m_payloadFiles.push_back(opcFileName);
+                    m_payloadBlockMapNames[opcFileName] = fileName;
                     m_files[opcFileName] = MSIX::ComPtr<IAppxFile>::Make<MSIX::AppxFile>(m_factory.Get(), fileName,
-                        [opcFileName, fileName, blockMapInternal, result = ComPtr<IStream>(), this]() mutable {
+                        [opcFileName, fileName, result = ComPtr<IStream>(), this]() mutable {
                         if (nullptr == result.Get())
                         {
-                            auto fileStream = m_container->GetFile(opcFileName);
-                            ThrowErrorIfNot(Error::FileNotFound, fileStream, "File described in blockmap not contained in OPC container");
-                            VerifyFile(fileStream, fileName, blockMapInternal);
-                            result = m_appxBlockMap->GetValidationStream(fileName, fileStream);
-                            ThrowHrIfFailed(result->Seek({0}, StreamBase::Reference::START, nullptr));
+                            result = GetPayloadStream(m_container, opcFileName, fileName);
                         }
                         return result;
                     });
@@ -403,50 +551,291 @@ namespace MSIX {
         }
     }
 
-    void AppxPackageObject::Unpack(MSIX_PACKUNPACK_OPTION options, const ComPtr<IDirectoryObject>& to)
+    ComPtr<IStream> AppxPackageObject::GetPayloadStream(const ComPtr<IStorageObject>& container, const std::string& opcFileName, const std::string& fileName)
     {
-        auto fileNames = GetFileNames(FileNameOptions::All);
-        for (const auto& fileName : fileNames)
-        {   // Don't extract packages files
-            auto file = std::find(std::begin(m_applicablePackagesNames), std::end(m_applicablePackagesNames), fileName);
-            if (file == std::end(m_applicablePackagesNames))
+        Global::Log::PartScope part(fileName);
+        auto fileStream = container->GetFile(opcFileName);
+        ThrowErrorIfNot(Error::FileNotFound, fileStream, "File described in blockmap not contained in OPC container");
+        auto blockMapInternal = m_appxBlockMap.As<IAppxBlockMapInternal>();
+        VerifyFile(fileStream, fileName, blockMapInternal);
+        auto result = m_appxBlockMap->GetValidationStream(fileName, fileStream);
+        ThrowHrIfFailed(result->Seek({0}, StreamBase::Reference::START, nullptr));
+
+        // With MSIX_FACTORY_OPTION_READER_PARALLEL_INFLATE large compressed files are inflated by several threads,
+        // from the stored blocks of the file
+        if (!m_parallelInflate || !fileStream.As<IStreamInternal>()->IsCompressed())
+        {
+            return result;
+        }
+        auto blocks = blockMapInternal->GetBlocks(fileName);
+        if (blocks.size() >= ParallelInflateStream::MinimumBlockCount)
+        {
+            ComPtr<IZipReader> zipReader;
+            HRESULT hr = container->QueryInterface(UuidOfImpl<IZipReader>::iid, reinterpret_cast<void**>(&zipReader));
+            if (SUCCEEDED(hr))
             {
-                std::string targetName = Encoding::DecodeFileName(fileName);
-                if ((options & MSIX_PACKUNPACK_OPTION_CREATEPACKAGESUBFOLDER) || options & MSIX_PACKUNPACK_OPTION_UNPACKWITHFLATSTRUCTURE)
+                UINT64 size = 0;
+                ThrowHrIfFailed(blockMapInternal->GetFile(fileName)->GetUncompressedSize(&size));
+                return ComPtr<IStream>::Make<ParallelInflateStream>(zipReader->GetRawFile(opcFileName), blocks, size, result,
+                    m_factory->GetInflateThreadPool());
+            }
+        }
+        return result;
+    }
+
+    std::string AppxPackageObject::GetUnpackTargetPrefix(MSIX_PACKUNPACK_OPTION options)
+    {
+        if ((options & MSIX_PACKUNPACK_OPTION_CREATEPACKAGESUBFOLDER) || options & MSIX_PACKUNPACK_OPTION_UNPACKWITHFLATSTRUCTURE)
+        {
+            ComPtr<IAppxManifestPackageId> packageId;
+            if (m_isBundle)
+            {
+                auto manifest = m_appxBundleManifest.As<IAppxBundleManifestReader>();
+                ThrowHrIfFailed(manifest->GetPackageId(&packageId));
+            }
+            else
+            {
+                auto manifest = m_appxManifest.As<IAppxManifestReader>();
+                ThrowHrIfFailed(manifest->GetPackageId(&packageId));
+            }
+            // Don't use to->GetPathSeparator(). DirectoryObject::OpenFile created directories
+            // by looking at "/" in the string. If to->GetPathSeparator() is used the subfolder with
+            // the package full name won't be created on Windows, but it will on other platforms.
+            // This means that we have different behaviors in non-Win platforms.
+            return packageId.As<IAppxManifestPackageIdInternal>()->GetPackageFullName() + "/";
+        }
+        return std::string();
+    }
+
+    std::uint64_t AppxPackageObject::GetUnpackedSize(const std::string& fileName)
+    {   // Only payload files have their size in the block map
+        auto blockMapName = m_payloadBlockMapNames.find(fileName);
+        if (blockMapName == m_payloadBlockMapNames.end())
+        {
+            return 0;
+        }
+        auto file = GetBlockMapObject().As<IAppxBlockMapInternal>()->GetFile(blockMapName->second);
+        UINT64 size = 0;
+        if (file)
+        {
+            ThrowHrIfFailed(file->GetUncompressedSize(&size));
+        }
+        return size;
+    }
+
+    void AppxPackageObject::UnpackFile(const ComPtr<IStream>& source, const std::string& targetName, const ComPtr<IDirectoryObject>& to, std::uint64_t size)
+    {
+        auto deleteFile = MSIX::scope_exit([&targetName]
+        {
+            remove(targetName.c_str());
+        });
+
+        auto targetFile = to->OpenFileForWrite(targetName, size);
+
+        ULARGE_INTEGER bytesCount = {0};
+        bytesCount.QuadPart = std::numeric_limits<std::uint64_t>::max();
+        ThrowHrIfFailed(source->CopyTo(targetFile.Get(), bytesCount, nullptr, nullptr));
+        deleteFile.release();
+    }
+
+    void AppxPackageObject::UnpackPayloadFilesInParallel(const std::vector<std::string>& fileNames, const std::string& targetPrefix, const ComPtr<IDirectoryObject>& to)
+    {
+        ThreadPool threadPool(ThreadPool::DefaultThreadCount());
+
+        // Streams aren't thread safe, every worker reads the payload files from its own view of the container.
+        std::vector<ComPtr<IStorageObject>> views;
+        ComPtr<IZipReader> zipReader;
+        HRESULT hr = m_container->QueryInterface(UuidOfImpl<IZipReader>::iid, reinterpret_cast<void**>(&zipReader));
+        if (SUCCEEDED(hr))
+        {
+            std::size_t workerCount = std::max(threadPool.GetThreadCount(), static_cast<std::size_t>(1));
+            for (std::size_t i = 0; i < workerCount; i++)
+            {
+                auto view = zipReader->CreateView();
+                if (!view)
                 {
-                    ComPtr<IAppxManifestPackageId> packageId;
-                    if (m_isBundle)
+                    views.clear();
+                    break;
+                }
+                views.push_back(std::move(view));
+            }
+        }
+
+        if (views.empty())
+        {   // The container stream can't be cloned, extract the files one after another.
+            for (const auto& fileName : fileNames)
+            {
+                UnpackFile(GetFile(fileName), targetPrefix + Encoding::DecodeFileName(fileName), to, GetUnpackedSize(fileName));
+            }
+            return;
+        }
+
+        std::atomic<std::size_t> nextFile(0);
+        std::atomic<bool> failed(false);
+        std::mutex failureLogMutex;
+        std::string failureLog;
+        std::vector<std::future<void>> workers;
+        for (const auto& view : views)
+        {
+            workers.push_back(threadPool.Submit([&, view]()
+            {
+                for (std::size_t index = nextFile++; (index < fileNames.size()) && !failed; index = nextFile++)
+                {
+                    try
                     {
-                        auto manifest = m_appxBundleManifest.As<IAppxBundleManifestReader>();
-                        ThrowHrIfFailed(manifest->GetPackageId(&packageId));
+                        const auto& fileName = fileNames[index];
+                        auto source = GetPayloadStream(view, fileName, m_payloadBlockMapNames.at(fileName));
+                        UnpackFile(source, targetPrefix + Encoding::DecodeFileName(fileName), to, GetUnpackedSize(fileName));
                     }
-                    else
-                    {
-                        auto manifest = m_appxManifest.As<IAppxManifestReader>();
-                        ThrowHrIfFailed(manifest->GetPackageId(&packageId));
+                    catch (...)
+                    {   // The log is per thread, hand the records of the first failure over to the caller
+                        std::lock_guard<std::mutex> lock(failureLogMutex);
+                        if (!failed) { failureLog = Global::Log::Take(); }
+                        failed = true;
+                        throw;
                     }
-                    // Don't use to->GetPathSeparator(). DirectoryObject::OpenFile created directories
-                    // by looking at "/" in the string. If to->GetPathSeparator() is used the subfolder with
-                    // the package full name won't be created on Windows, but it will on other platforms.
-                    // This means that we have different behaviors in non-Win platforms.
-                    targetName = packageId.As<IAppxManifestPackageIdInternal>()->GetPackageFullName() + "/" + targetName;
                 }
+            }));
+        }
+
+        // Workers reference this frame, wait for all of them before reporting the first failure.
+        for (auto& worker : workers) { worker.wait(); }
+        try
+        {
+            for (auto& worker : workers) { worker.get(); }
+        }
+        catch (...)
+        {
+            Global::Log::Append(failureLog);
+            throw;
+        }
+    }
 
-                auto deleteFile = MSIX::scope_exit([&targetName]
+    #ifdef BUNDLE_SUPPORT
+    void AppxPackageObject::UnpackPackagesInParallel(MSIX_PACKUNPACK_OPTION options, const ComPtr<IDirectoryObject>& to)
+    {
+        // The packages validated with the bundle read from the bundle stream, which the workers can't share.
+        // Every package reads its payload files from its own view over a clone of its stream instead.
+        std::vector<ComPtr<IStorageObject>> views;
+        for (const auto& appx : m_applicablePackages)
+        {
+            auto view = appx.As<IPackage>()->CreateView();
+            if (!view)
+            {
+                views.clear();
+                break;
+            }
+            views.push_back(std::move(view));
+        }
+
+        if (views.empty())
+        {
+            for (const auto& appx : m_applicablePackages)
+            {
+                appx.As<IPackage>()->Unpack(options, to);
+            }
+            return;
+        }
+
+        // Footprint files can be read from the bundle stream, unpack them before starting the workers.
+        for (const auto& appx : m_applicablePackages)
+        {
+            appx.As<IPackage>()->UnpackFootprintFiles(options, to);
+        }
+
+        ThreadPool threadPool(ThreadPool::DefaultThreadCount());
+        std::vector<std::future<void>> workers;
+        std::vector<std::string> failureLogs(views.size());
+        for (std::size_t i = 0; i < views.size(); i++)
+        {
+            workers.push_back(threadPool.Submit([&, i]()
+            {
+                try
                 {
-                    remove(targetName.c_str());
-                });
+                    m_applicablePackages[i].As<IPackage>()->UnpackPayloadFiles(options, to, views[i]);
+                }
+                catch (...)
+                {   // The log is per thread, hand the records over to the caller
+                    failureLogs[i] = Global::Log::Take();
+                    throw;
+                }
+            }));
+        }
+
+        // Workers reference this frame, wait for all of them before reporting the first failure.
+        for (auto& worker : workers) { worker.wait(); }
+        for (std::size_t i = 0; i < workers.size(); i++)
+        {
+            try
+            {
+                workers[i].get();
+            }
+            catch (...)
+            {
+                Global::Log::Append(failureLogs[i]);
+                throw;
+            }
+        }
+    }
+    #endif
+
+    ComPtr<IStorageObject> AppxPackageObject::CreateView()
+    {
+        ComPtr<IZipReader> zipReader;
+        HRESULT hr = m_container->QueryInterface(UuidOfImpl<IZipReader>::iid, reinterpret_cast<void**>(&zipReader));
+        return SUCCEEDED(hr) ? zipReader->CreateView() : ComPtr<IStorageObject>();
+    }
+
+    void AppxPackageObject::UnpackFootprintFiles(MSIX_PACKUNPACK_OPTION options, const ComPtr<IDirectoryObject>& to)
+    {
+        IndexFiles();
+        auto targetPrefix = GetUnpackTargetPrefix(options);
+        for (const auto& fileName : m_footprintFiles)
+        {
+            UnpackFile(GetFile(fileName), targetPrefix + Encoding::DecodeFileName(fileName), to, GetUnpackedSize(fileName));
+        }
+    }
+
+    void AppxPackageObject::UnpackPayloadFiles(MSIX_PACKUNPACK_OPTION options, const ComPtr<IDirectoryObject>& to, const ComPtr<IStorageObject>& view)
+    {
+        IndexFiles();
+        auto targetPrefix = GetUnpackTargetPrefix(options);
+        for (const auto& fileName : m_payloadFiles)
+        {
+            auto source = GetPayloadStream(view, fileName, m_payloadBlockMapNames.at(fileName));
+            UnpackFile(source, targetPrefix + Encoding::DecodeFileName(fileName), to, GetUnpackedSize(fileName));
+        }
+    }
 
-                auto targetFile = to->OpenFile(targetName, MSIX::FileStream::Mode::WRITE);
-                auto sourceFile = GetFile(fileName).As<IStream>();
+    void AppxPackageObject::Unpack(MSIX_PACKUNPACK_OPTION options, const ComPtr<IDirectoryObject>& to)
+    {
+        IndexFiles();
+        bool parallel = (options & MSIX_PACKUNPACK_OPTION_PARALLELUNPACK) != 0;
+        auto targetPrefix = GetUnpackTargetPrefix(options);
+        std::vector<std::string> payloadFiles;
 
-                ULARGE_INTEGER bytesCount = {0};
-                bytesCount.QuadPart = std::numeric_limits<std::uint64_t>::max();
-                ThrowHrIfFailed(sourceFile->CopyTo(targetFile.Get(), bytesCount, nullptr, nullptr));
-                deleteFile.release();
+        auto fileNames = GetFileNames(FileNameOptions::All);
+        for (const auto& fileName : fileNames)
+        {   // Don't extract packages files
+            auto file = std::find(std::begin(m_applicablePackagesNames), std::end(m_applicablePackagesNames), fileName);
+            if (file == std::end(m_applicablePackagesNames))
+            {
+                if (parallel && (m_payloadBlockMapNames.find(fileName) != m_payloadBlockMapNames.end()))
+                {
+                    payloadFiles.push_back(fileName);
+                }
+                else
+                {
+                    UnpackFile(GetFile(fileName), targetPrefix + Encoding::DecodeFileName(fileName), to, GetUnpackedSize(fileName));
+                }
             }
         }
 
+        if (!payloadFiles.empty())
+        {
+            UnpackPayloadFilesInParallel(payloadFiles, targetPrefix, to);
+        }
+
 #ifdef BUNDLE_SUPPORT
         if(m_isBundle)
         {
@@ -466,10 +855,18 @@ namespace MSIX {
             {
                 toPackages = to;
             }
-            for(const auto& appx : m_applicablePackages)
+            if (parallel)
+            {   // Packages are already unpacked in parallel, don't start more threads for their files.
+                UnpackPackagesInParallel(static_cast<MSIX_PACKUNPACK_OPTION>((options | MSIX_PACKUNPACK_OPTION_CREATEPACKAGESUBFOLDER) &
+                    ~MSIX_PACKUNPACK_OPTION_PARALLELUNPACK), toPackages);
+            }
+            else
             {
-                appx.As<IPackage>()->Unpack(
-                    static_cast<MSIX_PACKUNPACK_OPTION>(options | MSIX_PACKUNPACK_OPTION_CREATEPACKAGESUBFOLDER), toPackages.Get());
+                for(const auto& appx : m_applicablePackages)
+                {
+                    appx.As<IPackage>()->Unpack(
+                        static_cast<MSIX_PACKUNPACK_OPTION>(options | MSIX_PACKUNPACK_OPTION_CREATEPACKAGESUBFOLDER), toPackages.Get());
+                }
             }
         }
 #endif
@@ -478,6 +875,7 @@ namespace MSIX {
     // IStorageObject
     std::vector<std::string> AppxPackageObject::GetFileNames(FileNameOptions options)
     {
+        IndexFiles();
         std::vector<std::string> result;
 
         if ((options & FileNameOptions::FootPrintOnly) == FileNameOptions::FootPrintOnly)
@@ -508,6 +906,7 @@ namespace MSIX {
 
     ComPtr<IAppxFile> AppxPackageObject::GetAppxFile(const std::string& fileName)
     {
+        IndexFiles();
         auto result = m_files.find(fileName);
         if (result == m_files.end())
         {
@@ -522,7 +921,7 @@ namespace MSIX {
     HRESULT STDMETHODCALLTYPE AppxPackageObject::GetBlockMap(IAppxBlockMapReader** blockMapReader) noexcept try
     {
         ThrowErrorIf(Error::InvalidParameter, (blockMapReader == nullptr || *blockMapReader != nullptr), "bad pointer");
-        *blockMapReader = m_appxBlockMap.As<IAppxBlockMapReader>().Detach();
+        *blockMapReader = GetBlockMapObject().As<IAppxBlockMapReader>().Detach();
         return static_cast<HRESULT>(Error::OK);
     } CATCH_RETURN();
 
@@ -565,7 +964,7 @@ namespace MSIX {
     {
         if (m_isBundle) { return static_cast<HRESULT>(Error::PackageIsBundle); }
         ThrowErrorIf(Error::InvalidParameter,(manifestReader == nullptr || *manifestReader != nullptr), "bad pointer");
-        *manifestReader = m_appxManifest.As<IAppxManifestReader>().Detach();
+        *manifestReader = GetManifestObject().As<IAppxManifestReader>().Detach();
         return static_cast<HRESULT>(Error::OK);
     } CATCH_RETURN();
 
@@ -616,7 +1015,7 @@ namespace MSIX {
         THROW_IF_BUNDLE_NOT_ENABLED
         if (!m_isBundle) { return static_cast<HRESULT>(Error::NotImplemented); }
         ThrowErrorIf(Error::InvalidParameter,(manifestReader == nullptr || *manifestReader != nullptr), "bad pointer");
-        *manifestReader = m_appxBundleManifest.As<IAppxBundleManifestReader>().Detach();
+        *manifestReader = GetManifestObject().As<IAppxBundleManifestReader>().Detach();
         return static_cast<HRESULT>(Error::OK);
     } CATCH_RETURN();
 
@@ -94,7 +94,14 @@ ComPtr<IStream>  AppxSignatureObject::GetValidationStream(const std::string& par
         {   // This stream implementation will throw if the underlying stream does not match the digest
             return ComPtr<IStream>::Make<HashStream>(stream, this->GetCodeIntegrityDigest());
         }
-        // TODO: unnamed stream for central directory?
+        else if (part == std::string(FILE_RECORDS_PART))
+        {   // This stream implementation will throw if the underlying stream does not match the digest
+            return ComPtr<IStream>::Make<HashStream>(stream, this->GetFileRecordsDigest());
+        }
+        else if (part == std::string(CENTRAL_DIRECTORY_PART))
+        {   // This stream implementation will throw if the underlying stream does not match the digest
+            return ComPtr<IStream>::Make<HashStream>(stream, this->GetCentralDirectoryDigest());
+        }
     }
     return stream;
 }
@@ -0,0 +1,270 @@
+//
+//  Copyright (C) 2019 Microsoft.  All rights reserved.
+//  See LICENSE file in the project root for full license information.
+//
+#include "DirectoryUpdater.hpp"
+#include "Exceptions.hpp"
+#include "Encoding.hpp"
+#include "StringHelper.hpp"
+#include "ScopeExit.hpp"
+#include "Crypto.hpp"
+#include "InflateStream.hpp"
+#include "AppxFactory.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <limits>
+
+namespace MSIX {
+
+    static const char* TemporarySuffix = ".msixupdate";
+
+    static bool FileExists(const std::string& name)
+    {
+        auto file = std::fopen(name.c_str(), "rb");
+        if (file == nullptr)
+        {
+            return false;
+        }
+        std::fclose(file);
+        return true;
+    }
+
+    static bool HashMatches(const std::vector<std::uint8_t>& block, const std::array<std::uint8_t, BLOCKMAP_HASH_SIZE>& hash)
+    {
+        std::vector<std::uint8_t> blockHash;
+        ThrowErrorIfNot(Error::BlockMapInvalidData,
+            SHA256::ComputeHash(block.data(), static_cast<std::uint32_t>(block.size()), blockHash), "Failed computing hash");
+        return std::equal(blockHash.begin(), blockHash.end(), hash.begin(), hash.end());
+    }
+
+    DirectoryUpdater::DirectoryUpdater(IMsixFactory* factory, const ComPtr<IAppxPackageReader>& package,
+        const ComPtr<IStream>& packageStream, const std::string& directory) : m_factory(factory), m_package(package), m_root(directory)
+    {
+        // Fails with PackageIsBundle for bundles
+        ComPtr<IAppxManifestReader> manifest;
+        ThrowHrIfFailed(package->GetManifest(&manifest));
+        ComPtr<IAppxBlockMapReader> blockMap;
+        ThrowHrIfFailed(package->GetBlockMap(&blockMap));
+        m_blockMap = blockMap.As<IAppxBlockMapInternal>();
+
+        // Blocks are read from the package as they are stored, without inflating the whole file
+        ComPtr<IStream> stream;
+        if (FAILED(packageStream->Clone(&stream)))
+        {
+            stream = packageStream;
+        }
+        m_zip = ComPtr<IZipReader>::Make<ZipObjectReader>(stream);
+        m_directory = ComPtr<IDirectoryObject>::Make<DirectoryObject>(m_root);
+    }
+
+    void DirectoryUpdater::Update()
+    {
+        IndexLocalBlocks();
+
+        auto blockMapFiles = m_blockMap->GetFileNames();
+        std::set<std::string> blockMapNames(blockMapFiles.begin(), blockMapFiles.end());
+        std::set<std::string> newFiles;
+        std::vector<std::string> written;
+        auto deleteFiles = MSIX::scope_exit([this, &written]
+        {
+            for (const auto& fileName : written)
+            {
+                std::remove((m_root + "/" + fileName + TemporarySuffix).c_str());
+            }
+        });
+
+        // Unpack writes the same files
+        auto storage = m_package.As<IStorageObject>();
+        for (const auto& fileName : storage->GetFileNames(FileNameOptions::All))
+        {
+            auto targetName = Encoding::DecodeFileName(fileName);
+            auto blockMapName = Helper::toBackSlash(targetName);
+            written.push_back(targetName);
+            newFiles.insert(targetName);
+            if (blockMapNames.find(blockMapName) != blockMapNames.end())
+            {
+                UINT64 size = 0;
+                ThrowHrIfFailed(m_blockMap->GetFile(blockMapName)->GetUncompressedSize(&size));
+                WriteFile(fileName, blockMapName, m_directory->OpenFileForWrite(targetName + TemporarySuffix, size));
+            }
+            else
+            {   // Footprint files that aren't in the block map are small, read them from the package.
+                CopyFile(storage->GetFile(fileName), m_directory->OpenFile(targetName + TemporarySuffix, FileStream::Mode::WRITE));
+            }
+        }
+
+        // Nothing else is read from the directory, replace the old files
+        m_localFiles.clear();
+        CommitFiles(written);
+        deleteFiles.release();
+
+        // Remove the files of the previous version that aren't in the new one. Files that weren't part of it stay.
+        for (auto fileName : { APPXBLOCKMAP_XML, APPXSIGNATURE_P7X, CODEINTEGRITY_CAT })
+        {
+            m_localFileNames.push_back(fileName);
+        }
+        for (const auto& fileName : m_localFileNames)
+        {
+            if (newFiles.find(fileName) == newFiles.end())
+            {
+                std::remove((m_root + "/" + fileName).c_str());
+            }
+        }
+    }
+
+    void DirectoryUpdater::IndexLocalBlocks()
+    {
+        auto blockMapName = m_root + "/" + APPXBLOCKMAP_XML;
+        ThrowErrorIfNot(Error::MissingAppxBlockMapXML, FileExists(blockMapName), "The directory doesn't have an AppxBlockMap.xml");
+        auto stream = ComPtr<IStream>::Make<FileStream>(blockMapName, FileStream::Mode::READ);
+        auto localBlockMap = ComPtr<IAppxBlockMapInternal>::Make<AppxBlockMapObject>(m_factory.Get(), stream);
+
+        for (const auto& name : localBlockMap->GetFileNames())
+        {
+            auto fileName = name;
+            std::replace(fileName.begin(), fileName.end(), '\\', '/');
+            m_localFileNames.push_back(fileName);
+            if (!FileExists(m_root + "/" + fileName))
+            {
+                continue;
+            }
+
+            // The block map of the directory only tells where a block might be, every block is checked when it is read
+            UINT64 fileSize = 0;
+            ThrowHrIfFailed(localBlockMap->GetFile(name)->GetUncompressedSize(&fileSize));
+            std::uint64_t offset = 0;
+            for (const auto& block : localBlockMap->GetBlocks(name))
+            {
+                if (offset >= fileSize)
+                {
+                    break;
+                }
+                m_localBlocks.emplace(block.hash, LocalBlock{ fileName, offset, std::min<std::uint64_t>(fileSize - offset, BLOCKMAP_BLOCK_SIZE) });
+                offset += BLOCKMAP_BLOCK_SIZE;
+            }
+        }
+    }
+
+    void DirectoryUpdater::WriteFile(const std::string& containerName, const std::string& blockMapName, const ComPtr<IStream>& target)
+    {
+        UINT64 fileSize = 0;
+        ThrowHrIfFailed(m_blockMap->GetFile(blockMapName)->GetUncompressedSize(&fileSize));
+        auto blocks = m_blockMap->GetBlocks(blockMapName);
+        ThrowErrorIf(Error::BlockMapSemanticError, (blocks.size() != (fileSize + BLOCKMAP_BLOCK_SIZE - 1) / BLOCKMAP_BLOCK_SIZE),
+            "The number of blocks doesn't match the size of the file");
+
+        auto rawFile = m_zip->GetRawFile(containerName);
+        ThrowErrorIfNot(Error::FileNotFound, rawFile, "File described in blockmap not contained in OPC container");
+        bool isCompressed = rawFile.As<IStreamInternal>()->IsCompressed();
+
+        std::uint64_t rawOffset = 0;
+        std::uint64_t offset = 0;
+        std::vector<std::uint8_t> block;
+        for (const auto& blockInfo : blocks)
+        {
+            block.resize(static_cast<std::size_t>(std::min<std::uint64_t>(fileSize - offset, BLOCKMAP_BLOCK_SIZE)));
+            // Blocks of a stored file don't have a size in the block map
+            auto rawSize = isCompressed ? blockInfo.compressedSize : block.size();
+            if (!ReadLocalBlock(blockInfo.hash, block) &&
+                !ReadPackageBlock(rawFile, rawOffset, rawSize, isCompressed, blockInfo.hash, block))
+            {   // The block can't be read by itself, read the whole file from the package instead. This also reports
+                // the file if the package is corrupt.
+                ThrowHrIfFailed(target->Seek({0}, StreamBase::Reference::START, nullptr));
+                CopyFile(m_package.As<IStorageObject>()->GetFile(containerName), target);
+                m_bytesRead += rawFile.As<IStreamInternal>()->GetSize() - rawOffset;
+                return;
+            }
+            ULONG bytesWritten = 0;
+            ThrowHrIfFailed(target->Write(block.data(), static_cast<ULONG>(block.size()), &bytesWritten));
+            ThrowErrorIf(Error::FileWrite, (bytesWritten != block.size()), "Failed to write file");
+            rawOffset += rawSize;
+            offset += block.size();
+        }
+    }
+
+    void DirectoryUpdater::CopyFile(const ComPtr<IStream>& source, const ComPtr<IStream>& target)
+    {
+        ULARGE_INTEGER bytesCount = {0};
+        bytesCount.QuadPart = std::numeric_limits<std::uint64_t>::max();
+        ThrowHrIfFailed(source->CopyTo(target.Get(), bytesCount, nullptr, nullptr));
+    }
+
+    bool DirectoryUpdater::ReadLocalBlock(const std::array<std::uint8_t, BLOCKMAP_HASH_SIZE>& hash, std::vector<std::uint8_t>& block)
+    {
+        auto localBlock = m_localBlocks.find(hash);
+        if (localBlock == m_localBlocks.end() || localBlock->second.size != block.size())
+        {
+            return false;
+        }
+
+        auto& file = m_localFiles[localBlock->second.fileName];
+        if (!file)
+        {
+            file = ComPtr<IStream>::Make<FileStream>(m_root + "/" + localBlock->second.fileName, FileStream::Mode::READ);
+        }
+        LARGE_INTEGER pos = {0};
+        pos.QuadPart = static_cast<LONGLONG>(localBlock->second.offset);
+        ThrowHrIfFailed(file->Seek(pos, StreamBase::Reference::START, nullptr));
+        ULONG bytesRead = 0;
+        ThrowHrIfFailed(file->Read(block.data(), static_cast<ULONG>(block.size()), &bytesRead));
+
+        // The file might have changed since it was unpacked
+        if (bytesRead != block.size() || !HashMatches(block, hash))
+        {
+            return false;
+        }
+        m_bytesCopied += block.size();
+        return true;
+    }
+
+    bool DirectoryUpdater::ReadPackageBlock(const ComPtr<IStream>& rawFile, std::uint64_t offset, std::uint64_t size, bool isCompressed,
+        const std::array<std::uint8_t, BLOCKMAP_HASH_SIZE>& hash, std::vector<std::uint8_t>& block)
+    {
+        // A deflated block is never much larger than the block
+        if (size > 2 * BLOCKMAP_BLOCK_SIZE)
+        {
+            return false;
+        }
+        std::vector<std::uint8_t> data(static_cast<std::size_t>(size));
+        LARGE_INTEGER pos = {0};
+        pos.QuadPart = static_cast<LONGLONG>(offset);
+        ThrowHrIfFailed(rawFile->Seek(pos, StreamBase::Reference::START, nullptr));
+        ULONG bytesRead = 0;
+        ThrowHrIfFailed(rawFile->Read(data.data(), static_cast<ULONG>(data.size()), &bytesRead));
+        if (bytesRead != data.size())
+        {
+            return false;
+        }
+        m_bytesRead += data.size();
+
+        if (!isCompressed)
+        {
+            block = std::move(data);
+        }
+        else
+        {   // Packages are written with every block ending in a full flush, so a block inflates by itself.
+            // Blocks of packages written otherwise fail here or don't match their hash.
+            if (!InflateBlock(data.data(), data.size(), block))
+            {
+                return false;
+            }
+        }
+        return HashMatches(block, hash);
+    }
+
+    void DirectoryUpdater::CommitFiles(std::vector<std::string>& files)
+    {
+        while (!files.empty())
+        {
+            auto target = m_root + "/" + files.back();
+            auto temporary = target + TemporarySuffix;
+            #ifdef WIN32
+            // rename doesn't replace existing files on Windows
+            std::remove(target.c_str());
+            #endif
+            ThrowErrorIf(Error::FileWrite, (std::rename(temporary.c_str(), target.c_str()) != 0), "Failed to replace file");
+            files.pop_back();
+        }
+    }
+}
@@ -6,11 +6,13 @@
 #include "ZipFileStream.hpp"
 #include "InflateStream.hpp"
 #include "StreamBase.hpp"
+#include "Crypto.hpp"
 
 #include <cassert>
 #include <algorithm>
 #include <cstring>
 #include <array>
+#include <memory>
 #include <utility>
 
 namespace MSIX {
@@ -31,10 +33,16 @@ namespace MSIX {
         // State::UNINITIALIZED
         InflateHandler([](InflateStream* self, void*, ULONG)
         {
-            ThrowHrIfFailed(self->m_stream->Seek({0}, StreamBase::START, nullptr));
-            self->m_fileCurrentPosition = 0;
-            self->m_fileCurrentWindowPositionEnd = 0;
+            LARGE_INTEGER li = {0};
+            li.QuadPart = static_cast<LONGLONG>(self->m_restartSourcePosition);
+            ThrowHrIfFailed(self->m_stream->Seek(li, StreamBase::START, nullptr));
+            self->m_fileCurrentPosition = self->m_restartPosition;
+            self->m_fileCurrentWindowPositionEnd = self->m_restartPosition;
 
+            if (!self->m_compressionObject)
+            {
+                self->m_compressionObject = AcquireCompressionObject();
+            }
             self->m_compressionStatus = self->m_compressionObject->Initialize(CompressionOperation::Inflate);
             ThrowErrorIfNot(Error::InflateInitialize, (self->m_compressionStatus == CompressionStatus::Ok), "compression_stream_init failed");
             return std::make_pair(true, InflateStream::State::READY_TO_READ);
@@ -45,7 +53,10 @@ namespace MSIX {
         {
             ThrowErrorIfNot(Error::InflateRead,(self->m_compressionObject->GetAvailableSourceSize() == 0), "uninflated bytes overwritten");
             ULONG available = 0;
-            self->m_compressedBuffer = std::make_unique<std::vector<std::uint8_t>>(BufferSize);
+            if (!self->m_compressedBuffer)
+            {
+                self->m_compressedBuffer = std::make_unique<std::vector<std::uint8_t>>(BufferSize);
+            }
             ThrowHrIfFailed(self->m_stream->Read(self->m_compressedBuffer->data(), static_cast<ULONG>(self->m_compressedBuffer->size()), &available));
             ThrowErrorIf(Error::FileRead, (available == 0), "Getting nothing back is unexpected here.");
             self->m_compressionObject->SetInput(self->m_compressedBuffer->data(), static_cast<size_t>(available));
@@ -53,9 +64,39 @@ namespace MSIX {
         }), // State::READY_TO_READ
 
         // State::READY_TO_INFLATE
-        InflateHandler([](InflateStream* self, void*, ULONG)
+        InflateHandler([](InflateStream* self, void* buffer, ULONG countBytes)
         {
-            self->m_inflateWindow = std::make_unique<std::vector<std::uint8_t>>(BufferSize);
+            // When nothing needs to be skipped and the caller wants at least a window, inflate straight into
+            // the caller's buffer instead of copying the window to it.
+            auto remaining = self->m_uncompressedSize - self->m_fileCurrentPosition;
+            if ((countBytes >= BufferSize) && (remaining > 0) &&
+                (self->m_fileCurrentPosition == self->m_seekPosition) && (self->m_fileCurrentWindowPositionEnd == self->m_seekPosition))
+            {
+                auto size = static_cast<ULONG>(std::min<std::uint64_t>(countBytes, remaining));
+                self->m_compressionObject->SetOutput(static_cast<std::uint8_t*>(buffer), size);
+                self->m_compressionStatus = self->m_compressionObject->Inflate();
+                if (self->m_compressionStatus == CompressionStatus::Error)
+                {
+                    self->Cleanup();
+                    ThrowErrorIfNot(Error::InflateCorruptData, false, "inflate failed unexpectedly.");
+                }
+                auto inflated = size - static_cast<ULONG>(self->m_compressionObject->GetAvailableDestinationSize());
+                self->m_bytesRead                    += inflated;
+                self->m_seekPosition                 += inflated;
+                self->m_fileCurrentPosition          += inflated;
+                self->m_fileCurrentWindowPositionEnd += inflated;
+                if (self->m_fileCurrentPosition == self->m_uncompressedSize)
+                {
+                    self->Cleanup();
+                    return std::make_pair(false, InflateStream::State::UNINITIALIZED);
+                }
+                return std::make_pair(true, (self->m_compressionObject->GetAvailableDestinationSize() == 0) ? InflateStream::State::READY_TO_INFLATE : InflateStream::State::READY_TO_READ);
+            }
+
+            if (!self->m_inflateWindow)
+            {
+                self->m_inflateWindow = std::make_unique<std::vector<std::uint8_t>>(BufferSize);
+            }
             self->m_inflateWindowPosition = 0;
             self->m_compressionObject->SetOutput(self->m_inflateWindow->data(), self->m_inflateWindow->size());
             self->m_compressionStatus = self->m_compressionObject->Inflate();
@@ -83,8 +124,9 @@ namespace MSIX {
                 return std::make_pair(true, InflateStream::State::CLEANUP);
             }
 
-            // If the end of the current window position is less than the seek position, keep inflating
-            if (self->m_fileCurrentWindowPositionEnd < self->m_seekPosition)
+            // If the seek position isn't within the current window, keep inflating. A seek position at the end of
+            // the window is the start of the next one.
+            if (self->m_fileCurrentWindowPositionEnd <= self->m_seekPosition)
             {
                 self->m_fileCurrentPosition = self->m_fileCurrentWindowPositionEnd;
                 return std::make_pair(true, (self->m_compressionObject->GetAvailableDestinationSize() == 0) ? InflateStream::State::READY_TO_INFLATE : InflateStream::State::READY_TO_READ);
@@ -137,7 +179,6 @@ namespace MSIX {
         m_state(State::UNINITIALIZED),
         m_uncompressedSize(uncompressedSize)
     {
-        m_compressionObject = CreateCompressionObject();
     }
 
     InflateStream::~InflateStream()
@@ -189,12 +230,19 @@ namespace MSIX {
             m_seekPosition = seekPosition.QuadPart;
             // If the caller is trying to seek back to an earlier
             // point in the inflated stream, we will need to reset
-            // zlib and start inflating from the beginning of the
-            // stream; otherwise, seeking forward is fine: We will
-            // catch up to the seek pointer during the ::Read operation.
-            if (m_seekPosition < m_fileCurrentPosition)
+            // zlib and start inflating from the closest checkpoint,
+            // or from the beginning of the stream; otherwise, seeking
+            // forward is fine: We will catch up to the seek pointer
+            // during the ::Read operation, unless there is a checkpoint
+            // between what is inflated and the seek pointer.
+            bool seekBack = (m_seekPosition < m_fileCurrentPosition);
+            auto inflated = (m_state == State::UNINITIALIZED) ? m_restartPosition : m_fileCurrentWindowPositionEnd;
+            auto checkpoint = FindCheckpoint(m_seekPosition, seekBack ? 0 : inflated);
+            if (seekBack || checkpoint)
             {
-                m_fileCurrentPosition = 0;
+                m_restartPosition = checkpoint ? checkpoint->offset : 0;
+                m_restartSourcePosition = checkpoint ? checkpoint->source.offset : 0;
+                m_fileCurrentPosition = m_restartPosition;
                 Cleanup();
             }
         }
@@ -202,11 +250,85 @@ namespace MSIX {
         return static_cast<HRESULT>(Error::OK);
     } CATCH_RETURN();
 
+    void InflateStream::SetCheckpoints(const std::vector<StreamCheckpoint>& checkpoints)
+    {
+        m_checkpoints = checkpoints;
+        std::sort(m_checkpoints.begin(), m_checkpoints.end(),
+            [](const StreamCheckpoint& a, const StreamCheckpoint& b) { return a.offset < b.offset; });
+        m_checkpointVerified.assign(m_checkpoints.size(), false);
+    }
+
+    // Returns the last checkpoint at or before position and after after, nullptr if there isn't one that can be used.
+    const StreamCheckpoint* InflateStream::FindCheckpoint(std::uint64_t position, std::uint64_t after)
+    {
+        auto next = std::upper_bound(m_checkpoints.begin(), m_checkpoints.end(), position,
+            [](std::uint64_t value, const StreamCheckpoint& checkpoint) { return value < checkpoint.offset; });
+        if (next == m_checkpoints.begin())
+        {
+            return nullptr;
+        }
+        auto index = static_cast<std::size_t>(std::distance(m_checkpoints.begin(), next) - 1);
+        const auto& checkpoint = m_checkpoints[index];
+        if (checkpoint.offset <= after)
+        {
+            return nullptr;
+        }
+        if (!m_checkpointVerified[index])
+        {
+            if (!VerifyCheckpoint(checkpoint))
+            {   // The stream wasn't compressed with a full flush at the end of every block, so its blocks
+                // depend on the data before them. Inflate it from the beginning as if it had no checkpoints.
+                m_checkpoints.clear();
+                m_checkpointVerified.clear();
+                return nullptr;
+            }
+            m_checkpointVerified[index] = true;
+        }
+        return &checkpoint;
+    }
+
+    // A checkpoint can be used when its data inflates by itself. The compressed stream is read, but the position
+    // of the underlying stream is restored.
+    bool InflateStream::VerifyCheckpoint(const StreamCheckpoint& checkpoint)
+    {
+        // Deflated data is never much larger than the data
+        if (checkpoint.source.size == 0 || checkpoint.source.size > 2 * checkpoint.size + BufferSize)
+        {
+            return false;
+        }
+
+        ULARGE_INTEGER position = {0};
+        ThrowHrIfFailed(m_stream->Seek({0}, StreamBase::CURRENT, &position));
+        std::vector<std::uint8_t> compressed(static_cast<std::size_t>(checkpoint.source.size));
+        LARGE_INTEGER li = {0};
+        li.QuadPart = static_cast<LONGLONG>(checkpoint.source.offset);
+        ThrowHrIfFailed(m_stream->Seek(li, StreamBase::START, nullptr));
+        ULONG bytesRead = 0;
+        ThrowHrIfFailed(m_stream->Read(compressed.data(), static_cast<ULONG>(compressed.size()), &bytesRead));
+        li.QuadPart = static_cast<LONGLONG>(position.QuadPart);
+        ThrowHrIfFailed(m_stream->Seek(li, StreamBase::START, nullptr));
+        if (bytesRead != compressed.size())
+        {
+            return false;
+        }
+
+        std::vector<std::uint8_t> inflated(static_cast<std::size_t>(checkpoint.size));
+        if (!InflateBlock(compressed.data(), compressed.size(), inflated))
+        {
+            return false;
+        }
+        std::vector<std::uint8_t> hash;
+        ThrowErrorIfNot(Error::InflateRead,
+            SHA256::ComputeHash(inflated.data(), static_cast<std::uint32_t>(inflated.size()), hash), "Failed computing hash");
+        return std::equal(hash.begin(), hash.end(), checkpoint.hash.begin(), checkpoint.hash.end());
+    }
+
     void InflateStream::Cleanup()
     {
         if (m_state != State::UNINITIALIZED)
-        {
+        {   // The stream keeps its buffers, but another stream can use the inflate until this one starts over
             m_compressionObject->Cleanup();
+            ReleaseCompressionObject(std::move(m_compressionObject));
             m_state = State::UNINITIALIZED;
         }
     }
@@ -0,0 +1,199 @@
+//
+//  Copyright (C) 2019 Microsoft.  All rights reserved.
+//  See LICENSE file in the project root for full license information.
+//
+#include "ParallelInflateStream.hpp"
+#include "InflateStream.hpp"
+#include "Crypto.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <exception>
+#include <utility>
+
+namespace MSIX {
+
+    const std::size_t ParallelInflateStream::MinimumBlockCount;
+
+    ParallelInflateStream::ParallelInflateStream(const ComPtr<IStream>& rawStream, const BlockRange& blocks, std::uint64_t size,
+        const ComPtr<IStream>& fallback, const std::shared_ptr<ThreadPool>& threadPool) : m_rawStream(rawStream), m_fallback(fallback),
+        m_threadPool(threadPool), m_blocks(blocks.begin(), blocks.end()), m_size(size)
+    {
+        m_blockCount = static_cast<std::size_t>((size + BLOCKMAP_BLOCK_SIZE - 1) / BLOCKMAP_BLOCK_SIZE);
+        // The block map stream reports files that don't match their blocks
+        m_useFallback = (m_blockCount != blocks.size());
+        std::uint64_t offset = 0;
+        for (const auto& block : blocks)
+        {
+            m_compressedOffsets.push_back(offset);
+            offset += block.compressedSize;
+        }
+    }
+
+    // IStream
+    HRESULT STDMETHODCALLTYPE ParallelInflateStream::Read(void* buffer, ULONG countBytes, ULONG* bytesRead) noexcept try
+    {
+        if (bytesRead) { *bytesRead = 0; }
+        ThrowErrorIf(Error::InvalidParameter, (buffer == nullptr && countBytes != 0), "bad pointer");
+        ULONG total = 0;
+        while (total < countBytes && m_position < m_size)
+        {
+            if (m_useFallback)
+            {
+                LARGE_INTEGER pos = {0};
+                pos.QuadPart = static_cast<LONGLONG>(m_position);
+                ThrowHrIfFailed(m_fallback->Seek(pos, StreamBase::Reference::START, nullptr));
+                ULONG read = 0;
+                ThrowHrIfFailed(m_fallback->Read(static_cast<std::uint8_t*>(buffer) + total, countBytes - total, &read));
+                total += read;
+                m_position += read;
+                break;
+            }
+
+            auto index = static_cast<std::size_t>(m_position / BLOCKMAP_BLOCK_SIZE);
+            if (m_current.empty() || m_currentIndex != index)
+            {
+                ReadBlock(index);
+                continue;
+            }
+            auto offsetInBlock = static_cast<std::size_t>(m_position - index * BLOCKMAP_BLOCK_SIZE);
+            auto toCopy = std::min(static_cast<std::size_t>(countBytes - total), m_current.size() - offsetInBlock);
+            std::memcpy(static_cast<std::uint8_t*>(buffer) + total, m_current.data() + offsetInBlock, toCopy);
+            total += static_cast<ULONG>(toCopy);
+            m_position += toCopy;
+        }
+        if (bytesRead) { *bytesRead = total; }
+        return (countBytes == total) ? S_OK : S_FALSE;
+    } CATCH_RETURN();
+
+    HRESULT STDMETHODCALLTYPE ParallelInflateStream::Seek(LARGE_INTEGER move, DWORD origin, ULARGE_INTEGER* newPosition) noexcept try
+    {
+        LONGLONG newPos = move.QuadPart;
+        switch (origin)
+        {
+            case Reference::CURRENT:
+                newPos += static_cast<LONGLONG>(m_position);
+                break;
+            case Reference::END:
+                newPos += static_cast<LONGLONG>(m_size);
+                break;
+        }
+        ThrowErrorIf(Error::FileSeek, (newPos < 0), "seek failed");
+        m_position = std::min(static_cast<std::uint64_t>(newPos), m_size);
+        if (newPosition) { newPosition->QuadPart = m_position; }
+        return static_cast<HRESULT>(Error::OK);
+    } CATCH_RETURN();
+
+    void ParallelInflateStream::ReadBlock(std::size_t index)
+    {
+        // Blocks ahead of the position are already submitted unless the caller seeked somewhere else
+        while (!m_pending.empty() && m_pending.front().index < index)
+        {
+            m_pending.pop_front();
+        }
+        if (!m_pending.empty() && m_pending.front().index != index)
+        {
+            m_pending.clear();
+        }
+        SubmitBlocks(m_pending.empty() ? index : m_pending.back().index + 1);
+
+        auto block = m_pending.front().block.get();
+        m_pending.pop_front();
+        ThrowErrorIf(Error::BlockMapInvalidData, block.corrupt, "Block doesn't match its hash in the block map");
+        if (block.data.empty())
+        {   // Blocks abandoned here are still inflated by the pool, but nothing waits for them
+            m_useFallback = true;
+            m_pending.clear();
+            m_current.clear();
+            return;
+        }
+        m_current = std::move(block.data);
+        m_currentIndex = index;
+    }
+
+    void ParallelInflateStream::SubmitBlocks(std::size_t first)
+    {
+        // Blocks are inflated and hashed a batch at a time, so the hashes of a batch are computed together
+        auto batchSize = SHA256::GetParallelHashCount();
+        auto window = std::max(m_threadPool->GetThreadCount() * 2, static_cast<std::size_t>(1)) * batchSize;
+        std::vector<BatchBlock> batch;
+        for (auto index = first; (index < m_blockCount) && (m_pending.size() + batch.size() < window); index++)
+        {
+            const auto& block = m_blocks[index];
+            auto size = std::min(m_size - index * BLOCKMAP_BLOCK_SIZE, BLOCKMAP_BLOCK_SIZE);
+            // Deflated data is never much larger than the data, the block map is wrong
+            if (block.compressedSize == 0 || block.compressedSize > 2 * BLOCKMAP_BLOCK_SIZE)
+            {
+                SubmitBatch(batch);
+                std::promise<InflatedBlock> unusable;
+                unusable.set_value({ std::vector<std::uint8_t>(), false });
+                m_pending.push_back({ index, unusable.get_future() });
+                return;
+            }
+
+            std::vector<std::uint8_t> compressed(static_cast<std::size_t>(block.compressedSize));
+            LARGE_INTEGER pos = {0};
+            pos.QuadPart = static_cast<LONGLONG>(m_compressedOffsets[index]);
+            ThrowHrIfFailed(m_rawStream->Seek(pos, StreamBase::Reference::START, nullptr));
+            ULONG bytesRead = 0;
+            ThrowHrIfFailed(m_rawStream->Read(compressed.data(), static_cast<ULONG>(compressed.size()), &bytesRead));
+            ThrowErrorIf(Error::FileRead, (bytesRead != compressed.size()), "Did not read as much as requested.");
+
+            batch.push_back({ index, std::move(compressed), static_cast<std::size_t>(size), block.hash, std::promise<InflatedBlock>() });
+            if (batch.size() == batchSize)
+            {
+                SubmitBatch(batch);
+            }
+        }
+        SubmitBatch(batch);
+    }
+
+    void ParallelInflateStream::SubmitBatch(std::vector<BatchBlock>& batch)
+    {
+        if (batch.empty())
+        {
+            return;
+        }
+        for (auto& block : batch)
+        {
+            m_pending.push_back({ block.index, block.inflated.get_future() });
+        }
+        m_threadPool->Submit([batch = std::move(batch)]() mutable
+        {
+            try
+            {
+                std::vector<std::vector<std::uint8_t>> inflated(batch.size());
+                std::vector<std::pair<const std::uint8_t*, std::uint32_t>> buffers;
+                for (std::size_t i = 0; i < batch.size(); i++)
+                {
+                    inflated[i].resize(batch[i].size);
+                    if (!InflateBlock(batch[i].compressed.data(), batch[i].compressed.size(), inflated[i]))
+                    {
+                        break;
+                    }
+                    buffers.emplace_back(inflated[i].data(), static_cast<std::uint32_t>(inflated[i].size()));
+                }
+                std::vector<std::vector<std::uint8_t>> hashes;
+                SHA256::ComputeHashes(buffers, hashes);
+
+                // The blocks after one that can't be used aren't needed
+                bool usable = true;
+                for (std::size_t i = 0; i < batch.size(); i++)
+                {
+                    bool inflatedByItself = usable && (i < hashes.size());
+                    usable = inflatedByItself &&
+                        std::equal(hashes[i].begin(), hashes[i].end(), batch[i].hash.begin(), batch[i].hash.end());
+                    batch[i].inflated.set_value({ usable ? std::move(inflated[i]) : std::vector<std::uint8_t>(), inflatedByItself && !usable });
+                }
+            }
+            catch (...)
+            {   // Nothing was returned yet
+                for (auto& block : batch)
+                {
+                    block.inflated.set_exception(std::current_exception());
+                }
+            }
+        });
+        batch.clear();
+    }
+}
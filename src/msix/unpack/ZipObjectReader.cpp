@@ -8,7 +8,10 @@
 #include "ZipFileStream.hpp"
 #include "InflateStream.hpp"
 #include "VectorStream.hpp"
+#include "RangeStream.hpp"
+#include "Crypto.hpp"
 
+#include <iterator>
 #include <vector>
 
 namespace MSIX {
@@ -66,6 +69,24 @@ namespace MSIX {
             auto current = StreamBase::Pos(buffer);
             ThrowErrorIfNot(Error::ZipHiddenData, (current == data.size()), "hidden data unsupported");
         }
+
+        // Streams that are expensive to read read the file records ahead, in the order they are stored. Packages
+        // store their payload files in block map order.
+        auto internal = GetStreamInternal();
+        if (internal)
+        {
+            std::vector<ByteRange> ranges;
+            for (const auto& range : GetFileRecordRanges())
+            {
+                ranges.push_back(range.second);
+            }
+            internal->SetReadOrder(ranges);
+        }
+    }
+
+    ZipObjectReader::ZipObjectReader(const ZipObject& zipObject, const ComPtr<IStream>& stream) : ZipObject(zipObject)
+    {
+        m_stream = stream;
     }
 
     // IStoreageObject
@@ -83,6 +104,7 @@ namespace MSIX {
     // Not finding a file is non-fatal
     ComPtr<IStream> ZipObjectReader::GetFile(const std::string& fileName)
     {
+        std::lock_guard<std::mutex> lock(m_streamsMutex);
         auto result = m_streams.find(fileName);
         if (result == m_streams.end())
         {
@@ -91,19 +113,7 @@ namespace MSIX {
             {
                 return ComPtr<IStream>();
             }
-            LARGE_INTEGER pos = {0};
-            pos.QuadPart = centralFileHeader->second.GetRelativeOffsetOfLocalHeader();
-            ThrowHrIfFailed(m_stream->Seek(pos, MSIX::StreamBase::Reference::START, nullptr));
-            LocalFileHeader lfh;
-            lfh.Read(m_stream.Get(), centralFileHeader->second);
-
-            auto fileStream = ComPtr<IStream>::Make<ZipFileStream>(
-                centralFileHeader->first,
-                centralFileHeader->second.GetCompressionMethod() == CompressionType::Deflate,
-                centralFileHeader->second.GetRelativeOffsetOfLocalHeader() + lfh.Size(),
-                centralFileHeader->second.GetCompressedSize(),
-                m_stream.Get()
-            );
+            auto fileStream = CreateRawFileStream(centralFileHeader->first, centralFileHeader->second);
 
             if (centralFileHeader->second.GetCompressionMethod() == CompressionType::Deflate)
             {
@@ -120,4 +130,209 @@ namespace MSIX {
     {
         return m_stream.As<IStreamInternal>()->GetName();
     }
+
+    // IZipReader
+    ComPtr<IStorageObject> ZipObjectReader::CreateView()
+    {
+        ComPtr<IStream> stream;
+        if (FAILED(m_stream->Clone(&stream)))
+        {
+            return ComPtr<IStorageObject>();
+        }
+        return ComPtr<IStorageObject>::Make<ZipObjectReader>(static_cast<const ZipObject&>(*this), stream);
+    }
+
+    ComPtr<IStream> ZipObjectReader::GetFileRecordsStream(const std::string& signatureFile)
+    {
+        auto signature = m_centralDirectories.find(signatureFile);
+        ThrowErrorIf(Error::FileNotFound, (signature == m_centralDirectories.end()), "signature file not in archive");
+        auto signatureOffset = signature->second.GetRelativeOffsetOfLocalHeader();
+        for (auto& centralFileHeader : m_centralDirectories)
+        {
+            ThrowErrorIf(Error::SignatureInvalid, (centralFileHeader.second.GetRelativeOffsetOfLocalHeader() > signatureOffset),
+                "file record after the signature file isn't covered by the signature");
+        }
+        return ComPtr<IStream>::Make<RangeStream>(0, signatureOffset, m_stream.Get(), m_streamLock);
+    }
+
+    ComPtr<IStream> ZipObjectReader::GetCentralDirectoryStream(const std::string& signatureFile)
+    {
+        auto signature = m_centralDirectories.find(signatureFile);
+        ThrowErrorIf(Error::FileNotFound, (signature == m_centralDirectories.end()), "signature file not in archive");
+        auto signatureOffset = signature->second.GetRelativeOffsetOfLocalHeader();
+
+        bool isZip64 = m_endCentralDirectoryRecord.GetIsZip64();
+        std::uint64_t offsetStartOfCD = 0;
+        std::uint64_t endOfCD = 0;
+        std::uint64_t totalNumberOfEntries = 0;
+        if (!isZip64)
+        {
+            offsetStartOfCD = m_endCentralDirectoryRecord.GetStartOfCentralDirectory();
+            totalNumberOfEntries = m_endCentralDirectoryRecord.GetNumberOfCentralDirectoryEntries();
+            endOfCD = offsetStartOfCD + m_endCentralDirectoryRecord.GetSizeOfCentralDirectory();
+        }
+        else
+        {
+            offsetStartOfCD = m_zip64EndOfCentralDirectory.GetOffsetStartOfCD();
+            endOfCD = m_zip64Locator.GetRelativeOffset();
+            totalNumberOfEntries = m_zip64EndOfCentralDirectory.GetTotalNumberOfEntries();
+        }
+
+        std::vector<std::uint8_t> data(static_cast<std::size_t>(endOfCD - offsetStartOfCD), 0);
+        {
+            std::lock_guard<std::mutex> streamLock(*m_streamLock);
+            LARGE_INTEGER pos = {0};
+            pos.QuadPart = offsetStartOfCD;
+            ThrowHrIfFailed(m_stream->Seek(pos, StreamBase::Reference::START, nullptr));
+            StreamBase::ReadData(m_stream, data);
+        }
+
+        // Keep the central directory headers in their original order, without the one of the signature file
+        std::vector<std::uint8_t> result;
+        result.reserve(data.size());
+        auto buffer = ComPtr<IStream>::Make<VectorStream>(&data);
+        std::uint64_t start = 0;
+        for (std::uint64_t index = 0; index < totalNumberOfEntries; index++)
+        {
+            CentralDirectoryFileHeader centralFileHeader;
+            centralFileHeader.Read(buffer.Get(), offsetStartOfCD, isZip64);
+            auto end = StreamBase::Pos(buffer);
+            if (centralFileHeader.GetFileName() != signatureFile)
+            {
+                result.insert(result.end(), data.begin() + static_cast<std::ptrdiff_t>(start), data.begin() + static_cast<std::ptrdiff_t>(end));
+            }
+            start = end;
+        }
+
+        // The end of central directory records describe the central directory without the signature file,
+        // which started where the signature file is now.
+        auto numberOfEntries = totalNumberOfEntries - 1;
+        auto sizeOfCD = static_cast<std::uint64_t>(result.size());
+        if (isZip64)
+        {
+            auto zip64EndOfCentralDirectory = m_zip64EndOfCentralDirectory;
+            zip64EndOfCentralDirectory.SetData(numberOfEntries, sizeOfCD, signatureOffset);
+            auto bytes = zip64EndOfCentralDirectory.GetBytes();
+            result.insert(result.end(), bytes.begin(), bytes.end());
+
+            auto zip64Locator = m_zip64Locator;
+            zip64Locator.SetData(signatureOffset + sizeOfCD);
+            bytes = zip64Locator.GetBytes();
+            result.insert(result.end(), bytes.begin(), bytes.end());
+        }
+        auto endCentralDirectoryRecord = m_endCentralDirectoryRecord;
+        endCentralDirectoryRecord.SetData(numberOfEntries, sizeOfCD, signatureOffset);
+        auto bytes = endCentralDirectoryRecord.GetBytes();
+        result.insert(result.end(), bytes.begin(), bytes.end());
+
+        return ComPtr<IStream>::Make<VectorStream>(std::move(result));
+    }
+
+    std::vector<std::uint8_t> ZipObjectReader::GetCentralDirectoryHash()
+    {
+        std::uint64_t offsetStartOfCD = m_endCentralDirectoryRecord.GetIsZip64() ?
+            m_zip64EndOfCentralDirectory.GetOffsetStartOfCD() : m_endCentralDirectoryRecord.GetStartOfCentralDirectory();
+
+        std::vector<std::uint8_t> data;
+        {
+            std::lock_guard<std::mutex> streamLock(*m_streamLock);
+            LARGE_INTEGER pos = {0};
+            ULARGE_INTEGER end = {0};
+            ThrowHrIfFailed(m_stream->Seek(pos, StreamBase::Reference::END, &end));
+            ThrowErrorIf(Error::ZipEOCDRecord, (offsetStartOfCD > end.QuadPart), "central directory past the end of the file");
+            data.resize(static_cast<std::size_t>(end.QuadPart - offsetStartOfCD));
+            pos.QuadPart = offsetStartOfCD;
+            ThrowHrIfFailed(m_stream->Seek(pos, StreamBase::Reference::START, nullptr));
+            StreamBase::ReadData(m_stream, data);
+        }
+
+        std::vector<std::uint8_t> hash;
+        ThrowErrorIfNot(Error::Unexpected, SHA256::ComputeHash(data.data(), static_cast<std::uint32_t>(data.size()), hash), "failed computing hash");
+        return hash;
+    }
+
+    ComPtr<IStream> ZipObjectReader::GetRawFile(const std::string& fileName)
+    {
+        auto centralFileHeader = m_centralDirectories.find(fileName);
+        if (centralFileHeader == m_centralDirectories.end())
+        {
+            return ComPtr<IStream>();
+        }
+        return CreateRawFileStream(centralFileHeader->first, centralFileHeader->second);
+    }
+
+    void ZipObjectReader::PrefetchFiles(const std::vector<std::string>& fileNames)
+    {
+        auto stream = GetStreamInternal();
+        if (!stream)
+        {
+            return;
+        }
+        auto fileRanges = GetFileRecordRanges();
+        std::vector<ByteRange> ranges;
+        for (const auto& fileName : fileNames)
+        {
+            auto range = fileRanges.find(fileName);
+            if (range != fileRanges.end())
+            {
+                ranges.push_back(range->second);
+            }
+        }
+        stream->Prefetch(ranges);
+    }
+
+    std::map<std::string, ByteRange> ZipObjectReader::GetFileRecordRanges()
+    {
+        std::map<std::uint64_t, std::string> offsets;
+        for (const auto& centralFileHeader : m_centralDirectories)
+        {
+            offsets.emplace(centralFileHeader.second.GetRelativeOffsetOfLocalHeader(), centralFileHeader.first);
+        }
+        auto startOfCentralDirectory = m_endCentralDirectoryRecord.GetIsZip64() ?
+            m_zip64EndOfCentralDirectory.GetOffsetStartOfCD() : m_endCentralDirectoryRecord.GetStartOfCentralDirectory();
+
+        std::map<std::string, ByteRange> result;
+        for (auto offset = offsets.begin(); offset != offsets.end(); offset++)
+        {
+            auto next = std::next(offset);
+            auto end = (next != offsets.end()) ? next->first : startOfCentralDirectory;
+            if (end > offset->first)
+            {
+                result.emplace(offset->second, ByteRange{ offset->first, end - offset->first });
+            }
+        }
+        return result;
+    }
+
+    ComPtr<IStreamInternal> ZipObjectReader::GetStreamInternal()
+    {
+        ComPtr<IStreamInternal> internal;
+        HRESULT hr = m_stream->QueryInterface(UuidOfImpl<IStreamInternal>::iid, reinterpret_cast<void**>(&internal));
+        if (FAILED(hr))
+        {
+            return ComPtr<IStreamInternal>();
+        }
+        return internal;
+    }
+
+    ComPtr<IStream> ZipObjectReader::CreateRawFileStream(const std::string& fileName, CentralDirectoryFileHeader& centralFileHeader)
+    {
+        LARGE_INTEGER pos = {0};
+        pos.QuadPart = centralFileHeader.GetRelativeOffsetOfLocalHeader();
+        LocalFileHeader lfh;
+        {
+            std::lock_guard<std::mutex> streamLock(*m_streamLock);
+            ThrowHrIfFailed(m_stream->Seek(pos, MSIX::StreamBase::Reference::START, nullptr));
+            lfh.Read(m_stream.Get(), centralFileHeader);
+        }
+
+        return ComPtr<IStream>::Make<ZipFileStream>(
+            fileName,
+            centralFileHeader.GetCompressionMethod() == CompressionType::Deflate,
+            centralFileHeader.GetRelativeOffsetOfLocalHeader() + lfh.Size(),
+            centralFileHeader.GetCompressedSize(),
+            m_stream.Get(),
+            m_streamLock
+        );
+    }
 }
@@ -0,0 +1,176 @@
+//
+//  Copyright (C) 2019 Microsoft.  All rights reserved.
+//  See LICENSE file in the project root for full license information.
+//
+
+#include "catch.hpp"
+#include "HashStream.hpp"
+#include "VectorStream.hpp"
+#include "MsixErrors.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+using namespace MSIX;
+
+// Larger than the scratch buffer used to hash skipped data
+static const std::size_t ContentSize = 200000;
+
+static std::vector<std::uint8_t> GetContent()
+{
+    std::vector<std::uint8_t> content(ContentSize);
+    for (std::size_t i = 0; i < content.size(); i++)
+    {
+        content[i] = static_cast<std::uint8_t>((i * 7919) >> 5);
+    }
+    return content;
+}
+
+// A hash stream over an in memory copy of content, which must match expectedHash
+static ComPtr<IStream> MakeHashStream(const std::vector<std::uint8_t>& content, const std::vector<std::uint8_t>& expectedHash)
+{
+    auto copy = content;
+    auto stream = ComPtr<IStream>::Make<VectorStream>(std::move(copy));
+    return ComPtr<IStream>::Make<HashStream>(stream, expectedHash);
+}
+
+static std::vector<std::uint8_t> GetHash(const std::vector<std::uint8_t>& content)
+{
+    std::vector<std::uint8_t> hash;
+    REQUIRE(SHA256::ComputeHash(content.data(), static_cast<std::uint32_t>(content.size()), hash));
+    return hash;
+}
+
+static void Seek(IStream* stream, std::uint64_t position)
+{
+    LARGE_INTEGER move = { 0 };
+    move.QuadPart = static_cast<LONGLONG>(position);
+    REQUIRE(stream->Seek(move, StreamBase::Reference::START, nullptr) == S_OK);
+}
+
+// Reads size bytes at the current position. Returns the HRESULT of the read, data receives what was read.
+static HRESULT Read(IStream* stream, ULONG size, std::vector<std::uint8_t>& data)
+{
+    data.resize(size);
+    ULONG bytesRead = 0;
+    HRESULT hr = stream->Read(data.data(), size, &bytesRead);
+    data.resize(bytesRead);
+    return hr;
+}
+
+TEST_CASE("HashStream_read_UT", "[unittests]")
+{
+    auto content = GetContent();
+    auto stream = MakeHashStream(content, GetHash(content));
+
+    std::vector<std::uint8_t> all;
+    std::vector<std::uint8_t> data;
+    while (all.size() < content.size())
+    {
+        REQUIRE(Read(stream.Get(), 7000, data) == S_OK);
+        REQUIRE(!data.empty());
+        all.insert(all.end(), data.begin(), data.end());
+    }
+    CHECK(all == content);
+
+    // Reading at the end of the stream returns no data
+    REQUIRE(Read(stream.Get(), 100, data) == S_OK);
+    CHECK(data.empty());
+}
+
+// Data is given to the caller as it is hashed, only the read that reaches the end of the stream fails
+TEST_CASE("HashStream_tampered_UT", "[unittests]")
+{
+    auto content = GetContent();
+    auto hash = GetHash(content);
+    auto tampered = content;
+    tampered[150000] ^= 1;
+    auto stream = MakeHashStream(tampered, hash);
+
+    std::vector<std::uint8_t> data;
+    std::size_t position = 0;
+    while (position + 10000 < content.size())
+    {
+        REQUIRE(Read(stream.Get(), 10000, data) == S_OK);
+        REQUIRE(data.size() == 10000);
+        position += data.size();
+    }
+    CHECK(Read(stream.Get(), 10000, data) == static_cast<HRESULT>(Error::SignatureInvalid));
+
+    // The failure sticks, whatever is read after it
+    CHECK(Read(stream.Get(), 10, data) == static_cast<HRESULT>(Error::SignatureInvalid));
+    Seek(stream.Get(), 0);
+    CHECK(Read(stream.Get(), 10, data) == static_cast<HRESULT>(Error::SignatureInvalid));
+    CHECK(data.empty());
+}
+
+// Data the caller seeks over is hashed before the data after it is read
+TEST_CASE("HashStream_skipped_data_UT", "[unittests]")
+{
+    auto content = GetContent();
+    auto hash = GetHash(content);
+
+    SECTION("Valid")
+    {
+        auto stream = MakeHashStream(content, hash);
+        std::vector<std::uint8_t> data;
+        REQUIRE(Read(stream.Get(), 1000, data) == S_OK);
+        Seek(stream.Get(), 150000);
+        REQUIRE(Read(stream.Get(), 1000, data) == S_OK);
+        REQUIRE(data.size() == 1000);
+        CHECK(std::equal(data.begin(), data.end(), content.begin() + 150000));
+        Seek(stream.Get(), content.size() - 10);
+        REQUIRE(Read(stream.Get(), 100, data) == S_OK);
+        REQUIRE(data.size() == 10);
+        CHECK(std::equal(data.begin(), data.end(), content.end() - 10));
+    }
+
+    SECTION("Tampered before the seek")
+    {
+        auto tampered = content;
+        tampered[5000] ^= 1;
+        auto stream = MakeHashStream(tampered, hash);
+        std::vector<std::uint8_t> data;
+        Seek(stream.Get(), 150000);
+        REQUIRE(Read(stream.Get(), 1000, data) == S_OK);
+        Seek(stream.Get(), content.size() - 10);
+        CHECK(Read(stream.Get(), 100, data) == static_cast<HRESULT>(Error::SignatureInvalid));
+    }
+
+    SECTION("Seek to the end without reading")
+    {
+        auto tampered = content;
+        tampered[ContentSize - 1] ^= 1;
+        auto stream = MakeHashStream(tampered, hash);
+        std::vector<std::uint8_t> data;
+        Seek(stream.Get(), content.size());
+        CHECK(Read(stream.Get(), 100, data) == static_cast<HRESULT>(Error::SignatureInvalid));
+    }
+}
+
+// Data read again, before or after the stream is validated, isn't hashed twice
+TEST_CASE("HashStream_seek_back_UT", "[unittests]")
+{
+    auto content = GetContent();
+    auto stream = MakeHashStream(content, GetHash(content));
+
+    std::vector<std::uint8_t> data;
+    REQUIRE(Read(stream.Get(), 50000, data) == S_OK);
+    Seek(stream.Get(), 10000);
+    REQUIRE(Read(stream.Get(), 60000, data) == S_OK);
+    REQUIRE(data.size() == 60000);
+    CHECK(std::equal(data.begin(), data.end(), content.begin() + 10000));
+
+    REQUIRE(Read(stream.Get(), ContentSize, data) == S_OK);
+    REQUIRE(data.size() == ContentSize - 70000);
+
+    // Validated, the stream can be read again from anywhere
+    Seek(stream.Get(), 100);
+    REQUIRE(Read(stream.Get(), 1000, data) == S_OK);
+    REQUIRE(data.size() == 1000);
+    CHECK(std::equal(data.begin(), data.end(), content.begin() + 100));
+    Seek(stream.Get(), 0);
+    REQUIRE(Read(stream.Get(), ContentSize, data) == S_OK);
+    CHECK(data == content);
+}
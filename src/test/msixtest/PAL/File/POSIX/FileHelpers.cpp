@@ -11,6 +11,8 @@
 #include <string>
 #include <map>
 #include <iostream>
+#include <fstream>
+#include <iterator>
 
 #include <sys/types.h>
 #include <sys/stat.h>
@@ -114,6 +116,44 @@ namespace MsixTest {
             return filesCopy.empty();
         }
 
+        bool CompareDirectories(const std::string& expected, const std::string& actual)
+        {
+            auto readFile = [](const std::string& path)
+            {
+                std::ifstream file(path, std::ios::binary);
+                return std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+            };
+
+            bool same = true;
+            std::size_t expectedFiles = 0;
+            auto compare = [&](const std::string& path, dirent* entry)
+            {
+                if (entry->d_type == DT_DIR) { return true; }
+                expectedFiles++;
+
+                auto file = path.substr(expected.size() + 1);
+                if (readFile(path) != readFile(actual + "/" + file))
+                {
+                    std::cout << "File: " << file << " doesn't match the expected content." << std::endl;
+                    same = false;
+                }
+                return true;
+            };
+
+            std::size_t actualFiles = 0;
+            auto count = [&actualFiles](const std::string&, dirent* entry)
+            {
+                if (entry->d_type != DT_DIR) { actualFiles++; }
+                return true;
+            };
+
+            if (!WalkDirectory(expected, compare) || !WalkDirectory(actual, count))
+            {
+                return false;
+            }
+            return same && (expectedFiles == actualFiles);
+        }
+
         // Converts path to posix separator
         std::string PathAsCurrentPlatform(const std::string& path)
         {
@@ -11,6 +11,8 @@
 #include <algorithm>
 #include <string>
 #include <iostream>
+#include <fstream>
+#include <iterator>
 #include <memory>
 
 namespace MsixTest {
@@ -141,6 +143,47 @@ namespace MsixTest {
             return filesCopy.empty();
         }
 
+        bool CompareDirectories(const std::string& expected, const std::string& actual)
+        {
+            auto expectedUtf16 = String::utf8_to_utf16(MsixTest::Directory::PathAsCurrentPlatform(expected));
+            auto actualUtf16 = String::utf8_to_utf16(MsixTest::Directory::PathAsCurrentPlatform(actual));
+
+            auto readFile = [](const std::wstring& path)
+            {
+                std::ifstream file(path, std::ios::binary);
+                return std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+            };
+
+            bool same = true;
+            std::size_t expectedFiles = 0;
+            auto compare = [&](const std::wstring& path, PWIN32_FIND_DATA fileData)
+            {
+                if (fileData->dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) { return true; }
+                expectedFiles++;
+
+                auto file = path.substr(expectedUtf16.size() + 1);
+                if (readFile(path) != readFile(actualUtf16 + L"\\" + file))
+                {
+                    std::cout << "File: " << String::utf16_to_utf8(file) << " doesn't match the expected content." << std::endl;
+                    same = false;
+                }
+                return true;
+            };
+
+            std::size_t actualFiles = 0;
+            auto count = [&actualFiles](const std::wstring&, PWIN32_FIND_DATA fileData)
+            {
+                if (!(fileData->dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)) { actualFiles++; }
+                return true;
+            };
+
+            if (!WalkDirectory(expectedUtf16, compare) || !WalkDirectory(actualUtf16, count))
+            {
+                return false;
+            }
+            return same && (expectedFiles == actualFiles);
+        }
+
         // Converts path to windows separator
         std::string PathAsCurrentPlatform(const std::string& path)
         {
@@ -0,0 +1,130 @@
+//
+//  Copyright (C) 2019 Microsoft.  All rights reserved.
+//  See LICENSE file in the project root for full license information.
+//
+
+#include "catch.hpp"
+#include "SHA256Kernel.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace MSIX;
+
+static std::string ToHex(const std::uint8_t* digest)
+{
+    static const char digits[] = "0123456789abcdef";
+    std::string result;
+    for (int i = 0; i < 32; i++)
+    {
+        result += digits[digest[i] >> 4];
+        result += digits[digest[i] & 0xf];
+    }
+    return result;
+}
+
+static std::string Hash(const std::uint8_t* data, std::size_t size)
+{
+    SHA256Kernel::Context context;
+    SHA256Kernel::Init(context);
+    SHA256Kernel::Update(context, data, size);
+    std::uint8_t digest[32];
+    SHA256Kernel::Final(context, digest);
+    return ToHex(digest);
+}
+
+// Runs check once with every implementation the CPU supports
+template <class Check>
+static void ForEachImplementation(Check check)
+{
+    const std::pair<SHA256Kernel::ImplementationKind, std::string> implementations[] = {
+        { SHA256Kernel::ImplementationKind::Portable, "portable" },
+        { SHA256Kernel::ImplementationKind::Avx2, "avx2" },
+        { SHA256Kernel::ImplementationKind::ShaNi, "sha-ni" } };
+    // Other tests hash with the implementation selected for the CPU, even when a check fails
+    struct Reset { ~Reset() { SHA256Kernel::ResetImplementation(); } } reset;
+    REQUIRE(SHA256Kernel::IsSupported(SHA256Kernel::ImplementationKind::Portable));
+    for (const auto& implementation : implementations)
+    {
+        if (SHA256Kernel::IsSupported(implementation.first))
+        {
+            SHA256Kernel::ForceImplementation(implementation.first);
+            INFO("Implementation " << implementation.second);
+            REQUIRE(implementation.second == SHA256Kernel::GetImplementationName());
+            check();
+        }
+    }
+}
+
+static void CheckVectors()
+{
+    std::string abc = "abc";
+    std::string twoBlocks = "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq";
+    CHECK("e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855" == Hash(nullptr, 0));
+    CHECK("ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad" ==
+        Hash(reinterpret_cast<const std::uint8_t*>(abc.data()), abc.size()));
+    CHECK("248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1" ==
+        Hash(reinterpret_cast<const std::uint8_t*>(twoBlocks.data()), twoBlocks.size()));
+
+    std::vector<std::uint8_t> million(1000000, 'a');
+    CHECK("cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0" == Hash(million.data(), million.size()));
+
+    // The same data in pieces that don't end on 64 bytes
+    SHA256Kernel::Context context;
+    SHA256Kernel::Init(context);
+    for (std::size_t offset = 0; offset < million.size(); offset += 1001)
+    {
+        SHA256Kernel::Update(context, million.data() + offset, std::min<std::size_t>(1001, million.size() - offset));
+    }
+    std::uint8_t digest[32];
+    SHA256Kernel::Final(context, digest);
+    CHECK("cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0" == ToHex(digest));
+}
+
+static void CheckParallel()
+{
+    auto parallelCount = SHA256Kernel::GetParallelCount();
+    REQUIRE(parallelCount >= 1);
+    REQUIRE(parallelCount <= SHA256Kernel::MaximumParallelCount);
+
+    // Sizes around the padding of the last block, and a full block of the block map
+    for (std::size_t size : { 0, 1, 55, 56, 63, 64, 65, 119, 120, 65536 })
+    {
+        std::vector<std::vector<std::uint8_t>> buffers(parallelCount);
+        const std::uint8_t* data[SHA256Kernel::MaximumParallelCount];
+        for (std::size_t i = 0; i < parallelCount; i++)
+        {
+            buffers[i].resize(size + 1);
+            for (std::size_t j = 0; j < buffers[i].size(); j++)
+            {
+                buffers[i][j] = static_cast<std::uint8_t>(j * 31 + i * 7);
+            }
+            data[i] = buffers[i].data();
+        }
+        for (std::size_t count = 1; count <= parallelCount; count++)
+        {
+            std::uint8_t digests[SHA256Kernel::MaximumParallelCount][32];
+            SHA256Kernel::HashParallel(data, size, count, digests);
+            for (std::size_t i = 0; i < count; i++)
+            {
+                INFO("Size " << size << " count " << count << " buffer " << i);
+                CHECK(Hash(data[i], size) == ToHex(digests[i]));
+            }
+        }
+    }
+}
+
+TEST_CASE("SHA256Kernel_vectors_UT", "[unittests]")
+{
+    INFO("Selected implementation " << SHA256Kernel::GetImplementationName());
+    ForEachImplementation(CheckVectors);
+}
+
+TEST_CASE("SHA256Kernel_parallel_UT", "[unittests]")
+{
+    INFO("Selected implementation " << SHA256Kernel::GetImplementationName());
+    ForEachImplementation(CheckParallel);
+}
@@ -9,9 +9,18 @@
 #include "UnpackTestData.hpp"
 #include "BlockMapTestData.hpp"
 #include "macros.hpp"
+#include "IPackage.hpp"
+#include "StreamBase.hpp"
 
 #include <iostream>
+#include <algorithm>
 #include <array>
+#include <fstream>
+#include <thread>
+#include <set>
+#include <map>
+#include <numeric>
+#include <cstdio>
 
 // Validates all payload files from the package are correct
 TEST_CASE("Api_AppxPackageReader_PayloadFiles", "[api]")
@@ -141,3 +150,859 @@ TEST_CASE("Api_AppxPackageReader_FootprintFile", "[api]")
     std::replace(codeIntegrityName.begin(), codeIntegrityName.end(), '/', '\\');
     REQUIRE(codeIntegrityName == appxCodeIntegrityName.ToString());
 }
+
+#ifndef WIN32
+// Verifies certificates added with MSIX_FACTORY_EXTENSION_TRUSTED_CERTIFICATES
+TEST_CASE("Api_AppxPackageReader_TrustedCertificates", "[api]")
+{
+    auto unpackPath = MsixTest::TestPath::GetInstance()->GetPath(MsixTest::TestPath::Directory::Unpack);
+
+    MsixTest::ComPtr<IAppxFactory> factory;
+    REQUIRE_SUCCEEDED(CoCreateAppxFactoryWithHeap(MsixTest::Allocators::Allocate, MsixTest::Allocators::Free, MSIX_VALIDATION_OPTION_FULL, &factory));
+    MsixTest::ComPtr<IMsixFactoryOverrides> factoryOverrides;
+    REQUIRE_SUCCEEDED(factory->QueryInterface(UuidOfImpl<IMsixFactoryOverrides>::iid, reinterpret_cast<void**>(&factoryOverrides)));
+
+    // A stream without PEM certificates is rejected and doesn't replace the current store
+    auto notCertificates = MsixTest::StreamFile(unpackPath + "/TestAppxPackage_Win32.appx", true);
+    REQUIRE_HR(static_cast<HRESULT>(MSIX::Error::InvalidParameter),
+        factoryOverrides->SpecifyExtension(MSIX_FACTORY_EXTENSION_TRUSTED_CERTIFICATES, notCertificates.Get()));
+    MsixTest::ComPtr<IUnknown> current;
+    REQUIRE_SUCCEEDED(factoryOverrides->GetCurrentSpecifiedExtension(MSIX_FACTORY_EXTENSION_TRUSTED_CERTIFICATES, &current));
+    REQUIRE(current.Get() == nullptr);
+
+    // The package is signed by a test root that isn't built in, so it's rejected until the root is added
+    auto package = MsixTest::StreamFile(unpackPath + "/SignedTestRootCert.appx", true);
+    MsixTest::ComPtr<IAppxPackageReader> packageReader;
+    REQUIRE_HR(static_cast<HRESULT>(MSIX::Error::CertNotTrusted), factory->CreatePackageReader(package.Get(), &packageReader));
+
+    auto certificates = MsixTest::StreamFile(unpackPath + "/TrustedRoot.cer", true);
+    REQUIRE_SUCCEEDED(factoryOverrides->SpecifyExtension(MSIX_FACTORY_EXTENSION_TRUSTED_CERTIFICATES, certificates.Get()));
+    REQUIRE_SUCCEEDED(factoryOverrides->GetCurrentSpecifiedExtension(MSIX_FACTORY_EXTENSION_TRUSTED_CERTIFICATES, &current));
+    MsixTest::ComPtr<IStream> currentStream;
+    REQUIRE_SUCCEEDED(current->QueryInterface(UuidOfImpl<IStream>::iid, reinterpret_cast<void**>(&currentStream)));
+    REQUIRE_ARE_SAME(currentStream.Get(), certificates.Get());
+
+    // With the additional root the chain is trusted
+    package = MsixTest::StreamFile(unpackPath + "/SignedTestRootCert.appx", true);
+    REQUIRE_SUCCEEDED(factory->CreatePackageReader(package.Get(), &packageReader));
+
+    // The additional root doesn't issue this package's certificate, so the chain still isn't trusted
+    auto untrustedPackage = MsixTest::StreamFile(unpackPath + "/SignedUntrustedCert-CERT_E_CHAINING.appx", true);
+    REQUIRE_HR(static_cast<HRESULT>(MSIX::Error::CertNotTrusted), factory->CreatePackageReader(untrustedPackage.Get(), &packageReader));
+}
+#endif
+
+// Reads all the payload files of a single package reader from several threads at the same time
+TEST_CASE("Api_AppxPackageReader_ConcurrentReads", "[api]")
+{
+    auto packagePath = MsixTest::TestPath::GetInstance()->GetPath(MsixTest::TestPath::Directory::Unpack) + "/TestAppxPackage_Win32.appx";
+    packagePath = MsixTest::Directory::PathAsCurrentPlatform(packagePath);
+
+    auto readFile = [](IAppxPackageReader* packageReader, const std::string& name, std::vector<std::uint8_t>& content) -> HRESULT
+    {
+        MsixTest::ComPtr<IAppxPackageReaderUtf8> packageReaderUtf8;
+        HRESULT hr = packageReader->QueryInterface(UuidOfImpl<IAppxPackageReaderUtf8>::iid, reinterpret_cast<void**>(&packageReaderUtf8));
+        if (FAILED(hr)) { return hr; }
+        MsixTest::ComPtr<IAppxFile> file;
+        hr = packageReaderUtf8->GetPayloadFile(name.c_str(), &file);
+        if (FAILED(hr)) { return hr; }
+        MsixTest::ComPtr<IStream> stream;
+        hr = file->GetStream(&stream);
+        if (FAILED(hr)) { return hr; }
+        std::uint8_t buffer[4096];
+        ULONG read = 0;
+        do
+        {
+            hr = stream->Read(buffer, sizeof(buffer), &read);
+            if (FAILED(hr)) { return hr; }
+            content.insert(content.end(), buffer, buffer + read);
+        } while (read > 0);
+        return S_OK;
+    };
+
+    // Expected content, read from one thread
+    MsixTest::ComPtr<IAppxPackageReader> expectedReader;
+    {
+        auto inputStream = MsixTest::StreamFile(packagePath, true);
+        MsixTest::ComPtr<IAppxFactory> factory;
+        REQUIRE_SUCCEEDED(CoCreateAppxFactoryWithHeap(MsixTest::Allocators::Allocate, MsixTest::Allocators::Free, MSIX_VALIDATION_OPTION_SKIPSIGNATURE, &factory));
+        REQUIRE_SUCCEEDED(factory->CreatePackageReader(inputStream.Get(), &expectedReader));
+    }
+    std::vector<std::string> names;
+    MsixTest::ComPtr<IAppxFilesEnumerator> files;
+    REQUIRE_SUCCEEDED(expectedReader->GetPayloadFiles(&files));
+    BOOL hasCurrent = FALSE;
+    REQUIRE_SUCCEEDED(files->GetHasCurrent(&hasCurrent));
+    while (hasCurrent)
+    {
+        MsixTest::ComPtr<IAppxFile> file;
+        REQUIRE_SUCCEEDED(files->GetCurrent(&file));
+        MsixTest::ComPtr<IAppxFileUtf8> fileUtf8;
+        REQUIRE_SUCCEEDED(file->QueryInterface(UuidOfImpl<IAppxFileUtf8>::iid, reinterpret_cast<void**>(&fileUtf8)));
+        MsixTest::Wrappers::Buffer<char> fileName;
+        REQUIRE_SUCCEEDED(fileUtf8->GetName(&fileName));
+        names.push_back(fileName.ToString());
+        REQUIRE_SUCCEEDED(files->MoveNext(&hasCurrent));
+    }
+    REQUIRE(names.size() > 1);
+    std::vector<std::vector<std::uint8_t>> expected(names.size());
+    for (std::size_t i = 0; i < names.size(); i++)
+    {
+        REQUIRE_SUCCEEDED(readFile(expectedReader.Get(), names[i], expected[i]));
+    }
+
+    // The package file is memory mapped by CreateMappedStreamOnFile on POSIX, CreateStreamOnFileUTF16
+    // uses a FileStream whose seek pointer is shared by all the files of the package.
+    std::vector<MsixTest::ComPtr<IStream>> inputStreams(2);
+    REQUIRE_SUCCEEDED(CreateMappedStreamOnFile(const_cast<char*>(packagePath.c_str()), &inputStreams[0]));
+    auto packagePathUtf16 = MsixTest::String::utf8_to_utf16(packagePath);
+    REQUIRE_SUCCEEDED(CreateStreamOnFileUTF16(packagePathUtf16.c_str(), true, &inputStreams[1]));
+    for (auto& inputStream : inputStreams)
+    {
+        MsixTest::ComPtr<IAppxFactory> factory;
+        REQUIRE_SUCCEEDED(CoCreateAppxFactoryWithHeap(MsixTest::Allocators::Allocate, MsixTest::Allocators::Free, MSIX_VALIDATION_OPTION_SKIPSIGNATURE, &factory));
+        MsixTest::ComPtr<IAppxPackageReader> packageReader;
+        REQUIRE_SUCCEEDED(factory->CreatePackageReader(inputStream.Get(), &packageReader));
+
+        const std::size_t threadCount = 4;
+        std::vector<std::vector<std::uint8_t>> actual(names.size());
+        std::vector<HRESULT> results(names.size(), E_FAIL);
+        std::vector<std::thread> threads;
+        for (std::size_t t = 0; t < threadCount; t++)
+        {
+            threads.emplace_back([&, t]()
+            {
+                for (std::size_t i = t; i < names.size(); i += threadCount)
+                {
+                    results[i] = readFile(packageReader.Get(), names[i], actual[i]);
+                }
+            });
+        }
+        for (auto& thread : threads)
+        {
+            thread.join();
+        }
+
+        for (std::size_t i = 0; i < names.size(); i++)
+        {
+            INFO(names[i]);
+            REQUIRE_SUCCEEDED(results[i]);
+            REQUIRE(expected[i] == actual[i]);
+        }
+    }
+}
+
+// Writes a file for the stream tests and opens it with CreateMappedStreamOnFile, which maps it on POSIX
+static std::vector<std::uint8_t> MakeMappedFile(const std::string& fileName, MsixTest::ComPtr<IStream>& stream)
+{
+    std::vector<std::uint8_t> content(300000);
+    for (std::size_t i = 0; i < content.size(); i++)
+    {
+        content[i] = static_cast<std::uint8_t>((i * 7919) >> 3);
+    }
+    {
+        std::ofstream file(fileName, std::ios::binary);
+        file.write(reinterpret_cast<const char*>(content.data()), content.size());
+    }
+    REQUIRE_SUCCEEDED(CreateMappedStreamOnFile(const_cast<char*>(fileName.c_str()), &stream));
+    #ifndef WIN32
+    REQUIRE(stream.As<IStreamInternal>()->GetData() != nullptr);
+    #endif
+    return content;
+}
+
+static std::vector<std::uint8_t> ReadAt(IStream* stream, std::uint64_t position, ULONG size)
+{
+    LARGE_INTEGER move = { 0 };
+    move.QuadPart = static_cast<LONGLONG>(position);
+    REQUIRE_SUCCEEDED(stream->Seek(move, STREAM_SEEK_SET, nullptr));
+    std::vector<std::uint8_t> buffer(size);
+    ULONG bytesRead = 0;
+    HRESULT hr = stream->Read(buffer.data(), size, &bytesRead);
+    REQUIRE_FALSE(FAILED(hr));
+    buffer.resize(bytesRead);
+    return buffer;
+}
+
+// Mapping is opt-in, CreateStreamOnFile and CreateStreamOnFileUTF16 read the file through a FileStream
+TEST_CASE("Api_CreateStreamOnFile_NotMapped", "[api]")
+{
+    std::string fileName = "mapped_file.bin";
+    MsixTest::ComPtr<IStream> mapped;
+    auto content = MakeMappedFile(fileName, mapped);
+
+    std::vector<MsixTest::ComPtr<IStream>> streams(2);
+    REQUIRE_SUCCEEDED(CreateStreamOnFile(const_cast<char*>(fileName.c_str()), true, &streams[0]));
+    auto fileNameUtf16 = MsixTest::String::utf8_to_utf16(fileName);
+    REQUIRE_SUCCEEDED(CreateStreamOnFileUTF16(fileNameUtf16.c_str(), true, &streams[1]));
+    for (auto& stream : streams)
+    {
+        CHECK(stream.As<IStreamInternal>()->GetData() == nullptr);
+        auto data = ReadAt(stream.Get(), 1000, 500);
+        REQUIRE(data.size() == 500);
+        CHECK(std::equal(data.begin(), data.end(), content.begin() + 1000));
+        stream = MsixTest::ComPtr<IStream>();
+    }
+
+    mapped = MsixTest::ComPtr<IStream>();
+    remove(fileName.c_str());
+}
+
+// Like fseek, the stream keeps a position past the end of the file. Reads from there return no data.
+TEST_CASE("Api_MappedFileStream_SeekBeyondEnd", "[api]")
+{
+    std::string fileName = "mapped_file.bin";
+    MsixTest::ComPtr<IStream> stream;
+    auto content = MakeMappedFile(fileName, stream);
+    auto size = static_cast<std::uint64_t>(content.size());
+
+    LARGE_INTEGER move = { 0 };
+    ULARGE_INTEGER position = { 0 };
+    move.QuadPart = static_cast<LONGLONG>(size + 100);
+    REQUIRE_SUCCEEDED(stream->Seek(move, STREAM_SEEK_SET, &position));
+    CHECK(position.QuadPart == size + 100);
+    std::uint8_t buffer[10];
+    ULONG bytesRead = 1;
+    HRESULT hr = stream->Read(buffer, sizeof(buffer), &bytesRead);
+    CHECK_FALSE(FAILED(hr));
+    CHECK(bytesRead == 0);
+
+    // Back from past the end, into the file
+    move.QuadPart = -150;
+    REQUIRE_SUCCEEDED(stream->Seek(move, STREAM_SEEK_CUR, &position));
+    CHECK(position.QuadPart == size - 50);
+    std::vector<std::uint8_t> tail(100);
+    hr = stream->Read(tail.data(), static_cast<ULONG>(tail.size()), &bytesRead);
+    CHECK_FALSE(FAILED(hr));
+    REQUIRE(bytesRead == 50);
+    CHECK(std::equal(content.end() - 50, content.end(), tail.begin()));
+
+    // Nothing to copy past the end
+    move.QuadPart = 10;
+    REQUIRE_SUCCEEDED(stream->Seek(move, STREAM_SEEK_END, &position));
+    CHECK(position.QuadPart == size + 10);
+    auto copy = MsixTest::StreamFile("mapped_file_copy.bin", false, true);
+    ULARGE_INTEGER count = { 0 };
+    count.QuadPart = 1000;
+    ULARGE_INTEGER copied = { 0 };
+    REQUIRE_SUCCEEDED(stream->CopyTo(copy.Get(), count, &copied, nullptr));
+    CHECK(copied.QuadPart == 0);
+
+    move.QuadPart = -1;
+    CHECK(FAILED(stream->Seek(move, STREAM_SEEK_SET, nullptr)));
+
+    stream = MsixTest::ComPtr<IStream>();
+    remove(fileName.c_str());
+}
+
+// A clone starts at the position of the stream it was cloned from, then each has its own position
+TEST_CASE("Api_MappedFileStream_Clone", "[api]")
+{
+    std::string fileName = "mapped_file.bin";
+    MsixTest::ComPtr<IStream> stream;
+    auto content = MakeMappedFile(fileName, stream);
+
+    LARGE_INTEGER move = { 0 };
+    move.QuadPart = 1000;
+    REQUIRE_SUCCEEDED(stream->Seek(move, STREAM_SEEK_SET, nullptr));
+    MsixTest::ComPtr<IStream> clone;
+    REQUIRE_SUCCEEDED(stream->Clone(&clone));
+    LARGE_INTEGER zero = { 0 };
+    ULARGE_INTEGER position = { 0 };
+    REQUIRE_SUCCEEDED(clone->Seek(zero, STREAM_SEEK_CUR, &position));
+    CHECK(position.QuadPart == 1000);
+
+    std::vector<std::uint8_t> buffer(500);
+    ULONG bytesRead = 0;
+    REQUIRE_SUCCEEDED(clone->Read(buffer.data(), static_cast<ULONG>(buffer.size()), &bytesRead));
+    REQUIRE(bytesRead == buffer.size());
+    CHECK(std::equal(buffer.begin(), buffer.end(), content.begin() + 1000));
+    REQUIRE_SUCCEEDED(stream->Seek(zero, STREAM_SEEK_CUR, &position));
+    CHECK(position.QuadPart == 1000);
+
+    // The clone keeps the file mapped after the stream is released
+    stream = MsixTest::ComPtr<IStream>();
+    auto tail = ReadAt(clone.Get(), content.size() - 100, 1000);
+    REQUIRE(tail.size() == 100);
+    CHECK(std::equal(tail.begin(), tail.end(), content.end() - 100));
+
+    clone = MsixTest::ComPtr<IStream>();
+    remove(fileName.c_str());
+}
+
+// Threads that read the file through their own clone all read the right data
+TEST_CASE("Api_MappedFileStream_ConcurrentReads", "[api]")
+{
+    std::string fileName = "mapped_file.bin";
+    MsixTest::ComPtr<IStream> stream;
+    auto content = MakeMappedFile(fileName, stream);
+
+    const std::size_t threadCount = 4;
+    std::vector<MsixTest::ComPtr<IStream>> clones(threadCount);
+    for (auto& clone : clones)
+    {
+        REQUIRE_SUCCEEDED(stream->Clone(&clone));
+    }
+    bool results[threadCount] = {};
+    std::vector<std::thread> threads;
+    for (std::size_t t = 0; t < threadCount; t++)
+    {
+        threads.emplace_back([&, t]()
+        {
+            // Reads of different sizes from different places, the same as readers of different payload files
+            bool same = true;
+            ULONG size = static_cast<ULONG>(1000 + t * 337);
+            for (std::uint64_t position = t * 101; position < content.size(); position += size * 2)
+            {
+                LARGE_INTEGER move = { 0 };
+                move.QuadPart = static_cast<LONGLONG>(position);
+                std::vector<std::uint8_t> buffer(size);
+                ULONG bytesRead = 0;
+                HRESULT hr = clones[t]->Seek(move, STREAM_SEEK_SET, nullptr);
+                if (SUCCEEDED(hr)) { hr = clones[t]->Read(buffer.data(), size, &bytesRead); }
+                auto expected = std::min<std::uint64_t>(size, content.size() - position);
+                same = same && SUCCEEDED(hr) && (bytesRead == expected) &&
+                    std::equal(buffer.begin(), buffer.begin() + bytesRead, content.begin() + position);
+            }
+            results[t] = same;
+        });
+    }
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+    for (std::size_t t = 0; t < threadCount; t++)
+    {
+        INFO("Thread " << t);
+        CHECK(results[t]);
+    }
+
+    clones.clear();
+    stream = MsixTest::ComPtr<IStream>();
+    remove(fileName.c_str());
+}
+
+// large.txt of the ParallelInflate packages has 21 blocks, enough to be inflated in parallel
+static std::string GetParallelInflateContent()
+{
+    std::string content;
+    char line[64];
+    for (int i = 0; content.size() < 20 * 65536 + 1234; i++)
+    {
+        std::snprintf(line, sizeof(line), "Line %06d of the parallel inflate test file\n", i);
+        content += line;
+    }
+    return content;
+}
+
+static HRESULT ReadParallelInflateFile(const std::string& package, MSIX_FACTORY_OPTIONS factoryOptions, std::string& content)
+{
+    auto packagePath = MsixTest::TestPath::GetInstance()->GetPath(MsixTest::TestPath::Directory::Unpack) + "/" + package;
+    auto packageStream = MsixTest::StreamFile(packagePath, true);
+    MsixTest::ComPtr<IAppxFactory> factory;
+    REQUIRE_SUCCEEDED(CoCreateAppxFactoryWithHeapAndOptions(MsixTest::Allocators::Allocate, MsixTest::Allocators::Free,
+        MSIX_VALIDATION_OPTION_SKIPSIGNATURE, factoryOptions, &factory));
+    MsixTest::ComPtr<IAppxPackageReader> packageReader;
+    REQUIRE_SUCCEEDED(factory->CreatePackageReader(packageStream.Get(), &packageReader));
+    MsixTest::ComPtr<IAppxFile> file;
+    REQUIRE_SUCCEEDED(packageReader->GetPayloadFile(L"large.txt", &file));
+    MsixTest::ComPtr<IStream> stream;
+    REQUIRE_SUCCEEDED(file->GetStream(&stream));
+
+    // Odd sized reads cross block boundaries
+    char buffer[40000];
+    ULONG read = 0;
+    do
+    {
+        HRESULT hr = stream->Read(buffer, sizeof(buffer), &read);
+        if (FAILED(hr)) { return hr; }
+        content.append(buffer, read);
+    } while (read > 0);
+    return S_OK;
+}
+
+// The first 8 blocks of large.txt are compressed with a full flush, the rest of the file is a single deflate
+// stream. Its blocks don't inflate by themselves, so the file is read from the block map stream from there.
+TEST_CASE("Api_AppxPackageReader_ParallelInflate_NotFlushed", "[api]")
+{
+    for (auto factoryOptions : { MSIX_FACTORY_OPTION_NONE, MSIX_FACTORY_OPTION_READER_PARALLEL_INFLATE })
+    {
+        INFO("Factory options " << factoryOptions);
+        std::string content;
+        REQUIRE_SUCCEEDED(ReadParallelInflateFile("ParallelInflateNotFlushed.appx", factoryOptions, content));
+        REQUIRE(GetParallelInflateContent() == content);
+    }
+}
+
+// Block 5 of large.txt doesn't match its hash in the block map
+TEST_CASE("Api_AppxPackageReader_ParallelInflate_BadBlockHash", "[api]")
+{
+    std::string content;
+    REQUIRE_HR(static_cast<HRESULT>(MSIX::Error::BlockMapInvalidData),
+        ReadParallelInflateFile("ParallelInflateBadBlockHash.appx", MSIX_FACTORY_OPTION_READER_PARALLEL_INFLATE, content));
+    // Nothing after the last good block is returned
+    REQUIRE(content.size() <= 5 * 65536);
+    REQUIRE(GetParallelInflateContent().compare(0, content.size(), content) == 0);
+}
+
+// Other producers don't always end the blocks of a compressed file with a full flush. Then the blocks can't be
+// inflated by themselves and the file is inflated from its beginning.
+TEST_CASE("Api_AppxPackageReader_RandomAccess_NotFlushed", "[api]")
+{
+    const std::uint64_t blockSize = 65536;
+
+    // small.txt is one deflate stream of 7 blocks
+    auto packagePath = MsixTest::TestPath::GetInstance()->GetPath(MsixTest::TestPath::Directory::Unpack) + "/InflateNotFlushed.appx";
+    MsixTest::ComPtr<IAppxPackageReader> expectedReader;
+    MsixTest::InitializePackageReader(MsixTest::StreamFile(packagePath, true).Get(), &expectedReader);
+    MsixTest::ComPtr<IAppxFile> expectedFile;
+    REQUIRE_SUCCEEDED(expectedReader->GetPayloadFile(L"small.txt", &expectedFile));
+    MsixTest::ComPtr<IStream> expectedStream;
+    REQUIRE_SUCCEEDED(expectedFile->GetStream(&expectedStream));
+    auto text = MsixTest::ReadStreamContent(expectedStream.Get());
+    REQUIRE(text.size() == blockSize * 6 + 1000);
+
+    auto package = MsixTest::StreamFile(packagePath, true);
+    MsixTest::RecordingStream packageStream(package.Get());
+    MsixTest::ComPtr<IAppxPackageReader> packageReader;
+    MsixTest::InitializePackageReader(&packageStream, &packageReader);
+    MsixTest::ComPtr<IAppxFile> file;
+    REQUIRE_SUCCEEDED(packageReader->GetPayloadFile(L"small.txt", &file));
+    MsixTest::ComPtr<IStream> fileStream;
+    REQUIRE_SUCCEEDED(file->GetStream(&fileStream));
+    auto compressedSizes = MsixTest::GetCompressedBlockSizes(packageReader.Get(), L"small.txt");
+    REQUIRE(compressedSizes.size() == 7);
+
+    auto readAt = [&](std::uint64_t offset, ULONG size)
+    {
+        packageStream.readOffsets.clear();
+        LARGE_INTEGER position = { 0 };
+        position.QuadPart = static_cast<LONGLONG>(offset);
+        REQUIRE_SUCCEEDED(fileStream->Seek(position, STREAM_SEEK_SET, nullptr));
+        std::vector<std::uint8_t> buffer(size);
+        ULONG bytesRead = 0;
+        REQUIRE_SUCCEEDED(fileStream->Read(buffer.data(), size, &bytesRead));
+        REQUIRE(bytesRead == size);
+        CHECK(std::equal(buffer.begin(), buffer.end(), text.begin() + offset));
+    };
+
+    // The checkpoint of the block is tried, but its block doesn't inflate by itself
+    readAt(100, 100);
+    readAt(blockSize * 5 + 100, 2000);
+    auto forwardReads = packageStream.readOffsets;
+
+    // Seeking back inflates from the beginning of the file again
+    readAt(blockSize + 7, 500);
+    REQUIRE(!packageStream.readOffsets.empty());
+    auto dataOffset = packageStream.readOffsets.front();
+    CHECK(*std::min_element(packageStream.readOffsets.begin(), packageStream.readOffsets.end()) == dataOffset);
+    auto block5 = dataOffset + std::accumulate(compressedSizes.begin(), compressedSizes.begin() + 5, std::uint64_t(0));
+    CHECK(std::find(forwardReads.begin(), forwardReads.end(), block5) != forwardReads.end());
+    CHECK(*std::min_element(forwardReads.begin(), forwardReads.end()) > dataOffset);
+
+    readAt(blockSize * 3 - 300, 1000);
+    readAt(blockSize * 2, 1000);
+    REQUIRE(!packageStream.readOffsets.empty());
+    CHECK(packageStream.readOffsets.front() == dataOffset);
+}
+
+// A lazily opened reader only reads the manifest up front and builds the payload index on first use
+TEST_CASE("Api_AppxPackageReader_LazyOpen", "[api]")
+{
+    auto unpackPath = MsixTest::TestPath::GetInstance()->GetPath(MsixTest::TestPath::Directory::Unpack);
+
+    MsixTest::ComPtr<IAppxFactory> factory;
+    REQUIRE_SUCCEEDED(CoCreateAppxFactoryWithHeapAndOptions(MsixTest::Allocators::Allocate, MsixTest::Allocators::Free,
+        MSIX_VALIDATION_OPTION_SKIPSIGNATURE, MSIX_FACTORY_OPTION_READER_LAZY_OPEN, &factory));
+
+    auto getPayloadFileNames = [](IAppxPackageReader* packageReader)
+    {
+        std::vector<std::string> names;
+        MsixTest::ComPtr<IAppxFilesEnumerator> files;
+        REQUIRE_SUCCEEDED(packageReader->GetPayloadFiles(&files));
+        BOOL hasCurrent = FALSE;
+        REQUIRE_SUCCEEDED(files->GetHasCurrent(&hasCurrent));
+        while (hasCurrent)
+        {
+            MsixTest::ComPtr<IAppxFile> file;
+            REQUIRE_SUCCEEDED(files->GetCurrent(&file));
+            MsixTest::Wrappers::Buffer<wchar_t> fileName;
+            REQUIRE_SUCCEEDED(file->GetName(&fileName));
+            names.push_back(fileName.ToString());
+            REQUIRE_SUCCEEDED(files->MoveNext(&hasCurrent));
+        }
+        return names;
+    };
+
+    // Same manifest and payload files as an eagerly opened reader
+    {
+        MsixTest::ComPtr<IAppxPackageReader> eagerReader;
+        MsixTest::InitializePackageReader("TestAppxPackage_Win32.appx", &eagerReader);
+
+        auto package = MsixTest::StreamFile(unpackPath + "/TestAppxPackage_Win32.appx", true);
+        MsixTest::ComPtr<IAppxPackageReader> packageReader;
+        REQUIRE_SUCCEEDED(factory->CreatePackageReader(package.Get(), &packageReader));
+
+        MsixTest::ComPtr<IAppxManifestReader> manifestReader;
+        REQUIRE_SUCCEEDED(packageReader->GetManifest(&manifestReader));
+        MsixTest::ComPtr<IAppxManifestPackageId> packageId;
+        REQUIRE_SUCCEEDED(manifestReader->GetPackageId(&packageId));
+        MsixTest::Wrappers::Buffer<wchar_t> packageFullName;
+        REQUIRE_SUCCEEDED(packageId->GetPackageFullName(&packageFullName));
+        REQUIRE_FALSE(packageFullName.ToString().empty());
+
+        auto expectedNames = getPayloadFileNames(eagerReader.Get());
+        REQUIRE_FALSE(expectedNames.empty());
+        REQUIRE(getPayloadFileNames(packageReader.Get()) == expectedNames);
+    }
+
+    // A file missing from the block map is only reported once the payload index is needed
+    {
+        auto package = MsixTest::StreamFile(unpackPath + "/BlockMap/File_missing_from_blockmap.msix", true);
+        MsixTest::ComPtr<IAppxPackageReader> packageReader;
+        REQUIRE_SUCCEEDED(factory->CreatePackageReader(package.Get(), &packageReader));
+
+        MsixTest::ComPtr<IAppxManifestReader> manifestReader;
+        REQUIRE_SUCCEEDED(packageReader->GetManifest(&manifestReader));
+
+        MsixTest::ComPtr<IAppxFilesEnumerator> files;
+        REQUIRE_HR(static_cast<HRESULT>(MSIX::Error::BlockMapSemanticError), packageReader->GetPayloadFiles(&files));
+    }
+}
+
+// Forwards the calls to an index cache and records how it is used
+class RecordingIndexCache final : public MsixTest::StackObject<IMsixIndexCache>
+{
+public:
+    RecordingIndexCache(IMsixIndexCache* cache) : m_cache(cache) {}
+
+    // IMsixIndexCache
+    HRESULT STDMETHODCALLTYPE GetEntry(LPCSTR key, IStream** entry) noexcept override
+    {
+        keys.insert(key);
+        HRESULT hr = m_cache->GetEntry(key, entry);
+        if (hr == S_OK && *entry != nullptr) { hits++; }
+        return hr;
+    }
+
+    HRESULT STDMETHODCALLTYPE SetEntry(LPCSTR key, IStream* entry) noexcept override
+    {
+        keys.insert(key);
+        updates++;
+        return m_cache->SetEntry(key, entry);
+    }
+
+    std::set<std::string> keys;
+    int hits = 0;
+    int updates = 0;
+
+private:
+    IMsixIndexCache* m_cache;
+};
+
+// Reopening a package with an index cache loads its block map from the cache
+TEST_CASE("Api_AppxPackageReader_IndexCache", "[api]")
+{
+    auto packagePath = MsixTest::TestPath::GetInstance()->GetPath(MsixTest::TestPath::Directory::Unpack) + "/TestAppxPackage_Win32.appx";
+    auto cacheDirectory = MsixTest::TestPath::GetInstance()->GetRoot() + ".";
+
+    MsixTest::ComPtr<IMsixIndexCache> directoryCache;
+    REQUIRE_SUCCEEDED(CreateIndexCacheOnDirectory(const_cast<char*>(cacheDirectory.c_str()), &directoryCache));
+    RecordingIndexCache indexCache(directoryCache.Get());
+
+    MsixTest::ComPtr<IAppxFactory> factory;
+    REQUIRE_SUCCEEDED(CoCreateAppxFactoryWithHeap(MsixTest::Allocators::Allocate, MsixTest::Allocators::Free,
+        MSIX_VALIDATION_OPTION_ALLOWSIGNATUREORIGINUNKNOWN, &factory));
+    MsixTest::ComPtr<IMsixFactoryOverrides> factoryOverrides;
+    REQUIRE_SUCCEEDED(factory->QueryInterface(UuidOfImpl<IMsixFactoryOverrides>::iid, reinterpret_cast<void**>(&factoryOverrides)));
+    REQUIRE_SUCCEEDED(factoryOverrides->SpecifyExtension(MSIX_FACTORY_EXTENSION_INDEX_CACHE, &indexCache));
+
+    // Describes the block map files and reads every payload file, which checks them against the block hashes
+    auto openPackage = [&]()
+    {
+        auto package = MsixTest::StreamFile(packagePath, true);
+        MsixTest::ComPtr<IAppxPackageReader> packageReader;
+        REQUIRE_SUCCEEDED(factory->CreatePackageReader(package.Get(), &packageReader));
+
+        std::vector<std::string> description;
+        MsixTest::ComPtr<IAppxBlockMapReader> blockMapReader;
+        REQUIRE_SUCCEEDED(packageReader->GetBlockMap(&blockMapReader));
+        MsixTest::ComPtr<IAppxBlockMapFilesEnumerator> blockMapFiles;
+        REQUIRE_SUCCEEDED(blockMapReader->GetFiles(&blockMapFiles));
+        BOOL hasCurrent = FALSE;
+        REQUIRE_SUCCEEDED(blockMapFiles->GetHasCurrent(&hasCurrent));
+        while (hasCurrent)
+        {
+            MsixTest::ComPtr<IAppxBlockMapFile> file;
+            REQUIRE_SUCCEEDED(blockMapFiles->GetCurrent(&file));
+            MsixTest::Wrappers::Buffer<wchar_t> name;
+            REQUIRE_SUCCEEDED(file->GetName(&name));
+            UINT64 size = 0;
+            REQUIRE_SUCCEEDED(file->GetUncompressedSize(&size));
+            description.push_back(name.ToString() + ":" + std::to_string(size));
+            REQUIRE_SUCCEEDED(blockMapFiles->MoveNext(&hasCurrent));
+        }
+
+        MsixTest::ComPtr<IAppxFilesEnumerator> files;
+        REQUIRE_SUCCEEDED(packageReader->GetPayloadFiles(&files));
+        REQUIRE_SUCCEEDED(files->GetHasCurrent(&hasCurrent));
+        std::vector<std::uint8_t> buffer(4096);
+        while (hasCurrent)
+        {
+            MsixTest::ComPtr<IAppxFile> file;
+            REQUIRE_SUCCEEDED(files->GetCurrent(&file));
+            MsixTest::ComPtr<IStream> stream;
+            REQUIRE_SUCCEEDED(file->GetStream(&stream));
+            ULONG bytesRead = 0;
+            do
+            {
+                HRESULT hr = stream->Read(buffer.data(), static_cast<ULONG>(buffer.size()), &bytesRead);
+                REQUIRE_FALSE(FAILED(hr));
+            } while (bytesRead != 0);
+            REQUIRE_SUCCEEDED(files->MoveNext(&hasCurrent));
+        }
+        return description;
+    };
+
+    auto expected = openPackage();
+    REQUIRE_FALSE(expected.empty());
+    REQUIRE(indexCache.keys.size() == 1);
+    REQUIRE(indexCache.hits == 0);
+    REQUIRE(indexCache.updates == 1);
+    auto entryName = cacheDirectory + "/" + *indexCache.keys.begin() + ".idx";
+
+    REQUIRE(openPackage() == expected);
+    REQUIRE(indexCache.hits == 1);
+    REQUIRE(indexCache.updates == 1);
+
+    // A damaged entry is ignored and replaced
+    {
+        auto entryFile = std::fopen(entryName.c_str(), "r+b");
+        REQUIRE(entryFile != nullptr);
+        std::fputs("damaged", entryFile);
+        std::fclose(entryFile);
+    }
+    REQUIRE(openPackage() == expected);
+    REQUIRE(indexCache.updates == 2);
+    REQUIRE(openPackage() == expected);
+    REQUIRE(indexCache.hits == 3);
+    REQUIRE(indexCache.updates == 2);
+    REQUIRE(indexCache.keys.size() == 1);
+
+    // Keys are hexadecimal, so entries stay in the cache directory
+    {
+        auto entry = MsixTest::StreamFile(entryName, true);
+        REQUIRE_HR(static_cast<HRESULT>(MSIX::Error::InvalidParameter), directoryCache->SetEntry("../entry", entry.Get()));
+    }
+    std::remove(entryName.c_str());
+}
+
+// Failures are logged per thread and only the most recent ones are kept
+TEST_CASE("Api_AppxPackageReader_LogText", "[api]")
+{
+    MsixTest::ComPtr<IAppxFactory> factory;
+    REQUIRE_SUCCEEDED(CoCreateAppxFactoryWithHeap(MsixTest::Allocators::Allocate, MsixTest::Allocators::Free, MSIX_VALIDATION_OPTION_SKIPSIGNATURE, &factory));
+    auto getLogText = []()
+    {
+        MsixTest::Wrappers::Buffer<char> text;
+        REQUIRE_SUCCEEDED(MsixGetLogTextUTF8(MsixTest::Allocators::Allocate, &text));
+        return text.ToString();
+    };
+    getLogText();
+
+    auto packagePath = MsixTest::TestPath::GetInstance()->GetPath(MsixTest::TestPath::Directory::Unpack) + "/TestAppxPackage_Win32.appx";
+    auto inputStream = MsixTest::StreamFile(packagePath, true);
+    REQUIRE_HR(static_cast<HRESULT>(MSIX::Error::InvalidParameter), factory->CreatePackageReader(inputStream.Get(), nullptr));
+    auto text = getLogText();
+    REQUIRE(text.find("Call failed in") != std::string::npos);
+    REQUIRE(getLogText().empty());
+
+    // A failure on another thread isn't logged in this thread
+    std::thread([&factory, &inputStream]()
+    {
+        factory->CreatePackageReader(inputStream.Get(), nullptr);
+    }).join();
+    REQUIRE(getLogText().empty());
+
+    for (int i = 0; i < 1000; i++)
+    {
+        factory->CreatePackageReader(inputStream.Get(), nullptr);
+    }
+    text = getLogText();
+    REQUIRE(text.find("earlier log records were dropped") != std::string::npos);
+    REQUIRE(text.size() < 100 * 1024);
+}
+
+// Reads ranges of a local file, standing in for HTTP range requests. Records the ranges read.
+class FileRangeSource final : public MsixTest::StackObject<IMsixRangeSource>
+{
+public:
+    FileRangeSource(IStream* file) : m_file(file) {}
+
+    // IMsixRangeSource
+    HRESULT STDMETHODCALLTYPE GetSize(UINT64* size) noexcept override
+    {
+        LARGE_INTEGER zero = { 0 };
+        ULARGE_INTEGER end = { 0 };
+        HRESULT hr = m_file->Seek(zero, STREAM_SEEK_END, &end);
+        *size = end.QuadPart;
+        return hr;
+    }
+
+    HRESULT STDMETHODCALLTYPE ReadRange(UINT64 offset, UINT32 size, BYTE* buffer) noexcept override
+    {
+        reads++;
+        bytesRead += size;
+        LARGE_INTEGER pos = { 0 };
+        pos.QuadPart = offset;
+        HRESULT hr = m_file->Seek(pos, STREAM_SEEK_SET, nullptr);
+        if (FAILED(hr)) { return hr; }
+        ULONG read = 0;
+        hr = m_file->Read(buffer, size, &read);
+        if (FAILED(hr)) { return hr; }
+        return (read == size) ? S_OK : static_cast<HRESULT>(MSIX::Error::FileRead);
+    }
+
+    int reads = 0;
+    std::uint64_t bytesRead = 0;
+
+private:
+    IStream* m_file;
+};
+
+// A package read over a range source reads the same data as from the file, with a few large reads
+TEST_CASE("Api_AppxPackageReader_RangeSource", "[api]")
+{
+    auto packagePath = MsixTest::TestPath::GetInstance()->GetPath(MsixTest::TestPath::Directory::Unpack) + "/HelloWorld.appx";
+    auto package = MsixTest::StreamFile(packagePath, true);
+    FileRangeSource rangeSource(package.Get());
+    UINT64 packageSize = 0;
+    REQUIRE_SUCCEEDED(rangeSource.GetSize(&packageSize));
+
+    MsixTest::ComPtr<IAppxFactory> factory;
+    REQUIRE_SUCCEEDED(CoCreateAppxFactoryWithHeap(MsixTest::Allocators::Allocate, MsixTest::Allocators::Free,
+        MSIX_VALIDATION_OPTION_SKIPSIGNATURE, &factory));
+    auto readFiles = [](IAppxPackageReader* packageReader)
+    {
+        std::map<std::string, std::vector<std::uint8_t>> result;
+        MsixTest::ComPtr<IAppxFilesEnumerator> files;
+        REQUIRE_SUCCEEDED(packageReader->GetPayloadFiles(&files));
+        BOOL hasCurrent = FALSE;
+        REQUIRE_SUCCEEDED(files->GetHasCurrent(&hasCurrent));
+        std::vector<std::uint8_t> buffer(4096);
+        while (hasCurrent)
+        {
+            MsixTest::ComPtr<IAppxFile> file;
+            REQUIRE_SUCCEEDED(files->GetCurrent(&file));
+            MsixTest::Wrappers::Buffer<wchar_t> name;
+            REQUIRE_SUCCEEDED(file->GetName(&name));
+            MsixTest::ComPtr<IStream> stream;
+            REQUIRE_SUCCEEDED(file->GetStream(&stream));
+            auto& content = result[name.ToString()];
+            ULONG bytesRead = 0;
+            do
+            {
+                HRESULT hr = stream->Read(buffer.data(), static_cast<ULONG>(buffer.size()), &bytesRead);
+                REQUIRE_FALSE(FAILED(hr));
+                content.insert(content.end(), buffer.begin(), buffer.begin() + bytesRead);
+            } while (bytesRead != 0);
+            REQUIRE_SUCCEEDED(files->MoveNext(&hasCurrent));
+        }
+        return result;
+    };
+
+    MsixTest::ComPtr<IAppxPackageReader> fileReader;
+    REQUIRE_SUCCEEDED(factory->CreatePackageReader(package.Get(), &fileReader));
+    auto expected = readFiles(fileReader.Get());
+    REQUIRE(expected.size() > 1);
+
+    MsixTest::ComPtr<IStream> rangeStream;
+    REQUIRE_SUCCEEDED(CreateStreamOnRangeSource(&rangeSource, &rangeStream));
+    MsixTest::ComPtr<IAppxPackageReader> rangeReader;
+    REQUIRE_SUCCEEDED(factory->CreatePackageReader(rangeStream.Get(), &rangeReader));
+    // The end of the package has the central directory and the footprint files
+    CHECK(rangeSource.reads <= 2);
+
+    CHECK(readFiles(rangeReader.Get()) == expected);
+    CHECK(rangeSource.reads < static_cast<int>(expected.size()));
+    CHECK(rangeSource.bytesRead <= packageSize);
+}
+
+// Stands in for the directory a package is unpacked to. Records the size every file is created with and writes
+// the files next to the test, one after the other under the same name.
+class RecordingDirectory final : public MsixTest::StackObject<IDirectoryObject>
+{
+public:
+    // IDirectoryObject
+    MsixTest::ComPtr<IStream> OpenFile(const std::string&, MSIX::FileStream::Mode) override
+    {
+        return MsixTest::ComPtr<IStream>();
+    }
+
+    MsixTest::ComPtr<IStream> OpenFileForWrite(const std::string& fileName, std::uint64_t size) override
+    {
+        auto name = fileName;
+        std::replace(name.begin(), name.end(), '\\', '/');
+        sizes[name] = size;
+        MsixTest::ComPtr<IStream> stream;
+        REQUIRE_SUCCEEDED(CreateStreamOnFile(const_cast<char*>(path.c_str()), false, &stream));
+        return stream;
+    }
+
+    std::multimap<std::uint64_t, std::string> GetFilesByLastModDate() override
+    {
+        return std::multimap<std::uint64_t, std::string>();
+    }
+
+    const std::string path = "unpacked_file.tmp";
+    std::map<std::string, std::uint64_t> sizes;
+};
+
+// Unpack creates every payload file with its size from the block map, which adds up to the size of the payload
+TEST_CASE("Api_AppxPackageReader_UnpackedSize", "[api]")
+{
+    MsixTest::ComPtr<IAppxPackageReader> packageReader;
+    MsixTest::InitializePackageReader("NotepadPlusPlus.appx", &packageReader);
+
+    std::map<std::string, std::uint64_t> payloadSizes;
+    std::uint64_t payloadSize = 0;
+    MsixTest::ComPtr<IAppxFilesEnumerator> files;
+    REQUIRE_SUCCEEDED(packageReader->GetPayloadFiles(&files));
+    BOOL hasCurrent = FALSE;
+    REQUIRE_SUCCEEDED(files->GetHasCurrent(&hasCurrent));
+    while (hasCurrent)
+    {
+        MsixTest::ComPtr<IAppxFile> file;
+        REQUIRE_SUCCEEDED(files->GetCurrent(&file));
+        MsixTest::Wrappers::Buffer<wchar_t> fileName;
+        REQUIRE_SUCCEEDED(file->GetName(&fileName));
+        UINT64 size = 0;
+        REQUIRE_SUCCEEDED(file->GetSize(&size));
+        auto name = fileName.ToString();
+        std::replace(name.begin(), name.end(), '\\', '/');
+        payloadSizes[name] = size;
+        payloadSize += size;
+        REQUIRE_SUCCEEDED(files->MoveNext(&hasCurrent));
+    }
+    REQUIRE(payloadSizes.size() > 1);
+
+    RecordingDirectory directory;
+    MsixTest::ComPtr<IPackage> package;
+    REQUIRE_SUCCEEDED(packageReader->QueryInterface(UuidOfImpl<IPackage>::iid, reinterpret_cast<void**>(&package)));
+    REQUIRE_NOTHROW(package->Unpack(MSIX_PACKUNPACK_OPTION_NONE, MsixTest::ComPtr<IDirectoryObject>(static_cast<IDirectoryObject*>(&directory))));
+    remove(directory.path.c_str());
+
+    std::uint64_t unpackedSize = 0;
+    for (const auto& payloadFile : payloadSizes)
+    {
+        auto unpacked = directory.sizes.find(payloadFile.first);
+        REQUIRE(unpacked != directory.sizes.end());
+        CHECK(unpacked->second == payloadFile.second);
+        unpackedSize += unpacked->second;
+    }
+    CHECK(unpackedSize == payloadSize);
+
+    // Footprint files aren't in the block map, their size isn't known up front
+    CHECK(directory.sizes.at("AppxManifest.xml") == 0);
+    CHECK(directory.sizes.at("AppxBlockMap.xml") == 0);
+}
@@ -11,6 +11,10 @@
 #include "StreamBase.hpp"
 
 #include <iostream>
+#include <fstream>
+#include <iterator>
+#include <numeric>
+#include <algorithm>
 
 using namespace MsixTest::Pack;
 
@@ -160,6 +164,421 @@ TEST_CASE("Api_AppxPackageWriter_good_with_empty_files", "[api]")
     MsixTest::InitializePackageReader(outputStream.Get(), &packageReader);
 }
 
+// Text whose blocks compress to different sizes with each compression option
+std::string MakeText(std::size_t size)
+{
+    std::string text;
+    for (std::uint32_t i = 0; text.size() < size; i++)
+    {
+        text += "line " + std::to_string(i) + " value " + std::to_string(i * 7919 % 1000) + "\n";
+    }
+    return text;
+}
+
+// Writes a package with the given payload files and their content to output, then seeks output back to its start
+void WritePackage(IStream* output, const std::vector<std::pair<std::wstring, std::string>>& files,
+    APPX_COMPRESSION_OPTION compression = APPX_COMPRESSION_OPTION_NORMAL, IStream* basePackage = nullptr)
+{
+    MsixTest::ComPtr<IAppxPackageWriter> packageWriter;
+    InitializePackageWriter(output, &packageWriter);
+    if (basePackage != nullptr)
+    {
+        REQUIRE_SUCCEEDED(packageWriter.As<IMsixPackageWriterBasePackage>()->SetBasePackage(basePackage));
+    }
+    LARGE_INTEGER zero = { 0 };
+    for (const auto& file : files)
+    {
+        auto content = MsixTest::StreamFile("test_file.txt", false, true);
+        REQUIRE_SUCCEEDED(content->Write(file.second.data(), static_cast<ULONG>(file.second.size()), nullptr));
+        REQUIRE_SUCCEEDED(content->Seek(zero, STREAM_SEEK_SET, nullptr));
+        REQUIRE_SUCCEEDED(packageWriter->AddPayloadFile(file.first.c_str(), TestConstants::ContentType.c_str(),
+            compression, content.Get()));
+    }
+    MsixTest::ComPtr<IStream> manifestStream;
+    MakeManifestStream(&manifestStream);
+    REQUIRE_SUCCEEDED(packageWriter->Close(manifestStream.Get()));
+    REQUIRE_SUCCEEDED(output->Seek(zero, STREAM_SEEK_SET, nullptr));
+}
+
+// Test that files spanning many blocks are written in order and that the data read back from the
+// package, after block hash validation and inflate, matches what was added.
+TEST_CASE("Api_AppxPackageWriter_many_blocks_roundtrip", "[api]")
+{
+    auto outputStream = MsixTest::StreamFile("test_package.msix", false, true);
+
+    MsixTest::ComPtr<IAppxPackageWriter> packageWriter;
+    InitializePackageWriter(outputStream.Get(), &packageWriter, true /* enableFileHash */);
+
+    auto contentStream = MsixTest::StreamFile("test_file.txt", false, true);
+    WriteContentToStream(DefaultBlockSize * 37 + 123, contentStream.Get());
+
+    REQUIRE_SUCCEEDED(packageWriter->AddPayloadFile(
+        TestConstants::GoodFileNames[0].second.c_str(),
+        TestConstants::ContentType.c_str(),
+        APPX_COMPRESSION_OPTION_NORMAL,
+        contentStream.Get()));
+    REQUIRE_SUCCEEDED(packageWriter->AddPayloadFile(
+        TestConstants::GoodFileNames[1].second.c_str(),
+        TestConstants::ContentType.c_str(),
+        APPX_COMPRESSION_OPTION_NONE,
+        contentStream.Get()));
+
+    MsixTest::ComPtr<IStream> manifestStream;
+    MakeManifestStream(&manifestStream);
+    REQUIRE_SUCCEEDED(packageWriter->Close(manifestStream.Get()));
+
+    LARGE_INTEGER zero = { 0 };
+    REQUIRE_SUCCEEDED(outputStream.Get()->Seek(zero, STREAM_SEEK_SET, nullptr));
+    MsixTest::ComPtr<IAppxPackageReader> packageReader;
+    MsixTest::InitializePackageReader(outputStream.Get(), &packageReader);
+
+    REQUIRE_SUCCEEDED(contentStream.Get()->Seek(zero, STREAM_SEEK_SET, nullptr));
+    auto expected = MsixTest::ReadStreamContent(contentStream.Get());
+    for (std::size_t i = 0; i < 2; i++)
+    {
+        MsixTest::ComPtr<IAppxFile> file;
+        REQUIRE_SUCCEEDED(packageReader->GetPayloadFile(TestConstants::GoodFileNames[i].second.c_str(), &file));
+        MsixTest::ComPtr<IStream> fileStream;
+        REQUIRE_SUCCEEDED(file->GetStream(&fileStream));
+        auto actual = MsixTest::ReadStreamContent(fileStream.Get());
+        REQUIRE(expected.size() == actual.size());
+        REQUIRE(std::equal(expected.begin(), expected.end(), actual.begin()));
+    }
+}
+
+// Reads of a compressed file smaller than a window are copied from the inflate window, larger reads that start
+// where the window ends are inflated straight into the caller's buffer. Mix both, and seek back after them.
+TEST_CASE("Api_AppxPackageWriter_window_and_direct_reads", "[api]")
+{
+    auto text = MakeText(DefaultBlockSize * 3 + 1000);
+    auto outputStream = MsixTest::StreamFile("test_package.msix", false, true);
+    WritePackage(outputStream.Get(), { { TestConstants::GoodFileNames[0].second, text } });
+
+    MsixTest::ComPtr<IAppxPackageReader> packageReader;
+    MsixTest::InitializePackageReader(outputStream.Get(), &packageReader);
+    MsixTest::ComPtr<IAppxFile> file;
+    REQUIRE_SUCCEEDED(packageReader->GetPayloadFile(TestConstants::GoodFileNames[0].second.c_str(), &file));
+    MsixTest::ComPtr<IStream> fileStream;
+    REQUIRE_SUCCEEDED(file->GetStream(&fileStream));
+
+    // A small read leaves most of the window unread, the next read copies the rest of it then inflates directly.
+    // Seeking back restarts inflating before the position, at the start of the file or of a block.
+    std::vector<std::pair<std::uint64_t, ULONG>> reads = {
+        { 0, 100 },
+        { 100, 65536 },
+        { 65636, 1000 },
+        { 66636, 40000 },
+        { 50, 70000 },
+        { DefaultBlockSize + 10, 40000 },
+        { DefaultBlockSize * 2 + 5000, DefaultBlockSize * 2 } };
+    for (const auto& read : reads)
+    {
+        INFO("Read " << read.second << " bytes at " << read.first);
+        LARGE_INTEGER position = { 0 };
+        position.QuadPart = static_cast<LONGLONG>(read.first);
+        REQUIRE_SUCCEEDED(fileStream->Seek(position, STREAM_SEEK_SET, nullptr));
+        std::vector<char> buffer(read.second);
+        ULONG bytesRead = 0;
+        // The last read goes past the end of the file and returns S_FALSE
+        HRESULT hr = fileStream->Read(buffer.data(), read.second, &bytesRead);
+        REQUIRE(SUCCEEDED(hr));
+        auto expected = text.substr(static_cast<std::size_t>(read.first), read.second);
+        REQUIRE(bytesRead == expected.size());
+        CHECK(std::string(buffer.data(), bytesRead) == expected);
+    }
+}
+
+// Reading a compressed file out of order, each block is inflated from where it starts in the package
+TEST_CASE("Api_AppxPackageWriter_random_access", "[api]")
+{
+    auto text = MakeText(DefaultBlockSize * 6 + 1000);
+    auto outputStream = MsixTest::StreamFile("test_package.msix", false, true);
+    WritePackage(outputStream.Get(), { { TestConstants::GoodFileNames[0].second, text } });
+
+    MsixTest::RecordingStream packageStream(outputStream.Get());
+    MsixTest::ComPtr<IAppxPackageReader> packageReader;
+    MsixTest::InitializePackageReader(&packageStream, &packageReader);
+    MsixTest::ComPtr<IAppxFile> file;
+    REQUIRE_SUCCEEDED(packageReader->GetPayloadFile(TestConstants::GoodFileNames[0].second.c_str(), &file));
+    MsixTest::ComPtr<IStream> fileStream;
+    REQUIRE_SUCCEEDED(file->GetStream(&fileStream));
+
+    // Forward past several blocks, back to an earlier block, across a block boundary, and back to the start
+    std::vector<std::pair<std::uint64_t, ULONG>> reads = {
+        { DefaultBlockSize * 5 + 100, 2000 },
+        { DefaultBlockSize + 7, 500 },
+        { DefaultBlockSize * 3 - 300, 1000 },
+        { DefaultBlockSize * 6, 1000 },
+        { 0, 100 },
+        { DefaultBlockSize * 4 + 50000, 30000 } };
+    std::vector<std::uint64_t> firstReadOffsets;
+    for (const auto& read : reads)
+    {
+        packageStream.readOffsets.clear();
+        LARGE_INTEGER position = { 0 };
+        position.QuadPart = static_cast<LONGLONG>(read.first);
+        REQUIRE_SUCCEEDED(fileStream->Seek(position, STREAM_SEEK_SET, nullptr));
+        std::vector<char> buffer(read.second);
+        ULONG bytesRead = 0;
+        REQUIRE_SUCCEEDED(fileStream->Read(buffer.data(), read.second, &bytesRead));
+        auto expected = text.substr(static_cast<std::size_t>(read.first), read.second);
+        REQUIRE(bytesRead == expected.size());
+        CHECK(std::string(buffer.data(), bytesRead) == expected);
+        REQUIRE(!packageStream.readOffsets.empty());
+        firstReadOffsets.push_back(*std::min_element(packageStream.readOffsets.begin(), packageStream.readOffsets.end()));
+    }
+
+    // Every read starts inflating at its block in the package, not at the beginning of the file
+    auto compressedSizes = MsixTest::GetCompressedBlockSizes(packageReader.Get(), TestConstants::GoodFileNames[0].second);
+    REQUIRE(compressedSizes.size() == 7);
+    auto dataOffset = firstReadOffsets[4];
+    for (std::size_t i = 0; i < reads.size(); i++)
+    {
+        auto block = static_cast<std::size_t>(reads[i].first / DefaultBlockSize);
+        INFO("Read at " << reads[i].first);
+        CHECK(firstReadOffsets[i] == dataOffset + std::accumulate(compressedSizes.begin(), compressedSizes.begin() + block, std::uint64_t(0)));
+    }
+}
+
+// With MSIX_FACTORY_OPTION_READER_PARALLEL_INFLATE large compressed files are inflated by several threads, reads
+// return the data in order wherever they start
+TEST_CASE("Api_AppxPackageWriter_parallel_inflate", "[api]")
+{
+    auto text = MakeText(DefaultBlockSize * 40 + 1234);
+    std::string packageName = "parallel_inflate.msix";
+    WritePackage(MsixTest::StreamFile(packageName, false).Get(), { { L"test.txt", text } });
+
+    auto packageStream = MsixTest::StreamFile(packageName, true);
+    MsixTest::ComPtr<IAppxFactory> factory;
+    REQUIRE_SUCCEEDED(CoCreateAppxFactoryWithHeapAndOptions(MsixTest::Allocators::Allocate, MsixTest::Allocators::Free,
+        MSIX_VALIDATION_OPTION_SKIPSIGNATURE, MSIX_FACTORY_OPTION_READER_PARALLEL_INFLATE, &factory));
+    MsixTest::ComPtr<IAppxPackageReader> packageReader;
+    REQUIRE_SUCCEEDED(factory->CreatePackageReader(packageStream.Get(), &packageReader));
+    MsixTest::ComPtr<IAppxFile> file;
+    REQUIRE_SUCCEEDED(packageReader->GetPayloadFile(L"test.txt", &file));
+    MsixTest::ComPtr<IStream> fileStream;
+    REQUIRE_SUCCEEDED(file->GetStream(&fileStream));
+
+    auto actual = MsixTest::ReadStreamContent(fileStream.Get());
+    CHECK(std::string(actual.begin(), actual.end()) == text);
+
+    LARGE_INTEGER position = { 0 };
+    position.QuadPart = static_cast<LONGLONG>(DefaultBlockSize * 3 + 17);
+    REQUIRE_SUCCEEDED(fileStream->Seek(position, STREAM_SEEK_SET, nullptr));
+    std::vector<char> buffer(1000);
+    ULONG bytesRead = 0;
+    REQUIRE_SUCCEEDED(fileStream->Read(buffer.data(), 1000, &bytesRead));
+    CHECK(std::string(buffer.data(), bytesRead) == text.substr(DefaultBlockSize * 3 + 17, 1000));
+
+    auto outputDir = MsixTest::TestPath::GetInstance()->GetPath(MsixTest::TestPath::Directory::Output);
+    REQUIRE_SUCCEEDED(UnpackPackage(MSIX_PACKUNPACK_OPTION_NONE, MSIX_VALIDATION_OPTION_SKIPSIGNATURE,
+        const_cast<char*>(packageName.c_str()), const_cast<char*>(outputDir.c_str())));
+    std::ifstream unpacked(outputDir + "/test.txt", std::ios::binary);
+    CHECK(std::string(std::istreambuf_iterator<char>(unpacked), std::istreambuf_iterator<char>()) == text);
+    unpacked.close();
+
+    CHECK(MsixTest::Directory::CleanDirectory(outputDir));
+    remove(packageName.c_str());
+}
+
+// Blocks that didn't change are copied from the base package, the changed block is deflated again.
+TEST_CASE("Api_AppxPackageWriter_base_package", "[api]")
+{
+    auto baseText = MakeText(DefaultBlockSize * 5);
+    const std::size_t changedBlock = 2;
+    auto text = baseText;
+    text[DefaultBlockSize * changedBlock + 10] = '#';
+
+    const auto& fileName = TestConstants::GoodFileNames[0].second;
+    auto basePackage = MsixTest::StreamFile("base_package.msix", false, true);
+    WritePackage(basePackage.Get(), { { fileName, baseText } }, APPX_COMPRESSION_OPTION_MAXIMUM);
+    auto controlPackage = MsixTest::StreamFile("control_package.msix", false, true);
+    WritePackage(controlPackage.Get(), { { fileName, text } }, APPX_COMPRESSION_OPTION_SUPERFAST);
+    auto outputPackage = MsixTest::StreamFile("test_package.msix", false, true);
+    WritePackage(outputPackage.Get(), { { fileName, text } }, APPX_COMPRESSION_OPTION_SUPERFAST, basePackage.Get());
+
+    MsixTest::ComPtr<IAppxPackageReader> baseReader;
+    MsixTest::InitializePackageReader(basePackage.Get(), &baseReader);
+    MsixTest::ComPtr<IAppxPackageReader> controlReader;
+    MsixTest::InitializePackageReader(controlPackage.Get(), &controlReader);
+    MsixTest::ComPtr<IAppxPackageReader> outputReader;
+    MsixTest::InitializePackageReader(outputPackage.Get(), &outputReader);
+    auto baseSizes = MsixTest::GetCompressedBlockSizes(baseReader.Get(), fileName);
+    auto controlSizes = MsixTest::GetCompressedBlockSizes(controlReader.Get(), fileName);
+    auto outputSizes = MsixTest::GetCompressedBlockSizes(outputReader.Get(), fileName);
+    REQUIRE(baseSizes.size() == 6);
+    REQUIRE(controlSizes.size() == baseSizes.size());
+    REQUIRE(outputSizes.size() == baseSizes.size());
+    REQUIRE(controlSizes != baseSizes);
+    for (std::size_t i = 0; i < outputSizes.size(); i++)
+    {
+        CHECK(outputSizes[i] == ((i == changedBlock) ? controlSizes[i] : baseSizes[i]));
+    }
+
+    MsixTest::ComPtr<IAppxFile> file;
+    REQUIRE_SUCCEEDED(outputReader->GetPayloadFile(fileName.c_str(), &file));
+    MsixTest::ComPtr<IStream> fileStream;
+    REQUIRE_SUCCEEDED(file->GetStream(&fileStream));
+    auto actual = MsixTest::ReadStreamContent(fileStream.Get());
+    REQUIRE(actual.size() == text.size());
+    REQUIRE(std::equal(actual.begin(), actual.end(), text.begin()));
+}
+
+// The blocks deflated by the writer, with the block deflater of DEFLATE_BACKEND or with zlib, inflate in order with the
+// inflate stream of the reader and are full flush blocks of their data, so a package with the same file copies them all.
+TEST_CASE("Api_AppxPackageWriter_deflated_blocks", "[api]")
+{
+    auto text = MakeText(DefaultBlockSize * 4 + 1000);
+    const auto& fileName = TestConstants::GoodFileNames[0].second;
+    for (auto compression : { APPX_COMPRESSION_OPTION_SUPERFAST, APPX_COMPRESSION_OPTION_FAST, APPX_COMPRESSION_OPTION_MAXIMUM })
+    {
+        INFO("Compression option " << compression);
+        auto other = (compression == APPX_COMPRESSION_OPTION_MAXIMUM) ? APPX_COMPRESSION_OPTION_SUPERFAST : APPX_COMPRESSION_OPTION_MAXIMUM;
+        auto basePackage = MsixTest::StreamFile("base_package.msix", false, true);
+        WritePackage(basePackage.Get(), { { fileName, text } }, compression);
+        auto controlPackage = MsixTest::StreamFile("control_package.msix", false, true);
+        WritePackage(controlPackage.Get(), { { fileName, text } }, other);
+        auto outputPackage = MsixTest::StreamFile("test_package.msix", false, true);
+        WritePackage(outputPackage.Get(), { { fileName, text } }, other, basePackage.Get());
+
+        MsixTest::ComPtr<IAppxPackageReader> baseReader;
+        MsixTest::InitializePackageReader(basePackage.Get(), &baseReader);
+        MsixTest::ComPtr<IAppxPackageReader> controlReader;
+        MsixTest::InitializePackageReader(controlPackage.Get(), &controlReader);
+        MsixTest::ComPtr<IAppxPackageReader> outputReader;
+        MsixTest::InitializePackageReader(outputPackage.Get(), &outputReader);
+        auto baseSizes = MsixTest::GetCompressedBlockSizes(baseReader.Get(), fileName);
+        REQUIRE(baseSizes.size() == 5);
+        REQUIRE(MsixTest::GetCompressedBlockSizes(controlReader.Get(), fileName) != baseSizes);
+        CHECK(MsixTest::GetCompressedBlockSizes(outputReader.Get(), fileName) == baseSizes);
+
+        // Read from the start to the end, the file is inflated as one stream
+        for (auto packageReader : { baseReader.Get(), outputReader.Get() })
+        {
+            MsixTest::ComPtr<IAppxFile> file;
+            REQUIRE_SUCCEEDED(packageReader->GetPayloadFile(fileName.c_str(), &file));
+            MsixTest::ComPtr<IStream> fileStream;
+            REQUIRE_SUCCEEDED(file->GetStream(&fileStream));
+            auto actual = MsixTest::ReadStreamContent(fileStream.Get());
+            CHECK(std::string(actual.begin(), actual.end()) == text);
+        }
+    }
+}
+
+// Unpacks a package, then updates the directory to a version of the package where a block of a file changed,
+// a file was added and another one removed.
+TEST_CASE("Api_AppxPackageWriter_update_directory", "[api]")
+{
+    auto text = MakeText(DefaultBlockSize * 5);
+    auto newText = text;
+    newText[DefaultBlockSize * 2 + 10] = '#';
+    std::string removedText = "removed file";
+    std::string addedText = "added file";
+
+    auto readFile = [](const std::string& fileName)
+    {
+        std::ifstream file(fileName, std::ios::binary);
+        return std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    };
+
+    std::string oldPackage = "update_old.msix";
+    std::string newPackage = "update_new.msix";
+    WritePackage(MsixTest::StreamFile(oldPackage, false).Get(), { { L"test.txt", text }, { L"essay.doc", removedText } });
+    WritePackage(MsixTest::StreamFile(newPackage, false).Get(), { { L"test.txt", newText }, { L"%%41.txt", addedText } });
+
+    auto outputDir = MsixTest::TestPath::GetInstance()->GetPath(MsixTest::TestPath::Directory::Output);
+    REQUIRE_SUCCEEDED(UnpackPackage(MSIX_PACKUNPACK_OPTION_NONE, MSIX_VALIDATION_OPTION_SKIPSIGNATURE,
+        const_cast<char*>(oldPackage.c_str()), const_cast<char*>(outputDir.c_str())));
+
+    MSIX_UPDATE_STATISTICS statistics = {};
+    REQUIRE_SUCCEEDED(UpdatePackageDirectory(MSIX_VALIDATION_OPTION_SKIPSIGNATURE, const_cast<char*>(newPackage.c_str()),
+        const_cast<char*>(outputDir.c_str()), &statistics));
+
+    CHECK(readFile(outputDir + "/test.txt") == newText);
+    CHECK(readFile(outputDir + "/%%41.txt") == addedText);
+    CHECK_FALSE(std::ifstream(outputDir + "/essay.doc").is_open());
+    CHECK_FALSE(std::ifstream(outputDir + "/test.txt.msixupdate").is_open());
+
+    // Only the changed block of test.txt is read from the package
+    CHECK(statistics.bytesCopied >= DefaultBlockSize * 4);
+    std::ifstream packageFile(newPackage, std::ios::binary | std::ios::ate);
+    CHECK(statistics.bytesRead < static_cast<std::uint64_t>(packageFile.tellg()) / 2);
+    packageFile.close();
+
+    // The directory of the new version can be updated again
+    REQUIRE_SUCCEEDED(UpdatePackageDirectory(MSIX_VALIDATION_OPTION_SKIPSIGNATURE, const_cast<char*>(oldPackage.c_str()),
+        const_cast<char*>(outputDir.c_str()), &statistics));
+    CHECK(readFile(outputDir + "/test.txt") == text);
+    CHECK(readFile(outputDir + "/essay.doc") == removedText);
+    CHECK_FALSE(std::ifstream(outputDir + "/%%41.txt").is_open());
+
+    CHECK(MsixTest::Directory::CleanDirectory(outputDir));
+    remove(oldPackage.c_str());
+    remove(newPackage.c_str());
+}
+
+// Unpacks many files spread over nested directories, one after the other and in parallel. Each directory is
+// only created once and the space of the files is reserved before they are written, they must still end up
+// with exactly their content.
+TEST_CASE("Api_AppxPackageWriter_unpack_nested_directories", "[api]")
+{
+#ifdef WIN32
+    const std::string separator = "\\";
+#else
+    const std::string separator = "/";
+#endif
+    // Empty files, files smaller than a block and files of a few blocks
+    std::vector<std::pair<std::string, std::string>> files;
+    for (std::uint32_t i = 0; i < 120; i++)
+    {
+        auto name = "dir" + std::to_string(i % 3) + separator + "sub" + std::to_string(i % 5) + separator +
+            "deep" + std::to_string(i % 2) + separator + "file" + std::to_string(i) + ".txt";
+        std::size_t size = (i % 10 == 0) ? 0 : ((i % 10 == 1) ? (DefaultBlockSize * 2 + i) : (i * 97));
+        std::string content;
+        for (std::uint32_t line = 0; content.size() < size; line++)
+        {
+            content += name + " line " + std::to_string(line) + "\n";
+        }
+        content.resize(size);
+        files.emplace_back(std::move(name), std::move(content));
+    }
+    files.emplace_back("root.txt", "file at the root of the package");
+
+    std::string packageName = "nested_directories.msix";
+    {
+        auto output = MsixTest::StreamFile(packageName, false);
+        MsixTest::ComPtr<IAppxPackageWriter> packageWriter;
+        InitializePackageWriter(output.Get(), &packageWriter);
+        for (const auto& file : files)
+        {
+            auto content = MsixTest::StreamFile("test_file.txt", false, true);
+            REQUIRE_SUCCEEDED(content->Write(file.second.data(), static_cast<ULONG>(file.second.size()), nullptr));
+            LARGE_INTEGER zero = { 0 };
+            REQUIRE_SUCCEEDED(content->Seek(zero, STREAM_SEEK_SET, nullptr));
+            REQUIRE_SUCCEEDED(packageWriter->AddPayloadFile(MsixTest::String::utf8_to_utf16(file.first).c_str(),
+                TestConstants::ContentType.c_str(), APPX_COMPRESSION_OPTION_NORMAL, content.Get()));
+        }
+        MsixTest::ComPtr<IStream> manifestStream;
+        MakeManifestStream(&manifestStream);
+        REQUIRE_SUCCEEDED(packageWriter->Close(manifestStream.Get()));
+    }
+
+    auto outputDir = MsixTest::TestPath::GetInstance()->GetPath(MsixTest::TestPath::Directory::Output);
+    for (auto option : { MSIX_PACKUNPACK_OPTION_NONE, MSIX_PACKUNPACK_OPTION_PARALLELUNPACK })
+    {
+        REQUIRE_SUCCEEDED(UnpackPackage(option, MSIX_VALIDATION_OPTION_SKIPSIGNATURE,
+            const_cast<char*>(packageName.c_str()), const_cast<char*>(outputDir.c_str())));
+        for (const auto& file : files)
+        {
+            std::ifstream unpacked(outputDir + separator + file.first, std::ios::binary);
+            REQUIRE(unpacked.is_open());
+            CHECK(std::string(std::istreambuf_iterator<char>(unpacked), std::istreambuf_iterator<char>()) == file.second);
+        }
+        CHECK(MsixTest::Directory::CleanDirectory(outputDir));
+    }
+    remove(packageName.c_str());
+}
+
 // Create new package writer to write out a package with no payload files
 TEST_CASE("Api_AppxPackageWriter_good_no_payload", "[api]")
 {
@@ -0,0 +1,188 @@
+//
+//  Copyright (C) 2019 Microsoft.  All rights reserved.
+//  See LICENSE file in the project root for full license information.
+//
+// Throughput benchmarks. They are hidden and only run when requested explicitly,
+// for example: msixtest [benchmark]
+#include "catch.hpp"
+#include "msixtest_int.hpp"
+#include "macros.hpp"
+#include "FileHelpers.hpp"
+#include "PackTestData.hpp"
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+
+    // Payload size used by the benchmarks. Defaults to 2GB, set MSIXTEST_BENCHMARK_SIZE_MB
+    // to use a different size.
+    std::uint64_t GetBenchmarkPayloadSize()
+    {
+        std::uint64_t sizeInMB = 2048;
+        const char* value = std::getenv("MSIXTEST_BENCHMARK_SIZE_MB");
+        if (value != nullptr && std::atoi(value) > 0)
+        {
+            sizeInMB = static_cast<std::uint64_t>(std::atoi(value));
+        }
+        return sizeInMB * 1024 * 1024;
+    }
+
+    // Number of iterations used by the count based benchmarks. Defaults to 1000, set
+    // MSIXTEST_BENCHMARK_ITERATIONS to use a different number.
+    int GetBenchmarkIterations()
+    {
+        int iterations = 1000;
+        const char* value = std::getenv("MSIXTEST_BENCHMARK_ITERATIONS");
+        if (value != nullptr && std::atoi(value) > 0)
+        {
+            iterations = std::atoi(value);
+        }
+        return iterations;
+    }
+
+    void PrintThroughput(const std::string& name, std::uint64_t bytes, std::chrono::steady_clock::duration elapsed)
+    {
+        auto seconds = std::chrono::duration<double>(elapsed).count();
+        std::cout << "\t" << name << ": " << (bytes / (1024 * 1024)) << " MB in " << seconds << " s, "
+                  << (seconds > 0 ? (bytes / (1024.0 * 1024.0)) / seconds : 0) << " MB/s" << std::endl;
+    }
+}
+
+// Packs a single large payload file and measures how fast UnpackPackage extracts it.
+TEST_CASE("Benchmark_Unpack", "[.][benchmark]")
+{
+    auto payloadSize = GetBenchmarkPayloadSize();
+    auto outputDir = MsixTest::TestPath::GetInstance()->GetPath(MsixTest::TestPath::Directory::Output);
+    std::string packageName = "benchmark_package.msix";
+
+    {
+        auto outputStream = MsixTest::StreamFile(packageName, false);
+
+        MsixTest::ComPtr<IAppxFactory> appxFactory;
+        REQUIRE_SUCCEEDED(CoCreateAppxFactoryWithHeap(MsixTest::Allocators::Allocate, MsixTest::Allocators::Free,
+            MSIX_VALIDATION_OPTION_SKIPSIGNATURE, &appxFactory));
+        MsixTest::ComPtr<IAppxPackageWriter> packageWriter;
+        REQUIRE_SUCCEEDED(appxFactory->CreatePackageWriter(outputStream.Get(), nullptr, &packageWriter));
+
+        auto contentStream = MsixTest::StreamFile("benchmark_payload.bin", false, true);
+        MsixTest::Pack::WriteContentToStream(payloadSize, contentStream.Get());
+
+        auto start = std::chrono::steady_clock::now();
+        REQUIRE_SUCCEEDED(packageWriter->AddPayloadFile(
+            L"payload.bin",
+            MsixTest::Pack::TestConstants::ContentType.c_str(),
+            APPX_COMPRESSION_OPTION_NORMAL,
+            contentStream.Get()));
+
+        MsixTest::ComPtr<IStream> manifestStream;
+        MsixTest::Pack::MakeManifestStream(&manifestStream);
+        REQUIRE_SUCCEEDED(packageWriter->Close(manifestStream.Get()));
+        PrintThroughput("Pack", payloadSize, std::chrono::steady_clock::now() - start);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    REQUIRE_SUCCEEDED(UnpackPackage(MSIX_PACKUNPACK_OPTION_NONE,
+                                    MSIX_VALIDATION_OPTION_SKIPSIGNATURE,
+                                    const_cast<char*>(packageName.c_str()),
+                                    const_cast<char*>(outputDir.c_str())));
+    PrintThroughput("Unpack", payloadSize, std::chrono::steady_clock::now() - start);
+
+    CHECK(MsixTest::Directory::CleanDirectory(outputDir));
+    remove(packageName.c_str());
+}
+
+// Packs a single large payload file with each compression option and measures how fast it is deflated, then how
+// fast the package reader inflates it. Build with -DDEFLATE_BACKEND=[zlib|libdeflate] and compare the results.
+TEST_CASE("Benchmark_Compression", "[.][benchmark]")
+{
+    auto payloadSize = GetBenchmarkPayloadSize();
+    std::string packageName = "benchmark_compression.msix";
+    auto contentStream = MsixTest::StreamFile("benchmark_payload.bin", false, true);
+    MsixTest::Pack::WriteContentToStream(payloadSize, contentStream.Get());
+
+    std::vector<std::pair<APPX_COMPRESSION_OPTION, std::string>> options = {
+        { APPX_COMPRESSION_OPTION_NORMAL, "Normal" },
+        { APPX_COMPRESSION_OPTION_FAST, "Fast" },
+        { APPX_COMPRESSION_OPTION_SUPERFAST, "SuperFast" } };
+    for (const auto& option : options)
+    {
+        MsixTest::ComPtr<IAppxFactory> appxFactory;
+        REQUIRE_SUCCEEDED(CoCreateAppxFactoryWithHeap(MsixTest::Allocators::Allocate, MsixTest::Allocators::Free,
+            MSIX_VALIDATION_OPTION_SKIPSIGNATURE, &appxFactory));
+        {
+            auto outputStream = MsixTest::StreamFile(packageName, false);
+            MsixTest::ComPtr<IAppxPackageWriter> packageWriter;
+            REQUIRE_SUCCEEDED(appxFactory->CreatePackageWriter(outputStream.Get(), nullptr, &packageWriter));
+
+            LARGE_INTEGER zero = { 0 };
+            REQUIRE_SUCCEEDED(contentStream->Seek(zero, STREAM_SEEK_SET, nullptr));
+            auto start = std::chrono::steady_clock::now();
+            REQUIRE_SUCCEEDED(packageWriter->AddPayloadFile(
+                L"payload.bin",
+                MsixTest::Pack::TestConstants::ContentType.c_str(),
+                option.first,
+                contentStream.Get()));
+
+            MsixTest::ComPtr<IStream> manifestStream;
+            MsixTest::Pack::MakeManifestStream(&manifestStream);
+            REQUIRE_SUCCEEDED(packageWriter->Close(manifestStream.Get()));
+            PrintThroughput("Deflate " + option.second, payloadSize, std::chrono::steady_clock::now() - start);
+
+            ULARGE_INTEGER packageSize = { 0 };
+            REQUIRE_SUCCEEDED(outputStream->Seek(zero, STREAM_SEEK_END, &packageSize));
+            std::cout << "\t\tPackage size: " << (packageSize.QuadPart * 100.0 / payloadSize) << "% of the payload" << std::endl;
+        }
+
+        auto inputStream = MsixTest::StreamFile(packageName, true);
+        MsixTest::ComPtr<IAppxPackageReader> packageReader;
+        REQUIRE_SUCCEEDED(appxFactory->CreatePackageReader(inputStream.Get(), &packageReader));
+        MsixTest::ComPtr<IAppxFile> file;
+        REQUIRE_SUCCEEDED(packageReader->GetPayloadFile(L"payload.bin", &file));
+        MsixTest::ComPtr<IStream> payloadStream;
+        REQUIRE_SUCCEEDED(file->GetStream(&payloadStream));
+
+        auto start = std::chrono::steady_clock::now();
+        std::vector<std::uint8_t> buffer(1024 * 1024);
+        std::uint64_t total = 0;
+        ULONG bytesRead = 0;
+        do
+        {
+            auto hr = payloadStream->Read(buffer.data(), static_cast<ULONG>(buffer.size()), &bytesRead);
+            REQUIRE_FALSE(FAILED(hr));
+            total += bytesRead;
+        } while (bytesRead > 0);
+        PrintThroughput("Inflate " + option.second, total, std::chrono::steady_clock::now() - start);
+        CHECK(total == payloadSize);
+    }
+    remove(packageName.c_str());
+}
+
+// Opens the same package repeatedly with one factory and measures how many manifests are parsed per
+// second. Every open parses and validates the content types, block map and manifest.
+TEST_CASE("Benchmark_ManifestParse", "[.][benchmark]")
+{
+    auto iterations = GetBenchmarkIterations();
+    auto packagePath = MsixTest::TestPath::GetInstance()->GetPath(MsixTest::TestPath::Directory::Unpack) + "/TestAppxPackage_Win32.appx";
+
+    MsixTest::ComPtr<IAppxFactory> appxFactory;
+    REQUIRE_SUCCEEDED(CoCreateAppxFactoryWithHeap(MsixTest::Allocators::Allocate, MsixTest::Allocators::Free,
+        MSIX_VALIDATION_OPTION_SKIPSIGNATURE, &appxFactory));
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; i++)
+    {
+        auto inputStream = MsixTest::StreamFile(packagePath, true);
+        MsixTest::ComPtr<IAppxPackageReader> packageReader;
+        REQUIRE_SUCCEEDED(appxFactory->CreatePackageReader(inputStream.Get(), &packageReader));
+        MsixTest::ComPtr<IAppxManifestReader> manifestReader;
+        REQUIRE_SUCCEEDED(packageReader->GetManifest(&manifestReader));
+    }
+    auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "\tManifestParse: " << iterations << " packages in " << seconds << " s, "
+              << (seconds > 0 ? iterations / seconds : 0) << " manifests/s" << std::endl;
+}
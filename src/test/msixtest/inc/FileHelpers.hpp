@@ -11,6 +11,8 @@ namespace MsixTest {
     {
         bool CleanDirectory(const std::string& directory);
         bool CompareDirectory(const std::string& directory, const std::map<std::string, std::uint64_t>& files);
+        // Verifies both directories hold the same files with the same content
+        bool CompareDirectories(const std::string& expected, const std::string& actual);
 
         std::string PathAsCurrentPlatform(const std::string& path);
         std::string PathAsAbsolute(const std::string& path);
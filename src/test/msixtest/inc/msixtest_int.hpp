@@ -13,6 +13,7 @@
 
 #include <string>
 #include <map>
+#include <vector>
 
 namespace MsixTest {
 
@@ -117,9 +118,101 @@ namespace MsixTest {
     void InitializeBundleReader(const std::string& package, IAppxBundleReader** bundleReader);
     void InitializeManifestReader(const std::string& manifest, IAppxManifestReader** manifestReader);
 
+    // Stream helpers
+    std::vector<std::uint8_t> ReadStreamContent(IStream* stream);
+    // Returns the compressed sizes of the blocks of fileName from the block map
+    std::vector<std::uint64_t> GetCompressedBlockSizes(IAppxPackageReader* packageReader, const std::wstring& fileName);
+
     // Use the product ComPtr; enables sharing without updating every qualified use.
     using MSIX::ComPtr;
 
+    // IUnknown of a test object that implements interface I, for tests that hand an object of their own to
+    // the packaging APIs. The object lives on the stack of the test, so it isn't deleted when the last
+    // reference is released.
+    template <class I>
+    class StackObject : public I
+    {
+    public:
+        HRESULT STDMETHODCALLTYPE QueryInterface(REFIID riid, void** ppvObject) noexcept override
+        {
+            if (riid == UuidOfImpl<IUnknown>::iid || riid == UuidOfImpl<I>::iid)
+            {
+                *ppvObject = static_cast<I*>(this);
+                AddRef();
+                return S_OK;
+            }
+            *ppvObject = nullptr;
+            return static_cast<HRESULT>(MSIX::Error::NoInterface);
+        }
+        ULONG STDMETHODCALLTYPE AddRef() noexcept override { return ++m_references; }
+        ULONG STDMETHODCALLTYPE Release() noexcept override { return --m_references; }
+
+    private:
+        ULONG m_references = 1;
+    };
+
+    // Forwards to the stream of a package and records where it is read
+    class RecordingStream final : public StackObject<IStream>
+    {
+    public:
+        RecordingStream(IStream* stream) : m_stream(stream) {}
+
+        // ISequentialStream
+        HRESULT STDMETHODCALLTYPE Read(void* buffer, ULONG countBytes, ULONG* bytesRead) noexcept override
+        {
+            LARGE_INTEGER zero = { 0 };
+            ULARGE_INTEGER position = { 0 };
+            HRESULT hr = m_stream->Seek(zero, STREAM_SEEK_CUR, &position);
+            if (FAILED(hr)) { return hr; }
+            readOffsets.push_back(position.QuadPart);
+            return m_stream->Read(buffer, countBytes, bytesRead);
+        }
+
+        HRESULT STDMETHODCALLTYPE Write(const void* buffer, ULONG countBytes, ULONG* bytesWritten) noexcept override
+        {
+            return m_stream->Write(buffer, countBytes, bytesWritten);
+        }
+
+        // IStream
+        HRESULT STDMETHODCALLTYPE Seek(LARGE_INTEGER move, DWORD origin, ULARGE_INTEGER* newPosition) noexcept override
+        {
+            return m_stream->Seek(move, origin, newPosition);
+        }
+
+        HRESULT STDMETHODCALLTYPE SetSize(ULARGE_INTEGER size) noexcept override { return m_stream->SetSize(size); }
+
+        HRESULT STDMETHODCALLTYPE CopyTo(IStream*, ULARGE_INTEGER, ULARGE_INTEGER*, ULARGE_INTEGER*) noexcept override
+        {
+            return static_cast<HRESULT>(MSIX::Error::NotImplemented);
+        }
+
+        HRESULT STDMETHODCALLTYPE Commit(DWORD flags) noexcept override { return m_stream->Commit(flags); }
+        HRESULT STDMETHODCALLTYPE Revert() noexcept override { return m_stream->Revert(); }
+
+        HRESULT STDMETHODCALLTYPE LockRegion(ULARGE_INTEGER offset, ULARGE_INTEGER count, DWORD type) noexcept override
+        {
+            return m_stream->LockRegion(offset, count, type);
+        }
+
+        HRESULT STDMETHODCALLTYPE UnlockRegion(ULARGE_INTEGER offset, ULARGE_INTEGER count, DWORD type) noexcept override
+        {
+            return m_stream->UnlockRegion(offset, count, type);
+        }
+
+        HRESULT STDMETHODCALLTYPE Stat(STATSTG* statStg, DWORD flag) noexcept override { return m_stream->Stat(statStg, flag); }
+
+        // The package is read through this stream only
+        HRESULT STDMETHODCALLTYPE Clone(IStream**) noexcept override
+        {
+            return static_cast<HRESULT>(MSIX::Error::NotImplemented);
+        }
+
+        std::vector<std::uint64_t> readOffsets;
+
+    private:
+        IStream* m_stream;
+    };
+
     // Helper class that creates a stream from a given file name.
     // toRead - true if the file already exists, false to create it
     // toDelete - true if the file should be deleted when the this object
@@ -179,6 +179,44 @@ namespace MsixTest {
         REQUIRE_NOT_NULL(*manifestReader);
     }
 
+    std::vector<std::uint8_t> ReadStreamContent(IStream* stream)
+    {
+        std::vector<std::uint8_t> content;
+        std::vector<std::uint8_t> buffer(65536);
+        ULONG bytesRead = 0;
+        do
+        {
+            // Streams return S_FALSE when reading less than requested
+            HRESULT hr = stream->Read(buffer.data(), static_cast<ULONG>(buffer.size()), &bytesRead);
+            REQUIRE((hr == S_OK || hr == S_FALSE));
+            content.insert(content.end(), buffer.begin(), buffer.begin() + bytesRead);
+        } while (bytesRead > 0);
+        return content;
+    }
+
+    std::vector<std::uint64_t> GetCompressedBlockSizes(IAppxPackageReader* packageReader, const std::wstring& fileName)
+    {
+        ComPtr<IAppxBlockMapReader> blockMapReader;
+        REQUIRE_SUCCEEDED(packageReader->GetBlockMap(&blockMapReader));
+        ComPtr<IAppxBlockMapFile> blockMapFile;
+        REQUIRE_SUCCEEDED(blockMapReader->GetFile(fileName.c_str(), &blockMapFile));
+        ComPtr<IAppxBlockMapBlocksEnumerator> blocks;
+        REQUIRE_SUCCEEDED(blockMapFile->GetBlocks(&blocks));
+        std::vector<std::uint64_t> sizes;
+        BOOL hasCurrent = FALSE;
+        REQUIRE_SUCCEEDED(blocks->GetHasCurrent(&hasCurrent));
+        while (hasCurrent)
+        {
+            ComPtr<IAppxBlockMapBlock> block;
+            REQUIRE_SUCCEEDED(blocks->GetCurrent(&block));
+            UINT32 size = 0;
+            REQUIRE_SUCCEEDED(block->GetCompressedSize(&size));
+            sizes.push_back(size);
+            REQUIRE_SUCCEEDED(blocks->MoveNext(&hasCurrent));
+        }
+        return sizes;
+    }
+
     StreamFile::StreamFile(std::string fileName, bool toRead, bool toDelete): m_toDelete(toDelete)
     {
         InitializeStream(fileName, toRead);
@@ -11,6 +11,8 @@
 #include "PackValidation.hpp"
 
 #include <iostream>
+#include <fstream>
+#include <map>
 
 static std::string outputPackage = "package.msix";
 
@@ -61,6 +63,103 @@ TEST_CASE("Pack_Good_EndsWithSeparator", "[pack]")
     MsixTest::Pack::ValidatePackageStream(outputPackage);
 }
 
+TEST_CASE("Pack_Good_CompressionOptions", "[pack]")
+{
+    auto testData = MsixTest::TestPath::GetInstance();
+    auto directoryPath = MsixTest::Directory::PathAsCurrentPlatform(
+        testData->GetPath(MsixTest::TestPath::Directory::Pack) + "/input");
+
+    std::map<APPX_COMPRESSION_OPTION, std::uint64_t> packageSizes;
+    for (auto compression : { APPX_COMPRESSION_OPTION_NONE, APPX_COMPRESSION_OPTION_SUPERFAST,
+                              APPX_COMPRESSION_OPTION_FAST, APPX_COMPRESSION_OPTION_MAXIMUM })
+    {
+        REQUIRE_SUCCEEDED(PackPackageWithCompressionOption(MSIX_PACKUNPACK_OPTION::MSIX_PACKUNPACK_OPTION_NONE,
+                                                           MSIX_VALIDATION_OPTION::MSIX_VALIDATION_OPTION_SKIPSIGNATURE,
+                                                           compression,
+                                                           const_cast<char*>(directoryPath.c_str()),
+                                                           const_cast<char*>(outputPackage.c_str())));
+
+        std::ifstream package(outputPackage, std::ios::binary | std::ios::ate);
+        REQUIRE(package.is_open());
+        packageSizes[compression] = static_cast<std::uint64_t>(package.tellg());
+        package.close();
+
+        // The block map changes with the compressed sizes, the payload must round trip regardless.
+        auto outputStream = MsixTest::StreamFile(outputPackage, true, true);
+        auto outputDir = testData->GetPath(MsixTest::TestPath::Directory::Output);
+        REQUIRE_SUCCEEDED(UnpackPackageFromStream(MSIX_PACKUNPACK_OPTION::MSIX_PACKUNPACK_OPTION_NONE,
+                                                  MSIX_VALIDATION_OPTION::MSIX_VALIDATION_OPTION_SKIPSIGNATURE,
+                                                  outputStream.Get(),
+                                                  const_cast<char*>(outputDir.c_str())));
+
+        auto files = MsixTest::Pack::GetExpectedFiles();
+        std::ifstream blockMap(outputDir + "/AppxBlockMap.xml", std::ios::binary | std::ios::ate);
+        REQUIRE(blockMap.is_open());
+        files["AppxBlockMap.xml"] = static_cast<std::uint64_t>(blockMap.tellg());
+        blockMap.close();
+        CHECK(MsixTest::Directory::CompareDirectory(outputDir, files));
+        CHECK(MsixTest::Directory::CleanDirectory(outputDir));
+    }
+
+    // The option must reach the deflate level, which shows in the size of the package.
+    CHECK(packageSizes[APPX_COMPRESSION_OPTION_MAXIMUM] < packageSizes[APPX_COMPRESSION_OPTION_SUPERFAST]);
+    CHECK(packageSizes[APPX_COMPRESSION_OPTION_FAST] <= packageSizes[APPX_COMPRESSION_OPTION_SUPERFAST]);
+    CHECK(packageSizes[APPX_COMPRESSION_OPTION_SUPERFAST] < packageSizes[APPX_COMPRESSION_OPTION_NONE]);
+
+    REQUIRE_HR(static_cast<HRESULT>(MSIX::Error::InvalidParameter),
+        PackPackageWithCompressionOption(MSIX_PACKUNPACK_OPTION::MSIX_PACKUNPACK_OPTION_NONE,
+                                         MSIX_VALIDATION_OPTION::MSIX_VALIDATION_OPTION_SKIPSIGNATURE,
+                                         static_cast<APPX_COMPRESSION_OPTION>(42),
+                                         const_cast<char*>(directoryPath.c_str()),
+                                         const_cast<char*>(outputPackage.c_str())));
+}
+
+// Packs a package and embeds it in a bundle, then unbundles it.
+TEST_CASE("Pack_Good_BundleWithPayloadPackage", "[pack]")
+{
+    RunPackTest(S_OK, "input");
+
+    std::string outputBundle = "bundle.msixbundle";
+    std::string packageFullName;
+    {
+        auto packageStream = MsixTest::StreamFile(outputPackage, true);
+        MsixTest::ComPtr<IAppxPackageReader> packageReader;
+        MsixTest::InitializePackageReader(packageStream.Get(), &packageReader);
+        MsixTest::ComPtr<IAppxManifestReader> manifestReader;
+        REQUIRE_SUCCEEDED(packageReader->GetManifest(&manifestReader));
+        MsixTest::ComPtr<IAppxManifestPackageId> packageId;
+        REQUIRE_SUCCEEDED(manifestReader->GetPackageId(&packageId));
+        MsixTest::Wrappers::Buffer<wchar_t> fullName;
+        REQUIRE_SUCCEEDED(packageId->GetPackageFullName(&fullName));
+        packageFullName = fullName.ToString();
+
+        MsixTest::ComPtr<IAppxBundleFactory> bundleFactory;
+        REQUIRE_SUCCEEDED(CoCreateAppxBundleFactoryWithHeap(MsixTest::Allocators::Allocate, MsixTest::Allocators::Free,
+            MSIX_VALIDATION_OPTION::MSIX_VALIDATION_OPTION_SKIPSIGNATURE, MSIX_APPLICABILITY_OPTIONS::MSIX_APPLICABILITY_OPTION_FULL,
+            &bundleFactory));
+        auto bundleStream = MsixTest::StreamFile(outputBundle, false);
+        MsixTest::ComPtr<IAppxBundleWriter> bundleWriter;
+        REQUIRE_SUCCEEDED(bundleFactory->CreateBundleWriter(bundleStream.Get(), 0, &bundleWriter));
+        REQUIRE_SUCCEEDED(bundleWriter->AddPayloadPackage(L"package.msix", packageStream.Get()));
+        REQUIRE_SUCCEEDED(bundleWriter->Close());
+    }
+
+    auto outputDir = MsixTest::TestPath::GetInstance()->GetPath(MsixTest::TestPath::Directory::Output);
+    HRESULT actual = UnpackBundle(MSIX_PACKUNPACK_OPTION::MSIX_PACKUNPACK_OPTION_NONE,
+                                  MSIX_VALIDATION_OPTION::MSIX_VALIDATION_OPTION_SKIPSIGNATURE,
+                                  static_cast<MSIX_APPLICABILITY_OPTIONS>(MSIX_APPLICABILITY_NONE),
+                                  const_cast<char*>(outputBundle.c_str()),
+                                  const_cast<char*>(outputDir.c_str()));
+    CHECK(S_OK == actual);
+    MsixTest::Log::PrintMsixLog(S_OK, actual);
+
+    // The package is read in place from the bundle, its files must round trip.
+    auto files = MsixTest::Pack::GetExpectedFiles();
+    CHECK(MsixTest::Directory::CompareDirectory(outputDir + "/" + packageFullName, files));
+    CHECK(MsixTest::Directory::CleanDirectory(outputDir));
+    remove(outputBundle.c_str());
+}
+
 // Fail if there's no AppxManifest.xml
 TEST_CASE("Pack_AppxManifestNotPresent", "[pack]")
 {
@@ -143,6 +143,32 @@ TEST_CASE("Unbundle_StoreSigned_Desktop_x86_x64_MoviesTV_extract-all", "[unbundl
     CHECK(MsixTest::Directory::CleanDirectory(outputDir));
 }
 
+TEST_CASE("Unbundle_StoreSigned_Desktop_x86_x64_MoviesTV_parallel_extract-all", "[unbundle]")
+{
+    HRESULT expected = S_OK;
+    std::string bundle = "StoreSigned_Desktop_x86_x64_MoviesTV.appxbundle";
+    MSIX_VALIDATION_OPTION validation = MSIX_VALIDATION_OPTION_FULL;
+    MSIX_PACKUNPACK_OPTION packUnpack = MSIX_PACKUNPACK_OPTION_PARALLELUNPACK;
+    MSIX_APPLICABILITY_OPTIONS applicability = static_cast<MSIX_APPLICABILITY_OPTIONS>(MSIX_APPLICABILITY_NONE);
+
+    RunUnbundleTest(expected, bundle, validation, packUnpack, applicability, MsixTest::TestPath::Directory::Unbundle, false);
+
+    auto outputDir = MsixTest::TestPath::GetInstance()->GetPath(MsixTest::TestPath::Directory::Output);
+
+    // Packages extracted in parallel must produce the same files as the sequential extraction
+    auto files = MsixTest::Unbundle::GetExpectedFilesFullApplicable();
+    auto filesNotApplicable = MsixTest::Unbundle::GetExpectedFilesNoApplicable();
+
+    std::map<std::string, std::uint64_t> allFiles;
+    allFiles.insert(files.begin(), files.end());
+    allFiles.insert(filesNotApplicable.begin(), filesNotApplicable.end());
+
+    CHECK(MsixTest::Directory::CompareDirectory(outputDir, allFiles));
+
+    // Clean directory
+    CHECK(MsixTest::Directory::CleanDirectory(outputDir));
+}
+
 TEST_CASE("Unbundle_StoreSigned_Desktop_x86_x64_MoviesTV_pfn_extract-all", "[unbundle]")
 {
     HRESULT expected = S_OK;
@@ -388,6 +414,28 @@ TEST_CASE("Unbundle_BundleWithIntlPackage", "[unbundle]")
     RunUnbundleTest(expected, bundle, validation, packUnpack, applicability);
 }
 
+TEST_CASE("Unbundle_BundleWithIntlPackage_parallel", "[unbundle]")
+{
+    auto testData = MsixTest::TestPath::GetInstance();
+    auto bundlePath = testData->GetPath(MsixTest::TestPath::Directory::Unbundle) + "/BundleWithIntlPackage.appxbundle";
+    bundlePath = MsixTest::Directory::PathAsCurrentPlatform(bundlePath);
+    auto outputDir = testData->GetPath(MsixTest::TestPath::Directory::Output);
+    auto sequentialDir = MsixTest::Directory::PathAsCurrentPlatform(outputDir + "/sequential");
+    auto parallelDir = MsixTest::Directory::PathAsCurrentPlatform(outputDir + "/parallel");
+    MSIX_APPLICABILITY_OPTIONS applicability = static_cast<MSIX_APPLICABILITY_OPTIONS>(MSIX_APPLICABILITY_NONE);
+
+    REQUIRE_SUCCEEDED(UnpackBundle(MSIX_PACKUNPACK_OPTION_NONE, MSIX_VALIDATION_OPTION_SKIPSIGNATURE,
+        applicability, const_cast<char*>(bundlePath.c_str()), const_cast<char*>(sequentialDir.c_str())));
+    REQUIRE_SUCCEEDED(UnpackBundle(MSIX_PACKUNPACK_OPTION_PARALLELUNPACK, MSIX_VALIDATION_OPTION_SKIPSIGNATURE,
+        applicability, const_cast<char*>(bundlePath.c_str()), const_cast<char*>(parallelDir.c_str())));
+
+    // Packages extracted in parallel must produce the same files as the sequential extraction
+    CHECK(MsixTest::Directory::CompareDirectories(sequentialDir, parallelDir));
+
+    // Clean directory
+    CHECK(MsixTest::Directory::CleanDirectory(outputDir));
+}
+
 TEST_CASE("Unbundle_FlatBundleWithAsset", "[unbundle][flat]")
 {
     HRESULT expected                         = S_OK;
@@ -118,6 +118,24 @@ TEST_CASE("Unpack_StoreSigned_Desktop_x64_MoviesTV_pfn-flat", "[unpack]")
     CHECK(MsixTest::Directory::CleanDirectory(outputDir));
 }
 
+TEST_CASE("Unpack_StoreSigned_Desktop_x64_MoviesTV_parallel", "[unpack]")
+{
+    HRESULT expected                  = S_OK;
+    std::string package               = "StoreSigned_Desktop_x64_MoviesTV.appx";
+    MSIX_VALIDATION_OPTION validation = MSIX_VALIDATION_OPTION_FULL;
+    MSIX_PACKUNPACK_OPTION packUnpack = MSIX_PACKUNPACK_OPTION_PARALLELUNPACK;
+
+    RunUnpackTest(expected, package, validation, packUnpack, false);
+
+    // Parallel extraction must produce the same files as the sequential one
+    auto files = MsixTest::Unpack::GetExpectedFiles();
+    auto outputDir = MsixTest::TestPath::GetInstance()->GetPath(MsixTest::TestPath::Directory::Output);
+    CHECK(MsixTest::Directory::CompareDirectory(outputDir, files));
+
+    // Clean directory
+    CHECK(MsixTest::Directory::CleanDirectory(outputDir));
+}
+
 TEST_CASE("Unpack_Empty", "[unpack]")
 {
     HRESULT expected                  = static_cast<HRESULT>(MSIX::Error::FileSeek);
@@ -148,6 +166,27 @@ TEST_CASE("Unpack_NotepadPlusPlus", "[unpack]")
     RunUnpackTest(expected, package, validation, packUnpack);
 }
 
+TEST_CASE("Unpack_NotepadPlusPlus_parallel", "[unpack]")
+{
+    auto testData = MsixTest::TestPath::GetInstance();
+    auto packagePath = testData->GetPath(MsixTest::TestPath::Directory::Unpack) + "/NotepadPlusPlus.appx";
+    packagePath = MsixTest::Directory::PathAsCurrentPlatform(packagePath);
+    auto outputDir = testData->GetPath(MsixTest::TestPath::Directory::Output);
+    auto sequentialDir = MsixTest::Directory::PathAsCurrentPlatform(outputDir + "/sequential");
+    auto parallelDir = MsixTest::Directory::PathAsCurrentPlatform(outputDir + "/parallel");
+
+    REQUIRE_SUCCEEDED(UnpackPackage(MSIX_PACKUNPACK_OPTION_NONE, MSIX_VALIDATION_OPTION_SKIPSIGNATURE,
+        const_cast<char*>(packagePath.c_str()), const_cast<char*>(sequentialDir.c_str())));
+    REQUIRE_SUCCEEDED(UnpackPackage(MSIX_PACKUNPACK_OPTION_PARALLELUNPACK, MSIX_VALIDATION_OPTION_SKIPSIGNATURE,
+        const_cast<char*>(packagePath.c_str()), const_cast<char*>(parallelDir.c_str())));
+
+    // Parallel extraction must produce the same files as the sequential one
+    CHECK(MsixTest::Directory::CompareDirectories(sequentialDir, parallelDir));
+
+    // Clean directory
+    CHECK(MsixTest::Directory::CleanDirectory(outputDir));
+}
+
 TEST_CASE("Unpack_IntlPackage", "[unpack]")
 {
     HRESULT expected                  = S_OK;
@@ -236,6 +275,39 @@ TEST_CASE("Unpack_TestAppxPackage_x64", "[unpack]")
     RunUnpackTest(expected, package, validation, packUnpack);
 }
 
+TEST_CASE("Unpack_VerifyContainerDigests", "[unpack]")
+{
+    HRESULT expected                  = S_OK;
+    std::string package               = "TestAppxPackage_Win32.appx";
+    MSIX_VALIDATION_OPTION validation = static_cast<MSIX_VALIDATION_OPTION>(
+        MSIX_VALIDATION_OPTION_ALLOWSIGNATUREORIGINUNKNOWN | MSIX_VALIDATION_OPTION_VERIFYCONTAINERDIGESTS);
+    MSIX_PACKUNPACK_OPTION packUnpack = MSIX_PACKUNPACK_OPTION_NONE;
+
+    RunUnpackTest(expected, package, validation, packUnpack);
+}
+
+TEST_CASE("Unpack_VerifyContainerDigests_SignedTamperedCD", "[unpack]")
+{
+    HRESULT expected                  = static_cast<HRESULT>(MSIX::Error::SignatureInvalid);
+    std::string package               = "SignedTamperedCD-TRUST_E_BAD_DIGEST.appx";
+    MSIX_VALIDATION_OPTION validation = static_cast<MSIX_VALIDATION_OPTION>(
+        MSIX_VALIDATION_OPTION_ALLOWSIGNATUREORIGINUNKNOWN | MSIX_VALIDATION_OPTION_VERIFYCONTAINERDIGESTS);
+    MSIX_PACKUNPACK_OPTION packUnpack = MSIX_PACKUNPACK_OPTION_NONE;
+
+    RunUnpackTest(expected, package, validation, packUnpack);
+}
+
+TEST_CASE("Unpack_VerifyContainerDigests_SignatureNotLastPart", "[unpack]")
+{
+    HRESULT expected                  = static_cast<HRESULT>(MSIX::Error::SignatureInvalid);
+    std::string package               = "SignatureNotLastPart-ERROR_BAD_FORMAT.appx";
+    MSIX_VALIDATION_OPTION validation = static_cast<MSIX_VALIDATION_OPTION>(
+        MSIX_VALIDATION_OPTION_ALLOWSIGNATUREORIGINUNKNOWN | MSIX_VALIDATION_OPTION_VERIFYCONTAINERDIGESTS);
+    MSIX_PACKUNPACK_OPTION packUnpack = MSIX_PACKUNPACK_OPTION_NONE;
+
+    RunUnpackTest(expected, package, validation, packUnpack);
+}
+
 TEST_CASE("Unpack_UnsignedZip64WithCI-APPX_E_MISSING_REQUIRED_FILE", "[unpack]")
 {
     HRESULT expected                  = static_cast<HRESULT>(MSIX::Error::MissingAppxSignatureP7X);